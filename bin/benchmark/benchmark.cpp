@@ -0,0 +1,384 @@
+#include "waveguide/batch.h"
+#include "waveguide/boundary_layout.h"
+#include "waveguide/fitted_boundary.h"
+#include "waveguide/mesh.h"
+#include "waveguide/postprocessor/node.h"
+#include "waveguide/preprocessor/hard_source.h"
+#include "waveguide/pressure_precision.h"
+#include "waveguide/waveguide.h"
+
+#include "raytracer/image_source/tree.h"
+#include "raytracer/multitree.h"
+#include "raytracer/raytracer.h"
+#include "raytracer/reflection_processor/image_source.h"
+#include "raytracer/reflection_processor/stochastic_histogram.h"
+#include "raytracer/reflection_processor/visual.h"
+
+#include "core/azimuth_elevation.h"
+#include "core/callback_accumulator.h"
+#include "core/cl/work_group_tuner.h"
+#include "core/geo/box.h"
+#include "core/scene_data_loader.h"
+#include "core/spatial_division/voxel_collection.h"
+#include "core/spatial_division/voxelised_scene_data.h"
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+
+//  Times the parts of the simulation which can be run in more than one way.
+//  These are too slow, and too dependent on the machine, to be unit tests.
+//  Run with no arguments to time everything, or name the benchmarks to run.
+//  Kernels are launched with the runtime's default work-group sizes, rather
+//  than tuned ones, so that launches aren't held up to be timed and results
+//  don't depend on the tuner's cache file.
+//  Pass --local-size=<n> to pin every launch to n work-items instead.
+
+#ifndef OBJ_PATH
+#define OBJ_PATH ""
+#endif
+
+using namespace wayverb::waveguide;
+using namespace wayverb::core;
+namespace reflection_processor = wayverb::raytracer::reflection_processor;
+namespace image_source = wayverb::raytracer::image_source;
+
+namespace {
+
+template <typename Func>
+double time_us(const Func& func) {
+    const auto begin = std::chrono::steady_clock::now();
+    func();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+mesh make_box_mesh(const compute_context& cc,
+                   const glm::vec3& room,
+                   double sample_rate,
+                   cl_int brick_size = 0) {
+    const auto scene_data =
+            geo::get_scene_data(geo::box{glm::vec3{0}, room},
+                                make_surface<simulation_bands>(0.1, 0));
+    auto ret = compute_voxels_and_mesh(cc,
+                                       scene_data,
+                                       room * 0.5f,
+                                       sample_rate,
+                                       340,
+                                       node_classifier::scanline,
+                                       scheme::rectilinear,
+                                       brick_size)
+                       .mesh;
+    ret.set_coefficients(to_flat_coefficients(0.1));
+    return ret;
+}
+
+/// Runs an impulse through a mesh, and returns the time per step.
+double time_mesh(const compute_context& cc,
+                 const mesh& mesh,
+                 size_t steps,
+                 boundary_layout layout = boundary_layout::array_of_structs,
+                 pressure_precision precision = pressure_precision::single) {
+    const auto& descriptor = mesh.get_descriptor();
+    const auto source = compute_index(descriptor, glm::vec3{0.5, 0.75, 0.5});
+    const auto receiver = compute_index(descriptor, glm::vec3{1.5, 0.75, 0.5});
+
+    util::aligned::vector<float> input(steps, 0);
+    input.front() = 1;
+
+    callback_accumulator<postprocessor::node> output{receiver};
+    return time_us([&] {
+               run(cc,
+                   mesh,
+                   preprocessor::make_hard_source(
+                           source, begin(input), end(input)),
+                   [&](auto& queue, const auto& buffer, auto step) {
+                       output(queue, buffer, step);
+                   },
+                   true,
+                   mesh_state{},
+                   0,
+                   [](auto&&...) {},
+                   layout,
+                   precision);
+           }) /
+           steps;
+}
+
+void boundary_layouts() {
+    const compute_context cc{};
+    const auto mesh = make_box_mesh(cc, glm::vec3{2, 1.5, 1}, 40000);
+
+    std::cout << "array of structs: "
+              << time_mesh(cc, mesh, 500, boundary_layout::array_of_structs)
+              << " us per step\n";
+    std::cout << "struct of arrays: "
+              << time_mesh(cc, mesh, 500, boundary_layout::struct_of_arrays)
+              << " us per step\n";
+}
+
+void pressure_precisions() {
+    const compute_context cc{};
+    const auto mesh = make_box_mesh(cc, glm::vec3{2, 1.5, 1}, 10000);
+
+    for (const auto precision :
+         {pressure_precision::single, pressure_precision::half}) {
+        std::cout << (precision == pressure_precision::single ? "single: "
+                                                              : "half: ")
+                  << time_mesh(cc,
+                               mesh,
+                               500,
+                               boundary_layout::array_of_structs,
+                               precision)
+                  << " us per step\n";
+    }
+}
+
+void flat_multitrees() {
+    using path = util::aligned::vector<image_source::path_element>;
+
+    //  Random paths through a small room, a segment's worth at a time, like
+    //  the raytracer produces.
+    std::default_random_engine engine{0};
+    std::uniform_int_distribution<cl_uint> triangle{0, 11};
+    std::uniform_int_distribution<size_t> length{0, 10};
+    std::bernoulli_distribution visible{0.5};
+
+    constexpr size_t segment = 1 << 14;
+    util::aligned::vector<util::aligned::vector<path>> segments(8);
+    for (auto& i : segments) {
+        i.resize(segment);
+        for (auto& j : i) {
+            j.resize(length(engine));
+            for (auto& k : j) {
+                k = image_source::path_element{triangle(engine),
+                                               visible(engine)};
+            }
+        }
+    }
+
+    const auto count_nodes = [](size_t& nodes) {
+        struct counter final {
+            size_t& nodes;
+            counter operator()(const image_source::path_element&) const {
+                nodes += 1;
+                return *this;
+            }
+        };
+        return counter{nodes};
+    };
+
+    wayverb::raytracer::multitree<image_source::path_element> reference{};
+    const auto reference_build = time_us([&] {
+        for (const auto& i : segments) {
+            for (const auto& j : i) {
+                add_path(reference, j.begin(), j.end());
+            }
+        }
+    });
+    size_t reference_nodes = 0;
+    const auto reference_traverse = time_us([&] {
+        traverse_multitree(reference, count_nodes(reference_nodes));
+    });
+
+    image_source::tree paths{};
+    wayverb::raytracer::flat_multitree<image_source::path_element> flat{};
+    const auto flat_build = time_us([&] {
+        for (const auto& i : segments) {
+            paths.push(i);
+        }
+        flat = paths.build();
+    });
+    size_t flat_nodes = 0;
+    const auto flat_traverse = time_us(
+            [&] { traverse_multitree(flat, count_nodes(flat_nodes)); });
+
+    std::cout << "multitree: " << reference_nodes << " nodes, build "
+              << reference_build / 1000 << " ms, traverse "
+              << reference_traverse / 1000 << " ms\n";
+    std::cout << "flat: " << flat_nodes << " nodes, build "
+              << flat_build / 1000 << " ms, traverse "
+              << flat_traverse / 1000 << " ms\n";
+}
+
+void node_layouts() {
+    const compute_context cc{};
+    for (const auto brick_size : {0, 4, 8, 16}) {
+        const auto mesh =
+                make_box_mesh(cc, glm::vec3{6, 4, 3}, 20000, brick_size);
+        std::cout << "brick size " << brick_size << ": "
+                  << time_mesh(cc, mesh, 200) << " us per step\n";
+    }
+}
+
+void batch_sizes() {
+    const compute_context cc{};
+    const auto mesh = make_box_mesh(cc, glm::vec3{2, 1.5, 1}, 10000);
+    const auto& descriptor = mesh.get_descriptor();
+    constexpr auto steps = 200;
+
+    util::aligned::vector<cl_float> signal(steps, 0);
+    signal.front() = 1;
+
+    util::aligned::vector<batch_source> sources;
+    for (auto i = 0; i != 8; ++i) {
+        sources.emplace_back(batch_source{
+                compute_index(descriptor, glm::vec3{0.2 + 0.2 * i, 0.75, 0.5}),
+                signal});
+    }
+    const util::aligned::vector<size_t> probes{
+            compute_index(descriptor, glm::vec3{1, 0.75, 0.5})};
+
+    for (const auto batch_size : {1, 2, 4, 8}) {
+        std::cout << "batch size " << batch_size << ": "
+                  << time_us([&] {
+                         run_batch(cc,
+                                   mesh,
+                                   sources,
+                                   probes,
+                                   true,
+                                   pressure_precision::single,
+                                   batch_size);
+                     }) / (steps * sources.size())
+                  << " us per source per step\n";
+    }
+}
+
+void filter_orders() {
+    const compute_context cc{};
+    constexpr auto sample_rate = 10000.0;
+    auto mesh = make_box_mesh(cc, glm::vec3{2, 1.5, 1}, sample_rate);
+
+    const std::array<double, simulation_bands> sloped_absorption{
+            {0.05, 0.1, 0.2, 0.4, 0.6, 0.7, 0.8, 0.9}};
+    mesh.set_coefficients(
+            to_impedance_coefficients(compute_reflectance_filter_coefficients(
+                    sloped_absorption, sample_rate, 0)));
+    std::cout << "full order: "
+              << time_mesh(cc, mesh, 500, boundary_layout::struct_of_arrays)
+              << " us per step\n";
+
+    mesh.set_coefficients(to_flat_coefficients(0.1));
+    std::cout << "order 0: "
+              << time_mesh(cc, mesh, 500, boundary_layout::struct_of_arrays)
+              << " us per step\n";
+}
+
+void segments_in_flight() {
+    const auto voxelised = make_voxelised_scene_data(
+            geo::get_scene_data(geo::box{glm::vec3{0}, glm::vec3{4, 3, 6}},
+                                make_surface<simulation_bands>(0.1, 0)),
+            5,
+            0.1f);
+    const compute_context cc{};
+    const glm::vec3 source{1, 2, 1};
+    const glm::vec3 receiver{2, 1, 5};
+    const environment env{};
+    const auto directions = get_random_directions(3 * (1 << 14) + 1000);
+
+    const auto processors = std::make_tuple(
+            reflection_processor::make_image_source{3},
+            reflection_processor::make_stochastic_histogram{
+                    directions.size(), 3, 0.5f, 1000.0f},
+            reflection_processor::make_visual{10});
+
+    for (const auto in_flight : {1u, 2u, 4u}) {
+        const auto time = time_us([&] {
+            wayverb::raytracer::run(begin(directions),
+                                    end(directions),
+                                    cc,
+                                    voxelised,
+                                    source,
+                                    receiver,
+                                    env,
+                                    true,
+                                    [](auto, auto) {},
+                                    processors,
+                                    in_flight);
+        });
+        std::cout << in_flight << " in flight: " << time / 1.0e6 << " s\n";
+    }
+}
+
+void voxelise() {
+    const auto scene = *scene_data_loader{OBJ_PATH}.get_scene_data();
+    const auto aabb = padded(geo::compute_aabb(scene.get_vertices()),
+                             glm::vec3{0.1f});
+    constexpr auto depth = 5;
+
+    //  The simple way: on one thread, with the full overlap test for every
+    //  triangle.
+    const auto reference = [&] {
+        util::aligned::vector<size_t> indices(scene.get_triangles().size());
+        std::iota(indices.begin(), indices.end(), 0);
+
+        const ndim_tree<3>::item_checker checker = [&](auto item,
+                                                       const auto& voxel) {
+            return geo::overlaps(padded(voxel, glm::vec3{0.001}),
+                                 geo::get_triangle_vec3(
+                                         scene.get_triangles()[item],
+                                         scene.get_vertices().data()));
+        };
+        voxel_collection<3>{ndim_tree<3>{depth, checker, indices, aabb, 0}};
+    };
+
+    const auto parallel = [&] {
+        make_voxelised_scene_data(scene, depth, aabb);
+    };
+
+    std::cout << "reference: " << time_us(reference) / 1000 << " ms\n";
+    std::cout << "parallel: " << time_us(parallel) / 1000 << " ms\n";
+}
+
+const std::map<std::string, std::function<void()>> benchmarks{
+        {"batch", batch_sizes},
+        {"boundary_layout", boundary_layouts},
+        {"filter_order", filter_orders},
+        {"flat_multitree", flat_multitrees},
+        {"node_layout", node_layouts},
+        {"pressure_precision", pressure_precisions},
+        {"segments_in_flight", segments_in_flight},
+        {"voxelise", voxelise}};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    try {
+        size_t local_size = 0;
+        std::vector<std::string> names;
+        const std::string local_size_flag{"--local-size="};
+        for (auto i = argv + 1; i != argv + argc; ++i) {
+            const std::string arg{*i};
+            if (arg.compare(0, local_size_flag.size(), local_size_flag) == 0) {
+                local_size = std::stoul(arg.substr(local_size_flag.size()));
+            } else {
+                names.emplace_back(arg);
+            }
+        }
+        get_work_group_tuner().set_override(local_size);
+
+        if (names.empty()) {
+            for (const auto& i : benchmarks) {
+                names.emplace_back(i.first);
+            }
+        }
+
+        for (const auto& i : names) {
+            const auto it = benchmarks.find(i);
+            if (it == benchmarks.end()) {
+                throw std::runtime_error{"No benchmark called " + i};
+            }
+            std::cout << "## " << i << '\n';
+            it->second();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -58,8 +58,7 @@ auto produce_histogram(
     for (auto i = 0ul; i != 100; ++i) {
         const auto reflections = ref.run_step(buffers);
 
-        const auto output =
-                finder.process(begin(reflections), end(reflections), buffers);
+        const auto output = finder.process(reflections, buffers);
         const auto to_histogram = [&](auto& in) {
             const auto make_iterator = [&](auto it) {
                 return wayverb::raytracer::make_histogram_iterator(
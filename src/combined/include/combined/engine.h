@@ -2,6 +2,8 @@
 
 #include "raytracer/cl/reflection.h"
 
+#include "waveguide/snapshot.h"
+
 #include "core/gpu_scene_data.h"
 
 #include "utilities/aligned/vector.h"
@@ -29,6 +31,7 @@ struct simulation_parameters;
 }  // namespace raytracer
 namespace waveguide {
 struct voxels_and_mesh;
+struct reflectance_filter_cache_statistics;
 }  // namespace waveguide
 namespace combined {
 class waveguide_base;
@@ -111,6 +114,10 @@ public:
     using waveguide_node_pressures_changed =
             util::event<util::aligned::vector<float>, double>;
 
+    /// Args: Selected node pressures, total distanced travelled by sound wave.
+    using waveguide_pressure_snapshot_taken =
+            util::event<waveguide::pressure_snapshot, double>;
+
     /// Args: Current reflections, source position.
     using raytracer_reflections_generated = util::event<
             util::aligned::vector<util::aligned::vector<raytracer::reflection>>,
@@ -119,6 +126,10 @@ public:
     engine_state_changed::connection connect_engine_state_changed(
             engine_state_changed::callback_type callback);
 
+    /// While anything is connected, the whole mesh is read back every step,
+    /// which is very slow for large meshes.
+    /// Only connect if every node is really needed - otherwise, use
+    /// connect_waveguide_pressure_snapshot_taken.
     waveguide_node_pressures_changed::connection
     connect_waveguide_node_pressures_changed(
             waveguide_node_pressures_changed::callback_type callback);
@@ -127,10 +138,83 @@ public:
     connect_raytracer_reflections_generated(
             raytracer_reflections_generated::callback_type callback);
 
+    /// A much cheaper alternative to waveguide_node_pressures_changed.
+    /// The snapshot is taken on the device, and only the requested nodes
+    /// are copied back, at the requested rate.
+    /// Each listener may ask for a different region and rate.
+    /// The parameters must describe a valid region of the engine's mesh (see
+    /// get_voxels_and_mesh).
+    waveguide_pressure_snapshot_taken::connection
+    connect_waveguide_pressure_snapshot_taken(
+            const waveguide::snapshot_parameters& parameters,
+            waveguide_pressure_snapshot_taken::callback_type callback);
+
     //  cached data  ///////////////////////////////////////////////////////////
 
     const waveguide::voxels_and_mesh& get_voxels_and_mesh() const;
 
+    /// Reflectance filter cache hits, misses, and fit time for this engine's
+    /// mesh.
+    /// Meshes for later source-receiver pairs should be all hits.
+    const waveguide::reflectance_filter_cache_statistics&
+    get_reflectance_filter_statistics() const;
+
+private:
+    class impl;
+    std::unique_ptr<impl> pimpl_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Like engine, for several sources and one receiver.
+/// The mesh is anchored on the receiver, so all the sources share it, and it
+/// is only built once.
+/// The sources are raytraced one at a time, and then their waveguide
+/// simulations are run together (see waveguide_base::run_batch).
+///
+/// There are no per-step waveguide notifications, because no single source's
+/// pressures are ever on the device on their own.
+/// Use engine to visualise the waveguide.
+class batch_engine final {
+public:
+    batch_engine(const core::compute_context& compute_context,
+                 const core::gpu_scene_data& scene_data,
+                 util::aligned::vector<glm::vec3> sources,
+                 const glm::vec3& receiver,
+                 const core::environment& environment,
+                 const raytracer::simulation_parameters& raytracer,
+                 std::unique_ptr<waveguide_base> waveguide);
+
+    ~batch_engine() noexcept;
+
+    /// Returns results for each source, in order, or an empty vector if the
+    /// run was cancelled.
+    util::aligned::vector<std::unique_ptr<intermediate>> run(
+            const std::atomic_bool& keep_going) const;
+
+    //  notifications  /////////////////////////////////////////////////////////
+
+    /// Args: Source index, current engine state, progress within state.
+    using engine_state_changed = util::event<size_t, state, double>;
+
+    using raytracer_reflections_generated =
+            engine::raytracer_reflections_generated;
+
+    engine_state_changed::connection connect_engine_state_changed(
+            engine_state_changed::callback_type callback);
+
+    raytracer_reflections_generated::connection
+    connect_raytracer_reflections_generated(
+            raytracer_reflections_generated::callback_type callback);
+
+    //  cached data  ///////////////////////////////////////////////////////////
+
+    const waveguide::voxels_and_mesh& get_voxels_and_mesh() const;
+
+    /// See engine::get_reflectance_filter_statistics.
+    const waveguide::reflectance_filter_cache_statistics&
+    get_reflectance_filter_statistics() const;
+
 private:
     class impl;
     std::unique_ptr<impl> pimpl_;
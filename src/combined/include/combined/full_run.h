@@ -89,6 +89,8 @@ public:
             engine::waveguide_node_pressures_changed;
     using raytracer_reflections_generated =
             engine::raytracer_reflections_generated;
+    using waveguide_pressure_snapshot_taken =
+            engine::waveguide_pressure_snapshot_taken;
 
     engine_state_changed::connection connect_engine_state_changed(
             engine_state_changed::callback_type callback);
@@ -101,10 +103,19 @@ public:
     connect_raytracer_reflections_generated(
             raytracer_reflections_generated::callback_type callback);
 
+    /// See engine::connect_waveguide_pressure_snapshot_taken.
+    waveguide_pressure_snapshot_taken::connection
+    connect_waveguide_pressure_snapshot_taken(
+            const waveguide::snapshot_parameters& parameters,
+            waveguide_pressure_snapshot_taken::callback_type callback);
+
     //  get contents
 
     const waveguide::voxels_and_mesh& get_voxels_and_mesh() const;
 
+    const waveguide::reflectance_filter_cache_statistics&
+    get_reflectance_filter_statistics() const;
+
 private:
     engine engine_;
 
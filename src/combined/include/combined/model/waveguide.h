@@ -6,12 +6,26 @@
 
 #include "hrtf/multiband.h"
 
+#include "cereal/cereal.hpp"
 #include "cereal/types/base_class.hpp"
 
+#include <cstdint>
+
+namespace cereal {
+class JSONInputArchive;
+}  // namespace cereal
+
 namespace wayverb {
 namespace combined {
 namespace model {
 
+/// Projects are saved as JSON, and projects saved before a class was
+/// versioned have no version number.
+/// cereal won't load those, so versioned classes load JSON by hand.
+template <typename Archive>
+constexpr auto is_json_input_v =
+        std::is_same<Archive, cereal::JSONInputArchive>::value;
+
 class single_band_waveguide final : public basic_member<single_band_waveguide> {
 public:
     explicit single_band_waveguide(double cutoff = 500,
@@ -19,14 +33,21 @@ public:
 
     void set_cutoff(double cutoff);
     void set_usable_portion(double usable);
+    void set_scheme(waveguide::scheme scheme);
 
     waveguide::single_band_parameters get() const;
 
-    template <typename Archive>
-    void serialize(Archive& archive) {
+    template <typename Archive,
+              std::enable_if_t<!is_json_input_v<Archive>, int> = 0>
+    void serialize(Archive& archive, std::uint32_t const version) {
         archive(data_.cutoff, data_.usable_portion);
+        if (version >= 1) {
+            archive(data_.scheme);
+        }
     }
 
+    void load(cereal::JSONInputArchive& archive);
+
     NOTIFYING_COPY_ASSIGN_DECLARATION(single_band_waveguide)
 private:
     inline void swap(single_band_waveguide& other) noexcept {
@@ -52,14 +73,21 @@ public:
     void set_bands(size_t bands);
     void set_cutoff(double cutoff);
     void set_usable_portion(double usable);
+    void set_scheme(waveguide::scheme scheme);
 
     waveguide::multiple_band_constant_spacing_parameters get() const;
 
-    template <typename Archive>
-    void serialize(Archive& archive) {
+    template <typename Archive,
+              std::enable_if_t<!is_json_input_v<Archive>, int> = 0>
+    void serialize(Archive& archive, std::uint32_t const version) {
         archive(data_.bands, data_.cutoff, data_.usable_portion);
+        if (version >= 1) {
+            archive(data_.scheme);
+        }
     }
 
+    void load(cereal::JSONInputArchive& archive);
+
     NOTIFYING_COPY_ASSIGN_DECLARATION(multiple_band_waveguide)
 private:
     inline void swap(multiple_band_waveguide& other) noexcept {
@@ -130,3 +158,7 @@ double compute_sampling_frequency(const waveguide& waveguide);
 }  // namespace model
 }  // namespace combined
 }  // namespace wayverb
+
+//  Version 1 adds the waveguide scheme.
+CEREAL_CLASS_VERSION(wayverb::combined::model::single_band_waveguide, 1);
+CEREAL_CLASS_VERSION(wayverb::combined::model::multiple_band_waveguide, 1);
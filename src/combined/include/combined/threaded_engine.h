@@ -5,7 +5,10 @@
 
 #include "waveguide/mesh_descriptor.h"
 
+#include <functional>
 #include <future>
+#include <list>
+#include <mutex>
 
 namespace wayverb {
 namespace combined {
@@ -15,6 +18,9 @@ namespace combined {
 ///     Simulate the scene.
 ///     Do microphone post-processing according to the receiver's capsules.
 ///     Cache the results.
+/// Sources with the same receiver share a mesh, and unless waveguide node
+/// pressures or snapshots are being listened for, their waveguide
+/// simulations are run together (see batch_engine).
 /// Once all outputs have been calculated:
 ///     Do global normalization.
 ///     Write files out.
@@ -43,6 +49,14 @@ public:
             postprocessing_engine::waveguide_node_pressures_changed;
     using raytracer_reflections_generated =
             postprocessing_engine::raytracer_reflections_generated;
+    using waveguide_pressure_snapshot_taken =
+            postprocessing_engine::waveguide_pressure_snapshot_taken;
+
+    /// Each source-receiver pair gets its own mesh, so snapshot regions are
+    /// chosen per-mesh.
+    using snapshot_parameters_factory =
+            std::function<waveguide::snapshot_parameters(
+                    const waveguide::mesh_descriptor&)>;
     using encountered_error = util::event<std::string>;
     using begun = util::event<>;
     using finished = util::event<>;
@@ -62,6 +76,11 @@ public:
             connect_raytracer_reflections_generated(
                     raytracer_reflections_generated::callback_type);
 
+    waveguide_pressure_snapshot_taken::connection
+            connect_waveguide_pressure_snapshot_taken(
+                    snapshot_parameters_factory,
+                    waveguide_pressure_snapshot_taken::callback_type);
+
     encountered_error::connection connect_encountered_error(
             encountered_error::callback_type);
 
@@ -74,11 +93,23 @@ private:
                 model::persistent persistent,
                 model::output output);
 
+    /// Drops snapshot subscriptions which have been disconnected, and
+    /// returns whether any are left.
+    bool has_snapshot_listeners();
+
     engine_state_changed engine_state_changed_;
     waveguide_node_positions_changed waveguide_node_positions_changed_;
     waveguide_node_pressures_changed waveguide_node_pressures_changed_;
     raytracer_reflections_generated raytracer_reflections_generated_;
     encountered_error encountered_error_;
+
+    struct snapshot_subscription final {
+        snapshot_parameters_factory factory;
+        waveguide_pressure_snapshot_taken event;
+    };
+    std::list<snapshot_subscription> snapshot_subscriptions_;
+    std::mutex snapshot_mutex_;
+
     begun begun_;
     finished finished_;
 
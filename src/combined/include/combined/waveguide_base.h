@@ -10,7 +10,6 @@
 //  forward declarations  //////////////////////////////////////////////////////
 
 namespace cl {
-class Buffer;
 class CommandQueue;
 }  // namespace cl
 
@@ -20,6 +19,10 @@ namespace waveguide {
 struct voxels_and_mesh;
 struct single_band_parameters;
 struct multiple_band_constant_spacing_parameters;
+struct multiple_band_variable_spacing_parameters;
+struct checkpoint_parameters;
+class pressure_buffer;
+enum class scheme;
 }  // namespace waveguide
 
 namespace core {
@@ -43,6 +46,7 @@ public:
     virtual std::unique_ptr<waveguide_base> clone() const = 0;
 
     virtual double compute_sampling_frequency() const = 0;
+    virtual waveguide::scheme get_scheme() const = 0;
 
     virtual std::optional<
             util::aligned::vector<waveguide::bandpass_band>>
@@ -54,15 +58,47 @@ public:
         double simulation_time,
         const std::atomic_bool& keep_going,
         std::function<void(cl::CommandQueue& queue,
-                           const cl::Buffer& buffer,
+                           const waveguide::pressure_buffer& buffer,
                            size_t step,
                            size_t steps)> pressure_callback) = 0;
+
+    /// Like run, for several sources and one receiver in the same mesh, each
+    /// with its own simulation time.
+    /// There's no pressure callback, because no single source's pressures
+    /// are ever on the device on their own.
+    ///
+    /// Returns the bands for each source, in order.
+    /// Each source's bands are identical to those from run.
+    /// By default, the sources are simply run one at a time.
+    virtual std::optional<util::aligned::vector<
+            util::aligned::vector<waveguide::bandpass_band>>>
+    run_batch(const core::compute_context& cc,
+              const waveguide::voxels_and_mesh& voxelised,
+              const util::aligned::vector<glm::vec3>& sources,
+              const glm::vec3& receiver,
+              const core::environment& environment,
+              const util::aligned::vector<double>& simulation_times,
+              const std::atomic_bool& keep_going);
 };
 
 std::unique_ptr<waveguide_base> make_waveguide_ptr(
         const waveguide::single_band_parameters& t);
 std::unique_ptr<waveguide_base> make_waveguide_ptr(
         const waveguide::multiple_band_constant_spacing_parameters& t);
+std::unique_ptr<waveguide_base> make_waveguide_ptr(
+        const waveguide::multiple_band_variable_spacing_parameters& t);
+
+/// Waveguides made with these overloads will periodically save their state,
+/// and will resume from a matching checkpoint if one exists.
+std::unique_ptr<waveguide_base> make_waveguide_ptr(
+        const waveguide::single_band_parameters& t,
+        const waveguide::checkpoint_parameters& checkpoint);
+std::unique_ptr<waveguide_base> make_waveguide_ptr(
+        const waveguide::multiple_band_constant_spacing_parameters& t,
+        const waveguide::checkpoint_parameters& checkpoint);
+std::unique_ptr<waveguide_base> make_waveguide_ptr(
+        const waveguide::multiple_band_variable_spacing_parameters& t,
+        const waveguide::checkpoint_parameters& checkpoint);
 
 }  // namespace combined
 }  // namespace wayverb
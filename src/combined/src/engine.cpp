@@ -3,6 +3,7 @@
 #include "combined/waveguide_base.h"
 
 #include "waveguide/mesh.h"
+#include "waveguide/pressure_precision.h"
 
 #include "raytracer/canonical.h"
 
@@ -13,6 +14,9 @@
 
 #include "glm/glm.hpp"
 
+#include <list>
+#include <mutex>
+
 namespace wayverb {
 namespace combined {
 
@@ -83,6 +87,47 @@ auto make_intermediate_impl_ptr(combined_results<Histogram> to_process,
                                                           environment);
 }
 
+/// The raytracer half of a run.
+/// Returns nullopt if the run was cancelled.
+template <typename StateCallback, typename ReflectionsCallback>
+auto run_raytracer(const core::compute_context& compute_context,
+                   const waveguide::voxels_and_mesh& voxels_and_mesh,
+                   const glm::vec3& source,
+                   const glm::vec3& receiver,
+                   const core::environment& environment,
+                   const raytracer::simulation_parameters& raytracer,
+                   const std::atomic_bool& keep_going,
+                   const StateCallback& state_changed,
+                   const ReflectionsCallback& reflections_generated) {
+    const auto rays_to_visualise = std::min(32ul, raytracer.rays);
+
+    state_changed(state::starting_raytracer, 1.0);
+
+    auto raytracer_output = raytracer::canonical(
+            compute_context,
+            voxels_and_mesh.voxels,
+            source,
+            receiver,
+            environment,
+            raytracer,
+            rays_to_visualise,
+            keep_going,
+            [&](auto step, auto total_steps) {
+                state_changed(state::running_raytracer,
+                              step / (total_steps - 1.0));
+            });
+
+    if (!(keep_going && raytracer_output)) {
+        return decltype(raytracer_output){};
+    }
+
+    state_changed(state::finishing_raytracer, 1.0);
+
+    reflections_generated(std::move(raytracer_output->visual), source);
+
+    return raytracer_output;
+}
+
 }  // namespace
 
 class engine::impl final {
@@ -100,7 +145,9 @@ public:
                       scene_data,
                       receiver,
                       waveguide->compute_sampling_frequency(),
-                      environment.speed_of_sound)}
+                      environment.speed_of_sound,
+                      waveguide::node_classifier::scanline,
+                      waveguide->get_scheme())}
             , room_volume_{estimate_volume(voxels_and_mesh_.mesh)}
             , source_{source}
             , receiver_{receiver}
@@ -112,34 +159,21 @@ public:
             const std::atomic_bool& keep_going) const {
         //  RAYTRACER  /////////////////////////////////////////////////////////
 
-        const auto rays_to_visualise = std::min(32ul, raytracer_.rays);
-
-        engine_state_changed_(state::starting_raytracer, 1.0);
-
-        auto raytracer_output = raytracer::canonical(
+        auto raytracer_output = run_raytracer(
                 compute_context_,
-                voxels_and_mesh_.voxels,
+                voxels_and_mesh_,
                 source_,
                 receiver_,
                 environment_,
                 raytracer_,
-                rays_to_visualise,
                 keep_going,
-                [&](auto step, auto total_steps) {
-                    engine_state_changed_(state::running_raytracer,
-                                          step / (total_steps - 1.0));
-                });
-
+                engine_state_changed_,
+                raytracer_reflections_generated_);
 
-        if (!(keep_going && raytracer_output)) {
+        if (!raytracer_output) {
             return nullptr;
         }
 
-        engine_state_changed_(state::finishing_raytracer, 1.0);
-
-        raytracer_reflections_generated_(std::move(raytracer_output->visual),
-                                         source_);
-
         //  look for the max time of an impulse
         const auto max_stochastic_time =
                 max_time(raytracer_output->aural.stochastic);
@@ -147,6 +181,25 @@ public:
         //  WAVEGUIDE  /////////////////////////////////////////////////////////
         engine_state_changed_(state::starting_waveguide, 1.0);
 
+        //  One device-side reader for each snapshot listener.
+        util::aligned::vector<
+                std::pair<const snapshot_subscription*,
+                          std::unique_ptr<waveguide::snapshot_reader>>>
+                snapshot_readers;
+        {
+            std::lock_guard<std::mutex> lck{snapshot_mutex_};
+            snapshot_subscriptions_.remove_if(
+                    [](const auto& i) { return i.event.empty(); });
+            for (const auto& i : snapshot_subscriptions_) {
+                snapshot_readers.emplace_back(
+                        &i,
+                        std::make_unique<waveguide::snapshot_reader>(
+                                compute_context_,
+                                voxels_and_mesh_.mesh.get_descriptor(),
+                                i.parameters));
+            }
+        }
+
         auto waveguide_output = waveguide_->run(
                 compute_context_,
                 voxels_and_mesh_,
@@ -156,18 +209,25 @@ public:
                 max_stochastic_time,
                 keep_going,
                 [&](auto& queue, const auto& buffer, auto step, auto steps) {
+                    const auto time =
+                            step / waveguide_->compute_sampling_frequency();
+                    const auto distance = time * environment_.speed_of_sound;
+
                     //  If there are node pressure listeners.
                     if (!waveguide_node_pressures_changed_.empty()) {
                         auto pressures =
-                                core::read_from_buffer<float>(queue, buffer);
-                        const auto time =
-                                step / waveguide_->compute_sampling_frequency();
-                        const auto distance =
-                                time * environment_.speed_of_sound;
+                                waveguide::read_pressures(queue, buffer);
                         waveguide_node_pressures_changed_(std::move(pressures),
                                                           distance);
                     }
 
+                    for (auto& i : snapshot_readers) {
+                        if (i.second->is_due(step) && !i.first->event.empty()) {
+                            i.first->event((*i.second)(queue, buffer, step),
+                                           distance);
+                        }
+                    }
+
                     engine_state_changed_(state::running_waveguide,
                                           step / (steps - 1.0));
                 });
@@ -206,12 +266,28 @@ public:
         return raytracer_reflections_generated_.connect(std::move(callback));
     }
 
+    waveguide_pressure_snapshot_taken::connection
+    connect_waveguide_pressure_snapshot_taken(
+            const waveguide::snapshot_parameters& parameters,
+            waveguide_pressure_snapshot_taken::callback_type callback) {
+        std::lock_guard<std::mutex> lck{snapshot_mutex_};
+        snapshot_subscriptions_.emplace_back();
+        snapshot_subscriptions_.back().parameters = parameters;
+        return snapshot_subscriptions_.back().event.connect(
+                std::move(callback));
+    }
+
     //  cached data  ///////////////////////////////////////////////////////////
 
     const waveguide::voxels_and_mesh& get_voxels_and_mesh() const {
         return voxels_and_mesh_;
     }
 
+    const waveguide::reflectance_filter_cache_statistics&
+    get_reflectance_filter_statistics() const {
+        return voxels_and_mesh_.filter_statistics;
+    }
+
 private:
     core::compute_context compute_context_;
     waveguide::voxels_and_mesh voxels_and_mesh_;
@@ -225,6 +301,16 @@ private:
     engine_state_changed engine_state_changed_;
     waveguide_node_pressures_changed waveguide_node_pressures_changed_;
     raytracer_reflections_generated raytracer_reflections_generated_;
+
+    /// Each snapshot listener gets its own event, so that it can have its own
+    /// parameters.
+    /// Stored in a list so that addresses are stable.
+    struct snapshot_subscription final {
+        waveguide::snapshot_parameters parameters;
+        waveguide_pressure_snapshot_taken event;
+    };
+    mutable std::list<snapshot_subscription> snapshot_subscriptions_;
+    mutable std::mutex snapshot_mutex_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -269,9 +355,195 @@ engine::connect_raytracer_reflections_generated(
     return pimpl_->connect_raytracer_reflections_generated(std::move(callback));
 }
 
+engine::waveguide_pressure_snapshot_taken::connection
+engine::connect_waveguide_pressure_snapshot_taken(
+        const waveguide::snapshot_parameters& parameters,
+        waveguide_pressure_snapshot_taken::callback_type callback) {
+    return pimpl_->connect_waveguide_pressure_snapshot_taken(
+            parameters, std::move(callback));
+}
+
 const waveguide::voxels_and_mesh& engine::get_voxels_and_mesh() const {
     return pimpl_->get_voxels_and_mesh();
 }
 
+const waveguide::reflectance_filter_cache_statistics&
+engine::get_reflectance_filter_statistics() const {
+    return pimpl_->get_reflectance_filter_statistics();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+class batch_engine::impl final {
+public:
+    impl(const core::compute_context& compute_context,
+         const core::gpu_scene_data& scene_data,
+         util::aligned::vector<glm::vec3> sources,
+         const glm::vec3& receiver,
+         const core::environment& environment,
+         const raytracer::simulation_parameters& raytracer,
+         std::unique_ptr<waveguide_base> waveguide)
+            : compute_context_{compute_context}
+            , voxels_and_mesh_{waveguide::compute_voxels_and_mesh(
+                      compute_context,
+                      scene_data,
+                      receiver,
+                      waveguide->compute_sampling_frequency(),
+                      environment.speed_of_sound,
+                      waveguide::node_classifier::scanline,
+                      waveguide->get_scheme())}
+            , room_volume_{estimate_volume(voxels_and_mesh_.mesh)}
+            , sources_{std::move(sources)}
+            , receiver_{receiver}
+            , environment_{environment}
+            , raytracer_{raytracer}
+            , waveguide_{std::move(waveguide)} {}
+
+    util::aligned::vector<std::unique_ptr<intermediate>> run(
+            const std::atomic_bool& keep_going) const {
+        //  RAYTRACER  /////////////////////////////////////////////////////////
+
+        const auto trace = [&](size_t source) {
+            return run_raytracer(
+                    compute_context_,
+                    voxels_and_mesh_,
+                    sources_[source],
+                    receiver_,
+                    environment_,
+                    raytracer_,
+                    keep_going,
+                    [&](auto state, auto progress) {
+                        engine_state_changed_(source, state, progress);
+                    },
+                    raytracer_reflections_generated_);
+        };
+
+        util::aligned::vector<decltype(trace(0)->aural)> raytracer_outputs;
+        util::aligned::vector<double> simulation_times;
+        for (auto i = 0u; i != sources_.size(); ++i) {
+            auto raytracer_output = trace(i);
+            if (!raytracer_output) {
+                return {};
+            }
+            simulation_times.emplace_back(
+                    max_time(raytracer_output->aural.stochastic));
+            raytracer_outputs.emplace_back(std::move(raytracer_output->aural));
+        }
+
+        //  WAVEGUIDE  /////////////////////////////////////////////////////////
+
+        for (auto i = 0u; i != sources_.size(); ++i) {
+            engine_state_changed_(i, state::starting_waveguide, 1.0);
+        }
+
+        auto waveguide_output = waveguide_->run_batch(compute_context_,
+                                                      voxels_and_mesh_,
+                                                      sources_,
+                                                      receiver_,
+                                                      environment_,
+                                                      simulation_times,
+                                                      keep_going);
+
+        if (!(keep_going && waveguide_output)) {
+            return {};
+        }
+
+        util::aligned::vector<std::unique_ptr<intermediate>> ret;
+        for (auto i = 0u; i != sources_.size(); ++i) {
+            engine_state_changed_(i, state::finishing_waveguide, 1.0);
+            ret.emplace_back(make_intermediate_impl_ptr(
+                    make_combined_results(std::move(raytracer_outputs[i]),
+                                          std::move((*waveguide_output)[i])),
+                    sources_[i],
+                    receiver_,
+                    room_volume_,
+                    environment_));
+        }
+        return ret;
+    }
+
+    //  notifications  /////////////////////////////////////////////////////////
+
+    engine_state_changed::connection connect_engine_state_changed(
+            engine_state_changed::callback_type callback) {
+        return engine_state_changed_.connect(std::move(callback));
+    }
+
+    raytracer_reflections_generated::connection
+    connect_raytracer_reflections_generated(
+            raytracer_reflections_generated::callback_type callback) {
+        return raytracer_reflections_generated_.connect(std::move(callback));
+    }
+
+    //  cached data  ///////////////////////////////////////////////////////////
+
+    const waveguide::voxels_and_mesh& get_voxels_and_mesh() const {
+        return voxels_and_mesh_;
+    }
+
+    const waveguide::reflectance_filter_cache_statistics&
+    get_reflectance_filter_statistics() const {
+        return voxels_and_mesh_.filter_statistics;
+    }
+
+private:
+    core::compute_context compute_context_;
+    waveguide::voxels_and_mesh voxels_and_mesh_;
+    double room_volume_;
+    util::aligned::vector<glm::vec3> sources_;
+    glm::vec3 receiver_;
+    core::environment environment_;
+    raytracer::simulation_parameters raytracer_;
+    std::unique_ptr<waveguide_base> waveguide_;
+
+    engine_state_changed engine_state_changed_;
+    raytracer_reflections_generated raytracer_reflections_generated_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+batch_engine::batch_engine(const core::compute_context& compute_context,
+                           const core::gpu_scene_data& scene_data,
+                           util::aligned::vector<glm::vec3> sources,
+                           const glm::vec3& receiver,
+                           const core::environment& environment,
+                           const raytracer::simulation_parameters& raytracer,
+                           std::unique_ptr<waveguide_base> waveguide)
+        : pimpl_{std::make_unique<impl>(compute_context,
+                                        scene_data,
+                                        std::move(sources),
+                                        receiver,
+                                        environment,
+                                        raytracer,
+                                        std::move(waveguide))} {}
+
+batch_engine::~batch_engine() noexcept = default;
+
+util::aligned::vector<std::unique_ptr<intermediate>> batch_engine::run(
+        const std::atomic_bool& keep_going) const {
+    return pimpl_->run(keep_going);
+}
+
+batch_engine::engine_state_changed::connection
+batch_engine::connect_engine_state_changed(
+        engine_state_changed::callback_type callback) {
+    return pimpl_->connect_engine_state_changed(std::move(callback));
+}
+
+batch_engine::raytracer_reflections_generated::connection
+batch_engine::connect_raytracer_reflections_generated(
+        raytracer_reflections_generated::callback_type callback) {
+    return pimpl_->connect_raytracer_reflections_generated(std::move(callback));
+}
+
+const waveguide::voxels_and_mesh& batch_engine::get_voxels_and_mesh() const {
+    return pimpl_->get_voxels_and_mesh();
+}
+
+const waveguide::reflectance_filter_cache_statistics&
+batch_engine::get_reflectance_filter_statistics() const {
+    return pimpl_->get_reflectance_filter_statistics();
+}
+
 }  // namespace combined
 }  // namespace wayverb
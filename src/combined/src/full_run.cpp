@@ -38,6 +38,14 @@ postprocessing_engine::connect_raytracer_reflections_generated(
     return raytracer_reflections_generated_.connect(std::move(callback));
 }
 
+postprocessing_engine::waveguide_pressure_snapshot_taken::connection
+postprocessing_engine::connect_waveguide_pressure_snapshot_taken(
+        const waveguide::snapshot_parameters& parameters,
+        waveguide_pressure_snapshot_taken::callback_type callback) {
+    return engine_.connect_waveguide_pressure_snapshot_taken(
+            parameters, std::move(callback));
+}
+
 //  get contents
 
 const waveguide::voxels_and_mesh& postprocessing_engine::get_voxels_and_mesh()
@@ -45,5 +53,10 @@ const waveguide::voxels_and_mesh& postprocessing_engine::get_voxels_and_mesh()
     return engine_.get_voxels_and_mesh();
 }
 
+const waveguide::reflectance_filter_cache_statistics&
+postprocessing_engine::get_reflectance_filter_statistics() const {
+    return engine_.get_reflectance_filter_statistics();
+}
+
 }  // namespace combined
 }  // namespace wayverb
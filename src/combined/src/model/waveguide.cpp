@@ -4,10 +4,36 @@
 
 #include "utilities/range.h"
 
+#include "cereal/archives/json.hpp"
+
+#include <cstring>
+
 namespace wayverb {
 namespace combined {
 namespace model {
 
+namespace {
+
+/// cereal stores a class's version with the first instance of that class in
+/// an archive, so a missing version means either an old project (version 0)
+/// or a later instance.
+/// Later instances are told apart by checking whether there are any values
+/// left to read.
+std::uint32_t load_class_version(cereal::JSONInputArchive& archive) {
+    std::uint32_t ret = 0;
+    const auto name = archive.getNodeName();
+    if (name && std::strcmp(name, "cereal_class_version") == 0) {
+        archive(cereal::make_nvp("cereal_class_version", ret));
+    }
+    return ret;
+}
+
+bool has_more_values(cereal::JSONInputArchive& archive) {
+    return archive.getNodeName() != nullptr;
+}
+
+}  // namespace
+
 single_band_waveguide::single_band_waveguide(double cutoff,
                                              double usable_portion)
         : data_{cutoff, usable_portion} {}
@@ -22,6 +48,20 @@ void single_band_waveguide::set_usable_portion(double usable) {
     notify();
 }
 
+void single_band_waveguide::set_scheme(wayverb::waveguide::scheme scheme) {
+    data_.scheme = scheme;
+    notify();
+}
+
+void single_band_waveguide::load(cereal::JSONInputArchive& archive) {
+    const auto version = load_class_version(archive);
+    archive(data_.cutoff, data_.usable_portion);
+    data_.scheme = wayverb::waveguide::scheme::rectilinear;
+    if (version >= 1 || has_more_values(archive)) {
+        archive(data_.scheme);
+    }
+}
+
 wayverb::waveguide::single_band_parameters single_band_waveguide::get() const {
     return data_;
 }
@@ -60,6 +100,20 @@ void multiple_band_waveguide::set_usable_portion(double usable) {
     notify();
 }
 
+void multiple_band_waveguide::set_scheme(wayverb::waveguide::scheme scheme) {
+    data_.scheme = scheme;
+    notify();
+}
+
+void multiple_band_waveguide::load(cereal::JSONInputArchive& archive) {
+    const auto version = load_class_version(archive);
+    archive(data_.bands, data_.cutoff, data_.usable_portion);
+    data_.scheme = wayverb::waveguide::scheme::rectilinear;
+    if (version >= 1 || has_more_values(archive)) {
+        archive(data_.scheme);
+    }
+}
+
 wayverb::waveguide::multiple_band_constant_spacing_parameters
 multiple_band_waveguide::get() const {
     return data_;
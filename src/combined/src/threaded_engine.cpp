@@ -29,6 +29,14 @@ struct channel_info final {
     std::string file_name;
 };
 
+template <typename Engine>
+void print_filter_statistics(const Engine& eng) {
+    const auto& filters = eng.get_reflectance_filter_statistics();
+    std::cout << "boundary filters: " << filters.hits << " cached, "
+              << filters.misses << " fitted in " << filters.fit_time << "s"
+              << std::endl;
+}
+
 }  // namespace
 
 std::unique_ptr<capsule_base> polymorphic_capsule_model(
@@ -151,100 +159,211 @@ void complete_engine::do_run(core::compute_context compute_context,
         const auto runs = persistent.sources().item()->size() *
                           persistent.receivers().item()->size();
 
-        auto run = 0;
+        const auto make_capsules = [](const model::receiver& receiver) {
+            return util::map_to_vector(
+                    std::begin(*receiver.capsules().item()),
+                    std::end(*receiver.capsules().item()),
+                    [&](const auto& i) {
+                        return polymorphic_capsule_model(
+                                *i.item(), receiver.get_orientation());
+                    });
+        };
+
+        const auto add_channels =
+                [&](const model::source& source,
+                    const model::receiver& receiver,
+                    util::aligned::vector<util::aligned::vector<float>>&
+                            channels) {
+                    for (size_t i = 0, e = receiver.capsules().item()->size();
+                         i != e;
+                         ++i) {
+                        all_channels.emplace_back(channel_info{
+                                std::move(channels[i]),
+                                compute_output_path(
+                                        source,
+                                        receiver,
+                                        *(*receiver.capsules().item())[i]
+                                                 .item(),
+                                        output)});
+                    }
+                };
+
+        //  Sources which share a receiver share a mesh, so they can be run
+        //  together, unless something wants to watch each source's waveguide
+        //  run step by step.
+        const auto batch = 1 < persistent.sources().item()->size() &&
+                           waveguide_node_pressures_changed_.empty() &&
+                           !has_snapshot_listeners();
+
+        if (batch) {
+            const auto& sources = *persistent.sources().item();
+            const auto positions = util::map_to_vector(
+                    std::begin(sources), std::end(sources), [](const auto& i) {
+                        return i.item()->get_position();
+                    });
+            const auto receivers = persistent.receivers().item()->size();
 
-        //  For each source-receiver pair.
-        for (auto source = std::begin(*persistent.sources().item()),
-                  e_source = std::end(*persistent.sources().item());
-             source != e_source && keep_going_;
-             ++source) {
+            size_t receiver_index = 0;
             for (auto receiver = std::begin(*persistent.receivers().item()),
                       e_receiver = std::end(*persistent.receivers().item());
                  receiver != e_receiver && keep_going_;
-                 ++receiver, ++run) {
-                std::cout << "run " << run << std::endl;
-                //  Set up an engine to use.
-                postprocessing_engine eng{compute_context,
-                                          scene_data,
-                                          source->item()->get_position(),
-                                          receiver->item()->get_position(),
-                                          environment,
-                                          persistent.raytracer().item()->get(),
-                                          poly_waveguide->clone()};
-                std::cout << "eng set up!" << std::endl;
-                //  Send new node position notification.
+                 ++receiver, ++receiver_index) {
+                std::cout << "receiver " << receiver_index << std::endl;
+                const auto run_index = [&](auto source) {
+                    return source * receivers + receiver_index;
+                };
+
+                batch_engine eng{compute_context,
+                                 scene_data,
+                                 positions,
+                                 receiver->item()->get_position(),
+                                 environment,
+                                 persistent.raytracer().item()->get(),
+                                 poly_waveguide->clone()};
+                print_filter_statistics(eng);
                 waveguide_node_positions_changed_(
                         eng.get_voxels_and_mesh().mesh.get_descriptor());
-                
-                //  Register callbacks.
-                if (!engine_state_changed_.empty()) {
-                    eng.connect_engine_state_changed([this, runs, run](
-                            auto state, auto progress) {
-                        std::cout << "engine state changed" << std::endl;
-                        engine_state_changed_(run, runs, state, progress);
-                    });
-                }
 
-                if (!waveguide_node_pressures_changed_.empty()) {
-                    std::cout << "node pressures changed" << std::endl;
-                    eng.connect_waveguide_node_pressures_changed(
-                            make_forwarding_call(
-                                    waveguide_node_pressures_changed_));
+                if (!engine_state_changed_.empty()) {
+                    eng.connect_engine_state_changed(
+                            [this, runs, run_index](
+                                    auto source, auto state, auto progress) {
+                                engine_state_changed_(run_index(source),
+                                                      runs,
+                                                      state,
+                                                      progress);
+                            });
                 }
 
                 if (!raytracer_reflections_generated_.empty()) {
-                    std::cout << "reflections generated" << std::endl;
                     eng.connect_raytracer_reflections_generated(
                             make_forwarding_call(
                                     raytracer_reflections_generated_));
                 }
 
-                const auto polymorphic_capsules = util::map_to_vector(
-                        std::begin(*receiver->item()->capsules().item()),
-                        std::end(*receiver->item()->capsules().item()),
-                        [&](const auto& i) {
-                            return polymorphic_capsule_model(
-                                    *i.item(),
-                                    receiver->item()->get_orientation());
-                        });
-                std::cout << "polymorphic_capsules finished" << std::endl;
-
-                //  Run the simulation, cache the result.
-                auto channel =
-                        eng.run(begin(polymorphic_capsules),
-                                end(polymorphic_capsules),
-                                get_sample_rate(output.get_sample_rate()),
-                                keep_going_);
-                std::cout << "channel finished" << std::endl;
-
-                //  If user cancelled while processing the channel, channel
-                //  will be null, but we want to exit before throwing an
-                //  exception.
+                const auto intermediates = eng.run(keep_going_);
+
                 if (!keep_going_) {
                     break;
                 }
 
-                if (!channel) {
+                if (intermediates.size() != sources.size()) {
                     throw std::runtime_error{
                             "Encountered unknown error, causing channel not to "
                             "be rendered."};
                 }
 
-                std::cout << "before for" << std::endl;
-                for (size_t i = 0,
-                            e = receiver->item()->capsules().item()->size();
-                     i != e;
-                     ++i) {
-                    all_channels.emplace_back(channel_info{
-                            std::move((*channel)[i]),
-                            compute_output_path(
-                                    *source->item(),
-                                    *receiver->item(),
-                                    *(*receiver->item()->capsules().item())[i]
-                                             .item(),
-                                    output)});
+                const auto polymorphic_capsules =
+                        make_capsules(*receiver->item());
+                const auto sample_rate =
+                        get_sample_rate(output.get_sample_rate());
+
+                for (auto i = 0u; i != sources.size() && keep_going_; ++i) {
+                    engine_state_changed_(
+                            run_index(i), runs, state::postprocessing, 1.0);
+                    auto channels = util::map_to_vector(
+                            begin(polymorphic_capsules),
+                            end(polymorphic_capsules),
+                            [&](const auto& capsule) {
+                                return capsule->postprocess(*intermediates[i],
+                                                            sample_rate);
+                            });
+                    add_channels(
+                            *sources[i].item(), *receiver->item(), channels);
+                }
+            }
+        } else {
+            auto run = 0;
+
+            //  For each source-receiver pair.
+            for (auto source = std::begin(*persistent.sources().item()),
+                      e_source = std::end(*persistent.sources().item());
+                 source != e_source && keep_going_;
+                 ++source) {
+                for (auto receiver = std::begin(*persistent.receivers().item()),
+                          e_receiver = std::end(*persistent.receivers().item());
+                     receiver != e_receiver && keep_going_;
+                     ++receiver, ++run) {
+                    std::cout << "run " << run << std::endl;
+                    //  Set up an engine to use.
+                    postprocessing_engine eng{
+                            compute_context,
+                            scene_data,
+                            source->item()->get_position(),
+                            receiver->item()->get_position(),
+                            environment,
+                            persistent.raytracer().item()->get(),
+                            poly_waveguide->clone()};
+                    std::cout << "eng set up!" << std::endl;
+                    print_filter_statistics(eng);
+                    //  Send new node position notification.
+                    waveguide_node_positions_changed_(
+                            eng.get_voxels_and_mesh().mesh.get_descriptor());
+                
+                    //  Register callbacks.
+                    if (!engine_state_changed_.empty()) {
+                        eng.connect_engine_state_changed([this, runs, run](
+                                auto state, auto progress) {
+                            std::cout << "engine state changed" << std::endl;
+                            engine_state_changed_(run, runs, state, progress);
+                        });
+                    }
+
+                    if (!waveguide_node_pressures_changed_.empty()) {
+                        std::cout << "node pressures changed" << std::endl;
+                        eng.connect_waveguide_node_pressures_changed(
+                                make_forwarding_call(
+                                        waveguide_node_pressures_changed_));
+                    }
+
+                    if (!raytracer_reflections_generated_.empty()) {
+                        std::cout << "reflections generated" << std::endl;
+                        eng.connect_raytracer_reflections_generated(
+                                make_forwarding_call(
+                                        raytracer_reflections_generated_));
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lck{snapshot_mutex_};
+                        snapshot_subscriptions_.remove_if(
+                                [](const auto& i) { return i.event.empty(); });
+                        for (auto& i : snapshot_subscriptions_) {
+                            eng.connect_waveguide_pressure_snapshot_taken(
+                                    i.factory(eng.get_voxels_and_mesh()
+                                                      .mesh.get_descriptor()),
+                                    make_forwarding_call(i.event));
+                        }
+                    }
+
+                    const auto polymorphic_capsules =
+                            make_capsules(*receiver->item());
+                    std::cout << "polymorphic_capsules finished" << std::endl;
+
+                    //  Run the simulation, cache the result.
+                    auto channel =
+                            eng.run(begin(polymorphic_capsules),
+                                    end(polymorphic_capsules),
+                                    get_sample_rate(output.get_sample_rate()),
+                                    keep_going_);
+                    std::cout << "channel finished" << std::endl;
+
+                    //  If user cancelled while processing the channel, channel
+                    //  will be null, but we want to exit before throwing an
+                    //  exception.
+                    if (!keep_going_) {
+                        break;
+                    }
+
+                    if (!channel) {
+                        throw std::runtime_error{
+                                "Encountered unknown error, causing channel "
+                                "not to be rendered."};
+                    }
+
+                    std::cout << "before for" << std::endl;
+                    add_channels(*source->item(), *receiver->item(), *channel);
+                    std::cout << "after for" << std::endl;
                 }
-                std::cout << "after for" << std::endl;
             }
         }
         std::cout << "source-receivers OK" << std::endl;
@@ -298,6 +417,13 @@ void complete_engine::do_run(core::compute_context compute_context,
     finished_();
 }
 
+bool complete_engine::has_snapshot_listeners() {
+    std::lock_guard<std::mutex> lck{snapshot_mutex_};
+    snapshot_subscriptions_.remove_if(
+            [](const auto& i) { return i.event.empty(); });
+    return !snapshot_subscriptions_.empty();
+}
+
 complete_engine::engine_state_changed::connection
 complete_engine::connect_engine_state_changed(
         engine_state_changed::callback_type callback) {
@@ -316,6 +442,16 @@ complete_engine::connect_waveguide_node_pressures_changed(
     return waveguide_node_pressures_changed_.connect(std::move(callback));
 }
 
+complete_engine::waveguide_pressure_snapshot_taken::connection
+complete_engine::connect_waveguide_pressure_snapshot_taken(
+        snapshot_parameters_factory factory,
+        waveguide_pressure_snapshot_taken::callback_type callback) {
+    std::lock_guard<std::mutex> lck{snapshot_mutex_};
+    snapshot_subscriptions_.emplace_back();
+    snapshot_subscriptions_.back().factory = std::move(factory);
+    return snapshot_subscriptions_.back().event.connect(std::move(callback));
+}
+
 complete_engine::raytracer_reflections_generated::connection
 complete_engine::connect_raytracer_reflections_generated(
         raytracer_reflections_generated::callback_type callback) {
@@ -1,15 +1,70 @@
 #include "combined/waveguide_base.h"
 
+#include "waveguide/batch.h"
 #include "waveguide/canonical.h"
 
+#include <algorithm>
+#include <type_traits>
+
 namespace wayverb {
 namespace combined {
 
+std::optional<
+        util::aligned::vector<util::aligned::vector<waveguide::bandpass_band>>>
+waveguide_base::run_batch(const core::compute_context& cc,
+                          const waveguide::voxels_and_mesh& voxelised,
+                          const util::aligned::vector<glm::vec3>& sources,
+                          const glm::vec3& receiver,
+                          const core::environment& environment,
+                          const util::aligned::vector<double>& simulation_times,
+                          const std::atomic_bool& keep_going) {
+    if (sources.size() != simulation_times.size()) {
+        throw std::runtime_error{
+                "Each source in a batch needs its own simulation time."};
+    }
+
+    util::aligned::vector<util::aligned::vector<waveguide::bandpass_band>> ret;
+    for (auto i = 0u; i != sources.size(); ++i) {
+        auto bands = run(cc,
+                         voxelised,
+                         sources[i],
+                         receiver,
+                         environment,
+                         simulation_times[i],
+                         keep_going,
+                         [](auto&, const auto&, auto, auto) {});
+        if (!bands) {
+            return std::nullopt;
+        }
+        ret.emplace_back(std::move(*bands));
+    }
+    return ret;
+}
+
+namespace {
+
+/// The mesh is causal, so a run which is cut short is identical to the start
+/// of a longer one.
+void truncate(util::aligned::vector<waveguide::bandpass_band>& bands,
+              double simulation_time) {
+    for (auto& i : bands) {
+        const auto steps = static_cast<size_t>(
+                std::ceil(i.band.sample_rate * simulation_time));
+        if (steps < i.band.directional.size()) {
+            i.band.directional.resize(steps);
+        }
+    }
+}
+
+}  // namespace
+
 template <typename T>
 class concrete_waveguide final : public waveguide_base {
 public:
-    concrete_waveguide(const T& t)
-            : sim_params_{t} {}
+    concrete_waveguide(const T& t,
+                       const waveguide::checkpoint_parameters& checkpoint)
+            : sim_params_{t}
+            , checkpoint_{checkpoint} {}
 
     std::unique_ptr<waveguide_base> clone() const override {
         return std::make_unique<concrete_waveguide>(*this);
@@ -19,6 +74,10 @@ public:
         return waveguide::compute_sampling_frequency(sim_params_);
     }
 
+    waveguide::scheme get_scheme() const override {
+        return sim_params_.scheme;
+    }
+
     std::optional<util::aligned::vector<waveguide::bandpass_band>>
     run(const core::compute_context& cc,
         const waveguide::voxels_and_mesh& voxelised,
@@ -28,7 +87,7 @@ public:
         double simulation_time,
         const std::atomic_bool& keep_going,
         std::function<void(cl::CommandQueue& queue,
-                           const cl::Buffer& buffer,
+                           const waveguide::pressure_buffer& buffer,
                            size_t step,
                            size_t steps)> pressure_callback) override {
         return waveguide::canonical(cc,
@@ -39,25 +98,96 @@ public:
                                     sim_params_,
                                     simulation_time,
                                     keep_going,
-                                    std::move(pressure_callback));
+                                    std::move(pressure_callback),
+                                    checkpoint_);
+    }
+
+    /// Single-band runs without checkpoints share one pass over the mesh.
+    /// Everything else runs one source at a time.
+    std::optional<util::aligned::vector<
+            util::aligned::vector<waveguide::bandpass_band>>>
+    run_batch(const core::compute_context& cc,
+              const waveguide::voxels_and_mesh& voxelised,
+              const util::aligned::vector<glm::vec3>& sources,
+              const glm::vec3& receiver,
+              const core::environment& environment,
+              const util::aligned::vector<double>& simulation_times,
+              const std::atomic_bool& keep_going) override {
+        if constexpr (std::is_same<T,
+                                   waveguide::single_band_parameters>{}) {
+            if (!is_enabled(checkpoint_) && 1 < sources.size() &&
+                sources.size() == simulation_times.size()) {
+                //  Run everything for as long as the longest source needs,
+                //  then cut each source down to its own length.
+                auto ret = waveguide::canonical_batch(
+                        cc,
+                        voxelised,
+                        sources,
+                        receiver,
+                        environment,
+                        sim_params_,
+                        *std::max_element(begin(simulation_times),
+                                          end(simulation_times)),
+                        keep_going);
+                if (ret) {
+                    for (auto i = 0u; i != ret->size(); ++i) {
+                        truncate((*ret)[i], simulation_times[i]);
+                    }
+                }
+                return ret;
+            }
+        }
+        return waveguide_base::run_batch(cc,
+                                         voxelised,
+                                         sources,
+                                         receiver,
+                                         environment,
+                                         simulation_times,
+                                         keep_going);
     }
 
 private:
     T sim_params_;
+    waveguide::checkpoint_parameters checkpoint_;
 };
 
 std::unique_ptr<waveguide_base> make_waveguide_ptr(
         const waveguide::single_band_parameters& t) {
+    return make_waveguide_ptr(t, waveguide::checkpoint_parameters{});
+}
+
+std::unique_ptr<waveguide_base> make_waveguide_ptr(
+        const waveguide::multiple_band_constant_spacing_parameters& t) {
+    return make_waveguide_ptr(t, waveguide::checkpoint_parameters{});
+}
+
+std::unique_ptr<waveguide_base> make_waveguide_ptr(
+        const waveguide::multiple_band_variable_spacing_parameters& t) {
+    return make_waveguide_ptr(t, waveguide::checkpoint_parameters{});
+}
+
+std::unique_ptr<waveguide_base> make_waveguide_ptr(
+        const waveguide::single_band_parameters& t,
+        const waveguide::checkpoint_parameters& checkpoint) {
     return std::make_unique<
             concrete_waveguide<waveguide::single_band_parameters>>(
-            std::move(t));
+            t, checkpoint);
 }
 
 std::unique_ptr<waveguide_base> make_waveguide_ptr(
-        const waveguide::multiple_band_constant_spacing_parameters& t) {
+        const waveguide::multiple_band_constant_spacing_parameters& t,
+        const waveguide::checkpoint_parameters& checkpoint) {
     return std::make_unique<concrete_waveguide<
             waveguide::multiple_band_constant_spacing_parameters>>(
-            std::move(t));
+            t, checkpoint);
+}
+
+std::unique_ptr<waveguide_base> make_waveguide_ptr(
+        const waveguide::multiple_band_variable_spacing_parameters& t,
+        const waveguide::checkpoint_parameters& checkpoint) {
+    return std::make_unique<concrete_waveguide<
+            waveguide::multiple_band_variable_spacing_parameters>>(
+            t, checkpoint);
 }
 
 }  // namespace wayverb
@@ -117,3 +117,159 @@ TEST(round_trip, waveguide) {
 TEST(round_trip, persistent) {
     round_trip(model::persistent());
 }
+
+TEST(round_trip, project_saved_before_waveguide_scheme) {
+    //  Saved by a build which didn't store the waveguide scheme.
+    std::stringstream serialized{R"({
+    "value0": {
+        "value0": {
+            "value0": [
+                {
+                    "value0": "new source",
+                    "value1": [
+                        0.0,
+                        0.0,
+                        0.0
+                    ]
+                }
+            ]
+        },
+        "value1": {
+            "value0": [
+                {
+                    "value0": {
+                        "value0": [
+                            {
+                                "value0": {
+                                    "value0": {
+                                        "value0": {
+                                            "orientation": {
+                                                "pointing": [
+                                                    0.0,
+                                                    0.0,
+                                                    -1.0
+                                                ],
+                                                "up": [
+                                                    0.0,
+                                                    1.0,
+                                                    0.0
+                                                ]
+                                            },
+                                            "shape": 0.0
+                                        }
+                                    },
+                                    "value1": {
+                                        "value0": {
+                                            "orientation": {
+                                                "pointing": [
+                                                    0.0,
+                                                    0.0,
+                                                    -1.0
+                                                ],
+                                                "up": [
+                                                    0.0,
+                                                    1.0,
+                                                    0.0
+                                                ]
+                                            },
+                                            "channel": 0,
+                                            "radius": 0.10000000149011612
+                                        }
+                                    }
+                                },
+                                "value1": "new capsule",
+                                "value2": 1
+                            }
+                        ]
+                    },
+                    "value1": "new receiver",
+                    "value2": [
+                        0.0,
+                        0.0,
+                        0.0
+                    ],
+                    "value3": {
+                        "pointing": [
+                            0.0,
+                            0.0,
+                            -1.0
+                        ],
+                        "up": [
+                            0.0,
+                            1.0,
+                            0.0
+                        ]
+                    }
+                }
+            ]
+        },
+        "value2": {
+            "value0": 3,
+            "value1": 4
+        },
+        "value3": {
+            "value0": {
+                "value0": {
+                    "value0": 400.0,
+                    "value1": 0.3
+                },
+                "value1": {
+                    "value0": 4,
+                    "value1": 450.0,
+                    "value2": 0.5
+                }
+            },
+            "value1": 1
+        },
+        "value4": {
+            "value0": [
+                {
+                    "value0": "new material",
+                    "value1": {
+                        "absorption": [
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806
+                        ],
+                        "scattering": [
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806,
+                            0.05000000074505806
+                        ]
+                    }
+                }
+            ]
+        }
+    }
+})"};
+
+    model::persistent deserialized;
+    {
+        cereal::JSONInputArchive archive(serialized);
+        archive(deserialized);
+    }
+
+    ASSERT_EQ(*deserialized.waveguide(),
+              (model::waveguide{model::waveguide::mode::multiple,
+                                model::single_band_waveguide{400, 0.3},
+                                model::multiple_band_waveguide{4, 450, 0.5}}));
+    ASSERT_EQ(deserialized.waveguide()->single_band()->get().scheme,
+              wayverb::waveguide::scheme::rectilinear);
+    ASSERT_EQ(deserialized.waveguide()->multiple_band()->get().scheme,
+              wayverb::waveguide::scheme::rectilinear);
+
+    //  Projects saved from now on keep the scheme.
+    deserialized.waveguide()->single_band()->set_scheme(
+            wayverb::waveguide::scheme::interpolated_wideband);
+    round_trip(deserialized);
+}
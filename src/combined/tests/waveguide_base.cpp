@@ -0,0 +1,75 @@
+#include "combined/waveguide_base.h"
+
+#include "waveguide/mesh.h"
+#include "waveguide/simulation_parameters.h"
+
+#include "core/cl/common.h"
+#include "core/environment.h"
+#include "core/geo/box.h"
+#include "core/scene_data.h"
+
+#include "gtest/gtest.h"
+
+using namespace wayverb::combined;
+using namespace wayverb::waveguide;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(waveguide_base, run_batch) {
+    const auto box = geo::box{glm::vec3{0, 0, 0}, glm::vec3{2, 1.5, 1}};
+    const auto scene_data = geo::get_scene_data(
+            box, make_surface<simulation_bands>(0.1, 0.1));
+
+    const compute_context cc{};
+    const environment env{};
+    const glm::vec3 receiver{1, 0.75, 0.5};
+    const auto waveguide =
+            make_waveguide_ptr(single_band_parameters{500, 0.6});
+
+    const auto voxelised =
+            compute_voxels_and_mesh(cc,
+                                    scene_data,
+                                    receiver,
+                                    waveguide->compute_sampling_frequency(),
+                                    env.speed_of_sound,
+                                    node_classifier::scanline,
+                                    waveguide->get_scheme());
+
+    //  Sources in a batch may need to run for different lengths of time.
+    const util::aligned::vector<glm::vec3> sources{
+            glm::vec3{0.5, 0.75, 0.5}, glm::vec3{1.5, 0.5, 0.3}};
+    const util::aligned::vector<double> times{0.05, 0.03};
+
+    const auto batched = waveguide->run_batch(
+            cc, voxelised, sources, receiver, env, times, true);
+    ASSERT_TRUE(batched);
+    ASSERT_EQ(batched->size(), sources.size());
+
+    for (auto i = 0u; i != sources.size(); ++i) {
+        const auto solo = waveguide->run(cc,
+                                         voxelised,
+                                         sources[i],
+                                         receiver,
+                                         env,
+                                         times[i],
+                                         true,
+                                         [](auto&, const auto&, auto, auto) {});
+        ASSERT_TRUE(solo);
+
+        const auto& bands = (*batched)[i];
+        ASSERT_EQ(bands.size(), solo->size());
+        for (auto j = 0u; j != bands.size(); ++j) {
+            const auto& a = bands[j].band.directional;
+            const auto& b = (*solo)[j].band.directional;
+            ASSERT_EQ(a.size(), b.size());
+            ASSERT_FALSE(a.empty());
+            for (auto k = 0u; k != a.size(); ++k) {
+                ASSERT_EQ(a[k].pressure, b[k].pressure);
+                ASSERT_EQ(a[k].intensity, b[k].intensity);
+            }
+        }
+    }
+}
+
+}  // namespace
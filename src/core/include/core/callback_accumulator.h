@@ -22,6 +22,14 @@ public:
 
     const auto& get_output() const { return output_; }
 
+    /// Used to restore the output of a previous, interrupted run.
+    void set_output(util::aligned::vector<Ret> output) {
+        output_ = std::move(output);
+    }
+
+    const T& get_postprocessor() const { return postprocessor_; }
+    T& get_postprocessor() { return postprocessor_; }
+
 private:
     util::aligned::vector<Ret> output_;
     T postprocessor_;
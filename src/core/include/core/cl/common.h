@@ -21,6 +21,12 @@ public:
     cl::Device device;
 };
 
+/// Split the device of a context into (at most) count equally-sized
+/// sub-devices, which share a single new context.
+/// Throws if the device can't be partitioned.
+util::aligned::vector<compute_context> make_sub_device_contexts(
+        const compute_context& cc, size_t count);
+
 template <typename T>
 cl::Buffer load_to_buffer(const cl::Context& context, T t, bool read_only) {
     return cl::Buffer{context, std::begin(t), std::end(t), read_only};
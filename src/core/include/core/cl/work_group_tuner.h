@@ -0,0 +1,234 @@
+#pragma once
+
+#include "core/cl/include.h"
+
+#include "utilities/aligned/vector.h"
+#include "utilities/locked_cache.h"
+
+#include <chrono>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+
+/// \file work_group_tuner.h
+/// Kernels launched with only a global size leave the work-group size to the
+/// OpenCL runtime, whose choices vary wildly between CPU and GPU drivers.
+/// The tuner chooses local sizes instead, by timing real launches.
+///
+/// Each (device, kernel, size class) is tuned separately, where the size
+/// class is the largest power of two not above the global size.
+/// Until every candidate local size has been timed, each launch uses the next
+/// untimed candidate, and is waited on so that it can be timed.
+/// Every launch is a single normal launch of the kernel, so kernels which
+/// update their buffers in place can be tuned while they run, and tuning
+/// never changes results.
+/// After that, launches use the fastest candidate, and aren't waited on.
+///
+/// OpenCL 1.2 requires the global size to be a multiple of the local size,
+/// so launches with a chosen local size round the global size up.
+/// Kernels launched through the tuner must therefore take the real number of
+/// work-items, and return early from any work-items past it.
+/// The runtime's default is always a candidate, and is launched with the
+/// real global size.
+///
+/// Timings are written to a cache file after every measurement, so tuning
+/// carries over between runs, and kernels which are only launched once or
+/// twice per run are still tuned eventually.
+
+namespace wayverb {
+namespace core {
+
+/// Launches with global sizes in the same class share a tuned local size.
+size_t compute_size_class(size_t global_size);
+
+/// The local sizes worth trying for a launch of global_size work-items, on a
+/// device whose largest work-group has max_local_size items.
+/// The first candidate is always 0, meaning the runtime's default.
+util::aligned::vector<size_t> compute_candidate_local_sizes(
+        size_t global_size, size_t max_local_size);
+
+/// The global size to launch with: global_size rounded up to a multiple of
+/// local_size, or global_size itself for the runtime's default.
+size_t compute_padded_global_size(size_t global_size, size_t local_size);
+
+struct work_group_tuner_statistics final {
+    /// Launches which were waited on and timed, to tune their local size.
+    size_t timed{0};
+
+    /// Launches which used an already-tuned or overridden local size.
+    size_t tuned{0};
+};
+
+class work_group_tuner final {
+public:
+    /// Loads any timings from cache_file.
+    /// An empty path keeps timings in memory only.
+    explicit work_group_tuner(std::string cache_file = "");
+
+    /// Launches a kernel over global_size work-items.
+    /// launch is called with the cl::EnqueueArgs to use, and should enqueue
+    /// the kernel and return its event.
+    /// It may be called again if the device rejects a local size, in which
+    /// case nothing will have been enqueued by the failed call.
+    template <typename Launch>
+    cl::Event operator()(cl::CommandQueue& queue,
+                         const std::string& kernel_name,
+                         size_t global_size,
+                         Launch&& launch) {
+        const auto device = queue.getInfo<CL_QUEUE_DEVICE>();
+        for (;;) {
+            const auto c = choose(device, kernel_name, global_size);
+            const auto padded =
+                    compute_padded_global_size(global_size, c.local_size);
+            const auto args =
+                    c.local_size
+                            ? cl::EnqueueArgs{queue,
+                                              cl::NDRange{padded},
+                                              cl::NDRange{c.local_size}}
+                            : cl::EnqueueArgs{queue, cl::NDRange{global_size}};
+
+            if (!c.timed) {
+                return launch(args);
+            }
+
+            //  Don't time work which was queued before this launch.
+            queue.finish();
+            try {
+                const auto begin = std::chrono::steady_clock::now();
+                auto event = launch(args);
+                event.wait();
+                const auto end = std::chrono::steady_clock::now();
+                record(device,
+                       kernel_name,
+                       global_size,
+                       c.local_size,
+                       std::chrono::duration<double>(end - begin).count());
+                return event;
+            } catch (const cl::Error& e) {
+                //  Some kernels can't use the largest work-groups that the
+                //  device supports.
+                if (!c.local_size || (e.err() != CL_INVALID_WORK_GROUP_SIZE &&
+                                      e.err() != CL_OUT_OF_RESOURCES)) {
+                    throw;
+                }
+                reject(device, kernel_name, global_size, c.local_size);
+            }
+        }
+    }
+
+    /// Makes every launch use local_size without any tuning, so that
+    /// benchmarks are reproducible.
+    /// A local size of 0 gives the runtime's default, as if there were no
+    /// tuner.
+    /// nullopt turns tuning back on.
+    void set_override(std::optional<size_t> local_size);
+    std::optional<size_t> get_override() const;
+
+    work_group_tuner_statistics get_statistics() const;
+
+    /// Forgets all timings, and resets the statistics.
+    /// The cache file is left alone.
+    void clear();
+
+    /// Each candidate is timed this many times, and the fastest time is kept,
+    /// so that one-off costs on the first launch of a kernel don't count
+    /// against whichever candidate is tried first.
+    static constexpr size_t samples_per_candidate = 2;
+
+private:
+    struct choice final {
+        size_t local_size;
+        bool timed;
+    };
+
+    choice choose(const cl::Device& device,
+                  const std::string& kernel_name,
+                  size_t global_size);
+
+    void record(const cl::Device& device,
+                const std::string& kernel_name,
+                size_t global_size,
+                size_t local_size,
+                double seconds);
+
+    void reject(const cl::Device& device,
+                const std::string& kernel_name,
+                size_t global_size,
+                size_t local_size);
+
+    struct timing final {
+        size_t samples{0};
+        double seconds{std::numeric_limits<double>::infinity()};
+    };
+
+    /// Device, kernel name, size class.
+    using key_type = std::tuple<std::string, std::string, size_t>;
+
+    using timings_type = std::map<key_type, std::map<size_t, timing>>;
+
+    static key_type make_key(const cl::Device& device,
+                             const std::string& kernel_name,
+                             size_t global_size);
+
+    void load(timings_type& timings) const;
+    void save(const timings_type& timings) const;
+
+    std::string cache_file_;
+
+    util::locked_cache<timings_type, work_group_tuner_statistics> timings_;
+
+    mutable std::mutex override_mutex_;
+    std::optional<size_t> override_;
+};
+
+/// Where the shared tuner keeps its timings: a file in the user's cache
+/// directory ($XDG_CACHE_HOME/wayverb, or ~/.cache/wayverb).
+/// Empty if there is no such directory and it can't be made, in which case
+/// timings are kept in memory only.
+std::string default_work_group_cache_file();
+
+/// The tuner shared by all kernels in the process.
+work_group_tuner& get_work_group_tuner();
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Wraps a kernel functor so that it can be launched with a tuned local size,
+/// by passing a queue and a global size instead of cl::EnqueueArgs.
+/// The launch may be padded past the global size, so the kernel must also be
+/// told how many work-items there really are.
+/// Launches with explicit cl::EnqueueArgs are passed straight through, for
+/// kernels which depend on a particular work-group size.
+template <typename Kernel>
+class tuned_kernel final {
+public:
+    tuned_kernel(Kernel kernel, std::string name)
+            : kernel_{std::move(kernel)}
+            , name_{std::move(name)} {}
+
+    template <typename... Ts>
+    cl::Event operator()(const cl::EnqueueArgs& args, Ts&&... ts) {
+        return kernel_(args, std::forward<Ts>(ts)...);
+    }
+
+    template <typename... Ts>
+    cl::Event operator()(cl::CommandQueue& queue,
+                         size_t global_size,
+                         const Ts&... ts) {
+        return get_work_group_tuner()(
+                queue, name_, global_size, [&](const auto& args) {
+                    return kernel_(args, ts...);
+                });
+    }
+
+    const std::string& get_name() const { return name_; }
+
+private:
+    Kernel kernel_;
+    std::string name_;
+};
+
+}  // namespace core
+}  // namespace wayverb
@@ -23,6 +23,11 @@ enum class direction { x, y, z };
 
 bool overlaps(const box& b, const triangle_vec3& t);
 
+/// A cheap test against the bounds of a triangle, which never returns false
+/// for a triangle which overlaps the box.
+/// Use it to skip the full overlaps test for triangles which are nowhere near.
+bool may_overlap(const box& b, const box& triangle_bounds);
+
 std::optional<std::pair<float, float>> intersection_distances(
         const box& b, const ray& ray);
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/cl/common.h"
+#include "core/cl/work_group_tuner.h"
 
 namespace wayverb {
 namespace core {
@@ -28,10 +29,15 @@ public:
 
     cl::Device get_device() const;
 
+    /// The kernel can be launched with explicit cl::EnqueueArgs, or with a
+    /// queue and a global size, to use a tuned local size (see
+    /// work_group_tuner.h).
     template <typename... Ts>
     auto get_kernel(const char* kernel_name) const {
         int error;
-        return cl::make_kernel<Ts...>(program, kernel_name, &error);
+        return tuned_kernel<cl::make_kernel<Ts...>>{
+                cl::make_kernel<Ts...>(program, kernel_name, &error),
+                kernel_name};
     }
 
 private:
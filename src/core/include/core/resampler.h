@@ -0,0 +1,157 @@
+#pragma once
+
+#include "utilities/aligned/vector.h"
+
+#include <cstdint>
+#include <memory>
+#include <tuple>
+
+/// \file resampler.h
+/// A polyphase sample-rate converter.
+/// The input is notionally upsampled by some factor L, lowpassed with a
+/// Kaiser-windowed sinc, and downsampled, but only the filter taps which
+/// contribute to each output are ever evaluated.
+/// When the ratio of rates is a fraction L/M with small terms (44.1k to 48k
+/// for example) every output lands exactly on one of the L filter phases.
+/// Other ratios (such as the waveguide's sampling rates) use a finer bank of
+/// phases and interpolate between adjacent phases.
+
+namespace wayverb {
+namespace core {
+
+/// Filter design for the resampler.
+struct resampler_quality final {
+    /// The proportion of the lower of the two Nyquist frequencies which is
+    /// passed without attenuation.
+    /// The transition band runs from here up to the Nyquist frequency.
+    double passband{0.9};
+
+    /// Attenuation in dB at and above the Nyquist frequency.
+    double stopband_attenuation{100};
+};
+
+constexpr auto to_tuple(const resampler_quality& x) {
+    return std::tie(x.passband, x.stopband_attenuation);
+}
+
+constexpr bool operator==(const resampler_quality& a,
+                          const resampler_quality& b) {
+    return to_tuple(a) == to_tuple(b);
+}
+
+constexpr bool operator!=(const resampler_quality& a,
+                          const resampler_quality& b) {
+    return !(a == b);
+}
+
+/// Short filters, for previews.
+constexpr resampler_quality resampler_fast{0.8, 60};
+
+/// Long filters, comparable to libsamplerate's best sinc converter.
+constexpr resampler_quality resampler_best{0.95, 120};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Find integers L and M such that L / M is close to out_sr / in_sr, with
+/// neither L nor M larger than max_term.
+std::pair<size_t, size_t> rational_ratio(double in_sr,
+                                         double out_sr,
+                                         size_t max_term = 4096);
+
+/// The lowpass filter for one (phases, ratio, quality) combination.
+/// Phase p holds taps p, p + phases, p + 2 * phases... of the filter.
+/// Each phase is stored reversed and contiguously, so that an output sample
+/// is a single dot product with a contiguous run of input samples.
+/// There are phases + 1 phases: the last is the first, shifted by one input
+/// sample, which makes interpolating between adjacent phases simple.
+class polyphase_filter_bank final {
+public:
+    /// ratio is the output rate divided by the input rate.
+    polyphase_filter_bank(size_t phases,
+                          double ratio,
+                          const resampler_quality& quality);
+
+    size_t get_phases() const;
+    double get_ratio() const;
+
+    /// The number of input samples which contribute to each output.
+    size_t get_taps_per_phase() const;
+
+    /// The filter delay, in samples at the upsampled rate.
+    size_t get_delay() const;
+
+    const float* get_phase(size_t phase) const;
+
+private:
+    size_t phases_;
+    double ratio_;
+    size_t taps_per_phase_;
+    util::aligned::vector<float> coefficients_;
+};
+
+/// Filter banks can be slow to design, so they are cached.
+/// Calls with the same arguments will share a single bank.
+std::shared_ptr<const polyphase_filter_bank> get_filter_bank(
+        double in_sr, double out_sr, const resampler_quality& quality);
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Converts a stream of interleaved multichannel audio.
+/// Feed blocks of any size to process(), then call flush() once at the end of
+/// the stream to collect the tail.
+/// The output is aligned with the input: the filter delay is removed.
+class resampler final {
+public:
+    resampler(double in_sr,
+              double out_sr,
+              size_t channels = 1,
+              const resampler_quality& quality = {});
+
+    /// Appends any output which can be computed from the input so far.
+    void process(const float* input,
+                 size_t frames,
+                 util::aligned::vector<float>& output);
+
+    /// Appends the remaining output, and resets the resampler so that it can
+    /// be used for a new stream.
+    /// After flushing, the total output length will be
+    /// ceil(input frames * out_sr / in_sr) frames.
+    void flush(util::aligned::vector<float>& output);
+
+    /// Discards all buffered input.
+    void reset();
+
+    /// The ratio of output to input rates.
+    double get_ratio() const;
+
+    size_t get_channels() const;
+
+private:
+    void append(const float* input, size_t frames);
+    void produce(std::uint64_t limit, util::aligned::vector<float>& output);
+
+    std::shared_ptr<const polyphase_filter_bank> bank_;
+    size_t channels_;
+
+    /// If every output lands exactly on a phase, the number of upsampled
+    /// samples between outputs. Otherwise zero.
+    std::uint64_t exact_step_;
+
+    /// One buffer of recent input per channel.
+    util::aligned::vector<util::aligned::vector<float>> history_;
+
+    /// The absolute index of the first sample in each history buffer.
+    std::int64_t history_start_;
+    std::uint64_t frames_in_;
+    std::uint64_t frames_out_;
+};
+
+/// Convert a whole single-channel signal in one go.
+util::aligned::vector<float> resample(const float* data,
+                                      size_t size,
+                                      double in_sr,
+                                      double out_sr,
+                                      const resampler_quality& quality = {});
+
+}  // namespace core
+}  // namespace wayverb
@@ -4,6 +4,9 @@
 #include "core/indexing.h"
 #include "core/spatial_division/range.h"
 
+#include <algorithm>
+#include <functional>
+#include <future>
 #include <memory>
 
 namespace wayverb {
@@ -33,6 +36,10 @@ next_boundaries_type next_boundaries(const aabb_type& parent) {
 
 }  // namespace detail
 
+/// Children are built on their own threads down to this many levels below
+/// the root, which gives up to 8 + 64 tasks for an octree.
+constexpr size_t default_parallel_depth = 2;
+
 /// A generic interface for spatial division algorithms (octree, quadtree)
 template <size_t n>
 class ndim_tree final {
@@ -45,18 +52,27 @@ public:
     using item_checker = std::function<bool(size_t, const aabb_type& aabb)>;
 
     ndim_tree() = default;
+
+    /// The callback may be any callable with the same signature as
+    /// item_checker.
+    /// It will be called from several threads at once unless parallel_depth
+    /// is 0.
+    /// The tree is the same whatever the parallel depth.
+    template <typename Callback>
     ndim_tree(size_t depth,
-              const item_checker& callback,
+              const Callback& callback,
               const util::aligned::vector<size_t>& to_test,
-              const aabb_type& aabb)
+              const aabb_type& aabb,
+              size_t parallel_depth = default_parallel_depth)
             : aabb_{aabb}
             , items_{compute_contained_items(callback, to_test, aabb)}
-            , nodes_{compute_nodes(depth, callback, items_, aabb)} {}
+            , nodes_{compute_nodes(
+                      depth, callback, items_, aabb, parallel_depth)} {}
 
     aabb_type get_aabb() const { return aabb_; }
     bool has_nodes() const { return nodes_ != nullptr; }
     const node_array& get_nodes() const { return *nodes_; }
-    util::aligned::vector<size_t> get_items() const { return items_; }
+    const util::aligned::vector<size_t>& get_items() const { return items_; }
 
     size_t get_side() const {
         return nodes_ ? 2 * nodes_->front().get_side() : 1;
@@ -65,8 +81,9 @@ public:
 private:
     using next_boundaries_type = std::array<aabb_type, (1 << n)>;
 
+    template <typename Callback>
     static util::aligned::vector<size_t> compute_contained_items(
-            const item_checker& callback,
+            const Callback& callback,
             const util::aligned::vector<size_t>& to_test,
             const aabb_type& aabb) {
         util::aligned::vector<size_t> ret;
@@ -77,21 +94,48 @@ private:
         return ret;
     }
 
+    template <typename Callback>
     static std::unique_ptr<node_array> compute_nodes(
             size_t depth,
-            const item_checker& callback,
+            const Callback& callback,
             const util::aligned::vector<size_t>& to_test,
-            const aabb_type& aabb) {
+            const aabb_type& aabb,
+            size_t parallel_depth) {
         if (!depth) {
             return nullptr;
         }
 
         const auto next = detail::next_boundaries<n>(aabb);
-        auto ret = std::make_unique<std::array<ndim_tree, (1 << n)>>();
-        std::transform(
-                begin(next), end(next), ret->begin(), [&](const auto& i) {
-                    return ndim_tree(depth - 1, callback, to_test, i);
-                });
+        auto ret = std::make_unique<node_array>();
+
+        const auto make_child = [&](const auto& i) {
+            return ndim_tree(depth - 1,
+                             callback,
+                             to_test,
+                             i,
+                             parallel_depth ? parallel_depth - 1 : 0);
+        };
+
+        //  Children don't share anything but the (read-only) parent, so they
+        //  can be built independently.
+        //  Each child goes straight into its own slot, so the layout doesn't
+        //  depend on which finishes first.
+        if (parallel_depth && 1 < depth) {
+            std::array<std::future<ndim_tree>, (1 << n)> futures;
+            std::transform(begin(next),
+                           end(next),
+                           futures.begin(),
+                           [&](const auto& i) {
+                               return std::async(std::launch::async,
+                                                 [&] { return make_child(i); });
+                           });
+            std::transform(begin(futures),
+                           end(futures),
+                           ret->begin(),
+                           [](auto& i) { return i.get(); });
+        } else {
+            std::transform(begin(next), end(next), ret->begin(), make_child);
+        }
         return ret;
     }
 
@@ -5,6 +5,9 @@
 #include "core/scene_data.h"
 #include "core/spatial_division/voxel_collection.h"
 
+#include "utilities/map_to_vector.h"
+
+#include <limits>
 #include <optional>
 #include <random>
 
@@ -30,19 +33,7 @@ public:
                          size_t octree_depth,
                          const geo::box& aabb)
             : scene_{std::move(scene)}
-            , voxels_{ndim_tree<3>{
-                      octree_depth,
-                      [this](auto item, const auto& aabb) {
-                          // This is a bit greedy - we're sacrificing some speed
-                          // in the name of correctness.
-                          return geo::overlaps(
-                                  padded(aabb, glm::vec3{0.001}),
-                                  geo::get_triangle_vec3(
-                                          scene_.get_triangles()[item],
-                                          scene_.get_vertices().data()));
-                      },
-                      compute_triangle_indices(scene_.get_triangles().size()),
-                      aabb}} {}
+            , voxels_{compute_voxels(scene_, octree_depth, aabb)} {}
 
     const scene_data& get_scene_data() const { return scene_; }
     const voxel_collection<3>& get_voxels() const { return voxels_; }
@@ -55,6 +46,36 @@ public:
     void set_surfaces(const Surface& surface) { scene_.set_surfaces(surface); }
 
 private:
+    static voxel_collection<3> compute_voxels(const scene_data& scene,
+                                              size_t octree_depth,
+                                              const geo::box& aabb) {
+        //  Each triangle is tested against many boxes, so find its vertices
+        //  and bounds once, up front.
+        const auto triangles = util::map_to_vector(
+                begin(scene.get_triangles()),
+                end(scene.get_triangles()),
+                [&](const auto& i) {
+                    return geo::get_triangle_vec3(i,
+                                                  scene.get_vertices().data());
+                });
+        const auto bounds = util::map_to_vector(
+                begin(triangles), end(triangles), [](const auto& i) {
+                    return util::enclosing_range(begin(i.s), end(i.s));
+                });
+
+        return ndim_tree<3>{
+                octree_depth,
+                [&](auto item, const auto& aabb) {
+                    // This is a bit greedy - we're sacrificing some speed
+                    // in the name of correctness.
+                    const auto padded_aabb = padded(aabb, glm::vec3{0.001});
+                    return geo::may_overlap(padded_aabb, bounds[item]) &&
+                           geo::overlaps(padded_aabb, triangles[item]);
+                },
+                compute_triangle_indices(scene.get_triangles().size()),
+                aabb};
+    }
+
     scene_data scene_;
     voxel_collection<3> voxels_;
 };
@@ -177,5 +198,100 @@ bool inside(const voxelised_scene_data<Vertex, Surface>& voxelised,
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+/// Find the index of the triangle closest to a point.
+/// Searches outwards from the voxel containing the point, one shell of voxels
+/// at a time, and stops as soon as no unsearched voxel could hold anything
+/// closer.
+/// Ties are broken in favour of the lowest triangle index, so the result is
+/// the same as a brute-force search over every triangle.
+/// Returns nothing if there are no triangles in the voxel grid.
+template <typename Vertex, typename Surface>
+std::optional<size_t> closest_triangle(
+        const voxelised_scene_data<Vertex, Surface>& voxelised,
+        const glm::vec3& pt) {
+    const auto& voxels = voxelised.get_voxels();
+    const auto& triangles = voxelised.get_scene_data().get_triangles();
+    const auto& vertices = voxelised.get_scene_data().get_vertices();
+
+    const auto aabb = voxels.get_aabb();
+    const auto voxel_dim = voxel_dimensions(voxels);
+    const auto last = static_cast<int>(voxels.get_side()) - 1;
+    const auto start = glm::clamp(
+            glm::ivec3{glm::floor((pt - aabb.get_min()) / voxel_dim)},
+            glm::ivec3{0},
+            glm::ivec3{last});
+
+    std::optional<size_t> ret;
+    auto ret_distance = std::numeric_limits<float>::infinity();
+
+    for (auto radius = 0;; ++radius) {
+        const auto lo = glm::max(start - radius, glm::ivec3{0});
+        const auto hi = glm::min(start + radius, glm::ivec3{last});
+
+        for (auto x = lo.x; x <= hi.x; ++x) {
+            for (auto y = lo.y; y <= hi.y; ++y) {
+                for (auto z = lo.z; z <= hi.z; ++z) {
+                    const glm::ivec3 ind{x, y, z};
+
+                    //  voxels inside the shell were searched last time
+                    if (glm::all(glm::lessThan(glm::abs(ind - start),
+                                               glm::ivec3{radius}))) {
+                        continue;
+                    }
+
+                    //  skip voxels which can't hold anything closer
+                    const auto box = voxel_aabb(voxels, ind);
+                    const auto outside =
+                            glm::max(glm::vec3{0},
+                                     glm::max(box.get_min() - pt,
+                                              pt - box.get_max()));
+                    if (ret_distance < glm::dot(outside, outside)) {
+                        continue;
+                    }
+
+                    for (const auto i : voxels.get_voxel(ind)) {
+                        const auto d = geo::point_triangle_distance_squared(
+                                geo::get_triangle_vec3(triangles[i],
+                                                       vertices.data()),
+                                pt);
+                        if (d < ret_distance ||
+                            (d == ret_distance && ret && i < *ret)) {
+                            ret = i;
+                            ret_distance = d;
+                        }
+                    }
+                }
+            }
+        }
+
+        //  the whole grid has been searched
+        if (glm::all(glm::equal(lo, glm::ivec3{0})) &&
+            glm::all(glm::equal(hi, glm::ivec3{last}))) {
+            return ret;
+        }
+
+        //  find the distance to the closest unsearched voxel
+        const auto searched_min = aabb.get_min() + glm::vec3{lo} * voxel_dim;
+        const auto searched_max =
+                aabb.get_min() + glm::vec3{hi + 1} * voxel_dim;
+        auto bound = std::numeric_limits<float>::infinity();
+        for (auto i = 0; i != 3; ++i) {
+            if (0 < lo[i]) {
+                bound = std::min(bound, pt[i] - searched_min[i]);
+            }
+            if (hi[i] < last) {
+                bound = std::min(bound, searched_max[i] - pt[i]);
+            }
+        }
+        bound = std::max(0.0f, bound);
+
+        if (ret_distance < bound * bound) {
+            return ret;
+        }
+    }
+}
+
 }  // namespace core
 }  // namespace wayverb
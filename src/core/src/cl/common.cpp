@@ -1,5 +1,6 @@
 #include "core/cl/common.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace wayverb {
@@ -88,5 +89,41 @@ compute_context::compute_context(const cl::Context& context,
                                  const cl::Device& device)
         : context(context)
         , device(device) {}
+
+util::aligned::vector<compute_context> make_sub_device_contexts(
+        const compute_context& cc, size_t count) {
+    if (count == 0) {
+        throw std::runtime_error{"Must request at least one sub-device."};
+    }
+
+    const auto compute_units =
+            cc.device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+    const cl_device_partition_property properties[] = {
+            CL_DEVICE_PARTITION_EQUALLY,
+            static_cast<cl_device_partition_property>(
+                    std::max(size_t{1}, compute_units / count)),
+            0,
+    };
+
+    auto device = cc.device;
+    std::vector<cl::Device> devices;
+    device.createSubDevices(properties, &devices);
+
+    if (devices.empty()) {
+        throw std::runtime_error{"Device could not be partitioned."};
+    }
+    if (count < devices.size()) {
+        devices.resize(count);
+    }
+
+    const cl::Context context{devices};
+    util::aligned::vector<compute_context> ret;
+    ret.reserve(devices.size());
+    for (const auto& i : devices) {
+        ret.emplace_back(context, i);
+    }
+    return ret;
+}
+
 }  // namespace core
 }  // namespace wayverb
@@ -0,0 +1,252 @@
+#include "core/cl/work_group_tuner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace wayverb {
+namespace core {
+
+namespace {
+
+//  Smaller groups are never faster than the runtime's default in practice,
+//  and each candidate costs a couple of synchronous launches to time.
+constexpr size_t min_local_size = 16;
+
+//  Device info strings may include the terminating null, and mustn't break
+//  the cache file's columns.
+std::string sanitise(std::string str) {
+    str.erase(std::remove(str.begin(), str.end(), '\0'), str.end());
+    std::replace_if(str.begin(),
+                    str.end(),
+                    [](auto c) { return c == '\t' || c == '\n'; },
+                    ' ');
+    return str;
+}
+
+std::string get_device_name(const cl::Device& device) {
+    return sanitise(device.getInfo<CL_DEVICE_NAME>() + " " +
+                    device.getInfo<CL_DRIVER_VERSION>());
+}
+
+}  // namespace
+
+size_t compute_size_class(size_t global_size) {
+    size_t ret = 0;
+    while (global_size >>= 1) {
+        ret += 1;
+    }
+    return ret;
+}
+
+util::aligned::vector<size_t> compute_candidate_local_sizes(
+        size_t global_size, size_t max_local_size) {
+    util::aligned::vector<size_t> ret{0};
+    for (auto i = min_local_size; i <= max_local_size && i <= global_size;
+         i *= 2) {
+        ret.emplace_back(i);
+    }
+    return ret;
+}
+
+size_t compute_padded_global_size(size_t global_size, size_t local_size) {
+    if (!local_size) {
+        return global_size;
+    }
+    return (global_size + local_size - 1) / local_size * local_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+work_group_tuner::work_group_tuner(std::string cache_file)
+        : cache_file_{std::move(cache_file)} {
+    timings_.access([&](auto& timings, auto&) { load(timings); });
+}
+
+work_group_tuner::key_type work_group_tuner::make_key(
+        const cl::Device& device,
+        const std::string& kernel_name,
+        size_t global_size) {
+    return key_type{get_device_name(device),
+                    kernel_name,
+                    compute_size_class(global_size)};
+}
+
+work_group_tuner::choice work_group_tuner::choose(
+        const cl::Device& device,
+        const std::string& kernel_name,
+        size_t global_size) {
+    if (const auto local_size = get_override()) {
+        timings_.access([](auto&, auto& statistics) { statistics.tuned += 1; });
+        return {*local_size, false};
+    }
+
+    const auto key = make_key(device, kernel_name, global_size);
+    const auto candidates = compute_candidate_local_sizes(
+            global_size, device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>());
+
+    return timings_.access([&](auto& all_timings, auto& statistics) {
+        auto& timings = all_timings[key];
+
+        //  Try the least-sampled candidate, so that candidates take turns.
+        const auto next = *std::min_element(
+                candidates.begin(), candidates.end(), [&](auto a, auto b) {
+                    return timings[a].samples < timings[b].samples;
+                });
+        if (timings[next].samples < samples_per_candidate) {
+            return choice{next, true};
+        }
+
+        const auto best = *std::min_element(
+                candidates.begin(), candidates.end(), [&](auto a, auto b) {
+                    return timings[a].seconds < timings[b].seconds;
+                });
+        statistics.tuned += 1;
+        return choice{best, false};
+    });
+}
+
+void work_group_tuner::record(const cl::Device& device,
+                              const std::string& kernel_name,
+                              size_t global_size,
+                              size_t local_size,
+                              double seconds) {
+    const auto key = make_key(device, kernel_name, global_size);
+    timings_.access([&](auto& timings, auto& statistics) {
+        auto& timing = timings[key][local_size];
+        timing.samples += 1;
+        timing.seconds = std::min(timing.seconds, seconds);
+        statistics.timed += 1;
+        save(timings);
+    });
+}
+
+void work_group_tuner::reject(const cl::Device& device,
+                              const std::string& kernel_name,
+                              size_t global_size,
+                              size_t local_size) {
+    const auto key = make_key(device, kernel_name, global_size);
+    timings_.access([&](auto& timings, auto&) {
+        //  Never try it again, and never pick it.
+        timings[key][local_size] =
+                timing{samples_per_candidate,
+                       std::numeric_limits<double>::infinity()};
+        save(timings);
+    });
+}
+
+//  One line per timed candidate:
+//      device \t kernel \t size class \t local size \t samples \t seconds
+//  Rejected candidates have 'inf' seconds.
+
+void work_group_tuner::load(timings_type& timings) const {
+    if (cache_file_.empty()) {
+        return;
+    }
+
+    std::ifstream stream{cache_file_};
+    std::string line;
+    while (std::getline(stream, line)) {
+        std::istringstream ss{line};
+        std::string device, kernel, seconds;
+        size_t size_class, local_size, samples;
+        if (std::getline(ss, device, '\t') && std::getline(ss, kernel, '\t') &&
+            ss >> size_class >> local_size >> samples >> seconds) {
+            //  A damaged cache only costs some re-tuning.
+            try {
+                timings[key_type{device, kernel, size_class}][local_size] =
+                        timing{samples, std::stod(seconds)};
+            } catch (const std::logic_error&) {
+            }
+        }
+    }
+}
+
+void work_group_tuner::save(const timings_type& timings) const {
+    if (cache_file_.empty()) {
+        return;
+    }
+
+    //  The cache is only an optimisation, so failing to write it is not an
+    //  error.
+    //  Other processes may be saving to the same cache, so each write goes
+    //  through a temp file of its own before replacing the cache.
+    const auto temp_path =
+            cache_file_ + ".tmp." + std::to_string(std::random_device{}());
+    {
+        std::ofstream stream{temp_path, std::ios::trunc};
+        if (!stream) {
+            return;
+        }
+        stream.precision(std::numeric_limits<double>::max_digits10);
+        for (const auto& i : timings) {
+            for (const auto& j : i.second) {
+                if (j.second.samples) {
+                    stream << std::get<0>(i.first) << '\t'
+                           << std::get<1>(i.first) << '\t'
+                           << std::get<2>(i.first) << '\t' << j.first << '\t'
+                           << j.second.samples << '\t' << j.second.seconds
+                           << '\n';
+                }
+            }
+        }
+    }
+    if (std::rename(temp_path.c_str(), cache_file_.c_str())) {
+        std::remove(temp_path.c_str());
+    }
+}
+
+void work_group_tuner::set_override(std::optional<size_t> local_size) {
+    std::lock_guard<std::mutex> lck{override_mutex_};
+    override_ = local_size;
+}
+
+std::optional<size_t> work_group_tuner::get_override() const {
+    std::lock_guard<std::mutex> lck{override_mutex_};
+    return override_;
+}
+
+work_group_tuner_statistics work_group_tuner::get_statistics() const {
+    return timings_.get_statistics();
+}
+
+void work_group_tuner::clear() { timings_.clear(); }
+
+////////////////////////////////////////////////////////////////////////////////
+
+std::string default_work_group_cache_file() {
+    const auto dir = []() -> std::filesystem::path {
+        const auto xdg = std::getenv("XDG_CACHE_HOME");
+        if (xdg && *xdg) {
+            return std::filesystem::path{xdg} / "wayverb";
+        }
+        const auto home = std::getenv("HOME");
+        if (home && *home) {
+            return std::filesystem::path{home} / ".cache" / "wayverb";
+        }
+        return {};
+    }();
+
+    if (dir.empty()) {
+        return "";
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        return "";
+    }
+    return (dir / "work_group_sizes.txt").string();
+}
+
+work_group_tuner& get_work_group_tuner() {
+    static work_group_tuner tuner{default_work_group_cache_file()};
+    return tuner;
+}
+
+}  // namespace core
+}  // namespace wayverb
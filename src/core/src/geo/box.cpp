@@ -26,6 +26,16 @@ bool overlaps(const box& b, const triangle_vec3& t) {
     return t_c_intersection(coll) == where::inside;
 }
 
+bool may_overlap(const box& b, const box& triangle_bounds) {
+    //  overlaps() moves the triangle into the box's space before comparing
+    //  bounds, so leave a margin well above the rounding error of that move.
+    const auto margin = (glm::abs(centre(b)) + dimensions(b)) * 1.0e-5f;
+    return !glm::any(glm::lessThan(triangle_bounds.get_max(),
+                                   b.get_min() - margin)) &&
+           !glm::any(glm::lessThan(b.get_max() + margin,
+                                   triangle_bounds.get_min()));
+}
+
 std::optional<std::pair<float, float>> intersection_distances(
         const box& b, const ray& ray) {
     /// from http://people.csail.mit.edu/amy/papers/box-jgt.pdf
@@ -0,0 +1,395 @@
+#include "core/resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+namespace wayverb {
+namespace core {
+
+namespace {
+
+/// Zeroth-order modified Bessel function of the first kind.
+double bessel_i0(double x) {
+    double ret = 1;
+    double term = 1;
+    for (auto k = 1; term > ret * 1.0e-12; ++k) {
+        const auto t = x / (2 * k);
+        term *= t * t;
+        ret += term;
+    }
+    return ret;
+}
+
+/// From Oppenheim & Schafer.
+double kaiser_beta(double attenuation) {
+    if (50 < attenuation) {
+        return 0.1102 * (attenuation - 8.7);
+    }
+    if (21 < attenuation) {
+        return 0.5842 * std::pow(attenuation - 21, 0.4) +
+               0.07886 * (attenuation - 21);
+    }
+    return 0;
+}
+
+double sinc(double x) {
+    if (x == 0) {
+        return 1;
+    }
+    const auto pix = M_PI * x;
+    return std::sin(pix) / pix;
+}
+
+/// Several independent accumulators let the compiler vectorise this loop.
+float dot(const float* a, const float* b, size_t size) {
+    float acc[4]{};
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        for (auto j = 0; j != 4; ++j) {
+            acc[j] += a[i + j] * b[i + j];
+        }
+    }
+    float ret = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    for (; i != size; ++i) {
+        ret += a[i] * b[i];
+    }
+    return ret;
+}
+
+}  // namespace
+
+std::pair<size_t, size_t> rational_ratio(double in_sr,
+                                         double out_sr,
+                                         size_t max_term) {
+    if (!(0 < in_sr && 0 < out_sr)) {
+        throw std::runtime_error{"Sample rates must be positive."};
+    }
+
+    //  Walk the continued fraction expansion of the ratio, keeping the last
+    //  convergent whose terms are small enough.
+    const auto ratio = out_sr / in_sr;
+    size_t p0 = 0, q0 = 1, p1 = 1, q1 = 0;
+    auto x = ratio;
+    std::pair<size_t, size_t> ret{0, 0};
+    const auto error = [&](auto p, auto q) {
+        return std::abs(static_cast<double>(p) / q - ratio);
+    };
+    for (;;) {
+        const auto a = std::min(std::floor(x), static_cast<double>(max_term));
+        const auto p2 = static_cast<size_t>(a) * p1 + p0;
+        const auto q2 = static_cast<size_t>(a) * q1 + q0;
+        if (max_term < p2 || max_term < q2) {
+            //  The next convergent is too big, but a semiconvergent with a
+            //  smaller term might still be an improvement.
+            const auto limit = std::min(p1 ? (max_term - p0) / p1 : max_term,
+                                        q1 ? (max_term - q0) / q1 : max_term);
+            if (limit) {
+                const auto p = limit * p1 + p0;
+                const auto q = limit * q1 + q0;
+                if (!ret.second || error(p, q) < error(ret.first, ret.second)) {
+                    ret = {p, q};
+                }
+            }
+            break;
+        }
+        ret = {p2, q2};
+        if (error(p2, q2) <= ratio * std::numeric_limits<float>::epsilon()) {
+            break;
+        }
+        const auto frac = x - a;
+        if (frac == 0) {
+            break;
+        }
+        x = 1 / frac;
+        p0 = p1;
+        q0 = q1;
+        p1 = p2;
+        q1 = q2;
+    }
+
+    if (!ret.first || !ret.second) {
+        throw std::runtime_error{
+                "Sample rate ratio can't be represented by a small fraction."};
+    }
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+polyphase_filter_bank::polyphase_filter_bank(size_t phases,
+                                             double ratio,
+                                             const resampler_quality& quality)
+        : phases_{phases}
+        , ratio_{ratio} {
+    if (!phases) {
+        throw std::runtime_error{"Filter bank needs at least one phase."};
+    }
+    if (!(0 < ratio)) {
+        throw std::runtime_error{"Resampling ratio must be positive."};
+    }
+    if (!(0 < quality.passband && quality.passband < 1)) {
+        throw std::runtime_error{"Resampler passband must be in (0, 1)."};
+    }
+    if (!(0 < quality.stopband_attenuation)) {
+        throw std::runtime_error{
+                "Resampler stopband attenuation must be positive."};
+    }
+
+    //  All frequencies normalised to the upsampled rate.
+    const auto nyquist = 0.5 * std::min(1.0, ratio) / phases;
+    const auto transition = (1 - quality.passband) * nyquist;
+    const auto cutoff = nyquist - transition / 2;
+
+    //  Kaiser's estimate of the filter length.
+    const auto length = (quality.stopband_attenuation - 7.95) /
+                                (14.36 * transition) +
+                        1;
+    const auto half_taps =
+            std::max(size_t{1},
+                     static_cast<size_t>(std::ceil(length / (2.0 * phases))));
+    taps_per_phase_ = 2 * half_taps;
+
+    const auto delay = static_cast<double>(get_delay());
+    const auto beta = kaiser_beta(quality.stopband_attenuation);
+    const auto i0_beta = bessel_i0(beta);
+
+    //  The filter is symmetric about 'delay', with one extra tap at the end
+    //  which is only reached by the extra phase.
+    const auto filter_length = taps_per_phase_ * phases + 1;
+    coefficients_.resize((phases + 1) * taps_per_phase_);
+    for (auto n = 0u; n != filter_length; ++n) {
+        const auto x = n - delay;
+        const auto r = x / delay;
+        const auto window =
+                bessel_i0(beta * std::sqrt(std::max(0.0, 1 - r * r))) /
+                i0_beta;
+
+        //  Gain of 'phases' makes up for the zeros inserted when upsampling.
+        const auto h = phases * 2 * cutoff * sinc(2 * cutoff * x) * window;
+
+        //  Scatter into reversed phases.
+        //  Tap n belongs to phase n % phases, and also to the extra phase if
+        //  it is a multiple of 'phases'.
+        const auto scatter = [&](auto phase, auto tap) {
+            if (tap < taps_per_phase_) {
+                coefficients_[phase * taps_per_phase_ + taps_per_phase_ - 1 -
+                              tap] = h;
+            }
+        };
+        scatter(n % phases, n / phases);
+        if (n % phases == 0 && n) {
+            scatter(phases, n / phases - 1);
+        }
+    }
+}
+
+size_t polyphase_filter_bank::get_phases() const { return phases_; }
+double polyphase_filter_bank::get_ratio() const { return ratio_; }
+
+size_t polyphase_filter_bank::get_taps_per_phase() const {
+    return taps_per_phase_;
+}
+
+size_t polyphase_filter_bank::get_delay() const {
+    return taps_per_phase_ / 2 * phases_;
+}
+
+const float* polyphase_filter_bank::get_phase(size_t phase) const {
+    return coefficients_.data() + phase * taps_per_phase_;
+}
+
+std::shared_ptr<const polyphase_filter_bank> get_filter_bank(
+        double in_sr, double out_sr, const resampler_quality& quality) {
+    //  Use exact phases if the ratio is a small fraction, otherwise fall back
+    //  to a fine grid of phases and interpolate.
+    constexpr size_t interpolated_phases = 1024;
+    const auto target = out_sr / in_sr;
+    const auto factors = rational_ratio(in_sr, out_sr);
+    const auto exact = static_cast<double>(factors.first) / factors.second;
+    const auto is_exact = std::abs(exact - target) <= target * 1.0e-12;
+
+    const auto phases = is_exact ? factors.first : interpolated_phases;
+    const auto ratio = is_exact ? exact : target;
+    const auto key = std::make_tuple(
+            phases, ratio, quality.passband, quality.stopband_attenuation);
+
+    static std::mutex mutex;
+    static std::map<decltype(key),
+                    std::shared_ptr<const polyphase_filter_bank>>
+            cache;
+
+    std::lock_guard<std::mutex> lck{mutex};
+    auto& ret = cache[key];
+    if (!ret) {
+        ret = std::make_shared<polyphase_filter_bank>(phases, ratio, quality);
+    }
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+resampler::resampler(double in_sr,
+                     double out_sr,
+                     size_t channels,
+                     const resampler_quality& quality)
+        : bank_{get_filter_bank(in_sr, out_sr, quality)}
+        , channels_{channels}
+        , exact_step_{0}
+        , history_(channels) {
+    if (!channels) {
+        throw std::runtime_error{"Resampler needs at least one channel."};
+    }
+
+    const auto step = bank_->get_phases() / bank_->get_ratio();
+    if (std::abs(step - std::round(step)) < 1.0e-6) {
+        exact_step_ = std::llround(step);
+    }
+
+    reset();
+}
+
+void resampler::process(const float* input,
+                        size_t frames,
+                        util::aligned::vector<float>& output) {
+    append(input, frames);
+    frames_in_ += frames;
+    produce(std::numeric_limits<std::uint64_t>::max(), output);
+}
+
+void resampler::flush(util::aligned::vector<float>& output) {
+    const auto phases = bank_->get_phases();
+    const auto total =
+            exact_step_
+                    ? (frames_in_ * phases + exact_step_ - 1) / exact_step_
+                    : static_cast<std::uint64_t>(
+                              std::ceil(frames_in_ * bank_->get_ratio()));
+
+    //  Pad with enough silence to push the last output through the filter.
+    const auto padding = bank_->get_delay() / phases + 2;
+    for (auto& i : history_) {
+        i.resize(i.size() + padding, 0.0f);
+    }
+
+    produce(total, output);
+    reset();
+}
+
+void resampler::reset() {
+    //  Start with a filter's worth of silence.
+    const auto taps = bank_->get_taps_per_phase();
+    for (auto& i : history_) {
+        i.assign(taps - 1, 0.0f);
+    }
+    history_start_ = -static_cast<std::int64_t>(taps - 1);
+    frames_in_ = 0;
+    frames_out_ = 0;
+}
+
+double resampler::get_ratio() const { return bank_->get_ratio(); }
+
+size_t resampler::get_channels() const { return channels_; }
+
+void resampler::append(const float* input, size_t frames) {
+    for (auto channel = 0u; channel != channels_; ++channel) {
+        auto& h = history_[channel];
+        const auto old_size = h.size();
+        h.resize(old_size + frames);
+        for (auto i = 0u; i != frames; ++i) {
+            h[old_size + i] = input[i * channels_ + channel];
+        }
+    }
+}
+
+namespace {
+
+/// Where an output sample falls relative to the input.
+struct filter_position final {
+    std::int64_t input_index;
+    size_t phase;
+
+    /// How far towards the next phase, for interpolated banks.
+    float alpha;
+};
+
+}  // namespace
+
+void resampler::produce(std::uint64_t limit,
+                        util::aligned::vector<float>& output) {
+    const auto phases = bank_->get_phases();
+    const auto delay = bank_->get_delay();
+    const auto taps = bank_->get_taps_per_phase();
+    const auto step = phases / bank_->get_ratio();
+    const auto available =
+            history_start_ + static_cast<std::int64_t>(history_.front().size());
+
+    //  Exact banks use integer arithmetic throughout, so that long streams
+    //  never drift.
+    const auto position = [&](std::uint64_t out) {
+        if (exact_step_) {
+            const auto m = out * exact_step_ + delay;
+            return filter_position{
+                    static_cast<std::int64_t>(m / phases), m % phases, 0};
+        }
+        const auto m = out * step + delay;
+        const auto i = std::floor(m / phases);
+        const auto f = m - i * phases;
+        const auto p = std::min(std::floor(f), phases - 1.0);
+        return filter_position{static_cast<std::int64_t>(i),
+                               static_cast<size_t>(p),
+                               static_cast<float>(f - p)};
+    };
+
+    for (; frames_out_ < limit; ++frames_out_) {
+        const auto pos = position(frames_out_);
+        if (available <= pos.input_index) {
+            break;
+        }
+
+        //  The same phase is used for every channel.
+        const auto a = bank_->get_phase(pos.phase);
+        const auto b = bank_->get_phase(pos.phase + 1);
+        const auto first = pos.input_index - static_cast<std::int64_t>(taps) +
+                           1 - history_start_;
+        for (const auto& h : history_) {
+            const auto x = h.data() + first;
+            auto y = dot(a, x, taps);
+            if (pos.alpha != 0) {
+                y += pos.alpha * (dot(b, x, taps) - y);
+            }
+            output.emplace_back(y);
+        }
+    }
+
+    //  Drop input which no future output depends on.
+    const auto keep_from = position(frames_out_).input_index -
+                           static_cast<std::int64_t>(taps) + 1;
+    const auto to_drop = std::min<std::int64_t>(
+            std::max<std::int64_t>(0, keep_from - history_start_),
+            history_.front().size());
+    for (auto& h : history_) {
+        h.erase(h.begin(), h.begin() + to_drop);
+    }
+    history_start_ += to_drop;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+util::aligned::vector<float> resample(const float* data,
+                                      size_t size,
+                                      double in_sr,
+                                      double out_sr,
+                                      const resampler_quality& quality) {
+    resampler r{in_sr, out_sr, 1, quality};
+    util::aligned::vector<float> ret;
+    ret.reserve(std::ceil(size * r.get_ratio()) + 1);
+    r.process(data, size, ret);
+    r.flush(ret);
+    return ret;
+}
+
+}  // namespace core
+}  // namespace wayverb
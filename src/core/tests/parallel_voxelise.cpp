@@ -0,0 +1,56 @@
+#include "core/scene_data_loader.h"
+#include "core/spatial_division/voxel_collection.h"
+#include "core/spatial_division/voxelised_scene_data.h"
+
+#include "gtest/gtest.h"
+
+#include <numeric>
+
+#ifndef OBJ_PATH
+#define OBJ_PATH ""
+#endif
+
+using namespace wayverb::core;
+
+namespace {
+
+/// Builds voxels the simple way: on one thread, with the full overlap test
+/// for every triangle.
+template <typename Vertex, typename Surface>
+auto reference_voxels(const generic_scene_data<Vertex, Surface>& scene,
+                      size_t octree_depth,
+                      const geo::box& aabb) {
+    util::aligned::vector<size_t> indices(scene.get_triangles().size());
+    std::iota(indices.begin(), indices.end(), 0);
+
+    const ndim_tree<3>::item_checker checker = [&](auto item,
+                                                   const auto& aabb) {
+        return geo::overlaps(padded(aabb, glm::vec3{0.001}),
+                             geo::get_triangle_vec3(
+                                     scene.get_triangles()[item],
+                                     scene.get_vertices().data()));
+    };
+
+    return voxel_collection<3>{
+            ndim_tree<3>{octree_depth, checker, indices, aabb, 0}};
+}
+
+TEST(parallel_voxelise, matches_reference) {
+    const util::aligned::vector<scene_data_loader::scene_data> scenes{
+            geo::get_scene_data(geo::box{glm::vec3(0), glm::vec3(4, 3, 6)},
+                                std::string{"default"}),
+            *scene_data_loader{OBJ_PATH}.get_scene_data()};
+
+    for (const auto& scene : scenes) {
+        for (const auto depth : {0u, 1u, 3u, 5u}) {
+            const auto aabb = padded(geo::compute_aabb(scene.get_vertices()),
+                                     glm::vec3{0.1f});
+            const auto voxelised =
+                    make_voxelised_scene_data(scene, depth, aabb);
+            ASSERT_EQ(get_flattened(voxelised.get_voxels()),
+                      get_flattened(reference_voxels(scene, depth, aabb)));
+        }
+    }
+}
+
+}  // namespace
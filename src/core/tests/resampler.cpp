@@ -0,0 +1,122 @@
+#include "core/resampler.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+using namespace wayverb::core;
+
+namespace {
+
+auto make_sine(double frequency, double sample_rate, size_t length) {
+    util::aligned::vector<float> ret(length);
+    for (auto i = 0u; i != length; ++i) {
+        ret[i] = std::sin(2 * M_PI * frequency * i / sample_rate);
+    }
+    return ret;
+}
+
+TEST(resampler, rational_ratio) {
+    ASSERT_EQ(rational_ratio(1000, 2000), std::make_pair(size_t{2}, size_t{1}));
+    ASSERT_EQ(rational_ratio(44100, 48000),
+              std::make_pair(size_t{160}, size_t{147}));
+    ASSERT_EQ(rational_ratio(48000, 44100),
+              std::make_pair(size_t{147}, size_t{160}));
+
+    //  Awkward ratios are approximated closely.
+    const auto r = rational_ratio(1774.2, 44100);
+    ASSERT_NEAR(static_cast<double>(r.first) / r.second,
+                44100 / 1774.2,
+                44100 / 1774.2 * 1.0e-5);
+
+    ASSERT_THROW(rational_ratio(0, 44100), std::exception);
+}
+
+TEST(resampler, sine) {
+    for (const auto& rates : {std::make_pair(1000.0, 2000.0),
+                              std::make_pair(44100.0, 48000.0),
+                              std::make_pair(48000.0, 44100.0),
+                              std::make_pair(44100.0, 8000.0),
+                              std::make_pair(1774.2, 44100.0),
+                              std::make_pair(44100.0, 1774.2)}) {
+        const auto in_sr = rates.first;
+        const auto out_sr = rates.second;
+        const auto frequency = 0.1 * std::min(in_sr, out_sr);
+
+        const auto input = make_sine(frequency, in_sr, 20000);
+        const auto output = resample(
+                input.data(), input.size(), in_sr, out_sr, resampler_best);
+
+        ASSERT_NEAR(output.size(), std::ceil(input.size() * out_sr / in_sr), 1);
+
+        //  Ignore the ends, where the filter runs off the signal.
+        const auto expected = make_sine(frequency, out_sr, output.size());
+        for (auto i = output.size() / 4; i != output.size() * 3 / 4; ++i) {
+            ASSERT_NEAR(output[i], expected[i], 1.0e-4);
+        }
+    }
+}
+
+TEST(resampler, streaming_multichannel) {
+    constexpr auto in_sr = 44100.0;
+    constexpr auto out_sr = 48000.0;
+    const auto a = make_sine(1000, in_sr, 5000);
+    const auto b = make_sine(3000, in_sr, 5000);
+
+    util::aligned::vector<float> interleaved;
+    for (auto i = 0u; i != a.size(); ++i) {
+        interleaved.emplace_back(a[i]);
+        interleaved.emplace_back(b[i]);
+    }
+
+    //  Feed in uneven blocks.
+    resampler r{in_sr, out_sr, 2};
+    util::aligned::vector<float> output;
+    for (auto i = 0u; i < a.size(); i += 333) {
+        const auto frames = std::min(a.size() - i, size_t{333});
+        r.process(interleaved.data() + i * 2, frames, output);
+    }
+    r.flush(output);
+
+    const auto expected_a = resample(a.data(), a.size(), in_sr, out_sr);
+    const auto expected_b = resample(b.data(), b.size(), in_sr, out_sr);
+
+    ASSERT_EQ(output.size(), expected_a.size() * 2);
+    for (auto i = 0u; i != expected_a.size(); ++i) {
+        ASSERT_EQ(output[i * 2 + 0], expected_a[i]);
+        ASSERT_EQ(output[i * 2 + 1], expected_b[i]);
+    }
+}
+
+TEST(resampler, cache) {
+    const auto a = get_filter_bank(44100, 48000, resampler_fast);
+    const auto b = get_filter_bank(88200, 96000, resampler_fast);
+    const auto c = get_filter_bank(44100, 48000, resampler_best);
+    ASSERT_EQ(a, b);
+    ASSERT_NE(a, c);
+}
+
+TEST(resampler, interpolated_streaming) {
+    //  Irrational ratios shouldn't depend on how the input is split up.
+    constexpr auto in_sr = 1774.2;
+    constexpr auto out_sr = 44100.0;
+    const auto input = make_sine(100, in_sr, 2000);
+
+    resampler r{in_sr, out_sr};
+    util::aligned::vector<float> output;
+    for (auto i = 0u; i < input.size(); i += 77) {
+        r.process(input.data() + i, std::min(input.size() - i, size_t{77}),
+                  output);
+    }
+    r.flush(output);
+
+    ASSERT_EQ(output, resample(input.data(), input.size(), in_sr, out_sr));
+}
+
+TEST(resampler, bad_quality) {
+    ASSERT_THROW((resampler{44100, 48000, 1, resampler_quality{1.5, 100}}),
+                 std::exception);
+    ASSERT_THROW((resampler{44100, 48000, 0}), std::exception);
+}
+
+}  // namespace
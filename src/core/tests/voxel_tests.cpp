@@ -200,6 +200,44 @@ void compare(const glm::vec3& source,
     ASSERT_EQ(problematic.size(), 0);
 }
 
+TEST(voxel, closest_triangle) {
+    std::default_random_engine engine{std::random_device{}()};
+    for (const auto& scene : get_test_scenes()) {
+        const auto voxelised = get_voxelised(scene);
+        const auto aabb = voxelised.get_voxels().get_aabb();
+        std::uniform_real_distribution<float> x{aabb.get_min().x,
+                                                aabb.get_max().x};
+        std::uniform_real_distribution<float> y{aabb.get_min().y,
+                                                aabb.get_max().y};
+        std::uniform_real_distribution<float> z{aabb.get_min().z,
+                                                aabb.get_max().z};
+
+        const auto& triangles = scene.get_triangles();
+        const auto& vertices = scene.get_vertices();
+
+        for (auto i = 0; i != 1000; ++i) {
+            const glm::vec3 pt{x(engine), y(engine), z(engine)};
+
+            //  brute force
+            size_t expected{0};
+            auto expected_distance = std::numeric_limits<float>::infinity();
+            for (auto j = 0u; j != triangles.size(); ++j) {
+                const auto d = geo::point_triangle_distance_squared(
+                        geo::get_triangle_vec3(triangles[j], vertices.data()),
+                        pt);
+                if (d < expected_distance) {
+                    expected = j;
+                    expected_distance = d;
+                }
+            }
+
+            const auto actual = closest_triangle(voxelised, pt);
+            ASSERT_TRUE(actual);
+            ASSERT_EQ(*actual, expected);
+        }
+    }
+}
+
 TEST(voxel, compare) {
     for (const auto& source :
          {glm::vec3{-100, -100, -100}, glm::vec3{100, 100, 100}}) {
@@ -0,0 +1,149 @@
+#include "core/cl/work_group_tuner.h"
+#include "core/program_wrapper.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#ifndef SCRATCH_PATH
+#define SCRATCH_PATH ""
+#endif
+
+using namespace wayverb::core;
+
+namespace {
+
+TEST(work_group_tuner, size_class) {
+    ASSERT_EQ(compute_size_class(1), 0u);
+    ASSERT_EQ(compute_size_class(2), 1u);
+    ASSERT_EQ(compute_size_class(1000), 9u);
+    ASSERT_EQ(compute_size_class(1024), 10u);
+    ASSERT_EQ(compute_size_class(1025), 10u);
+}
+
+TEST(work_group_tuner, candidates) {
+    //  The runtime default is always a candidate.
+    ASSERT_EQ(compute_candidate_local_sizes(1, 256),
+              (util::aligned::vector<size_t>{0}));
+
+    //  Sizes needn't divide the global size, but aren't larger than it, or
+    //  than the device limit.
+    ASSERT_EQ(compute_candidate_local_sizes(96, 256),
+              (util::aligned::vector<size_t>{0, 16, 32, 64}));
+    ASSERT_EQ(compute_candidate_local_sizes(1001, 256),
+              (util::aligned::vector<size_t>{0, 16, 32, 64, 128, 256}));
+    ASSERT_EQ(compute_candidate_local_sizes(1 << 20, 256),
+              (util::aligned::vector<size_t>{0, 16, 32, 64, 128, 256}));
+}
+
+TEST(work_group_tuner, padded_global_size) {
+    ASSERT_EQ(compute_padded_global_size(1001, 0), 1001u);
+    ASSERT_EQ(compute_padded_global_size(1001, 16), 1008u);
+    ASSERT_EQ(compute_padded_global_size(1024, 256), 1024u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const std::string source{R"(
+kernel void increment(global float* x, uint n) {
+    if (get_global_id(0) >= n) {
+        return;
+    }
+    x[get_global_id(0)] += 1;
+}
+)"};
+
+class tuner_test : public ::testing::Test {
+protected:
+    ~tuner_test() noexcept { std::remove(cache_file.c_str()); }
+
+    //  Launches the increment kernel on a buffer of zeros, 'count' times.
+    //  Every element should end up equal to count.
+    auto run(work_group_tuner& tuner, size_t count) {
+        auto kernel = wrapper.get_kernel<cl::Buffer, cl_uint>("increment");
+        cl::CommandQueue queue{cc.context, cc.device};
+        auto buffer = load_to_buffer(
+                cc.context, util::aligned::vector<cl_float>(items, 0), false);
+        for (auto i = 0u; i != count; ++i) {
+            tuner(queue, "increment", items, [&](const auto& args) {
+                return kernel(args, buffer, cl_uint{items});
+            });
+        }
+        return read_from_buffer<cl_float>(queue, buffer);
+    }
+
+    const compute_context cc{};
+    const program_wrapper wrapper{cc, source};
+    const std::string cache_file{std::string{SCRATCH_PATH} +
+                                 "/work_group_tuner_test.txt"};
+    //  Not a multiple of any candidate, so every tuned launch is padded.
+    static constexpr size_t items = (1 << 16) + 1;
+};
+
+TEST_F(tuner_test, tunes_and_persists) {
+    std::remove(cache_file.c_str());
+
+    const auto candidates = compute_candidate_local_sizes(
+            items, cc.device.getInfo<CL_DEVICE_MAX_WORK_GROUP_SIZE>());
+    const auto tuning_launches =
+            candidates.size() * work_group_tuner::samples_per_candidate;
+    const auto launches = tuning_launches + 10;
+
+    {
+        work_group_tuner tuner{cache_file};
+        const auto result = run(tuner, launches);
+
+        //  Every launch ran exactly once, tuning or not.
+        ASSERT_TRUE(std::all_of(result.begin(), result.end(), [&](auto i) {
+            return i == launches;
+        }));
+
+        //  Rejected candidates aren't timed, so there may be fewer timed
+        //  launches than candidate samples.
+        const auto statistics = tuner.get_statistics();
+        ASSERT_LE(statistics.timed, tuning_launches);
+        ASSERT_EQ(statistics.timed + statistics.tuned, launches);
+    }
+
+    {
+        //  A fresh tuner picks up the timings from the cache file.
+        work_group_tuner tuner{cache_file};
+        run(tuner, 5);
+        ASSERT_EQ(tuner.get_statistics().timed, 0u);
+        ASSERT_EQ(tuner.get_statistics().tuned, 5u);
+    }
+}
+
+TEST_F(tuner_test, override) {
+    work_group_tuner tuner{};
+    for (const auto local_size : {size_t{0}, size_t{16}}) {
+        tuner.set_override(local_size);
+        const auto result = run(tuner, 5);
+        ASSERT_TRUE(std::all_of(
+                result.begin(), result.end(), [](auto i) { return i == 5; }));
+    }
+    ASSERT_EQ(tuner.get_statistics().timed, 0u);
+
+    tuner.set_override(std::nullopt);
+    run(tuner, 1);
+    ASSERT_EQ(tuner.get_statistics().timed, 1u);
+}
+
+TEST_F(tuner_test, tuned_kernel) {
+    //  Kernels from a program wrapper can be launched either way.
+    auto kernel = wrapper.get_kernel<cl::Buffer, cl_uint>("increment");
+    ASSERT_EQ(kernel.get_name(), "increment");
+
+    cl::CommandQueue queue{cc.context, cc.device};
+    auto buffer = load_to_buffer(
+            cc.context, util::aligned::vector<cl_float>(items, 0), false);
+    kernel(cl::EnqueueArgs{queue, cl::NDRange{items}}, buffer, cl_uint{items});
+    kernel(queue, items, buffer, cl_uint{items});
+
+    const auto result = read_from_buffer<cl_float>(queue, buffer);
+    ASSERT_TRUE(std::all_of(
+            result.begin(), result.end(), [](auto i) { return i == 2; }));
+}
+
+}  // namespace
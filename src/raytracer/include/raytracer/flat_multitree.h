@@ -0,0 +1,336 @@
+#pragma once
+
+#include "utilities/aligned/vector.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace wayverb {
+namespace raytracer {
+
+template <typename T>
+class flat_multitree;
+
+template <typename T>
+struct flat_multitree_branch;
+
+/// The branches of a node in a flat_multitree, which occupy a contiguous
+/// range of the tree's node array.
+template <typename T>
+class flat_multitree_branches final {
+public:
+    class const_iterator final {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = flat_multitree_branch<T>;
+        using difference_type = std::ptrdiff_t;
+        using reference = value_type;
+
+        /// Branches are views, created on the fly, so -> has to hold on to
+        /// the view it points to.
+        struct pointer final {
+            value_type branch;
+            const value_type* operator->() const { return &branch; }
+        };
+
+        const_iterator() = default;
+        const_iterator(const flat_multitree<T>* tree, size_t index)
+                : tree_{tree}
+                , index_{index} {}
+
+        reference operator*() const { return tree_->get_branch(index_); }
+        pointer operator->() const { return pointer{**this}; }
+
+        const_iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+
+        const_iterator operator++(int) {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        bool operator==(const const_iterator& other) const {
+            return index_ == other.index_;
+        }
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const flat_multitree<T>* tree_{nullptr};
+        size_t index_{0};
+    };
+
+    flat_multitree_branches(const flat_multitree<T>* tree, size_t b, size_t e)
+            : tree_{tree}
+            , b_{b}
+            , e_{e} {}
+
+    const_iterator begin() const { return {tree_, b_}; }
+    const_iterator end() const { return {tree_, e_}; }
+
+    size_t size() const { return e_ - b_; }
+    bool empty() const { return b_ == e_; }
+
+    friend const_iterator begin(const flat_multitree_branches& x) {
+        return x.begin();
+    }
+    friend const_iterator end(const flat_multitree_branches& x) {
+        return x.end();
+    }
+
+private:
+    const flat_multitree<T>* tree_;
+    size_t b_;
+    size_t e_;
+};
+
+/// A view of a single node, with the same members as a multitree node, so
+/// it can be traversed in the same way.
+template <typename T>
+struct flat_multitree_branch final {
+    const T& item;
+    flat_multitree_branches<T> branches;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// A multitree stored in a single contiguous array, rather than with one
+/// allocation per node.
+/// Nodes are laid out breadth-first, so the branches of each node sit in a
+/// contiguous range, sorted by item.
+/// Like multitree, items are keyed using operator<, and when two paths
+/// share a node the item which was added first is kept.
+/// Adding paths to a flat tree would mean moving most of the existing nodes,
+/// so trees are built from whole collections of paths at a time, and
+/// combined with a single merge of many trees at once.
+template <typename T>
+class flat_multitree final {
+public:
+    struct node final {
+        T item;
+        size_t branches_begin;
+        size_t branches_end;
+    };
+
+    explicit flat_multitree(T item = T{})
+            : nodes_{node{std::move(item), 1, 1}} {}
+
+    /// Builds a tree from a range of paths, where each path is a range of
+    /// items.
+    template <typename It>
+    static flat_multitree from_paths(It b, It e, T item = T{}) {
+        //  Keep track of the order in which paths were added.
+        //  Paths are sorted through these entries, so the paths themselves
+        //  never have to be copied.
+        struct entry final {
+            It path;
+            size_t order;
+            T key;
+        };
+        util::aligned::vector<entry> sorted;
+        sorted.reserve(std::distance(b, e));
+        for (auto order = 0u; b != e; ++b, ++order) {
+            sorted.emplace_back(entry{b, order, T{}});
+        }
+
+        flat_multitree ret{std::move(item)};
+
+        struct pending final {
+            size_t node;
+            size_t b;
+            size_t e;
+        };
+        util::aligned::vector<pending> current{pending{0, 0, sorted.size()}};
+        util::aligned::vector<pending> next;
+
+        //  This is a most-significant-digit-first sort, one level at a time.
+        //  Each node's paths are sorted by the item at the current depth, so
+        //  that paths which share the next node end up next to one another.
+        for (size_t depth = 0; !current.empty(); ++depth) {
+            next.clear();
+            for (const auto& p : current) {
+                //  All paths in the range share a prefix of length 'depth'.
+                //  Move the ones which end here out of the way.
+                const auto b = std::partition(
+                        sorted.begin() + p.b,
+                        sorted.begin() + p.e,
+                        [&](const auto& i) {
+                            return path_size(*i.path) == depth;
+                        });
+
+                //  Copy out the items at this depth, so that sorting doesn't
+                //  have to chase pointers.
+                std::for_each(b, sorted.begin() + p.e, [&](auto& i) {
+                    i.key = item_at(*i.path, depth);
+                });
+                std::sort(b,
+                          sorted.begin() + p.e,
+                          [](const auto& i, const auto& j) {
+                              return i.key < j.key;
+                          });
+
+                ret.nodes_[p.node].branches_begin = ret.nodes_.size();
+                for (auto i = static_cast<size_t>(b - sorted.begin());
+                     i != p.e;) {
+                    //  Where several paths share this node, use the item
+                    //  from the one which was added first.
+                    auto first = i;
+                    auto j = i + 1;
+                    for (; j != p.e && !(sorted[i].key < sorted[j].key); ++j) {
+                        if (sorted[j].order < sorted[first].order) {
+                            first = j;
+                        }
+                    }
+
+                    next.emplace_back(pending{ret.nodes_.size(), i, j});
+                    ret.nodes_.emplace_back(node{sorted[first].key, 0, 0});
+                    i = j;
+                }
+                ret.nodes_[p.node].branches_end = ret.nodes_.size();
+            }
+            std::swap(current, next);
+        }
+
+        return ret;
+    }
+
+    /// Combines a range of trees into one, in a single pass over all of them.
+    /// Where several trees contain the same node, the item from the earliest
+    /// tree is kept.
+    template <typename It>
+    static flat_multitree merge(It b, It e) {
+        util::aligned::vector<const flat_multitree*> trees;
+        for (; b != e; ++b) {
+            trees.emplace_back(&*b);
+        }
+        if (trees.empty()) {
+            return flat_multitree{};
+        }
+
+        flat_multitree ret{trees.front()->get_item()};
+
+        //  The nodes in the input trees which make up each output node.
+        struct source final {
+            size_t tree;
+            size_t node;
+        };
+        util::aligned::vector<source> current_sources;
+        for (size_t i = 0; i != trees.size(); ++i) {
+            current_sources.emplace_back(source{i, 0});
+        }
+        util::aligned::vector<source> next_sources;
+
+        struct pending final {
+            size_t node;
+            size_t b;
+            size_t e;
+        };
+        util::aligned::vector<pending> current{
+                pending{0, 0, current_sources.size()}};
+        util::aligned::vector<pending> next;
+
+        const auto get_item = [&](const source& s) -> const T& {
+            return trees[s.tree]->nodes_[s.node].item;
+        };
+
+        util::aligned::vector<source> branches;
+        while (!current.empty()) {
+            next.clear();
+            next_sources.clear();
+            for (const auto& p : current) {
+                //  Each tree's branches are already sorted, so this is a
+                //  k-way merge.
+                //  Sources are in tree order, and the sort is stable, so
+                //  equal items stay in tree order too.
+                branches.clear();
+                for (auto i = p.b; i != p.e; ++i) {
+                    const auto& s = current_sources[i];
+                    const auto& n = trees[s.tree]->nodes_[s.node];
+                    for (auto j = n.branches_begin; j != n.branches_end; ++j) {
+                        branches.emplace_back(source{s.tree, j});
+                    }
+                }
+                std::stable_sort(branches.begin(),
+                                 branches.end(),
+                                 [&](const auto& i, const auto& j) {
+                                     return get_item(i) < get_item(j);
+                                 });
+
+                ret.nodes_[p.node].branches_begin = ret.nodes_.size();
+                for (auto i = branches.begin(); i != branches.end();) {
+                    const auto j = std::find_if(i, branches.end(), [&](auto x) {
+                        return get_item(*i) < get_item(x);
+                    });
+                    next.emplace_back(pending{ret.nodes_.size(),
+                                              next_sources.size(),
+                                              next_sources.size() +
+                                                      std::distance(i, j)});
+                    next_sources.insert(next_sources.end(), i, j);
+                    ret.nodes_.emplace_back(node{get_item(*i), 0, 0});
+                    i = j;
+                }
+                ret.nodes_[p.node].branches_end = ret.nodes_.size();
+            }
+            std::swap(current, next);
+            std::swap(current_sources, next_sources);
+        }
+
+        return ret;
+    }
+
+    const T& get_item() const { return nodes_.front().item; }
+    flat_multitree_branches<T> get_branches() const {
+        return get_branches(0);
+    }
+
+    /// The number of nodes, not including the root.
+    size_t size() const { return nodes_.size() - 1; }
+
+    /// The underlying storage, in breadth-first order, starting with the root.
+    const util::aligned::vector<node>& get_nodes() const { return nodes_; }
+
+    flat_multitree_branch<T> get_branch(size_t i) const {
+        return {nodes_[i].item, get_branches(i)};
+    }
+
+    flat_multitree_branches<T> get_branches(size_t i) const {
+        return {this, nodes_[i].branches_begin, nodes_[i].branches_end};
+    }
+
+private:
+    template <typename Path>
+    static size_t path_size(const Path& path) {
+        return std::distance(std::begin(path), std::end(path));
+    }
+
+    template <typename Path>
+    static const T& item_at(const Path& path, size_t i) {
+        return *std::next(std::begin(path), i);
+    }
+
+    util::aligned::vector<node> nodes_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Works just like traverse_multitree for multitree nodes.
+template <typename T, typename Callback>
+void traverse_multitree(const flat_multitree_branch<T>& tree,
+                        const Callback& callback) {
+    for (const auto& i : tree.branches) {
+        traverse_multitree(i, callback(i.item));
+    }
+}
+
+template <typename T, typename Callback>
+void traverse_multitree(const flat_multitree<T>& tree,
+                        const Callback& callback) {
+    traverse_multitree(tree.get_branch(0), callback);
+}
+
+}  // namespace raytracer
+}  // namespace wayverb
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "raytracer/image_source/program.h"
+#include "raytracer/image_source/tree.h"
+
+#include "core/spatial_division/scene_buffers.h"
+
+#include "utilities/aligned/vector.h"
+
+namespace wayverb {
+namespace raytracer {
+namespace image_source {
+
+/// Every candidate path in a multitree, flattened into arrays which can be
+/// copied to the device.
+/// Candidate i reflects from triangles[offsets[i]] to
+/// triangles[offsets[i + 1] - 1], in order from the source.
+struct flattened_paths final {
+    util::aligned::vector<cl_uint> offsets{0};
+    util::aligned::vector<cl_uint> triangles;
+};
+
+/// Adds a candidate for every visible node in the tree, in the same order
+/// that find_valid_paths visits them.
+void flatten_paths(const tree_branch& tree, flattened_paths& ret);
+
+template <typename It>
+flattened_paths flatten_paths(It b_branches, It e_branches) {
+    flattened_paths ret;
+    for (; b_branches != e_branches; ++b_branches) {
+        flatten_paths(*b_branches, ret);
+    }
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Checks candidate image-source paths on the device.
+/// Gives the same results as the find_valid_paths host traversal, in the same
+/// order, but without recursion or per-path allocation.
+/// The scene buffers must be made from the same scene, and must outlive the
+/// validator.
+class path_validator final {
+public:
+    using vsd =
+            core::voxelised_scene_data<cl_float3,
+                                       core::surface<core::simulation_bands>>;
+
+    path_validator(const core::compute_context& cc,
+                   const vsd& voxelised,
+                   const core::scene_buffers& buffers);
+
+    /// Calls the callback for every valid path, in candidate order.
+    void find_valid_paths(const flattened_paths& paths,
+                          const glm::vec3& source,
+                          const glm::vec3& receiver,
+                          const postprocessor& callback);
+
+    /// The maximum number of candidates checked by one kernel launch.
+    static constexpr size_t batch_size = 1 << 16;
+
+private:
+    void find_valid_paths(const flattened_paths& paths,
+                          size_t b,
+                          size_t e,
+                          const glm::vec3& source,
+                          const glm::vec3& receiver,
+                          const postprocessor& callback);
+
+    using kernel_t =
+            decltype(std::declval<program>().get_validate_paths_kernel());
+
+    core::compute_context cc_;
+    cl::CommandQueue queue_;
+    kernel_t kernel_;
+    const vsd& voxelised_;
+    const core::scene_buffers& buffers_;
+};
+
+}  // namespace image_source
+}  // namespace raytracer
+}  // namespace wayverb
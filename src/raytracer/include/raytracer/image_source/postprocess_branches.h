@@ -1,6 +1,7 @@
 #pragma once
 
 #include "raytracer/cl/structs.h"
+#include "raytracer/image_source/device_validation.h"
 #include "raytracer/image_source/tree.h"
 
 #include "core/callback_accumulator.h"
@@ -15,7 +16,7 @@ namespace raytracer {
 namespace image_source {
 
 util::aligned::vector<impulse<core::simulation_bands>> postprocess_branches(
-        const multitree<path_element>& tree,
+        const tree_branch& tree,
         const glm::vec3& source,
         const glm::vec3& receiver,
         const core::voxelised_scene_data<cl_float3,
@@ -33,16 +34,16 @@ auto postprocess_branches(
                                          core::surface<core::simulation_bands>>&
                 voxelised,
         bool flip_phase) {
-    auto futures = util::map_to_vector(
-            b_branches, e_branches, [&](const auto& branch) {
-                return std::async(std::launch::async, [&] {
-                    return postprocess_branches(
-                            branch, source, receiver, voxelised, flip_phase);
-                });
-            });
-
-    using value_type = decltype(
-            std::declval<typename decltype(futures)::value_type>().get());
+    //  Branches may be views which only live as long as the dereference, so
+    //  each thread holds on to an iterator instead.
+    using value_type = util::aligned::vector<impulse<core::simulation_bands>>;
+    util::aligned::vector<std::future<value_type>> futures;
+    for (auto it = b_branches; it != e_branches; ++it) {
+        futures.emplace_back(std::async(std::launch::async, [&, it] {
+            return postprocess_branches(
+                    *it, source, receiver, voxelised, flip_phase);
+        }));
+    }
 
     //  Collect futures.
     value_type ret;
@@ -54,6 +55,44 @@ auto postprocess_branches(
     return ret;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+/// Validates flattened candidate paths on the device, rather than walking the
+/// tree on the host.
+util::aligned::vector<impulse<core::simulation_bands>> postprocess_paths(
+        const core::compute_context& cc,
+        const flattened_paths& paths,
+        const glm::vec3& source,
+        const glm::vec3& receiver,
+        const core::voxelised_scene_data<cl_float3,
+                                         core::surface<core::simulation_bands>>&
+                voxelised,
+        const core::scene_buffers& buffers,
+        bool flip_phase);
+
+/// Like the host version, but every branch is checked by a single device
+/// kernel. Results come back in the same order.
+template <typename It>
+auto postprocess_branches(
+        const core::compute_context& cc,
+        It b_branches,
+        It e_branches,
+        const glm::vec3& source,
+        const glm::vec3& receiver,
+        const core::voxelised_scene_data<cl_float3,
+                                         core::surface<core::simulation_bands>>&
+                voxelised,
+        const core::scene_buffers& buffers,
+        bool flip_phase) {
+    return postprocess_paths(cc,
+                             flatten_paths(b_branches, e_branches),
+                             source,
+                             receiver,
+                             voxelised,
+                             buffers,
+                             flip_phase);
+}
+
 }  // namespace image_source
 }  // namespace raytracer
 }  // namespace wayverb
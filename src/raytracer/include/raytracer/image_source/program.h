@@ -0,0 +1,40 @@
+#pragma once
+
+#include "core/program_wrapper.h"
+#include "core/spatial_division/scene_buffers.h"
+
+namespace wayverb {
+namespace raytracer {
+namespace image_source {
+
+class program final {
+public:
+    program(const core::compute_context& cc);
+
+    auto get_validate_paths_kernel() const {
+        return program_wrapper_.get_kernel<cl::Buffer,  //  path offsets
+                                           cl::Buffer,  //  path triangles
+                                           cl::Buffer,  //  image sources
+                                           cl_float3,   //  source
+                                           cl_float3,   //  receiver
+                                           cl::Buffer,  //  voxel_index
+                                           core::aabb,  //  global_aabb
+                                           cl_uint,     //  side
+                                           cl::Buffer,  //  triangles
+                                           cl::Buffer,  //  vertices
+                                           cl::Buffer,  //  counts
+                                           cl::Buffer,  //  valid paths
+                                           cl::Buffer,  //  valid offsets
+                                           cl::Buffer,  //  valid images
+                                           cl::Buffer,  //  valid angles
+                                           cl_uint      //  num paths
+                                           >("validate_paths");
+    }
+
+private:
+    core::program_wrapper program_wrapper_;
+};
+
+}  // namespace image_source
+}  // namespace raytracer
+}  // namespace wayverb
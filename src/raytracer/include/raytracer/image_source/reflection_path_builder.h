@@ -2,6 +2,7 @@
 
 #include "raytracer/image_source/tree.h"
 #include "raytracer/iterative_builder.h"
+#include "raytracer/live_reflections.h"
 
 namespace wayverb {
 namespace raytracer {
@@ -12,15 +13,15 @@ public:
     reflection_path_builder(size_t rays)
             : reflection_path_builder_{rays} {}
 
-    template <typename It>
-    void push(It b, It e) {
-        reflection_path_builder_.push(b, e, [](const reflection& i) {
-            return i.keep_going
-                           ? std::make_optional(path_element{
-                                     i.triangle,
-                                     static_cast<bool>(i.receiver_visible)})
-                           : std::nullopt;
-        });
+    void push(const live_reflections& live) {
+        reflection_path_builder_.push_indexed(
+                begin(live.rays),
+                end(live.rays),
+                begin(live.reflections),
+                [](const reflection& i) {
+                    return path_element{i.triangle,
+                                        static_cast<bool>(i.receiver_visible)};
+                });
     }
 
     const auto& get_data() const { return reflection_path_builder_.get_data(); }
@@ -1,7 +1,7 @@
 #pragma once
 
 #include "raytracer/image_source/fast_pressure_calculator.h"
-#include "raytracer/multitree.h"
+#include "raytracer/flat_multitree.h"
 
 #include "core/cl/include.h"
 #include "core/geo/triangle_vec.h"
@@ -39,13 +39,20 @@ constexpr bool operator<(const path_element& a, const path_element& b) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+using tree_branch = flat_multitree_branch<path_element>;
+
+/// Holds every candidate image-source path found by the raytracer.
+/// Each push sorts and deduplicates its paths into a flat tree of their own.
+/// The trees are merged into one when they are needed.
 class tree final {
 public:
-    void push(const util::aligned::vector<path_element>& path);
-    const multitree<path_element>::branches_type& get_branches() const;
+    void push(const util::aligned::vector<util::aligned::vector<path_element>>&
+                      paths);
+
+    flat_multitree<path_element> build() const;
 
 private:
-    multitree<path_element> root_{path_element{}};
+    util::aligned::vector<flat_multitree<path_element>> segments_;
 };
 
 using postprocessor = std::function<void(
@@ -54,7 +61,7 @@ using postprocessor = std::function<void(
         util::aligned::vector<reflection_metadata>::const_iterator)>;
 
 void find_valid_paths(
-        const multitree<path_element>& tree,
+        const tree_branch& tree,
         const glm::vec3& source,
         const glm::vec3& receiver,
         const core::voxelised_scene_data<cl_float3,
@@ -32,6 +32,19 @@ public:
         push(b, e, [](const auto& i) -> const auto& { return i; });
     }
 
+    /// Adds func(*b) to the item with index *i_b, for each index in the range.
+    /// Items which aren't indexed get nothing.
+    template <typename IndexIt, typename It, typename Func>
+    void push_indexed(IndexIt i_b, IndexIt i_e, It b, const Func& func) {
+        for (; i_b != i_e; ++i_b, ++b) {
+            if (get_num_items() <= *i_b) {
+                throw std::runtime_error{
+                        "Index out of range in iterative_builder."};
+            }
+            push_item(*i_b, func(*b));
+        }
+    }
+
     const auto& get_data() const { return data_; }
     auto& get_data() { return data_; }
 
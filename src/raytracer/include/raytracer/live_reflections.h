@@ -0,0 +1,36 @@
+#pragma once
+
+#include "raytracer/cl/structs.h"
+
+#include "utilities/aligned/vector.h"
+
+namespace wayverb {
+namespace raytracer {
+
+/// The reflections found by one step of the reflector, for only those rays
+/// which are still going.
+/// Rays which have escaped or stopped are left out entirely, so later steps
+/// get cheaper as rays die.
+/// rays[i] is the index of the ray which produced reflections[i], and the
+/// entries are sorted by ray index.
+struct live_reflections final {
+    util::aligned::vector<cl_uint> rays;
+    util::aligned::vector<reflection> reflections;
+};
+
+/// Builds the live reflections from a range with one reflection per ray,
+/// like the ones the reflector used to return.
+template <typename It>
+live_reflections make_live_reflections(It b, It e) {
+    live_reflections ret;
+    for (auto i = 0u; b != e; ++b, ++i) {
+        if (b->keep_going) {
+            ret.rays.emplace_back(i);
+            ret.reflections.emplace_back(*b);
+        }
+    }
+    return ret;
+}
+
+}  // namespace raytracer
+}  // namespace wayverb
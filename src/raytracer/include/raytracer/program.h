@@ -13,7 +13,8 @@ public:
     program(const core::compute_context& cc);
 
     auto get_kernel() const {
-        return program_wrapper_.get_kernel<cl::Buffer,  //  ray
+        return program_wrapper_.get_kernel<cl::Buffer,  //  live rays
+                                           cl::Buffer,  //  ray
                                            cl_float3,   //  receiver
                                            cl::Buffer,  //  voxel_index
                                            core::aabb,  //  global_aabb
@@ -22,12 +23,25 @@ public:
                                            cl::Buffer,  //  vertices
                                            cl::Buffer,  //  surfaces
                                            cl::Buffer,  //  rng
-                                           cl::Buffer   //  reflection
+                                           cl::Buffer,  //  reflection
+                                           cl_uint      //  num live rays
                                            >("reflections");
     }
 
     auto get_init_reflections_kernel() const {
-        return program_wrapper_.get_kernel<cl::Buffer>("init_reflections");
+        return program_wrapper_.get_kernel<cl::Buffer,  //  reflections
+                                           cl_uint      //  num rays
+                                           >("init_reflections");
+    }
+
+    auto get_compact_reflections_kernel() const {
+        return program_wrapper_.get_kernel<cl::Buffer,  //  live rays
+                                           cl::Buffer,  //  reflections
+                                           cl::Buffer,  //  next live rays
+                                           cl::Buffer,  //  live reflections
+                                           cl::Buffer,  //  live count
+                                           cl_uint      //  num live rays
+                                           >("compact_reflections");
     }
 
     template <cl_program_info T>
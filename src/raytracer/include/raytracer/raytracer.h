@@ -19,6 +19,9 @@
 #include "utilities/apply.h"
 #include "utilities/map.h"
 
+#include <algorithm>
+#include <deque>
+#include <future>
 #include <optional>
 #include <iostream>
 
@@ -185,6 +188,13 @@ constexpr auto make_random_direction_generator_iterator(
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Segments are traced on their own threads and command queues, so that the
+/// device can trace one segment while the host is still processing the
+/// reflections of another.
+/// Each segment in flight holds its own rays and group processors, so this
+/// also bounds memory use.
+constexpr size_t default_segments_in_flight = 2;
+
 template <typename It, typename PerStepCallback, typename Callbacks>
 auto run(
         It b_direction,
@@ -198,7 +208,8 @@ auto run(
         const core::environment& environment,
         const std::atomic_bool& keep_going,
         PerStepCallback&& per_step_callback,
-        Callbacks&& callbacks) {
+        Callbacks&& callbacks,
+        size_t segments_in_flight = default_segments_in_flight) {
     const core::scene_buffers buffers{cc.context, voxelised};
 
     const auto make_ray_iterator = [&](auto it) {
@@ -211,7 +222,7 @@ auto run(
     auto processors = util::apply_each(
             util::map(make_get_processor_functor_adapter{},
                       std::forward<Callbacks>(callbacks)),
-            std::tie(cc, source, receiver, environment, voxelised));
+            std::tie(cc, source, receiver, environment, voxelised, buffers));
 
     using return_type = decltype(util::apply_each(
             util::map(make_get_results_functor_adapter{}, processors)));
@@ -220,9 +231,12 @@ auto run(
     const auto reflection_depth =
             compute_optimum_reflection_number(voxelised.get_scene_data());
 
-    const auto run_segment = [&](auto b, auto e) {
+    const auto start_segment = [&](auto b, auto e) {
         const auto num_directions = std::distance(b, e);
 
+        //  The rays and group processors are set up on this thread, because
+        //  the direction iterators and the processors might not be safe to
+        //  use from more than one thread at once.
         reflector ref{cc, receiver, make_ray_iterator(b), make_ray_iterator(e)};
 
         auto group_processors = util::apply_each(
@@ -230,37 +244,72 @@ auto run(
                           processors),
                 std::make_tuple(num_directions));
 
-        for (auto i = 0ul; i != reflection_depth; ++i) {
-            const auto reflections = ref.run_step(buffers);
-            const auto b = begin(reflections);
-            const auto e = end(reflections);
-            util::call_each(
-                    util::map(make_process_functor_adapter{}, group_processors),
-                    std::tie(b, e, buffers, i, reflection_depth));
-        }
+        return std::async(
+                std::launch::async,
+                [&,
+                 ref = std::move(ref),
+                 group_processors = std::move(group_processors)]() mutable {
+                    //  Once every ray has stopped, later steps would find
+                    //  nothing.
+                    for (auto i = 0ul; i != reflection_depth &&
+                                       ref.get_live_rays() && keep_going;
+                         ++i) {
+                        const auto reflections = ref.run_step(buffers);
+                        util::call_each(
+                                util::map(make_process_functor_adapter{},
+                                          group_processors),
+                                std::tie(reflections,
+                                         buffers,
+                                         i,
+                                         reflection_depth));
+                    }
+                    return std::move(group_processors);
+                });
+    };
 
+    //  Segments are merged in the order they were started, so results don't
+    //  depend on which segment finishes first.
+    std::deque<decltype(start_segment(b_direction, e_direction))> in_flight;
+    const auto merge_oldest = [&] {
         zip_apply(util::map(make_accumulate_functor_adapter{}, processors),
-                  group_processors);
+                  in_flight.front().get());
+        in_flight.pop_front();
     };
 
     const auto groups = std::distance(b_direction, e_direction) / segment_size;
+    auto merged = 0;
+
+    //  Only full segments are reported to the callback.
+    const auto merge_oldest_and_report = [&] {
+        merge_oldest();
+        if (merged < groups) {
+            per_step_callback(merged++, groups);
+        }
+    };
 
     auto it = b_direction;
-    for (auto group = 0; it + segment_size <= e_direction;
-         it += segment_size, ++group) {
-        run_segment(it, it + segment_size);
+    for (; it + segment_size <= e_direction; it += segment_size) {
+        in_flight.emplace_back(start_segment(it, it + segment_size));
+
+        if (std::max(segments_in_flight, size_t{1}) <= in_flight.size()) {
+            merge_oldest_and_report();
+            if (!keep_going) {
+                return std::optional<return_type>{};
+            }
+        }
+    }
 
-        per_step_callback(group, groups);
+    if (it != e_direction) {
+        in_flight.emplace_back(start_segment(it, e_direction));
+    }
 
+    while (!in_flight.empty()) {
+        merge_oldest_and_report();
         if (!keep_going) {
             return std::optional<return_type>{};
         }
     }
 
-    if (it != e_direction) {
-        run_segment(it, e_direction);
-    }
-
     return std::make_optional(util::apply_each(
             util::map(make_get_results_functor_adapter{}, processors)));
 }
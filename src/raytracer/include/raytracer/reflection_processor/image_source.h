@@ -14,14 +14,12 @@ class image_source_group_processor final {
 public:
     image_source_group_processor(size_t max_order, size_t items);
 
-    template <typename It>
-    void process(It b,
-                 It e,
+    void process(const live_reflections& live,
                  const core::scene_buffers& /*buffers*/,
                  size_t step,
                  size_t /*total*/) {
         if (step < max_image_source_order_) {
-            builder_.push(b, e);
+            builder_.push(live);
         }
     }
 
@@ -35,16 +33,23 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Candidate image-source paths can either be checked by walking the tree on
+/// the host, one thread per branch, or all at once in a device kernel.
+enum class validation_mode { host, device };
+
 class image_source_processor final {
 public:
     image_source_processor(
+            const core::compute_context& cc,
             const glm::vec3& source,
             const glm::vec3& receiver,
             const core::environment& environment,
             const core::voxelised_scene_data<
                     cl_float3,
                     core::surface<core::simulation_bands>>& voxelised,
-            size_t max_order);
+            const core::scene_buffers& buffers,
+            size_t max_order,
+            validation_mode mode);
 
     image_source_group_processor get_group_processor(
             size_t num_directions) const;
@@ -53,15 +58,18 @@ public:
     util::aligned::vector<impulse<8>> get_results() const;
 
 private:
+    core::compute_context cc_;
     glm::vec3 source_;
     glm::vec3 receiver_;
     core::environment environment_;
     const core::voxelised_scene_data<cl_float3,
                                      core::surface<core::simulation_bands>>&
             voxelised_;
+    const core::scene_buffers& buffers_;
     size_t num_directions_;
 
     size_t max_order_;
+    validation_mode mode_;
 
     raytracer::image_source::tree tree_;
 };
@@ -70,7 +78,8 @@ private:
 
 class make_image_source final {
 public:
-    make_image_source(size_t max_order);
+    make_image_source(size_t max_order,
+                      validation_mode mode = validation_mode::host);
 
     image_source_processor get_processor(
             const core::compute_context& cc,
@@ -79,10 +88,12 @@ public:
             const core::environment& environment,
             const core::voxelised_scene_data<
                     cl_float3,
-                    core::surface<core::simulation_bands>>& voxelised) const;
+                    core::surface<core::simulation_bands>>& voxelised,
+            const core::scene_buffers& buffers) const;
 
 private:
     size_t max_order_;
+    validation_mode mode_;
 };
 
 }  // namespace reflection_processor
@@ -2,6 +2,7 @@
 
 #include "raytracer/histogram.h"
 #include "raytracer/simulation_parameters.h"
+#include "raytracer/stochastic/device_histogram.h"
 #include "raytracer/stochastic/finder.h"
 #include "raytracer/stochastic/postprocessing.h"
 
@@ -46,7 +47,10 @@ public:
     /// A max_image_source_order of 0 = direct energy from image-source
     /// An order of 1 = direct and one reflection from image-source
     /// i.e. the order == the number of reflections for each image
+    /// The program is shared by every group, so that it is only built once
+    /// per run.
     stochastic_group_processor(const core::compute_context& cc,
+                               const stochastic::program& program,
                                const glm::vec3& source,
                                const glm::vec3& receiver,
                                const core::environment& environment,
@@ -56,68 +60,52 @@ public:
                                float histogram_sample_rate,
                                size_t group_items)
             : finder_(cc,
+                      program,
                       group_items,
                       source,
                       receiver,
                       receiver_radius,
                       stochastic::compute_ray_energy(
                               total_rays, source, receiver, receiver_radius))
-            , receiver_{receiver}
-            , environment_{environment}
             , max_image_source_order_{max_image_source_order}
-            , histogram_{histogram_sample_rate} {}
-
-    template <typename It>
-    void process(It b,
-                 It e,
+            , sample_rate_{histogram_sample_rate}
+            , histogram_{
+                      cc,
+                      program,
+                      receiver,
+                      environment.speed_of_sound,
+                      histogram_sample_rate,
+                      stochastic::histogram_divisions<Histogram>::azimuth,
+                      stochastic::histogram_divisions<Histogram>::elevation} {}
+
+    /// Impulses are binned on the device, straight from the finder's output
+    /// buffers.
+    void process(const live_reflections& live,
                  const core::scene_buffers& buffers,
                  size_t step,
                  size_t /*total*/) {
-        const auto output = finder_.process(b, e, buffers);
-
-        struct intermediate_impulse final {
-            core::bands_type volume;
-            double time;
-            glm::vec3 pointing;
-        };
-
-        const auto intermediate = [&] {
-            util::aligned::vector<intermediate_impulse> ret;
-            ret.reserve(output.stochastic.size() + output.specular.size());
-
-            const auto push_vector = [&](const auto& vec) {
-                for (const auto& impulse : vec) {
-                    ret.emplace_back(intermediate_impulse{
-                            impulse.volume,
-                            impulse.distance / environment_.speed_of_sound,
-                            glm::normalize(core::to_vec3{}(impulse.position) -
-                                           receiver_)});
-                }
-            };
-
-            push_vector(output.stochastic);
-            if (max_image_source_order_ <= step) {
-                push_vector(output.specular);
-            }
-
-            return ret;
-        }();
-
-        incremental_histogram(histogram_.histogram,
-                              begin(intermediate),
-                              end(intermediate),
-                              histogram_.sample_rate,
-                              energy_histogram_sum_functor{});
+        const auto count = finder_.find(live, buffers);
+        auto& queue = finder_.get_queue();
+
+        histogram_.add(queue, finder_.get_stochastic_output_buffer(), count);
+        if (max_image_source_order_ <= step) {
+            histogram_.add(queue, finder_.get_specular_output_buffer(), count);
+        }
     }
 
-    Histogram get_results() const { return histogram_; }
+    /// Reads the finished histogram back from the device.
+    Histogram get_results() const {
+        Histogram ret{sample_rate_, {}};
+        auto queue = finder_.get_queue();
+        stochastic::unpack_histogram(histogram_.read(queue), ret);
+        return ret;
+    }
 
 private:
     stochastic::finder finder_;
-    glm::vec3 receiver_;
-    core::environment environment_;
     size_t max_image_source_order_;
-    Histogram histogram_;
+    float sample_rate_;
+    stochastic::device_histogram histogram_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -134,6 +122,7 @@ public:
                          float receiver_radius,
                          float histogram_sample_rate)
             : cc_{cc}
+            , program_{cc}
             , source_{source}
             , receiver_{receiver}
             , environment_{environment}
@@ -146,6 +135,7 @@ public:
     stochastic_group_processor<Histogram> get_group_processor(
             size_t num_directions) const {
         return {cc_,
+                program_,
                 source_,
                 receiver_,
                 environment_,
@@ -164,6 +154,7 @@ public:
 
 private:
     core::compute_context cc_;
+    stochastic::program program_;
     glm::vec3 source_;
     glm::vec3 receiver_;
     core::environment environment_;
@@ -191,7 +182,8 @@ public:
             const core::environment& environment,
             const core::voxelised_scene_data<
                     cl_float3,
-                    core::surface<core::simulation_bands>>& voxelised) const;
+                    core::surface<core::simulation_bands>>& voxelised,
+            const core::scene_buffers& buffers) const;
 
 private:
     size_t total_rays_;
@@ -215,7 +207,8 @@ public:
             const core::environment& environment,
             const core::voxelised_scene_data<
                     cl_float3,
-                    core::surface<core::simulation_bands>>& voxelised) const;
+                    core::surface<core::simulation_bands>>& voxelised,
+            const core::scene_buffers& buffers) const;
 
 private:
     size_t total_rays_;
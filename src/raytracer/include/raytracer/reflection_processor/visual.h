@@ -2,11 +2,14 @@
 
 #include "raytracer/cl/structs.h"
 #include "raytracer/iterative_builder.h"
+#include "raytracer/live_reflections.h"
 
 #include "core/cl/common.h"
 #include "core/environment.h"
 #include "core/spatial_division/scene_buffers.h"
 
+#include <algorithm>
+
 namespace wayverb {
 namespace raytracer {
 namespace reflection_processor {
@@ -15,13 +18,20 @@ class visual_group_processor final {
 public:
     explicit visual_group_processor(size_t items);
 
-    template <typename It>
-    void process(It b,
-                 It /*e*/,
+    void process(const live_reflections& live,
                  const core::scene_buffers& /*buffers*/,
                  size_t /*step*/,
                  size_t /*total*/) {
-        builder_.push(b, b + builder_.get_num_items());
+        //  Live rays are sorted, so the visualised ones come first.
+        const auto visualised =
+                std::lower_bound(begin(live.rays),
+                                 end(live.rays),
+                                 builder_.get_num_items()) -
+                begin(live.rays);
+        builder_.push_indexed(begin(live.rays),
+                              begin(live.rays) + visualised,
+                              begin(live.reflections),
+                              [](const auto& i) { return i; });
     }
 
     auto get_results() const { return builder_.get_data(); }
@@ -60,7 +70,8 @@ public:
             const core::environment& environment,
             const core::voxelised_scene_data<
                     cl_float3,
-                    core::surface<core::simulation_bands>>& voxelised) const;
+                    core::surface<core::simulation_bands>>& voxelised,
+            const core::scene_buffers& buffers) const;
 
 private:
     size_t items_;
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "raytracer/live_reflections.h"
 #include "raytracer/program.h"
 
 #include "core/cl/geometry.h"
@@ -22,6 +23,10 @@ auto get_rays_from_directions(It begin, It end, const glm::vec3& source) {
     });
 }
 
+/// Traces a group of rays through the scene, one reflection at a time.
+/// A list of the rays which are still going is kept on the device, and is
+/// compacted after every step, so rays which have escaped or stopped don't
+/// take up work-items or get read back.
 class reflector final {
 public:
     template <typename It>
@@ -29,31 +34,19 @@ public:
               const glm::vec3& receiver,
               It b,
               It e)
-            : cc_{cc}
-            , queue_{cc.context, cc.device}
-            , kernel_{program{cc}.get_kernel()}
-            , receiver_{core::to_cl_float3{}(receiver)}
-            , rays_(std::distance(b, e))
-            , ray_buffer_{core::load_to_buffer(
-                      cc.context,
-                      util::map_to_vector(
-                              b,
-                              e,
-                              [](const auto& i) { return core::convert(i); }),
-                      false)}
-            , reflection_buffer_{cc.context,
-                                 CL_MEM_READ_WRITE,
-                                 rays_ * sizeof(reflection)}
-            , rng_buffer_{cc.context,
-                          CL_MEM_READ_WRITE,
-                          rays_ * 2 * sizeof(cl_float)} {
-        program{cc_}.get_init_reflections_kernel()(
-                cl::EnqueueArgs{queue_, cl::NDRange{rays_}},
-                reflection_buffer_);
-    }
+            : reflector{cc,
+                        receiver,
+                        util::map_to_vector(b, e, [](const auto& i) {
+                            return core::convert(i);
+                        })} {}
+
+    /// Returns the reflections of the rays which were still going before
+    /// this step, and which are still going after it.
+    /// Once every ray has stopped, further steps do nothing.
+    live_reflections run_step(const core::scene_buffers& buffers);
 
-    util::aligned::vector<reflection> run_step(
-            const core::scene_buffers& buffers);
+    /// The number of rays which will be traced by the next step.
+    size_t get_live_rays() const;
 
     util::aligned::vector<core::ray> get_rays();
     util::aligned::vector<reflection> get_reflections();
@@ -61,22 +54,41 @@ public:
 
     /// The constant buffer size required per parallel ray.
     static constexpr auto get_per_ray_size() {
-        return sizeof(core::ray) + sizeof(reflection) + 2 * sizeof(cl_float);
+        return sizeof(core::ray) + 2 * sizeof(reflection) +
+               2 * sizeof(cl_float) + 2 * sizeof(cl_uint);
     }
 
 private:
+    reflector(const core::compute_context& cc,
+              const glm::vec3& receiver,
+              const util::aligned::vector<core::ray>& rays);
+
+    reflector(const core::compute_context& cc,
+              const program& program,
+              const glm::vec3& receiver,
+              const util::aligned::vector<core::ray>& rays);
+
     using kernel_t = decltype(std::declval<program>().get_kernel());
+    using compact_kernel_t =
+            decltype(std::declval<program>().get_compact_reflections_kernel());
 
     core::compute_context cc_;
     cl::CommandQueue queue_;
     kernel_t kernel_;
+    compact_kernel_t compact_kernel_;
     cl_float3 receiver_;
     size_t rays_;
+    size_t live_rays_;
 
     cl::Buffer ray_buffer_;
     cl::Buffer reflection_buffer_;
 
     cl::Buffer rng_buffer_;
+
+    cl::Buffer live_ray_buffer_;
+    cl::Buffer next_live_ray_buffer_;
+    cl::Buffer live_reflection_buffer_;
+    cl::Buffer live_count_buffer_;
 };
 
 }  // namespace raytracer
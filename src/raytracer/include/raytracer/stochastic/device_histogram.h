@@ -0,0 +1,121 @@
+#pragma once
+
+#include "raytracer/stochastic/postprocessing.h"
+#include "raytracer/stochastic/program.h"
+
+#include "core/cl/common.h"
+
+#include "utilities/aligned/vector.h"
+
+#include "glm/glm.hpp"
+
+namespace wayverb {
+namespace raytracer {
+namespace stochastic {
+
+/// An energy histogram which is accumulated on the device, split into
+/// azimuth/elevation sectors around the receiver.
+/// Impulses are binned where the finder left them, so nothing proportional
+/// to the number of impulses is copied back to the host.
+/// Each batch is summed in fixed point, so the result doesn't depend on the
+/// order in which the device happens to run work-items.
+class device_histogram final {
+public:
+    device_histogram(const core::compute_context& cc,
+                     const glm::vec3& receiver,
+                     double speed_of_sound,
+                     double sample_rate,
+                     size_t azimuth_divisions,
+                     size_t elevation_divisions);
+
+    /// Uses an existing program, so that histograms which are made over and
+    /// over don't each have to build it.
+    device_histogram(const core::compute_context& cc,
+                     const program& program,
+                     const glm::vec3& receiver,
+                     double speed_of_sound,
+                     double sample_rate,
+                     size_t azimuth_divisions,
+                     size_t elevation_divisions);
+
+    /// Adds the first 'count' entries of a buffer of impulses.
+    /// Entries with a distance of zero are ignored.
+    void add(cl::CommandQueue& queue, const cl::Buffer& impulses, size_t count);
+
+    /// Returns the histogram, laid out as [bin][direction], where direction
+    /// is azimuth_index * elevation_divisions + elevation_index.
+    util::aligned::vector<core::bands_type> read(
+            cl::CommandQueue& queue) const;
+
+    size_t get_bins() const { return bins_; }
+    size_t get_directions() const {
+        return azimuth_divisions_ * elevation_divisions_;
+    }
+
+private:
+    void reserve(cl::CommandQueue& queue, size_t bins);
+
+    using extent_kernel_t =
+            decltype(std::declval<program>().get_histogram_extent_kernel());
+    using histogram_kernel_t = decltype(
+            std::declval<program>().get_directional_histogram_kernel());
+    using resolve_kernel_t =
+            decltype(std::declval<program>().get_resolve_histogram_kernel());
+
+    core::compute_context cc_;
+    extent_kernel_t extent_kernel_;
+    histogram_kernel_t histogram_kernel_;
+    resolve_kernel_t resolve_kernel_;
+
+    cl_float3 receiver_;
+    cl_float bins_per_metre_;
+    size_t azimuth_divisions_;
+    size_t elevation_divisions_;
+
+    size_t bins_{0};
+    size_t capacity_{0};
+    cl::Buffer extent_buffer_;
+    cl::Buffer accumulator_buffer_;
+    cl::Buffer histogram_buffer_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// The number of azimuth/elevation sectors used by each kind of histogram.
+template <typename Histogram>
+struct histogram_divisions;
+
+template <>
+struct histogram_divisions<energy_histogram> final {
+    static constexpr size_t azimuth = 1;
+    static constexpr size_t elevation = 1;
+};
+
+template <size_t Az, size_t El>
+struct histogram_divisions<directional_energy_histogram<Az, El>> final {
+    static constexpr size_t azimuth = Az;
+    static constexpr size_t elevation = El;
+};
+
+/// Unpacks a histogram read from the device.
+void unpack_histogram(const util::aligned::vector<core::bands_type>& raw,
+                      energy_histogram& ret);
+
+template <size_t Az, size_t El>
+void unpack_histogram(const util::aligned::vector<core::bands_type>& raw,
+                      directional_energy_histogram<Az, El>& ret) {
+    const auto bins = raw.size() / (Az * El);
+    for (size_t a = 0; a != Az; ++a) {
+        for (size_t e = 0; e != El; ++e) {
+            auto& out = ret.histogram.table[a][e];
+            out.resize(bins);
+            for (size_t i = 0; i != bins; ++i) {
+                out[i] = raw[i * Az * El + a * El + e];
+            }
+        }
+    }
+}
+
+}  // namespace stochastic
+}  // namespace raytracer
+}  // namespace wayverb
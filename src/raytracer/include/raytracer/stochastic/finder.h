@@ -3,6 +3,7 @@
 #include "program.h"
 
 #include "raytracer/cl/structs.h"
+#include "raytracer/live_reflections.h"
 
 #include "core/cl/common.h"
 #include "core/conversions.h"
@@ -40,44 +41,50 @@ public:
            float receiver_radius,
            float starting_energy);
 
+    /// Uses an existing program, so that finders which are made over and
+    /// over don't each have to build it.
+    finder(const core::compute_context& cc,
+           const program& program,
+           size_t group_size,
+           const glm::vec3& source,
+           const glm::vec3& receiver,
+           float receiver_radius,
+           float starting_energy);
+
     struct results final {
         util::aligned::vector<impulse<core::simulation_bands>> specular;
         util::aligned::vector<impulse<core::simulation_bands>> stochastic;
     };
 
+    /// Finds the impulses from one step of reflections, but leaves them in
+    /// the output buffers on the device.
+    /// Returns the number of entries written to each output buffer.
+    /// Entries with a distance of zero don't hold an impulse.
+    size_t find(const live_reflections& live,
+                const core::scene_buffers& scene_buffers);
+
+    /// Finds the impulses from one step of reflections.
+    /// Only rays with live reflections are processed.
+    results process(const live_reflections& live,
+                    const core::scene_buffers& scene_buffers);
+
+    /// Takes one reflection per ray, including ones which have stopped.
     template <typename It>
-    auto process(It b, It e, const core::scene_buffers& scene_buffers) {
-        //  copy the current batch of reflections to the device
-        cl::copy(queue_, b, e, reflections_buffer_);
-
-        //  get the kernel and run it
-        kernel_(cl::EnqueueArgs(queue_, cl::NDRange(rays_)),
-                reflections_buffer_,
-                receiver_,
-                receiver_radius_,
-                scene_buffers.get_triangles_buffer(),
-                scene_buffers.get_vertices_buffer(),
-                scene_buffers.get_surfaces_buffer(),
-                stochastic_path_buffer_,
-                stochastic_output_buffer_,
-                specular_output_buffer_);
-
-        const auto read_out_impulses = [&](const auto& buffer) {
-            auto raw = core::read_from_buffer<impulse<core::simulation_bands>>(
-                    queue_, buffer);
-            raw.erase(std::remove_if(begin(raw),
-                                     end(raw),
-                                     [](const auto& impulse) {
-                                         return !impulse.distance;
-                                     }),
-                      end(raw));
-            return raw;
-        };
-
-        return results{read_out_impulses(specular_output_buffer_),
-                       read_out_impulses(stochastic_output_buffer_)};
+    results process(It b, It e, const core::scene_buffers& scene_buffers) {
+        return process(make_live_reflections(b, e), scene_buffers);
+    }
+
+    const cl::Buffer& get_specular_output_buffer() const {
+        return specular_output_buffer_;
+    }
+    const cl::Buffer& get_stochastic_output_buffer() const {
+        return stochastic_output_buffer_;
     }
 
+    /// Commands which use the output buffers should go on this queue.
+    cl::CommandQueue& get_queue() { return queue_; }
+    const cl::CommandQueue& get_queue() const { return queue_; }
+
 private:
     using kernel_t = decltype(std::declval<program>().get_kernel());
 
@@ -88,6 +95,7 @@ private:
     cl_float receiver_radius_;
     size_t rays_;
 
+    cl::Buffer rays_buffer_;
     cl::Buffer reflections_buffer_;
     cl::Buffer stochastic_path_buffer_;
     cl::Buffer stochastic_output_buffer_;
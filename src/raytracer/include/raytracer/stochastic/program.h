@@ -14,7 +14,8 @@ public:
     program(const core::compute_context& cc);
 
     auto get_kernel() const {
-        return program_wrapper_.get_kernel<cl::Buffer,  // reflections
+        return program_wrapper_.get_kernel<cl::Buffer,  // rays
+                                           cl::Buffer,  // reflections
                                            cl_float3,   // receiver
                                            cl_float,    // receiver radius
                                            cl::Buffer,  // triangles
@@ -22,17 +23,47 @@ public:
                                            cl::Buffer,  // surfaces
                                            cl::Buffer,  // stochastic path info
                                            cl::Buffer,  // stochastic output
-                                           cl::Buffer   // intersected output
+                                           cl::Buffer,  // intersected output
+                                           cl_uint      // num rays
                                            >("stochastic");
     }
 
     auto get_init_stochastic_path_info_kernel() const {
         return program_wrapper_.get_kernel<cl::Buffer,        // buffer
                                            core::bands_type,  // initial energy
-                                           cl_float3  // initial position
+                                           cl_float3,  // initial position
+                                           cl_uint     // num rays
                                            >("init_stochastic_path_info");
     }
 
+    auto get_histogram_extent_kernel() const {
+        return program_wrapper_.get_kernel<cl::Buffer,  // impulses
+                                           cl_float,    // bins per metre
+                                           cl::Buffer,  // extent
+                                           cl_uint      // num impulses
+                                           >("histogram_extent");
+    }
+
+    auto get_directional_histogram_kernel() const {
+        return program_wrapper_.get_kernel<cl::Buffer,  // impulses
+                                           cl_float3,   // receiver
+                                           cl_float,    // bins per metre
+                                           cl_uint,     // azimuth divisions
+                                           cl_uint,     // elevation divisions
+                                           cl_float,    // scale
+                                           cl::Buffer,  // accumulator
+                                           cl_uint      // num impulses
+                                           >("directional_histogram");
+    }
+
+    auto get_resolve_histogram_kernel() const {
+        return program_wrapper_.get_kernel<cl::Buffer,  // accumulator
+                                           cl_float,    // scale
+                                           cl::Buffer,  // histogram
+                                           cl_uint      // num values
+                                           >("resolve_histogram");
+    }
+
 private:
     core::program_wrapper program_wrapper_;
 };
@@ -0,0 +1,173 @@
+#include "raytracer/image_source/device_validation.h"
+
+#include "core/conversions.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace wayverb {
+namespace raytracer {
+namespace image_source {
+
+namespace {
+
+void flatten_paths(const tree_branch& tree,
+                   util::aligned::vector<cl_uint>& state,
+                   flattened_paths& ret) {
+    state.emplace_back(tree.item.index);
+    if (tree.item.visible) {
+        ret.triangles.insert(ret.triangles.end(), state.begin(), state.end());
+        ret.offsets.emplace_back(ret.triangles.size());
+    }
+    for (const auto& i : tree.branches) {
+        flatten_paths(i, state, ret);
+    }
+    state.pop_back();
+}
+
+}  // namespace
+
+void flatten_paths(const tree_branch& tree, flattened_paths& ret) {
+    util::aligned::vector<cl_uint> state;
+    flatten_paths(tree, state, ret);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+path_validator::path_validator(const core::compute_context& cc,
+                               const vsd& voxelised,
+                               const core::scene_buffers& buffers)
+        : cc_{cc}
+        , queue_{cc.context, cc.device}
+        , kernel_{program{cc}.get_validate_paths_kernel()}
+        , voxelised_{voxelised}
+        , buffers_{buffers} {}
+
+void path_validator::find_valid_paths(const flattened_paths& paths,
+                                      const glm::vec3& source,
+                                      const glm::vec3& receiver,
+                                      const postprocessor& callback) {
+    const auto candidates = paths.offsets.size() - 1;
+    for (size_t b = 0; b < candidates; b += batch_size) {
+        find_valid_paths(paths,
+                         b,
+                         std::min(b + batch_size, candidates),
+                         source,
+                         receiver,
+                         callback);
+    }
+}
+
+void path_validator::find_valid_paths(const flattened_paths& paths,
+                                      size_t b,
+                                      size_t e,
+                                      const glm::vec3& source,
+                                      const glm::vec3& receiver,
+                                      const postprocessor& callback) {
+    const auto candidates = e - b;
+    const auto first = paths.offsets[b];
+    const auto reflections = paths.offsets[e] - first;
+
+    //  Offsets and triangles for just this batch.
+    util::aligned::vector<cl_uint> offsets(candidates + 1);
+    std::transform(paths.offsets.begin() + b,
+                   paths.offsets.begin() + e + 1,
+                   offsets.begin(),
+                   [&](auto i) { return i - first; });
+    const util::aligned::vector<cl_uint> triangles(
+            paths.triangles.begin() + first,
+            paths.triangles.begin() + paths.offsets[e]);
+
+    const auto offset_buffer = core::load_to_buffer(cc_.context, offsets, true);
+    const auto triangle_buffer =
+            core::load_to_buffer(cc_.context, triangles, true);
+    cl::Buffer image_source_buffer{
+            cc_.context, CL_MEM_READ_WRITE, sizeof(cl_float3) * reflections};
+
+    const auto count_buffer = core::load_to_buffer(
+            cc_.context, util::aligned::vector<cl_uint>{0, 0}, false);
+    cl::Buffer valid_path_buffer{
+            cc_.context, CL_MEM_READ_WRITE, sizeof(cl_uint) * candidates};
+    cl::Buffer valid_offset_buffer{
+            cc_.context, CL_MEM_READ_WRITE, sizeof(cl_uint) * candidates};
+    cl::Buffer valid_image_buffer{
+            cc_.context, CL_MEM_READ_WRITE, sizeof(cl_float3) * candidates};
+    cl::Buffer valid_angle_buffer{
+            cc_.context, CL_MEM_READ_WRITE, sizeof(cl_float) * reflections};
+
+    kernel_(queue_,
+            candidates,
+            offset_buffer,
+            triangle_buffer,
+            image_source_buffer,
+            core::to_cl_float3{}(source),
+            core::to_cl_float3{}(receiver),
+            buffers_.get_voxel_index_buffer(),
+            buffers_.get_global_aabb(),
+            buffers_.get_side(),
+            buffers_.get_triangles_buffer(),
+            buffers_.get_vertices_buffer(),
+            count_buffer,
+            valid_path_buffer,
+            valid_offset_buffer,
+            valid_image_buffer,
+            valid_angle_buffer,
+            static_cast<cl_uint>(candidates));
+
+    //  Only read back the parts of the outputs which were written.
+    const auto counts = core::read_from_buffer<cl_uint>(queue_, count_buffer);
+    if (!counts[0]) {
+        return;
+    }
+
+    util::aligned::vector<cl_uint> valid_paths(counts[0]);
+    util::aligned::vector<cl_uint> valid_offsets(counts[0]);
+    util::aligned::vector<cl_float3> valid_images(counts[0]);
+    util::aligned::vector<cl_float> valid_angles(counts[1]);
+    cl::copy(queue_, valid_path_buffer, valid_paths.begin(), valid_paths.end());
+    cl::copy(queue_,
+             valid_offset_buffer,
+             valid_offsets.begin(),
+             valid_offsets.end());
+    cl::copy(queue_,
+             valid_image_buffer,
+             valid_images.begin(),
+             valid_images.end());
+    cl::copy(queue_,
+             valid_angle_buffer,
+             valid_angles.begin(),
+             valid_angles.end());
+
+    //  Paths are appended in whatever order the device finishes them, so put
+    //  them back in candidate order.
+    util::aligned::vector<size_t> order(counts[0]);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](auto i, auto j) {
+        return valid_paths[i] < valid_paths[j];
+    });
+
+    const auto& scene_triangles = voxelised_.get_scene_data().get_triangles();
+    util::aligned::vector<reflection_metadata> intersections;
+    for (const auto i : order) {
+        const auto path = valid_paths[i];
+        const auto path_begin = offsets[path];
+        const auto path_end = offsets[path + 1];
+
+        //  Like the host traversal, the metadata runs from the receiver back
+        //  to the source.
+        intersections.clear();
+        for (auto j = path_end; j != path_begin; --j) {
+            intersections.emplace_back(reflection_metadata{
+                    scene_triangles[triangles[j - 1]].surface,
+                    valid_angles[valid_offsets[i] + path_end - j]});
+        }
+
+        callback(core::to_vec3{}(valid_images[i]),
+                 intersections.cbegin(),
+                 intersections.cend());
+    }
+}
+
+}  // namespace image_source
+}  // namespace raytracer
+}  // namespace wayverb
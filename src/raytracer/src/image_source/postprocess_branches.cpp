@@ -6,7 +6,7 @@ namespace raytracer {
 namespace image_source {
 
 util::aligned::vector<impulse<core::simulation_bands>> postprocess_branches(
-        const multitree<path_element>& tree,
+        const tree_branch& tree,
         const glm::vec3& source,
         const glm::vec3& receiver,
         const core::voxelised_scene_data<cl_float3,
@@ -28,6 +28,30 @@ util::aligned::vector<impulse<core::simulation_bands>> postprocess_branches(
     return callback.get_output();
 }
 
+util::aligned::vector<impulse<core::simulation_bands>> postprocess_paths(
+        const core::compute_context& cc,
+        const flattened_paths& paths,
+        const glm::vec3& source,
+        const glm::vec3& receiver,
+        const core::voxelised_scene_data<cl_float3,
+                                         core::surface<core::simulation_bands>>&
+                voxelised,
+        const core::scene_buffers& buffers,
+        bool flip_phase) {
+    auto callback =
+            core::make_callback_accumulator(make_fast_pressure_calculator(
+                    begin(voxelised.get_scene_data().get_surfaces()),
+                    end(voxelised.get_scene_data().get_surfaces()),
+                    receiver,
+                    flip_phase));
+    path_validator{cc, voxelised, buffers}.find_valid_paths(
+            paths,
+            source,
+            receiver,
+            [&](auto img, auto begin, auto end) { callback(img, begin, end); });
+    return callback.get_output();
+}
+
 }  // namespace image_source
 }  // namespace raytracer
 }  // namespace wayverb
@@ -0,0 +1,141 @@
+#include "raytracer/image_source/program.h"
+
+#include "core/cl/geometry.h"
+#include "core/cl/geometry_structs.h"
+#include "core/cl/scene_structs.h"
+#include "core/cl/voxel.h"
+#include "core/cl/voxel_structs.h"
+
+namespace wayverb {
+namespace raytracer {
+namespace image_source {
+
+constexpr auto source = R"(
+
+//  Matches geo::mirror on the host.
+float3 mirror_through_triangle(float3 p, triangle t, const global float3* v);
+float3 mirror_through_triangle(float3 p, triangle t, const global float3* v) {
+    const float3 n = triangle_normal(t, v);
+    return p - n * dot(n, p - v[t.v0]) * 2;
+}
+
+//  One thread per candidate path.
+//  The reflection angles of valid paths are written from the receiver end of
+//  the path back to the source, like the host validation.
+kernel void validate_paths(const global uint* path_offsets,
+                           const global uint* path_triangles,
+                           global float3* image_sources,
+
+                           float3 source,
+                           float3 receiver,
+
+                           const global uint* voxel_index,
+                           aabb global_aabb,
+                           uint side,
+
+                           const global triangle* triangles,
+                           const global float3* vertices,
+
+                           volatile global uint* counts,
+                           global uint* valid_paths,
+                           global uint* valid_offsets,
+                           global float3* valid_images,
+                           global float* valid_angles,
+
+                           uint num_paths) {
+    const size_t thread = get_global_id(0);
+    if (thread >= num_paths) {
+        return;
+    }
+
+    const uint begin = path_offsets[thread];
+    const uint end = path_offsets[thread + 1];
+
+    //  find the image source for each reflection
+    float3 image = source;
+    for (uint i = begin; i != end; ++i) {
+        image = mirror_through_triangle(
+                image, triangles[path_triangles[i]], vertices);
+        image_sources[i] = image;
+    }
+
+    //  the image source might end up on top of the receiver
+    if (all(receiver == image)) {
+        return;
+    }
+
+    //  check that we can cast a ray to the receiver from all of the image
+    //  sources, through the correct triangles
+    float3 prev_intersection = receiver;
+    uint prev_surface = ~(uint)0;
+    for (uint i = end; i != begin; --i) {
+        const uint index = path_triangles[i - 1];
+        if (all(prev_intersection == image_sources[i - 1])) {
+            return;
+        }
+        const ray r = {prev_intersection,
+                       normalize(image_sources[i - 1] - prev_intersection)};
+        const intersection closest = voxel_traversal(r,
+                                                     voxel_index,
+                                                     global_aabb,
+                                                     side,
+                                                     triangles,
+                                                     vertices,
+                                                     prev_surface);
+        if (!closest.inter.t || closest.index != index) {
+            return;
+        }
+
+        //  reuse the image source slot for the angle, so that nothing is
+        //  written to the outputs until the whole path is known to be valid
+        image_sources[i - 1].x = clamp(
+                fabs(dot(r.direction, triangle_normal(triangles[index],
+                                                      vertices))),
+                0.0f,
+                1.0f);
+
+        prev_intersection = r.position + r.direction * closest.inter.t;
+        prev_surface = index;
+    }
+
+    //  ensure there is line-of-sight from source to the first reflection
+    if (all(source == prev_intersection)) {
+        return;
+    }
+    const ray r = {source, normalize(prev_intersection - source)};
+    const intersection closest = voxel_traversal(
+            r, voxel_index, global_aabb, side, triangles, vertices, ~(uint)0);
+    if (!closest.inter.t || closest.index != prev_surface) {
+        return;
+    }
+
+    //  append this path to the outputs
+    const uint slot = atomic_inc(counts + 0);
+    const uint offset = atomic_add(counts + 1, end - begin);
+    valid_paths[slot] = thread;
+    valid_offsets[slot] = offset;
+    valid_images[slot] = image;
+    for (uint i = end; i != begin; --i) {
+        valid_angles[offset + end - i] = image_sources[i - 1].x;
+    }
+}
+
+)";
+
+program::program(const core::compute_context& cc)
+        : program_wrapper_{
+                  cc,
+                  std::vector<std::string>{
+                          core::cl_representation_v<core::triangle>,
+                          core::cl_representation_v<core::triangle_verts>,
+                          core::cl_representation_v<core::aabb>,
+                          core::cl_representation_v<core::ray>,
+                          core::cl_representation_v<core::triangle_inter>,
+                          core::cl_representation_v<core::intersection>,
+                          core::cl_sources::geometry,
+                          core::cl_sources::voxel,
+                          source}} {}
+
+}  // namespace image_source
+}  // namespace raytracer
+}  // namespace wayverb
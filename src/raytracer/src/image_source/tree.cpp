@@ -182,26 +182,22 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 
-multitree<path_element>::branches_type construct_image_source_tree(
+void tree::push(
         const util::aligned::vector<util::aligned::vector<path_element>>&
                 paths) {
-    multitree<path_element> root{path_element{}};
-    for (const auto& i : paths) {
-        add_path(root, i.begin(), i.end());
+    if (!paths.empty()) {
+        segments_.emplace_back(flat_multitree<path_element>::from_paths(
+                paths.begin(), paths.end(), path_element{}));
     }
-    return std::move(root.branches);
 }
 
-void tree::push(const util::aligned::vector<path_element>& path) {
-    add_path(root_, path.cbegin(), path.cend());
-}
-
-const multitree<path_element>::branches_type& tree::get_branches() const {
-    return root_.branches;
+flat_multitree<path_element> tree::build() const {
+    return flat_multitree<path_element>::merge(segments_.begin(),
+                                               segments_.end());
 }
 
 void find_valid_paths(
-        const multitree<path_element>& tree,
+        const tree_branch& tree,
         const glm::vec3& source,
         const glm::vec3& receiver,
         const core::voxelised_scene_data<cl_float3,
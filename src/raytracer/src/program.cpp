@@ -48,15 +48,20 @@ void reflect_and_add_triangle_to_history(triangle_verts current,
     history[iteration] = current;
 }
 
-kernel void init_reflections(global reflection* reflections) {
+kernel void init_reflections(global reflection* reflections, uint num_rays) {
     const size_t thread = get_global_id(0);
+    if (thread >= num_rays) {
+        return;
+    }
     reflections[thread] = (reflection){(float3)(0),
                                        ~(uint)0,
                                        (char)true,
                                        (char)0};
 }
 
-kernel void reflections(global ray* rays,  //  ray
+kernel void reflections(const global uint* live_rays,  //  live ray indices
+
+                        global ray* rays,  //  ray
 
                         float3 receiver,  //  receiver
 
@@ -70,9 +75,16 @@ kernel void reflections(global ray* rays,  //  ray
 
                         const global float* rng,  //  random numbers
 
-                        global reflection* reflections) {  //  output
-    //  get thread index
-    const size_t thread = get_global_id(0);
+                        global reflection* reflections,  //  output
+
+                        uint num_live_rays) {
+    if (get_global_id(0) >= num_live_rays) {
+        return;
+    }
+
+    //  get the index of the ray traced by this thread
+    //  only rays which are still going are launched
+    const size_t thread = live_rays[get_global_id(0)];
 
     const bool keep_going = reflections[thread].keep_going;
     const uint previous_triangle = reflections[thread].triangle;
@@ -139,8 +151,8 @@ kernel void reflections(global ray* rays,  //  ray
 
     //  find the scattering
     //  get random values to influence direction of reflected ray
-    const float z = rng[2 * thread + 0];
-    const float theta = rng[2 * thread + 1];
+    const float z = rng[2 * get_global_id(0) + 0];
+    const float theta = rng[2 * get_global_id(0) + 1];
     const float3 random_unit_vector = sphere_point(z, theta);
     //  scattering coefficient is the average of the diffuse coefficients
     const surface s = surfaces[closest_triangle.surface];
@@ -152,6 +164,27 @@ kernel void reflections(global ray* rays,  //  ray
     rays[thread] = (ray){intersection_pt, scattering};
 }
 
+kernel void compact_reflections(const global uint* live_rays,
+                                const global reflection* reflections,
+                                global uint* next_live_rays,
+                                global reflection* live_reflections,
+                                volatile global uint* live_count,
+                                uint num_live_rays) {
+    if (get_global_id(0) >= num_live_rays) {
+        return;
+    }
+
+    const uint ray = live_rays[get_global_id(0)];
+
+    //  append rays which are still going to the next live list, along with
+    //  their reflections, so that the host only has to read those back
+    if (reflections[ray].keep_going) {
+        const uint index = atomic_inc(live_count);
+        next_live_rays[index] = ray;
+        live_reflections[index] = reflections[ray];
+    }
+}
+
 )";
 
 program::program(const core::compute_context& cc)
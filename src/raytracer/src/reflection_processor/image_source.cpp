@@ -16,18 +16,24 @@ image_source_group_processor::image_source_group_processor(size_t max_order,
 ////////////////////////////////////////////////////////////////////////////////
 
 image_source_processor::image_source_processor(
+        const core::compute_context& cc,
         const glm::vec3& source,
         const glm::vec3& receiver,
         const core::environment& environment,
         const core::voxelised_scene_data<cl_float3,
                                          core::surface<core::simulation_bands>>&
                 voxelised,
-        size_t max_order)
-        : source_{source}
+        const core::scene_buffers& buffers,
+        size_t max_order,
+        validation_mode mode)
+        : cc_{cc}
+        , source_{source}
         , receiver_{receiver}
         , environment_{environment}
         , voxelised_{voxelised}
-        , max_order_{max_order} {}
+        , buffers_{buffers}
+        , max_order_{max_order}
+        , mode_{mode} {}
 
 image_source_group_processor image_source_processor::get_group_processor(
         size_t num_directions) const {
@@ -36,20 +42,29 @@ image_source_group_processor image_source_processor::get_group_processor(
 
 void image_source_processor::accumulate(
         const image_source_group_processor& processor) {
-    for (const auto& path : processor.get_results()) {
-        tree_.push(path);
-    }
+    tree_.push(processor.get_results());
 }
 
 util::aligned::vector<impulse<8>> image_source_processor::get_results() const {
     //  Fetch the image source results.
-    auto ret = raytracer::image_source::postprocess_branches(
-            begin(tree_.get_branches()),
-            end(tree_.get_branches()),
-            source_,
-            receiver_,
-            voxelised_,
-            false);
+    const auto tree = tree_.build();
+    auto ret = mode_ == validation_mode::device
+                       ? raytracer::image_source::postprocess_branches(
+                                 cc_,
+                                 begin(tree.get_branches()),
+                                 end(tree.get_branches()),
+                                 source_,
+                                 receiver_,
+                                 voxelised_,
+                                 buffers_,
+                                 false)
+                       : raytracer::image_source::postprocess_branches(
+                                 begin(tree.get_branches()),
+                                 end(tree.get_branches()),
+                                 source_,
+                                 receiver_,
+                                 voxelised_,
+                                 false);
 
     //  Add the line-of-sight contribution, which isn't directly detected by
     //  the image-source machinery.
@@ -69,18 +84,27 @@ util::aligned::vector<impulse<8>> image_source_processor::get_results() const {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-make_image_source::make_image_source(size_t max_order)
-        : max_order_{max_order} {}
+make_image_source::make_image_source(size_t max_order, validation_mode mode)
+        : max_order_{max_order}
+        , mode_{mode} {}
 
 image_source_processor make_image_source::get_processor(
-        const core::compute_context& /*cc*/,
+        const core::compute_context& cc,
         const glm::vec3& source,
         const glm::vec3& receiver,
         const core::environment& environment,
         const core::voxelised_scene_data<cl_float3,
                                          core::surface<core::simulation_bands>>&
-                voxelised) const {
-    return {source, receiver, environment, voxelised, max_order_};
+                voxelised,
+        const core::scene_buffers& buffers) const {
+    return {cc,
+            source,
+            receiver,
+            environment,
+            voxelised,
+            buffers,
+            max_order_,
+            mode_};
 }
 
 }  // namespace reflection_processor
@@ -22,7 +22,8 @@ make_stochastic_histogram::get_processor(
         const core::environment& environment,
         const core::voxelised_scene_data<cl_float3,
                                          core::surface<core::simulation_bands>>&
-        /*voxelised*/) const {
+        /*voxelised*/,
+        const core::scene_buffers& /*buffers*/) const {
     return {cc,
             source,
             receiver,
@@ -53,7 +54,8 @@ make_directional_histogram::get_processor(
         const core::environment& environment,
         const core::voxelised_scene_data<cl_float3,
                                          core::surface<core::simulation_bands>>&
-        /*voxelised*/) const {
+        /*voxelised*/,
+        const core::scene_buffers& /*buffers*/) const {
     return {cc,
             source,
             receiver,
@@ -40,7 +40,8 @@ visual_processor make_visual::get_processor(
         const core::environment& /*environment*/,
         const core::voxelised_scene_data<cl_float3,
                                          core::surface<core::simulation_bands>>&
-        /*voxelised*/) const {
+        /*voxelised*/,
+        const core::scene_buffers& /*buffers*/) const {
     return visual_processor{items_};
 }
 
@@ -4,6 +4,8 @@
 #include "core/conversions.h"
 #include "core/spatial_division/scene_buffers.h"
 
+#include <algorithm>
+#include <numeric>
 #include <random>
 
 namespace wayverb {
@@ -24,18 +26,82 @@ util::aligned::vector<cl_float> get_direction_rng(size_t num) {
     return ret;
 }
 
+/// Rays are appended to the live list in whatever order the device gets to
+/// them, so put them back in ray order to keep results repeatable.
+live_reflections sort_by_ray(const live_reflections& in) {
+    util::aligned::vector<size_t> order(in.rays.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](auto a, auto b) {
+        return in.rays[a] < in.rays[b];
+    });
+
+    live_reflections ret;
+    ret.rays.reserve(order.size());
+    ret.reflections.reserve(order.size());
+    for (const auto i : order) {
+        ret.rays.emplace_back(in.rays[i]);
+        ret.reflections.emplace_back(in.reflections[i]);
+    }
+    return ret;
+}
+
 }  // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
 
-util::aligned::vector<reflection> reflector::run_step(
-        const core::scene_buffers& buffers) {
+reflector::reflector(const core::compute_context& cc,
+                     const glm::vec3& receiver,
+                     const util::aligned::vector<core::ray>& rays)
+        : reflector{cc, program{cc}, receiver, rays} {}
+
+reflector::reflector(const core::compute_context& cc,
+                     const program& program,
+                     const glm::vec3& receiver,
+                     const util::aligned::vector<core::ray>& rays)
+        : cc_{cc}
+        , queue_{cc.context, cc.device}
+        , kernel_{program.get_kernel()}
+        , compact_kernel_{program.get_compact_reflections_kernel()}
+        , receiver_{core::to_cl_float3{}(receiver)}
+        , rays_{rays.size()}
+        , live_rays_{rays.size()}
+        , ray_buffer_{core::load_to_buffer(cc.context, rays, false)}
+        , reflection_buffer_{cc.context,
+                             CL_MEM_READ_WRITE,
+                             rays_ * sizeof(reflection)}
+        , rng_buffer_{cc.context,
+                      CL_MEM_READ_WRITE,
+                      rays_ * 2 * sizeof(cl_float)}
+        , live_ray_buffer_{[&] {
+            //  to begin with, every ray is live
+            util::aligned::vector<cl_uint> ret(rays_);
+            std::iota(ret.begin(), ret.end(), 0);
+            return core::load_to_buffer(cc.context, ret, false);
+        }()}
+        , next_live_ray_buffer_{cc.context,
+                                CL_MEM_READ_WRITE,
+                                rays_ * sizeof(cl_uint)}
+        , live_reflection_buffer_{cc.context,
+                                  CL_MEM_READ_WRITE,
+                                  rays_ * sizeof(reflection)}
+        , live_count_buffer_{cc.context, CL_MEM_READ_WRITE, sizeof(cl_uint)} {
+    program.get_init_reflections_kernel()(
+            queue_, rays_, reflection_buffer_, static_cast<cl_uint>(rays_));
+}
+
+live_reflections reflector::run_step(const core::scene_buffers& buffers) {
+    if (!live_rays_) {
+        return {};
+    }
+
     //  get some new rng and copy it to device memory
-    const auto rng{get_direction_rng(rays_)};
+    const auto rng{get_direction_rng(live_rays_)};
     cl::copy(queue_, std::begin(rng), std::end(rng), rng_buffer_);
 
-    //  get the kernel and run it
-    kernel_(cl::EnqueueArgs(queue_, cl::NDRange(rays_)),
+    //  get the kernel and run it, over only the rays which are still going
+    kernel_(queue_,
+            live_rays_,
+            live_ray_buffer_,
             ray_buffer_,
             receiver_,
             buffers.get_voxel_index_buffer(),
@@ -45,11 +111,37 @@ util::aligned::vector<reflection> reflector::run_step(
             buffers.get_vertices_buffer(),
             buffers.get_surfaces_buffer(),
             rng_buffer_,
-            reflection_buffer_);
+            reflection_buffer_,
+            static_cast<cl_uint>(live_rays_));
 
-    return core::read_from_buffer<reflection>(queue_, reflection_buffer_);
+    //  gather the rays which are still going into the next live list
+    core::write_value(queue_, live_count_buffer_, 0, cl_uint{0});
+    compact_kernel_(queue_,
+                    live_rays_,
+                    live_ray_buffer_,
+                    reflection_buffer_,
+                    next_live_ray_buffer_,
+                    live_reflection_buffer_,
+                    live_count_buffer_,
+                    static_cast<cl_uint>(live_rays_));
+    live_rays_ = core::read_value<cl_uint>(queue_, live_count_buffer_, 0);
+    std::swap(live_ray_buffer_, next_live_ray_buffer_);
+
+    //  only read back the live part of the lists
+    live_reflections ret{util::aligned::vector<cl_uint>(live_rays_),
+                         util::aligned::vector<reflection>(live_rays_)};
+    if (live_rays_) {
+        cl::copy(queue_, live_ray_buffer_, ret.rays.begin(), ret.rays.end());
+        cl::copy(queue_,
+                 live_reflection_buffer_,
+                 ret.reflections.begin(),
+                 ret.reflections.end());
+    }
+    return sort_by_ray(ret);
 }
 
+size_t reflector::get_live_rays() const { return live_rays_; }
+
 util::aligned::vector<core::ray> reflector::get_rays() {
     return core::read_from_buffer<core::ray>(queue_, ray_buffer_);
 }
@@ -0,0 +1,147 @@
+#include "raytracer/stochastic/device_histogram.h"
+
+#include "core/conversions.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace wayverb {
+namespace raytracer {
+namespace stochastic {
+
+device_histogram::device_histogram(const core::compute_context& cc,
+                                   const glm::vec3& receiver,
+                                   double speed_of_sound,
+                                   double sample_rate,
+                                   size_t azimuth_divisions,
+                                   size_t elevation_divisions)
+        : device_histogram{cc,
+                           program{cc},
+                           receiver,
+                           speed_of_sound,
+                           sample_rate,
+                           azimuth_divisions,
+                           elevation_divisions} {}
+
+device_histogram::device_histogram(const core::compute_context& cc,
+                                   const program& program,
+                                   const glm::vec3& receiver,
+                                   double speed_of_sound,
+                                   double sample_rate,
+                                   size_t azimuth_divisions,
+                                   size_t elevation_divisions)
+        : cc_{cc}
+        , extent_kernel_{program.get_histogram_extent_kernel()}
+        , histogram_kernel_{program.get_directional_histogram_kernel()}
+        , resolve_kernel_{program.get_resolve_histogram_kernel()}
+        , receiver_{core::to_cl_float3{}(receiver)}
+        , bins_per_metre_{static_cast<cl_float>(sample_rate / speed_of_sound)}
+        , azimuth_divisions_{azimuth_divisions}
+        , elevation_divisions_{elevation_divisions}
+        , extent_buffer_{cc.context, CL_MEM_READ_WRITE, 2 * sizeof(cl_uint)} {}
+
+void device_histogram::add(cl::CommandQueue& queue,
+                           const cl::Buffer& impulses,
+                           size_t count) {
+    if (!count) {
+        return;
+    }
+
+    //  Find out how long the histogram needs to be, and make room.
+    //  Also find the loudest band, which sets the fixed-point scale.
+    core::write_value(queue, extent_buffer_, 0, cl_uint{0});
+    core::write_value(queue, extent_buffer_, 1, cl_uint{0});
+    extent_kernel_(queue,
+                   count,
+                   impulses,
+                   bins_per_metre_,
+                   extent_buffer_,
+                   static_cast<cl_uint>(count));
+    const auto extent = core::read_value<cl_uint>(queue, extent_buffer_, 0);
+    const auto loudest = core::read_value<cl_float>(queue, extent_buffer_, 1);
+    if (!extent) {
+        return;
+    }
+    reserve(queue, extent);
+    if (!loudest) {
+        return;
+    }
+
+    //  No histogram entry can hold more than 'count' of the loudest band, so
+    //  pick a power-of-two scale which keeps that sum below 2^62.
+    //  The scale is clamped so that it stays a finite float.
+    const auto exponent = std::ilogb(static_cast<double>(loudest) * count);
+    const auto scale = std::ldexp(cl_float{1}, std::min(61 - exponent, 127));
+
+    const auto values = extent * get_directions() *
+                        (sizeof(core::bands_type) / sizeof(cl_float));
+    queue.enqueueFillBuffer(
+            accumulator_buffer_, cl_uint{0}, 0, values * 2 * sizeof(cl_uint));
+    histogram_kernel_(queue,
+                      count,
+                      impulses,
+                      receiver_,
+                      bins_per_metre_,
+                      static_cast<cl_uint>(azimuth_divisions_),
+                      static_cast<cl_uint>(elevation_divisions_),
+                      scale,
+                      accumulator_buffer_,
+                      static_cast<cl_uint>(count));
+    resolve_kernel_(queue,
+                    values,
+                    accumulator_buffer_,
+                    scale,
+                    histogram_buffer_,
+                    static_cast<cl_uint>(values));
+}
+
+util::aligned::vector<core::bands_type> device_histogram::read(
+        cl::CommandQueue& queue) const {
+    //  Only the used part of the buffer is read back.
+    util::aligned::vector<core::bands_type> ret(bins_ * get_directions());
+    if (!ret.empty()) {
+        cl::copy(queue, histogram_buffer_, ret.begin(), ret.end());
+    }
+    return ret;
+}
+
+void device_histogram::reserve(cl::CommandQueue& queue, size_t bins) {
+    const auto bytes_per_bin = sizeof(core::bands_type) * get_directions();
+
+    if (capacity_ < bins) {
+        //  The histogram is laid out bin by bin, so growing it is just a
+        //  matter of copying the old contents to the front of a bigger
+        //  buffer.
+        const auto capacity = std::max(bins, capacity_ * 2);
+        cl::Buffer buffer{
+                cc_.context, CL_MEM_READ_WRITE, bytes_per_bin * capacity};
+        if (capacity_) {
+            queue.enqueueCopyBuffer(
+                    histogram_buffer_, buffer, 0, 0, bytes_per_bin * capacity_);
+        }
+        queue.enqueueFillBuffer(buffer,
+                                cl_float{0},
+                                bytes_per_bin * capacity_,
+                                bytes_per_bin * (capacity - capacity_));
+        histogram_buffer_ = std::move(buffer);
+
+        //  The fixed-point sums are cleared before every batch, so there's
+        //  nothing to copy.
+        accumulator_buffer_ = cl::Buffer{
+                cc_.context, CL_MEM_READ_WRITE, 2 * bytes_per_bin * capacity};
+        capacity_ = capacity;
+    }
+
+    bins_ = std::max(bins_, bins);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void unpack_histogram(const util::aligned::vector<core::bands_type>& raw,
+                      energy_histogram& ret) {
+    ret.histogram = raw;
+}
+
+}  // namespace stochastic
+}  // namespace raytracer
+}  // namespace wayverb
@@ -1,5 +1,7 @@
 #include "raytracer/stochastic/finder.h"
 
+#include <algorithm>
+
 namespace wayverb {
 namespace raytracer {
 namespace stochastic {
@@ -22,12 +24,30 @@ finder::finder(const core::compute_context& cc,
                const glm::vec3& receiver,
                float receiver_radius,
                float starting_energy)
+        : finder{cc,
+                 program{cc},
+                 group_size,
+                 source,
+                 receiver,
+                 receiver_radius,
+                 starting_energy} {}
+
+finder::finder(const core::compute_context& cc,
+               const program& program,
+               size_t group_size,
+               const glm::vec3& source,
+               const glm::vec3& receiver,
+               float receiver_radius,
+               float starting_energy)
         : cc_{cc}
         , queue_{cc.context, cc.device}
-        , kernel_{program{cc}.get_kernel()}
+        , kernel_{program.get_kernel()}
         , receiver_{core::to_cl_float3{}(receiver)}
         , receiver_radius_{receiver_radius}
         , rays_{group_size}
+        , rays_buffer_{cc.context,
+                       CL_MEM_READ_WRITE,
+                       sizeof(cl_uint) * group_size}
         , reflections_buffer_{cc.context,
                               CL_MEM_READ_WRITE,
                               sizeof(reflection) * group_size}
@@ -42,11 +62,69 @@ finder::finder(const core::compute_context& cc,
                   cc.context,
                   CL_MEM_READ_WRITE,
                   sizeof(impulse<core::simulation_bands>) * group_size} {
-    program{cc_}.get_init_stochastic_path_info_kernel()(
-            cl::EnqueueArgs{queue_, cl::NDRange{rays_}},
+    program.get_init_stochastic_path_info_kernel()(
+            queue_,
+            rays_,
             stochastic_path_buffer_,
             core::make_bands_type(starting_energy),
-            core::to_cl_float3{}(source));
+            core::to_cl_float3{}(source),
+            static_cast<cl_uint>(rays_));
+}
+
+size_t finder::find(const live_reflections& live,
+                    const core::scene_buffers& scene_buffers) {
+    const auto live_rays = live.rays.size();
+    if (!live_rays) {
+        return 0;
+    }
+
+    //  copy the current batch of reflections to the device
+    cl::copy(queue_, begin(live.rays), end(live.rays), rays_buffer_);
+    cl::copy(queue_,
+             begin(live.reflections),
+             end(live.reflections),
+             reflections_buffer_);
+
+    //  get the kernel and run it
+    kernel_(queue_,
+            live_rays,
+            rays_buffer_,
+            reflections_buffer_,
+            receiver_,
+            receiver_radius_,
+            scene_buffers.get_triangles_buffer(),
+            scene_buffers.get_vertices_buffer(),
+            scene_buffers.get_surfaces_buffer(),
+            stochastic_path_buffer_,
+            stochastic_output_buffer_,
+            specular_output_buffer_,
+            static_cast<cl_uint>(live_rays));
+
+    return live_rays;
+}
+
+finder::results finder::process(const live_reflections& live,
+                                const core::scene_buffers& scene_buffers) {
+    const auto live_rays = find(live, scene_buffers);
+    if (!live_rays) {
+        return {};
+    }
+
+    //  only the first live_rays outputs were written
+    const auto read_out_impulses = [&](const auto& buffer) {
+        util::aligned::vector<impulse<core::simulation_bands>> raw(live_rays);
+        cl::copy(queue_, buffer, begin(raw), end(raw));
+        raw.erase(std::remove_if(begin(raw),
+                                 end(raw),
+                                 [](const auto& impulse) {
+                                     return !impulse.distance;
+                                 }),
+                  end(raw));
+        return raw;
+    };
+
+    return results{read_out_impulses(specular_output_buffer_),
+                   read_out_impulses(stochastic_output_buffer_)};
 }
 
 }  // namespace stochastic
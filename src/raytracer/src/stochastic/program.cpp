@@ -50,12 +50,17 @@ bands_type specular(bands_type total_reflected, bands_type scattering) {
 
 kernel void init_stochastic_path_info(global stochastic_path_info* info,
                                    bands_type volume,
-                                   float3 position) {
+                                   float3 position,
+                                   uint num_rays) {
     const size_t thread = get_global_id(0);
+    if (thread >= num_rays) {
+        return;
+    }
     info[thread] = (stochastic_path_info){volume, position, 0};
 }
 
-kernel void stochastic(const global reflection* reflections,
+kernel void stochastic(const global uint* rays,
+                    const global reflection* reflections,
                     float3 receiver,
                     float receiver_radius,
 
@@ -66,8 +71,15 @@ kernel void stochastic(const global reflection* reflections,
                     global stochastic_path_info* stochastic_path,
 
                     global impulse* stochastic_output,
-                    global impulse* intersected_output) {
+                    global impulse* intersected_output,
+                    uint num_rays) {
+    //  reflections and outputs are indexed by thread, but path info is
+    //  indexed by ray, because only live rays are passed in
     const size_t thread = get_global_id(0);
+    if (thread >= num_rays) {
+        return;
+    }
+    const size_t ray = rays[thread];
 
     //  zero out output
     stochastic_output[thread] = (impulse){};
@@ -87,19 +99,19 @@ kernel void stochastic(const global reflection* reflections,
     const bands_type reflectance =
             absorption_to_energy_reflectance(reflective_surface.absorption);
 
-    const bands_type last_volume = stochastic_path[thread].volume;
+    const bands_type last_volume = stochastic_path[ray].volume;
     const bands_type outgoing = last_volume * reflectance;
 
-    const float3 last_position = stochastic_path[thread].position;
+    const float3 last_position = stochastic_path[ray].position;
     const float3 this_position = reflections[thread].position;
 
     //  find the new distance to this reflection
-    const float last_distance = stochastic_path[thread].distance;
+    const float last_distance = stochastic_path[ray].distance;
     const float this_distance =
             last_distance + distance(last_position, this_position);
 
     //  set accumulator
-    stochastic_path[thread] = (stochastic_path_info){
+    stochastic_path[ray] = (stochastic_path_info){
             outgoing, this_position, this_distance};
 
     //  compute output
@@ -151,6 +163,158 @@ kernel void stochastic(const global reflection* reflections,
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+//  Energies are summed as 64-bit fixed-point numbers, because integer
+//  addition gives the same total whatever order the work-items arrive in.
+//  OpenCL 1.2 only has 32-bit atomics, so each number is a pair of words:
+//  add to the low word, and carry into the high word if it wrapped.
+void atomic_add_fixed(volatile global uint* p, ulong x);
+void atomic_add_fixed(volatile global uint* p, ulong x) {
+    const uint lo = x;
+    const uint prev = atomic_add(p, lo);
+    const uint hi = (x >> 32) + (prev + lo < prev ? 1 : 0);
+    if (hi) {
+        atomic_add(p + 1, hi);
+    }
+}
+
+uint histogram_bin(float distance, float bins_per_metre);
+uint histogram_bin(float distance, float bins_per_metre) {
+    return distance * bins_per_metre;
+}
+
+//  These replicate vector_look_up_table::index from core.
+uint azimuth_to_index(float azimuth, uint divisions);
+uint azimuth_to_index(float azimuth, uint divisions) {
+    const float angle = 360.0f / divisions;
+    azimuth += angle / 2;
+    while (azimuth < 0) {
+        azimuth += 360;
+    }
+    return ((uint)(azimuth / angle)) % divisions;
+}
+
+uint elevation_to_index(float elevation, uint divisions);
+uint elevation_to_index(float elevation, uint divisions) {
+    const float angle = 180.0f / (divisions + 1);
+    elevation += 90 + angle / 2;
+    while (elevation < 0) {
+        elevation += 360;
+    }
+    const uint adjusted = ((uint)(elevation / angle)) % (2 * (divisions + 1));
+    return clamp(adjusted, (uint)1, divisions) - 1;
+}
+
+uint direction_index(float3 pointing,
+                     uint azimuth_divisions,
+                     uint elevation_divisions);
+uint direction_index(float3 pointing,
+                     uint azimuth_divisions,
+                     uint elevation_divisions) {
+    const float elevation = asin(pointing.y);
+    const float azimuth =
+            fabs(pointing.y) == 1 ? 0 : atan2(pointing.x, -pointing.z);
+    return azimuth_to_index(degrees(-azimuth), azimuth_divisions) *
+                   elevation_divisions +
+           elevation_to_index(degrees(elevation), elevation_divisions);
+}
+
+//  Finds the number of histogram bins needed to hold every impulse, and the
+//  loudest band of any impulse, which sets the fixed-point scale.
+//  Each work-group finds its own maxima first, so that there are only two
+//  global atomics per group.
+//  Energies are never negative, so their bits sort in the same order as
+//  the floats themselves.
+kernel void histogram_extent(const global impulse* impulses,
+                             float bins_per_metre,
+                             volatile global uint* extent,
+                             uint num_impulses) {
+    local uint group_extent;
+    local uint group_volume;
+    if (get_local_id(0) == 0) {
+        group_extent = 0;
+        group_volume = 0;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    //  Every work-item has to reach the barriers, so padding work-items
+    //  can't return early.
+    const size_t thread = get_global_id(0);
+    if (thread < num_impulses) {
+        const impulse i = impulses[thread];
+        if (i.distance) {
+            atomic_max(&group_extent,
+                       histogram_bin(i.distance, bins_per_metre) + 1);
+
+            const float4 v = fmax(i.volume.lo, i.volume.hi);
+            const float2 w = fmax(v.lo, v.hi);
+            atomic_max(&group_volume, as_uint(fmax(w.x, w.y)));
+        }
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (get_local_id(0) == 0) {
+        atomic_max(extent, group_extent);
+        atomic_max(extent + 1, group_volume);
+    }
+}
+
+//  Adds each impulse's energy to a fixed-point histogram, which is laid out
+//  as [bin][direction][band][word].
+kernel void directional_histogram(const global impulse* impulses,
+                                  float3 receiver,
+                                  float bins_per_metre,
+                                  uint azimuth_divisions,
+                                  uint elevation_divisions,
+                                  float scale,
+                                  volatile global uint* accumulator,
+                                  uint num_impulses) {
+    const size_t thread = get_global_id(0);
+    if (thread >= num_impulses) {
+        return;
+    }
+
+    const impulse i = impulses[thread];
+    if (!i.distance) {
+        return;
+    }
+
+    const uint bin = histogram_bin(i.distance, bins_per_metre);
+    const uint direction = direction_index(normalize(i.position - receiver),
+                                           azimuth_divisions,
+                                           elevation_divisions);
+
+    //  bands_type is a float8.
+    const uint bands = 8;
+    float volume[8];
+    vstore8(i.volume, 0, volume);
+
+    volatile global uint* out =
+            accumulator +
+            (bin * azimuth_divisions * elevation_divisions + direction) *
+                    bands * 2;
+    for (uint band = 0; band != bands; ++band) {
+        atomic_add_fixed(out + band * 2, (ulong)(volume[band] * scale));
+    }
+}
+
+//  Adds a fixed-point histogram to the float histogram, which is laid out
+//  as [bin][direction][band], so that it can grow without being rearranged.
+//  Each value is written by exactly one work-item.
+kernel void resolve_histogram(const global uint2* accumulator,
+                              float scale,
+                              global float* histogram,
+                              uint num_values) {
+    const size_t thread = get_global_id(0);
+    if (thread >= num_values) {
+        return;
+    }
+
+    const uint2 x = accumulator[thread];
+    histogram[thread] += convert_float((ulong)x.y << 32 | x.x) / scale;
+}
+
 )";
 
 program::program(const core::compute_context& cc)
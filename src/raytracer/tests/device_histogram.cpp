@@ -0,0 +1,161 @@
+#include "raytracer/reflection_processor/stochastic_histogram.h"
+#include "raytracer/stochastic/device_histogram.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace wayverb::raytracer;
+using namespace wayverb::core;
+
+namespace {
+
+constexpr auto speed_of_sound = 340.0;
+constexpr auto sample_rate = 1000.0;
+
+using histogram_t = stochastic::directional_energy_histogram<20, 9>;
+using table_t = decltype(histogram_t::histogram);
+
+/// Random impulses around a receiver.
+/// Impulses are in the middle of histogram bins and directional sectors, so
+/// that the host and device can't disagree about where they go.
+auto make_impulses(size_t num, const glm::vec3& receiver, size_t max_bin) {
+    std::default_random_engine engine{0};
+    std::uniform_int_distribution<size_t> bin{0, max_bin};
+    std::uniform_int_distribution<size_t> azimuth{0, 19};
+    std::uniform_int_distribution<size_t> elevation{0, 8};
+    std::uniform_real_distribution<float> volume{0, 1};
+    std::bernoulli_distribution empty{0.1};
+
+    util::aligned::vector<impulse<simulation_bands>> ret(num);
+    for (auto& i : ret) {
+        if (empty(engine)) {
+            continue;
+        }
+        const auto distance = static_cast<float>(
+                (bin(engine) + 0.5) * speed_of_sound / sample_rate);
+        const auto direction = table_t::pointing(
+                table_t::index_pair{azimuth(engine), elevation(engine)});
+        bands_type v{};
+        for (auto& j : v.s) {
+            j = volume(engine);
+        }
+        i = make_impulse(
+                v, to_cl_float3{}(receiver + direction * distance), distance);
+    }
+    return ret;
+}
+
+struct intermediate_impulse final {
+    bands_type volume;
+    double time;
+    glm::vec3 pointing;
+};
+
+/// Bins impulses on the host, like the stochastic processor used to.
+template <typename Histogram>
+void host_histogram(const util::aligned::vector<impulse<8>>& impulses,
+                    const glm::vec3& receiver,
+                    Histogram& ret) {
+    util::aligned::vector<intermediate_impulse> intermediate;
+    for (const auto& i : impulses) {
+        if (i.distance) {
+            intermediate.emplace_back(intermediate_impulse{
+                    i.volume,
+                    i.distance / speed_of_sound,
+                    glm::normalize(to_vec3{}(i.position) - receiver)});
+        }
+    }
+    incremental_histogram(ret.histogram,
+                          begin(intermediate),
+                          end(intermediate),
+                          ret.sample_rate,
+                          reflection_processor::energy_histogram_sum_functor{});
+}
+
+void check_near(const util::aligned::vector<bands_type>& a,
+                const util::aligned::vector<bands_type>& b) {
+    ASSERT_EQ(a.size(), b.size());
+    for (auto i = 0u; i != a.size(); ++i) {
+        for (auto j = 0u; j != simulation_bands; ++j) {
+            ASSERT_NEAR(a[i].s[j], b[i].s[j], 0.0001 * (1 + b[i].s[j]));
+        }
+    }
+}
+
+TEST(device_histogram, matches_host) {
+    const compute_context cc{};
+    cl::CommandQueue queue{cc.context, cc.device};
+    const glm::vec3 receiver{1, 2, 3};
+
+    histogram_t reference{sample_rate, {}};
+    stochastic::device_histogram device{
+            cc, receiver, speed_of_sound, sample_rate, 20, 9};
+
+    //  Later batches are longer, so the device histogram has to grow.
+    for (const auto max_bin : {10u, 100u, 50u, 1000u}) {
+        const auto impulses = make_impulses(1 << 14, receiver, max_bin);
+        host_histogram(impulses, receiver, reference);
+
+        //  The buffer is bigger than the number of valid entries.
+        auto padded = impulses;
+        padded.resize(impulses.size() + 100,
+                      make_impulse(make_bands_type(1),
+                                   cl_float3{{0, 0, 0}},
+                                   1.0f));
+        const auto buffer = load_to_buffer(cc.context, padded, true);
+        device.add(queue, buffer, impulses.size());
+    }
+
+    histogram_t result{sample_rate, {}};
+    stochastic::unpack_histogram(device.read(queue), result);
+
+    for (auto i = 0u; i != 20; ++i) {
+        for (auto j = 0u; j != 9; ++j) {
+            check_near(result.histogram.table[i][j],
+                       reference.histogram.table[i][j]);
+        }
+    }
+}
+
+TEST(device_histogram, order_independent) {
+    const compute_context cc{};
+    cl::CommandQueue queue{cc.context, cc.device};
+    const glm::vec3 receiver{1, 2, 3};
+
+    //  Few bins, so that lots of impulses land in each entry.
+    auto impulses = make_impulses(1 << 14, receiver, 3);
+
+    stochastic::device_histogram forward{
+            cc, receiver, speed_of_sound, sample_rate, 20, 9};
+    forward.add(queue,
+                load_to_buffer(cc.context, impulses, true),
+                impulses.size());
+
+    std::reverse(impulses.begin(), impulses.end());
+    stochastic::device_histogram reverse{
+            cc, receiver, speed_of_sound, sample_rate, 20, 9};
+    reverse.add(queue,
+                load_to_buffer(cc.context, impulses, true),
+                impulses.size());
+
+    ASSERT_EQ(forward.read(queue), reverse.read(queue));
+}
+
+TEST(device_histogram, empty) {
+    const compute_context cc{};
+    cl::CommandQueue queue{cc.context, cc.device};
+
+    stochastic::device_histogram device{
+            cc, glm::vec3{0}, speed_of_sound, sample_rate, 1, 1};
+    const auto buffer = load_to_buffer(
+            cc.context, util::aligned::vector<impulse<8>>(100), true);
+    device.add(queue, buffer, 100);
+    device.add(queue, buffer, 0);
+
+    ASSERT_EQ(device.get_bins(), 0u);
+    ASSERT_TRUE(device.read(queue).empty());
+}
+
+}  // namespace
@@ -0,0 +1,135 @@
+#include "raytracer/image_source/device_validation.h"
+#include "raytracer/image_source/postprocess_branches.h"
+#include "raytracer/image_source/reflection_path_builder.h"
+#include "raytracer/reflector.h"
+
+#include "core/azimuth_elevation.h"
+#include "core/geo/box.h"
+#include "core/spatial_division/voxelised_scene_data.h"
+
+#include "gtest/gtest.h"
+
+using namespace wayverb::raytracer;
+using namespace wayverb::raytracer::image_source;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(device_validation, flatten_paths) {
+    using path = util::aligned::vector<path_element>;
+    image_source::tree paths;
+    paths.push({path{{1, true}, {2, false}, {3, true}},
+                path{{1, true}, {4, true}},
+                path{{0, false}, {2, true}}});
+    const auto tree = paths.build();
+
+    const auto flattened = flatten_paths(begin(tree.get_branches()),
+                                         end(tree.get_branches()));
+
+    //  Visible nodes only, in depth-first order.
+    ASSERT_EQ(flattened.offsets,
+              (util::aligned::vector<cl_uint>{0, 2, 3, 6, 8}));
+    ASSERT_EQ(flattened.triangles,
+              (util::aligned::vector<cl_uint>{
+                      0, 2, 1, 1, 2, 3, 1, 4}));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct valid_path final {
+    glm::vec3 image_source;
+    util::aligned::vector<reflection_metadata> intersections;
+};
+
+auto make_collector(util::aligned::vector<valid_path>& ret) {
+    return [&ret](const auto& img, auto b, auto e) {
+        ret.emplace_back(valid_path{img, {b, e}});
+    };
+}
+
+TEST(device_validation, matches_host) {
+    const compute_context cc{};
+    const auto voxelised = make_voxelised_scene_data(
+            geo::get_scene_data(geo::box{glm::vec3{0}, glm::vec3{4, 3, 6}},
+                                make_surface<simulation_bands>(0.1, 0.1)),
+            5,
+            0.1f);
+    const scene_buffers buffers{cc.context, voxelised};
+
+    const glm::vec3 source{1, 2, 1};
+    const glm::vec3 receiver{2, 1, 5};
+
+    //  Build a tree of candidate paths with the raytracer.
+    const auto directions = get_random_directions(1 << 13);
+    const auto rays = get_rays_from_directions(
+            begin(directions), end(directions), source);
+    reflector reflector{cc, receiver, begin(rays), end(rays)};
+    reflection_path_builder builder{rays.size()};
+    for (auto i = 0; i != 4; ++i) {
+        builder.push(reflector.run_step(buffers));
+    }
+
+    image_source::tree paths;
+    paths.push(builder.get_data());
+    const auto tree = paths.build();
+
+    util::aligned::vector<valid_path> host;
+    for (const auto& branch : tree.get_branches()) {
+        find_valid_paths(
+                branch, source, receiver, voxelised, make_collector(host));
+    }
+    ASSERT_FALSE(host.empty());
+
+    util::aligned::vector<valid_path> device;
+    path_validator{cc, voxelised, buffers}.find_valid_paths(
+            flatten_paths(begin(tree.get_branches()),
+                          end(tree.get_branches())),
+            source,
+            receiver,
+            make_collector(device));
+
+    //  Same paths, in the same order.
+    ASSERT_EQ(host.size(), device.size());
+    for (auto i = 0u; i != host.size(); ++i) {
+        for (auto j = 0u; j != 3; ++j) {
+            ASSERT_NEAR(host[i].image_source[j],
+                        device[i].image_source[j],
+                        0.0001);
+        }
+
+        ASSERT_EQ(host[i].intersections.size(),
+                  device[i].intersections.size());
+        for (auto j = 0u; j != host[i].intersections.size(); ++j) {
+            ASSERT_EQ(host[i].intersections[j].surface_index,
+                      device[i].intersections[j].surface_index);
+            ASSERT_NEAR(host[i].intersections[j].cos_angle,
+                        device[i].intersections[j].cos_angle,
+                        0.0001);
+        }
+    }
+
+    //  And the same impulses once postprocessed.
+    const auto host_impulses = postprocess_branches(begin(tree.get_branches()),
+                                                    end(tree.get_branches()),
+                                                    source,
+                                                    receiver,
+                                                    voxelised,
+                                                    false);
+    const auto device_impulses =
+            postprocess_branches(cc,
+                                 begin(tree.get_branches()),
+                                 end(tree.get_branches()),
+                                 source,
+                                 receiver,
+                                 voxelised,
+                                 buffers,
+                                 false);
+    ASSERT_EQ(host_impulses.size(), device_impulses.size());
+    for (auto i = 0u; i != host_impulses.size(); ++i) {
+        ASSERT_NEAR(host_impulses[i].distance,
+                    device_impulses[i].distance,
+                    0.0001);
+    }
+}
+
+}  // namespace
@@ -0,0 +1,116 @@
+#include "raytracer/flat_multitree.h"
+#include "raytracer/image_source/tree.h"
+#include "raytracer/multitree.h"
+
+#include "gtest/gtest.h"
+
+#include <random>
+
+using namespace wayverb::raytracer;
+using namespace wayverb::raytracer::image_source;
+
+namespace {
+
+using path = util::aligned::vector<path_element>;
+
+/// Checks that a flat tree has exactly the same shape and items as a
+/// multitree.
+template <typename T>
+void check_equal(const flat_multitree_branch<T>& a, const multitree<T>& b) {
+    ASSERT_EQ(a.item, b.item);
+    ASSERT_EQ(a.branches.size(), b.branches.size());
+    auto it = b.branches.begin();
+    for (const auto& i : a.branches) {
+        check_equal(i, *it++);
+    }
+}
+
+auto make_random_paths(size_t num, cl_uint triangles, size_t max_length) {
+    std::default_random_engine engine{0};
+    std::uniform_int_distribution<cl_uint> triangle{0, triangles - 1};
+    std::uniform_int_distribution<size_t> length{0, max_length};
+    std::bernoulli_distribution visible{0.5};
+
+    util::aligned::vector<path> ret(num);
+    for (auto& i : ret) {
+        i.resize(length(engine));
+        for (auto& j : i) {
+            j = path_element{triangle(engine), visible(engine)};
+        }
+    }
+    return ret;
+}
+
+auto make_multitree(const util::aligned::vector<path>& paths) {
+    multitree<path_element> ret{};
+    for (const auto& i : paths) {
+        add_path(ret, i.begin(), i.end());
+    }
+    return ret;
+}
+
+TEST(flat_multitree, from_paths) {
+    const util::aligned::vector<path> paths{path{{2, true}, {1, true}},
+                                            path{{0, false}},
+                                            path{},
+                                            path{{2, false}, {3, true}},
+                                            path{{2, true}, {1, true}}};
+    const auto tree = flat_multitree<path_element>::from_paths(paths.begin(),
+                                                               paths.end());
+
+    //  Breadth-first, with sorted, contiguous branches.
+    ASSERT_EQ(tree.size(), 4u);
+    const auto& nodes = tree.get_nodes();
+    ASSERT_EQ(nodes[0].branches_begin, 1u);
+    ASSERT_EQ(nodes[0].branches_end, 3u);
+    ASSERT_EQ(nodes[1].item, (path_element{0, false}));
+    ASSERT_EQ(nodes[2].item, (path_element{2, true}));
+    ASSERT_EQ(nodes[2].branches_begin, 3u);
+    ASSERT_EQ(nodes[2].branches_end, 5u);
+    ASSERT_EQ(nodes[3].item, (path_element{1, true}));
+    ASSERT_EQ(nodes[4].item, (path_element{3, true}));
+
+    check_equal(tree.get_branch(0), make_multitree(paths));
+}
+
+TEST(flat_multitree, merge) {
+    const util::aligned::vector<path> a{path{{1, false}, {2, true}}};
+    const util::aligned::vector<path> b{path{{1, true}, {3, true}},
+                                        path{{0, true}}};
+    const util::aligned::vector<flat_multitree<path_element>> trees{
+            flat_multitree<path_element>::from_paths(a.begin(), a.end()),
+            flat_multitree<path_element>::from_paths(b.begin(), b.end())};
+    const auto merged = flat_multitree<path_element>::merge(trees.begin(),
+                                                            trees.end());
+
+    //  Where both trees have a node, the item from the first is kept.
+    ASSERT_EQ(merged.get_nodes()[2].item, (path_element{1, false}));
+
+    auto all = a;
+    all.insert(all.end(), b.begin(), b.end());
+    check_equal(merged.get_branch(0), make_multitree(all));
+}
+
+TEST(flat_multitree, matches_multitree) {
+    for (const auto triangles : {2u, 12u, 1000u}) {
+        const auto paths = make_random_paths(10000, triangles, 8);
+
+        //  Built in one go.
+        const auto tree = flat_multitree<path_element>::from_paths(
+                paths.begin(), paths.end());
+        const auto reference = make_multitree(paths);
+        check_equal(tree.get_branch(0), reference);
+
+        //  Pushed a segment at a time, where earlier paths take precedence.
+        image_source::tree segmented{};
+        for (auto i = 0u; i < paths.size(); i += 999) {
+            segmented.push(util::aligned::vector<path>(
+                    paths.begin() + i,
+                    paths.begin() + std::min(paths.size(), i + size_t{999})));
+        }
+        const auto built = segmented.build();
+        check_equal(built.get_branch(0), reference);
+    }
+}
+
+}  // namespace
@@ -0,0 +1,129 @@
+#include "raytracer/iterative_builder.h"
+#include "raytracer/live_reflections.h"
+#include "raytracer/reflector.h"
+
+#include "core/azimuth_elevation.h"
+#include "core/geo/box.h"
+#include "core/spatial_division/voxelised_scene_data.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+using namespace wayverb::raytracer;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(live_reflections, make_live_reflections) {
+    const util::aligned::vector<reflection> reflections{
+            reflection{cl_float3{{1, 0, 0}}, 3, 1, 0},
+            reflection{},
+            reflection{cl_float3{{0, 1, 0}}, 5, 1, 1},
+            reflection{}};
+
+    const auto live =
+            make_live_reflections(begin(reflections), end(reflections));
+    ASSERT_EQ(live.rays, (util::aligned::vector<cl_uint>{0, 2}));
+    ASSERT_EQ(live.reflections,
+              (util::aligned::vector<reflection>{reflections[0],
+                                                 reflections[2]}));
+}
+
+TEST(live_reflections, push_indexed) {
+    iterative_builder<int> builder{4};
+    const util::aligned::vector<cl_uint> indices{1, 3};
+    const util::aligned::vector<int> items{10, 30};
+
+    builder.push_indexed(begin(indices),
+                         end(indices),
+                         begin(items),
+                         [](auto i) { return i; });
+    ASSERT_EQ(builder.get_data(),
+              (util::aligned::vector<util::aligned::vector<int>>{
+                      {}, {10}, {}, {30}}));
+
+    const util::aligned::vector<cl_uint> bad_indices{4};
+    ASSERT_THROW(builder.push_indexed(begin(bad_indices),
+                                      end(bad_indices),
+                                      begin(items),
+                                      [](auto i) { return i; }),
+                 std::runtime_error);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// A box with one missing wall, so that rays gradually escape.
+auto make_open_box() {
+    const auto box_scene = geo::get_scene_data(
+            geo::box{glm::vec3{0}, glm::vec3{4, 3, 6}},
+            make_surface<simulation_bands>(0, 0));
+    auto triangles = box_scene.get_triangles();
+    triangles.erase(triangles.begin(), triangles.begin() + 2);
+    return make_voxelised_scene_data(
+            decltype(box_scene){triangles,
+                                box_scene.get_vertices(),
+                                box_scene.get_surfaces()},
+            5,
+            0.1f);
+}
+
+TEST(live_reflections, compaction) {
+    const compute_context cc{};
+    const auto voxelised = make_open_box();
+    const scene_buffers buffers{cc.context, voxelised};
+
+    const glm::vec3 source{1, 2, 1};
+    const glm::vec3 receiver{2, 1, 2};
+
+    const auto directions = get_random_directions(1 << 12);
+    const auto rays = get_rays_from_directions(
+            begin(directions), end(directions), source);
+
+    reflector reflector{cc, receiver, begin(rays), end(rays)};
+    ASSERT_EQ(reflector.get_live_rays(), rays.size());
+
+    auto previous_live = rays.size();
+    for (auto step = 0u; step != 50 && reflector.get_live_rays(); ++step) {
+        const auto live = reflector.run_step(buffers);
+        ASSERT_EQ(live.rays.size(), live.reflections.size());
+        ASSERT_EQ(live.rays.size(), reflector.get_live_rays());
+
+        //  Rays only ever stop.
+        ASSERT_LE(live.rays.size(), previous_live);
+        previous_live = live.rays.size();
+
+        //  Live results are sorted, and only contain rays which are going.
+        ASSERT_TRUE(std::is_sorted(begin(live.rays), end(live.rays)));
+        ASSERT_TRUE(std::adjacent_find(begin(live.rays), end(live.rays)) ==
+                    end(live.rays));
+        ASSERT_TRUE(std::all_of(begin(live.reflections),
+                                end(live.reflections),
+                                [](const auto& i) { return i.keep_going; }));
+
+        //  They match the full per-ray list on the device, which has
+        //  stopped entries for every other ray.
+        const auto all = reflector.get_reflections();
+        auto it = begin(live.rays);
+        for (auto ray = 0u; ray != all.size(); ++ray) {
+            if (it != end(live.rays) && *it == ray) {
+                ASSERT_EQ(all[ray], live.reflections[it - begin(live.rays)]);
+                ++it;
+            } else {
+                ASSERT_FALSE(all[ray].keep_going);
+            }
+        }
+    }
+
+    //  With a wall missing, plenty of rays should have escaped.
+    ASSERT_LT(previous_live, rays.size());
+
+    //  Once every ray has stopped, steps don't do anything.
+    if (!reflector.get_live_rays()) {
+        const auto live = reflector.run_step(buffers);
+        ASSERT_TRUE(live.rays.empty());
+        ASSERT_TRUE(live.reflections.empty());
+    }
+}
+
+}  // namespace
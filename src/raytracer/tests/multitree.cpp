@@ -21,10 +21,9 @@ TEST(multitree, construct_image_source_tree_small) {
                           image_source::path_element{0, true}}};
 
     image_source::tree ist{};
-    for (const auto& path : paths) {
-        ist.push(path);
-    }
-    const auto& tree{ist.get_branches()};
+    ist.push(paths);
+    const auto built = ist.build();
+    const auto tree = built.get_branches();
 
     ASSERT_EQ(tree.size(), 1);
     ASSERT_EQ(tree.begin()->item.index, 0);
@@ -53,7 +52,6 @@ TEST(multitree, construct_image_source_tree_large) {
             paths{100000};
     std::generate(paths.begin(), paths.end(), make_path);
     image_source::tree tree{};
-    for (const auto& path : paths) {
-        tree.push(path);
-    }
+    tree.push(paths);
+    tree.build();
 }
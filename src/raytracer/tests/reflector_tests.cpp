@@ -103,7 +103,11 @@ TEST_F(reflector_fixture, locations) {
     }
 
     const auto current_rays = reflector.get_rays();
-    const auto reflections = reflector.run_step(buffers);
+    const auto live = reflector.run_step(buffers);
+
+    //  The box is closed, so every ray is still going.
+    ASSERT_EQ(live.rays.size(), current_rays.size());
+    const auto& reflections = live.reflections;
 
     ASSERT_TRUE(std::any_of(begin(reflections),
                             end(reflections),
@@ -132,7 +136,9 @@ TEST_F(reflector_fixture, multi_layer_reflections) {
         for (auto i = 0u; i != fast_intersections.size(); ++i) {
             ASSERT_EQ(fast_intersections[i], slow_intersections[i]);
         }
-        const auto reflections = reflector.run_step(buffers);
+        const auto live = reflector.run_step(buffers);
+        ASSERT_EQ(live.rays.size(), current_rays.size());
+        const auto& reflections = live.reflections;
 
         for (auto j = 0u; j != current_rays.size(); ++j) {
             ASSERT_TRUE(reflections[j].keep_going);
@@ -0,0 +1,96 @@
+#include "raytracer/raytracer.h"
+#include "raytracer/reflection_processor/image_source.h"
+#include "raytracer/reflection_processor/stochastic_histogram.h"
+#include "raytracer/reflection_processor/visual.h"
+
+#include "core/azimuth_elevation.h"
+#include "core/geo/box.h"
+#include "core/spatial_division/voxelised_scene_data.h"
+
+#include "gtest/gtest.h"
+
+using namespace wayverb::raytracer;
+using namespace wayverb::core;
+
+namespace {
+
+struct segments_in_flight : public ::testing::Test {
+    //  With no scattering, rays reflect specularly, so the raytracer's own
+    //  random numbers don't change the results.
+    const voxelised_scene_data<cl_float3, surface<simulation_bands>>
+            voxelised{make_voxelised_scene_data(
+                    geo::get_scene_data(
+                            geo::box{glm::vec3{0}, glm::vec3{4, 3, 6}},
+                            make_surface<simulation_bands>(0.1, 0)),
+                    5,
+                    0.1f)};
+    const compute_context cc{};
+    const glm::vec3 source{1, 2, 1};
+    const glm::vec3 receiver{2, 1, 5};
+    const environment env{};
+
+    //  A few full segments, and a partial one.
+    const util::aligned::vector<glm::vec3> directions{
+            get_random_directions(3 * (1 << 14) + 1000)};
+
+    auto run_with(size_t in_flight, size_t& callbacks) {
+        return run(begin(directions),
+                   end(directions),
+                   cc,
+                   voxelised,
+                   source,
+                   receiver,
+                   env,
+                   true,
+                   [&](auto i, auto total) {
+                       //  Callbacks come in order, for full segments only.
+                       ASSERT_EQ(static_cast<size_t>(i), callbacks);
+                       ASSERT_EQ(total, 3);
+                       callbacks += 1;
+                   },
+                   std::make_tuple(
+                           reflection_processor::make_image_source{3},
+                           reflection_processor::make_stochastic_histogram{
+                                   directions.size(), 3, 0.5f, 1000.0f},
+                           reflection_processor::make_visual{10}),
+                   in_flight);
+    }
+};
+
+TEST_F(segments_in_flight, deterministic) {
+    size_t sequential_callbacks = 0;
+    const auto sequential = run_with(1, sequential_callbacks);
+    ASSERT_TRUE(sequential);
+    ASSERT_EQ(sequential_callbacks, 3u);
+
+    for (const auto in_flight : {2u, 3u, 8u}) {
+        size_t callbacks = 0;
+        const auto overlapped = run_with(in_flight, callbacks);
+        ASSERT_TRUE(overlapped);
+        ASSERT_EQ(callbacks, 3u);
+
+        //  Segments are merged in order, so results match exactly.
+        ASSERT_EQ(std::get<0>(*overlapped), std::get<0>(*sequential));
+        ASSERT_EQ(std::get<1>(*overlapped).histogram,
+                  std::get<1>(*sequential).histogram);
+        ASSERT_EQ(std::get<2>(*overlapped), std::get<2>(*sequential));
+    }
+}
+
+TEST_F(segments_in_flight, cancel) {
+    const std::atomic_bool keep_going{false};
+    const auto results = run(begin(directions),
+                             end(directions),
+                             cc,
+                             voxelised,
+                             source,
+                             receiver,
+                             env,
+                             keep_going,
+                             [](auto, auto) {},
+                             std::make_tuple(
+                                     reflection_processor::make_visual{10}));
+    ASSERT_FALSE(results);
+}
+
+}  // namespace
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <mutex>
+
+namespace util {
+
+/// State which is shared between threads, like a table of previous results,
+/// along with counters describing how it has been used.
+/// The state and the counters are only ever touched under the same lock, so
+/// they always agree with one another.
+template <typename State, typename Statistics>
+class locked_cache final {
+public:
+    /// Calls f with the state and the statistics while holding the lock, and
+    /// returns whatever f returns.
+    /// f should be quick: slow work (fitting, simulating, timing) belongs
+    /// outside, with a second call to store its result.
+    template <typename Func>
+    auto access(Func&& f) {
+        std::lock_guard<std::mutex> lck{mutex_};
+        return f(state_, statistics_);
+    }
+
+    template <typename Func>
+    auto access(Func&& f) const {
+        std::lock_guard<std::mutex> lck{mutex_};
+        return f(state_, statistics_);
+    }
+
+    Statistics get_statistics() const {
+        std::lock_guard<std::mutex> lck{mutex_};
+        return statistics_;
+    }
+
+    /// Resets both the state and the statistics.
+    void clear() {
+        std::lock_guard<std::mutex> lck{mutex_};
+        state_ = State{};
+        statistics_ = Statistics{};
+    }
+
+private:
+    mutable std::mutex mutex_;
+    State state_;
+    Statistics statistics_;
+};
+
+}  // namespace util
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core/cl/common.h"
+
+#include "utilities/aligned/vector.h"
+#include "utilities/locked_cache.h"
+
+#include <map>
+
+/// \file cache.h
+/// A compensation signal is the impulse response of the compressed
+/// rectangular mesh, seen from the source node.
+/// The mesh always runs at its maximum courant number with the same impulse,
+/// so the signal depends only on its length, and each length only needs to be
+/// simulated once per cache.
+
+namespace wayverb {
+namespace waveguide {
+
+struct compensation_signal_cache_statistics final {
+    size_t hits{0};
+    size_t misses{0};
+};
+
+class compensation_signal_cache final {
+public:
+    /// Returns the first 'steps' samples of the compensation signal,
+    /// simulating it on the given device if this length hasn't been seen.
+    util::aligned::vector<float> get(const core::compute_context& cc,
+                                     size_t steps);
+
+    compensation_signal_cache_statistics get_statistics() const;
+
+    /// Removes all cached signals, and resets the statistics.
+    void clear();
+
+private:
+    util::locked_cache<std::map<size_t, util::aligned::vector<float>>,
+                       compensation_signal_cache_statistics>
+            signals_;
+};
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -18,12 +18,28 @@ public:
             const core::compute_context& cc);
 
     auto get_compressed_waveguide_kernel() const {
-        return program_wrapper_.get_kernel<cl::Buffer, cl::Buffer>(
+        return program_wrapper_.get_kernel<cl::Buffer, cl::Buffer, cl_uint>(
                 "compressed_waveguide");
     }
 
     auto get_zero_buffer_kernel() const {
-        return program_wrapper_.get_kernel<cl::Buffer>("zero_buffer");
+        return program_wrapper_.get_kernel<cl::Buffer, cl_uint>(
+                "zero_buffer");
+    }
+
+    auto get_hard_source_kernel() const {
+        return program_wrapper_.get_kernel<cl::Buffer, cl::Buffer, cl_uint>(
+                "hard_source");
+    }
+
+    auto get_soft_source_kernel() const {
+        return program_wrapper_.get_kernel<cl::Buffer, cl::Buffer, cl_uint>(
+                "soft_source");
+    }
+
+    auto get_record_output_kernel() const {
+        return program_wrapper_.get_kernel<cl::Buffer, cl::Buffer, cl_uint>(
+                "record_output");
     }
 
     template <cl_program_info T>
@@ -39,6 +55,9 @@ private:
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// The whole input is uploaded before the run, and the output is recorded on
+/// the device and downloaded once at the end, so there are no blocking
+/// transfers between steps.
 class compressed_rectangular_waveguide final {
 public:
     using compressed_waveguide_kernel =
@@ -47,83 +66,118 @@ public:
     using zero_buffer_kernel =
             decltype(std::declval<compressed_rectangular_waveguide_program>()
                              .get_zero_buffer_kernel());
+    using source_kernel =
+            decltype(std::declval<compressed_rectangular_waveguide_program>()
+                             .get_hard_source_kernel());
+    using record_output_kernel =
+            decltype(std::declval<compressed_rectangular_waveguide_program>()
+                             .get_record_output_kernel());
 
     compressed_rectangular_waveguide(const core::compute_context& cc,
                                      size_t steps);
 
+    /// per_step is called with each step number once that step has run.
+    /// The device is only waited on every progress_interval steps, so calls
+    /// come in bursts.
     template <typename It, typename T>
     util::aligned::vector<float> run_hard_source(It begin,
                                                  It end,
                                                  const T& per_step) {
-        return run(begin,
-                   end,
-                   [](auto& queue, auto& buffer, float input) {
-                       core::write_value(queue, buffer, 0, input);
-                   },
-                   per_step);
+        return run(begin, end, hard_source_kernel_, per_step);
     }
 
     template <typename It, typename T>
     util::aligned::vector<float> run_soft_source(It begin,
                                                  It end,
                                                  const T& per_step) {
-        return run(begin,
-                   end,
-                   [](auto& queue, auto& buffer, float input) {
-                       const auto c =
-                               core::read_value<cl_float>(queue, buffer, 0);
-                       core::write_value(queue, buffer, 0, c + input);
-                   },
-                   per_step);
+        return run(begin, end, soft_source_kernel_, per_step);
     }
 
+    static constexpr size_t progress_interval = 64;
+
 private:
-    template <typename It, typename T, typename U>
+    compressed_rectangular_waveguide(
+            const core::compute_context& cc,
+            const compressed_rectangular_waveguide_program& program,
+            size_t steps);
+
+    template <typename It, typename T>
     util::aligned::vector<float> run(It begin,
                                      It end,
-                                     const T& writer,
-                                     const U& per_step) {
+                                     source_kernel& source,
+                                     const T& per_step) {
+        const auto steps = dimension_ * 2;
+        if (!steps) {
+            return {};
+        }
+
+        const auto context = queue_.getInfo<CL_QUEUE_CONTEXT>();
+
+        //  The input is zero-padded to the length of the run.
+        util::aligned::vector<cl_float> input(steps, 0);
+        for (auto i = 0u; i != steps && begin != end; ++i, ++begin) {
+            input[i] = *begin;
+        }
+        const auto input_buffer = core::load_to_buffer(context, input, true);
+        cl::Buffer output_buffer{
+                context, CL_MEM_WRITE_ONLY, sizeof(cl_float) * steps};
+
         //  init buffers
         const auto buffer_size = tetrahedron(dimension_);
-        zero_buffer_kernel_(
-                cl::EnqueueArgs{queue_,
-                                cl::NDRange{previous_.getInfo<CL_MEM_SIZE>() /
-                                            sizeof(cl_float)}},
-                previous_);
-        zero_buffer_kernel_(
-                cl::EnqueueArgs{queue_,
-                                cl::NDRange{current_.getInfo<CL_MEM_SIZE>() /
-                                            sizeof(cl_float)}},
-                current_);
-
-        util::aligned::vector<float> ret{};
-        ret.reserve(std::distance(begin, end));
-
-        for (auto count = 0ul; count != dimension_ * 2; ++count) {
-            writer(queue_, current_, begin == end ? 0.0f : *begin++);
+        const auto zero = [&](const auto& buffer) {
+            const auto items = core::items_in_buffer<cl_float>(buffer);
+            zero_buffer_kernel_(
+                    queue_, items, buffer, static_cast<cl_uint>(items));
+        };
+        zero(previous_);
+        zero(current_);
+
+        //  The source and recording touch a single node.
+        const auto single = [&] {
+            return cl::EnqueueArgs{queue_, cl::NDRange{1}};
+        };
+
+        auto reported = 0ul;
+        for (auto count = 0ul; count != steps; ++count) {
+            source(single(),
+                   current_,
+                   input_buffer,
+                   static_cast<cl_uint>(count));
 
             //  run the kernel
-            compressed_waveguide_kernel_(
-                    cl::EnqueueArgs{queue_, cl::NDRange{buffer_size}},
-                    previous_,
-                    current_);
+            compressed_waveguide_kernel_(queue_,
+                                         buffer_size,
+                                         previous_,
+                                         current_,
+                                         static_cast<cl_uint>(buffer_size));
 
             //  ping-pong the buffers
             using std::swap;
             swap(previous_, current_);
 
             //  get output value
-            ret.emplace_back(core::read_value<cl_float>(queue_, current_, 0));
-
-            per_step(count);
+            record_output_kernel_(single(),
+                                  current_,
+                                  output_buffer,
+                                  static_cast<cl_uint>(count));
+
+            if ((count + 1) % progress_interval == 0 || count + 1 == steps) {
+                queue_.finish();
+                for (; reported <= count; ++reported) {
+                    per_step(reported);
+                }
+            }
         }
 
-        return ret;
+        return core::read_from_buffer<cl_float>(queue_, output_buffer);
     }
 
     cl::CommandQueue queue_;
     compressed_waveguide_kernel compressed_waveguide_kernel_;
     zero_buffer_kernel zero_buffer_kernel_;
+    source_kernel hard_source_kernel_;
+    source_kernel soft_source_kernel_;
+    record_output_kernel record_output_kernel_;
     size_t dimension_;
 
     cl::Buffer current_;
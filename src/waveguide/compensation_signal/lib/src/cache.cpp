@@ -0,0 +1,50 @@
+#include "compensation_signal/cache.h"
+#include "compensation_signal/waveguide.h"
+
+#include <optional>
+
+namespace wayverb {
+namespace waveguide {
+
+util::aligned::vector<float> compensation_signal_cache::get(
+        const core::compute_context& cc, size_t steps) {
+    auto cached = signals_.access([&](const auto& signals, auto& statistics) {
+        const auto it = signals.find(steps);
+        if (it == signals.end()) {
+            return std::optional<util::aligned::vector<float>>{};
+        }
+        statistics.hits += 1;
+        return std::optional<util::aligned::vector<float>>{it->second};
+    });
+    if (cached) {
+        return std::move(*cached);
+    }
+
+    if (!steps) {
+        return {};
+    }
+
+    //  Simulate without holding the lock, so that other lengths (and hits)
+    //  aren't held up.
+    //  The same impulse as the write_compensation_signal tool.
+    compressed_rectangular_waveguide waveguide{cc, steps};
+    const util::aligned::vector<float> impulse{0.0f, 1.0f};
+    auto signal = waveguide.run_hard_source(
+            impulse.begin(), impulse.end(), [](auto) {});
+    signal.resize(steps);
+
+    return signals_.access([&](auto& signals, auto& statistics) {
+        statistics.misses += 1;
+        return signals.emplace(steps, std::move(signal)).first->second;
+    });
+}
+
+compensation_signal_cache_statistics compensation_signal_cache::get_statistics()
+        const {
+    return signals_.get_statistics();
+}
+
+void compensation_signal_cache::clear() { signals_.clear(); }
+
+}  // namespace waveguide
+}  // namespace wayverb
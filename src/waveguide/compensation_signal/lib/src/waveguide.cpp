@@ -7,11 +7,20 @@ namespace waveguide {
 
 compressed_rectangular_waveguide::compressed_rectangular_waveguide(
         const core::compute_context& cc, size_t steps)
+        : compressed_rectangular_waveguide{
+                  cc, compressed_rectangular_waveguide_program{cc}, steps} {}
+
+compressed_rectangular_waveguide::compressed_rectangular_waveguide(
+        const core::compute_context& cc,
+        const compressed_rectangular_waveguide_program& program,
+        size_t steps)
         : queue_{cc.context, cc.device}
-        , compressed_waveguide_kernel_{compressed_rectangular_waveguide_program{
-                  cc}.get_compressed_waveguide_kernel()}
-        , zero_buffer_kernel_{compressed_rectangular_waveguide_program{
-                  cc}.get_zero_buffer_kernel()}
+        , compressed_waveguide_kernel_{
+                  program.get_compressed_waveguide_kernel()}
+        , zero_buffer_kernel_{program.get_zero_buffer_kernel()}
+        , hard_source_kernel_{program.get_hard_source_kernel()}
+        , soft_source_kernel_{program.get_soft_source_kernel()}
+        , record_output_kernel_{program.get_record_output_kernel()}
         , dimension_{(steps + 1) / 2}
         , current_{cc.context,
                    CL_MEM_READ_WRITE,
@@ -101,16 +110,43 @@ void waveguide_cell_update(global float* prev,
 }
 
 kernel void compressed_waveguide(global float* previous,
-                                 const global float* current) {
+                                 const global float* current,
+                                 uint num_nodes) {
     int index = get_global_id(0);
+    if (index >= num_nodes) {
+        return;
+    }
     waveguide_cell_update(previous, current, to_locator(index));
 }
 
-kernel void zero_buffer(global float* buf) {
+kernel void zero_buffer(global float* buf, uint num_items) {
     size_t thread = get_global_id(0);
+    if (thread >= num_items) {
+        return;
+    }
     buf[thread] = 0;
 }
 
+//  The source and output node is always the first node.
+
+kernel void hard_source(global float* current,
+                        const global float* input,
+                        uint step) {
+    current[0] = input[step];
+}
+
+kernel void soft_source(global float* current,
+                        const global float* input,
+                        uint step) {
+    current[0] += input[step];
+}
+
+kernel void record_output(const global float* current,
+                          global float* output,
+                          uint step) {
+    output[step] = current[0];
+}
+
 )";
 
 compressed_rectangular_waveguide_program::
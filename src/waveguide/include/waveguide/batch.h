@@ -0,0 +1,115 @@
+#pragma once
+
+#include "waveguide/bandpass_band.h"
+#include "waveguide/mesh.h"
+#include "waveguide/pressure_precision.h"
+#include "waveguide/simulation_parameters.h"
+
+#include "core/cl/common.h"
+#include "core/environment.h"
+
+#include "utilities/aligned/vector.h"
+
+#include "glm/glm.hpp"
+
+#include <atomic>
+#include <optional>
+
+/// \file batch.h
+/// The mesh update is linear, and doesn't depend on where the source is, so
+/// simulations of different sources in the same room can share a mesh.
+///
+/// In a batch, each node holds one pressure per source, interleaved so that
+/// the pressures of all sources at a node are adjacent, and each source has
+/// its own copy of the boundary filter state.
+/// Nodes and boundary coefficients are shared.
+/// A single kernel pass updates every source, so neighbour lookups are done
+/// once per node rather than once per source, and the memory latency of each
+/// neighbour read is shared by the whole batch.
+///
+/// Each source's result is identical to running it on its own.
+///
+/// Sources are hard sources, and only a fixed set of probe nodes is recorded.
+/// Boundary state is always kept in the array-of-structs layout.
+
+namespace wayverb {
+namespace waveguide {
+
+/// The device memory needed for each extra source in a batch: two pressures
+/// per node, and a copy of the boundary filter state.
+size_t compute_bytes_per_source(const mesh& mesh,
+                                pressure_precision precision);
+
+/// The device memory used by the batch as a whole, whatever its size: the
+/// nodes, and the boundary coefficients with their filter orders.
+size_t compute_shared_bytes(const mesh& mesh);
+
+/// Finds the most sources which can be run together within memory_bytes, such
+/// that no single buffer is larger than max_alloc_bytes.
+/// Always returns at least 1, and at most max_batch_size.
+size_t compute_batch_size(size_t memory_bytes,
+                          size_t max_alloc_bytes,
+                          const mesh& mesh,
+                          pressure_precision precision,
+                          size_t max_batch_size);
+
+constexpr size_t default_max_batch_size = 16;
+
+/// Leaves half of the device's global memory free, for the rest of the
+/// program and for other users of the device.
+size_t compute_batch_size(const cl::Device& device,
+                          const mesh& mesh,
+                          pressure_precision precision =
+                                  pressure_precision::single,
+                          size_t max_batch_size = default_max_batch_size);
+
+struct batch_source final {
+    /// The node to inject into.
+    size_t node;
+
+    /// One hard-source sample per step.
+    util::aligned::vector<cl_float> signal;
+};
+
+/// For each source, the pressure at each probe node, at each step.
+/// Each source's output has one entry per sample of its signal, unless the
+/// run was cancelled.
+using batch_output = util::aligned::vector<
+        util::aligned::vector<util::aligned::vector<cl_float>>>;
+
+/// Like run in waveguide.h, with a hard source, recording the pressure at
+/// each probe node, for several sources at once.
+/// Sources are split into batches of batch_size, or as many as will fit on
+/// the device if batch_size is 0.
+///
+/// Each batch runs for as many steps as its longest signal.
+/// Shorter signals stop being injected (and recorded) when they run out.
+/// Stops early if keep_going is cleared.
+batch_output run_batch(const core::compute_context& cc,
+                       const mesh& mesh,
+                       const util::aligned::vector<batch_source>& sources,
+                       const util::aligned::vector<size_t>& probes,
+                       const std::atomic_bool& keep_going,
+                       pressure_precision precision =
+                               pressure_precision::single,
+                       size_t batch_size = 0);
+
+/// Like canonical (see canonical.h) with single-band parameters, for several
+/// sources and one receiver in the same mesh.
+/// Every source is simulated for the same length of time.
+///
+/// Returns the bands for each source, in order, or nullopt if the run was
+/// cancelled.
+std::optional<util::aligned::vector<util::aligned::vector<bandpass_band>>>
+canonical_batch(const core::compute_context& cc,
+                const voxels_and_mesh& voxelised,
+                const util::aligned::vector<glm::vec3>& sources,
+                const glm::vec3& receiver,
+                const core::environment& environment,
+                const single_band_parameters& sim_params,
+                double simulation_time,
+                const std::atomic_bool& keep_going,
+                size_t batch_size = 0);
+
+}  // namespace waveguide
+}  // namespace wayverb
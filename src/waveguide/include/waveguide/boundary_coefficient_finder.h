@@ -45,5 +45,18 @@ boundary_index_data compute_boundary_index_data(
         const mesh_descriptor& descriptor,
         util::aligned::vector<condensed_node>& nodes);
 
+/// Does the same job as the overload above, but the nodes stay on the device.
+/// Boundary indices are assigned with a parallel count-scan-scatter, and
+/// written straight into the nodes buffer.
+/// Only the finished boundary tables are copied back to the host.
+/// Kernels are enqueued on the supplied queue.
+boundary_index_data compute_boundary_index_data(
+        const cl::Device& device,
+        cl::CommandQueue& queue,
+        const core::scene_buffers& buffers,
+        const mesh_descriptor& descriptor,
+        const cl::Buffer& nodes,
+        size_t num_nodes);
+
 }  // namespace waveguide
 }  // namespace wayverb
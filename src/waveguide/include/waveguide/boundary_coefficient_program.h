@@ -10,7 +10,10 @@ namespace waveguide {
 
 class boundary_coefficient_program final {
 public:
-    boundary_coefficient_program(const core::compute_context& cc);
+    /// Kernels expect nodes in the layout given by brick_size (see
+    /// mesh_descriptor.h).
+    boundary_coefficient_program(const core::compute_context& cc,
+                                 cl_int brick_size = 0);
 
     auto get_boundary_coefficient_finder_1d_kernel() const {
         return wrapper_.get_kernel<cl::Buffer,       /// nodes
@@ -20,8 +23,8 @@ public:
                                    core::aabb,       /// global_aabb
                                    cl_uint,          /// side
                                    cl::Buffer,       /// triangles
-                                   cl_uint,          /// num_triangles
-                                   cl::Buffer        /// vertices
+                                   cl::Buffer,       /// vertices
+                                   cl_ulong          /// num_nodes
                                    >("boundary_coefficient_finder_1d");
     }
 
@@ -29,7 +32,8 @@ public:
         return wrapper_.get_kernel<cl::Buffer,       /// nodes
                                    mesh_descriptor,  /// descriptor
                                    cl::Buffer,       /// 2d boundary index
-                                   cl::Buffer        /// 1d boundary index
+                                   cl::Buffer,       /// 1d boundary index
+                                   cl_ulong          /// num_nodes
                                    >("boundary_coefficient_finder_2d");
     }
 
@@ -37,10 +41,53 @@ public:
         return wrapper_.get_kernel<cl::Buffer,       /// nodes
                                    mesh_descriptor,  /// descriptor
                                    cl::Buffer,       /// 3d boundary index
-                                   cl::Buffer        /// 1d boundary index
+                                   cl::Buffer,       /// 1d boundary index
+                                   cl_ulong          /// num_nodes
                                    >("boundary_coefficient_finder_3d");
     }
 
+    /// The scan kernel must be run as a single work-group of this size.
+    static constexpr size_t scan_group_size = 64;
+
+    auto get_count_boundary_blocks_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,  /// nodes
+                                   cl_ulong,    /// num_nodes
+                                   cl_uint,     /// block_size
+                                   cl::Buffer   /// block_counts
+                                   >("count_boundary_blocks");
+    }
+
+    auto get_scan_boundary_blocks_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,  /// block_counts
+                                   cl_uint,     /// num_blocks
+                                   cl::Buffer   /// totals
+                                   >("scan_boundary_blocks");
+    }
+
+    auto get_assign_boundary_indices_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,  /// nodes
+                                   cl_ulong,    /// num_nodes
+                                   cl_uint,     /// block_size
+                                   cl::Buffer,  /// block_offsets
+                                   cl::Buffer   /// combined_to_1d
+                                   >("assign_boundary_indices");
+    }
+
+    auto get_compact_1d_boundaries_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,  /// combined
+                                   cl::Buffer,  /// combined_to_1d
+                                   cl::Buffer,  /// boundary_1d
+                                   cl_uint      /// num_combined
+                                   >("compact_1d_boundaries");
+    }
+
+    auto get_finalise_1d_boundary_indices_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,  /// nodes
+                                   cl::Buffer,  /// combined_to_1d
+                                   cl_ulong     /// num_nodes
+                                   >("finalise_1d_boundary_indices");
+    }
+
 private:
     core::program_wrapper wrapper_;
 };
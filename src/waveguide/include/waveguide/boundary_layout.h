@@ -0,0 +1,154 @@
+#pragma once
+
+#include "waveguide/cl/structs.h"
+
+#include "core/cl/common.h"
+
+#include "utilities/aligned/vector.h"
+
+/// \file boundary_layout.h
+/// Boundary filter state can be stored on the device in two ways.
+///
+/// The array-of-structs layout keeps each boundary node's filter memories and
+/// coefficient indices together, as a boundary_data_array.
+/// Neighbouring work-items then read memory with a large stride.
+///
+/// The struct-of-arrays layout gives every filter memory lane, and every
+/// coefficient index, its own contiguous array, so that neighbouring
+/// work-items read neighbouring addresses.
+/// For dimension d, lane l and boundary i:
+///     filter_memory[(d * memory_canonical::order + l) * size + i]
+///     coefficient_index[d * size + i]
+///
+/// Saved states (mesh_state) always use the array-of-structs layout, so
+/// checkpoints can be resumed with either layout.
+
+namespace wayverb {
+namespace waveguide {
+
+enum class boundary_layout { array_of_structs, struct_of_arrays };
+
+template <size_t D>
+struct boundary_data_soa final {
+    static constexpr auto DIMENSIONS = D;
+    util::aligned::vector<filt_real> filter_memory;
+    util::aligned::vector<cl_uint> coefficient_index;
+};
+
+template <size_t D>
+size_t size(const boundary_data_soa<D>& x) {
+    return x.coefficient_index.size() / D;
+}
+
+template <size_t D>
+auto to_soa(const util::aligned::vector<boundary_data_array<D>>& aos) {
+    constexpr auto order = memory_canonical::order;
+    const auto n = aos.size();
+
+    boundary_data_soa<D> ret;
+    ret.filter_memory.resize(D * order * n);
+    ret.coefficient_index.resize(D * n);
+    for (auto i = 0u; i != n; ++i) {
+        for (auto d = 0u; d != D; ++d) {
+            const auto& bd = aos[i].array[d];
+            ret.coefficient_index[d * n + i] = bd.coefficient_index;
+            for (auto l = 0u; l != order; ++l) {
+                ret.filter_memory[(d * order + l) * n + i] =
+                        bd.filter_memory.array[l];
+            }
+        }
+    }
+    return ret;
+}
+
+template <size_t D>
+auto to_aos(const boundary_data_soa<D>& soa) {
+    constexpr auto order = memory_canonical::order;
+    const auto n = size(soa);
+
+    util::aligned::vector<boundary_data_array<D>> ret(n);
+    for (auto i = 0u; i != n; ++i) {
+        for (auto d = 0u; d != D; ++d) {
+            auto& bd = ret[i].array[d];
+            bd.coefficient_index = soa.coefficient_index[d * n + i];
+            for (auto l = 0u; l != order; ++l) {
+                bd.filter_memory.array[l] =
+                        soa.filter_memory[(d * order + l) * n + i];
+            }
+        }
+    }
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Boundary state on the device, in either layout.
+template <size_t D>
+class boundary_buffer final {
+public:
+    boundary_buffer(const cl::Context& context,
+                    const util::aligned::vector<boundary_data_array<D>>& state,
+                    boundary_layout layout)
+            : layout_{layout}
+            , size_{state.size()} {
+        switch (layout_) {
+            case boundary_layout::array_of_structs:
+                data_ = core::load_to_buffer(context, state, false);
+                break;
+            case boundary_layout::struct_of_arrays: {
+                const auto soa = to_soa(state);
+                data_ = core::load_to_buffer(context, soa.filter_memory, false);
+                coefficient_index_ = core::load_to_buffer(
+                        context, soa.coefficient_index, true);
+                break;
+            }
+        }
+    }
+
+    boundary_layout get_layout() const { return layout_; }
+    size_t size() const { return size_; }
+
+    /// boundary_data_arrays, or filter memory lanes.
+    const cl::Buffer& get_data() const { return data_; }
+
+    /// Only used by the struct-of-arrays layout.
+    const cl::Buffer& get_coefficient_index() const {
+        return coefficient_index_;
+    }
+
+    /// Reads the state back in the array-of-structs layout.
+    /// The read is non-blocking for the array-of-structs layout, in which case
+    /// 'out' must stay alive until the queue has finished the read.
+    /// Other layouts block while the state is read and converted.
+    void read(cl::CommandQueue& queue,
+              util::aligned::vector<boundary_data_array<D>>& out) const {
+        switch (layout_) {
+            case boundary_layout::array_of_structs:
+                out.resize(size_);
+                queue.enqueueReadBuffer(data_,
+                                        CL_FALSE,
+                                        0,
+                                        out.size() * sizeof(out.front()),
+                                        out.data());
+                break;
+            case boundary_layout::struct_of_arrays: {
+                boundary_data_soa<D> soa;
+                soa.filter_memory =
+                        core::read_from_buffer<filt_real>(queue, data_);
+                soa.coefficient_index = core::read_from_buffer<cl_uint>(
+                        queue, coefficient_index_);
+                out = to_aos(soa);
+                break;
+            }
+        }
+    }
+
+private:
+    boundary_layout layout_;
+    size_t size_;
+    cl::Buffer data_;
+    cl::Buffer coefficient_index_;
+};
+
+}  // namespace waveguide
+}  // namespace wayverb
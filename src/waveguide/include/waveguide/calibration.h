@@ -1,5 +1,7 @@
 #pragma once
 
+#include "waveguide/scheme.h"
+
 #include <cmath>
 #include <iostream>
 
@@ -30,5 +32,17 @@ inline auto rectilinear_calibration_factor(T grid_spacing,
                      (0.3405 * grid_spacing);
 }
 
+/// The far-field level produced by a hard source is proportional to
+/// X / courant^2, so other schemes are calibrated relative to the rectilinear
+/// scheme.
+template <typename T, typename U>
+inline auto calibration_factor(scheme s,
+                               T grid_spacing,
+                               U acoustic_impedance) {
+    const auto ratio = courant_number(s) / courant_number(scheme::rectilinear);
+    return rectilinear_calibration_factor(grid_spacing, acoustic_impedance) *
+           ratio * ratio;
+}
+
 }  // namespace waveguide
 }  // namespace wayverb
@@ -2,6 +2,7 @@
 
 #include "waveguide/bandpass_band.h"
 #include "waveguide/calibration.h"
+#include "waveguide/checkpoint.h"
 #include "waveguide/fitted_boundary.h"
 #include "waveguide/postprocessor/directional_receiver.h"
 #include "waveguide/preprocessor/hard_source.h"
@@ -14,6 +15,8 @@
 
 #include "hrtf/multiband.h"
 
+#include "utilities/string_builder.h"
+
 #include <cmath>
 #include <optional>
 
@@ -27,6 +30,24 @@ namespace wayverb {
 namespace waveguide {
 namespace detail {
 
+/// The receiver state which must be saved alongside the mesh.
+struct canonical_checkpoint_state final {
+    glm::dvec3 velocity{0};
+    util::aligned::vector<postprocessor::directional_receiver::output> output;
+
+    template <typename Archive>
+    void save(Archive& archive) const {
+        archive(velocity.x, velocity.y, velocity.z);
+        cereal::save_trivial(archive, output);
+    }
+
+    template <typename Archive>
+    void load(Archive& archive) {
+        archive(velocity.x, velocity.y, velocity.z);
+        cereal::load_trivial(archive, output);
+    }
+};
+
 template <typename Callback>
 std::optional<band> canonical_impl(
         const core::compute_context& cc,
@@ -36,9 +57,11 @@ std::optional<band> canonical_impl(
         const glm::vec3& receiver,
         const core::environment& environment,
         const std::atomic_bool& keep_going,
-        Callback&& callback) {
+        Callback&& callback,
+        const checkpoint_parameters& checkpoint) {
     const auto sample_rate = compute_sample_rate(mesh.get_descriptor(),
-                                                 environment.speed_of_sound);
+                                                 environment.speed_of_sound,
+                                                 mesh.get_scheme());
 
     const auto compute_mesh_index = [&](const auto& pt) {
         const auto ret = compute_index(mesh.get_descriptor(), pt);
@@ -56,30 +79,75 @@ std::optional<band> canonical_impl(
     const auto input = [&] {
         auto raw = util::aligned::vector<float>(ideal_steps, 0.0f);
         if (!raw.empty()) {
-            raw.front() = rectilinear_calibration_factor(
-                    mesh.get_descriptor().spacing,
-                    environment.acoustic_impedance);
+            raw.front() = calibration_factor(mesh.get_scheme(),
+                                             mesh.get_descriptor().spacing,
+                                             environment.acoustic_impedance);
         }
         return raw;
     }();
 
+    const auto source_index = compute_mesh_index(source);
+    const auto receiver_index = compute_mesh_index(receiver);
+
     auto output_accumulator =
             core::callback_accumulator<postprocessor::directional_receiver>{
                     mesh.get_descriptor(),
                     sample_rate,
                     get_ambient_density(environment),
-                    compute_mesh_index(receiver)};
+                    receiver_index};
+
+    //  Only resume from runs with exactly the same setup.
+    const auto fingerprint = [&] {
+        auto ret = compute_fingerprint(mesh);
+        ret = combine_fingerprint(ret, source_index);
+        ret = combine_fingerprint(ret, receiver_index);
+        ret = combine_fingerprint(ret, sample_rate);
+        ret = combine_fingerprint(ret, ideal_steps);
+        ret = combine_fingerprint(ret, environment.speed_of_sound);
+        ret = combine_fingerprint(ret, environment.acoustic_impedance);
+        return ret;
+    }();
+
+    mesh_state initial{};
+    std::optional<checkpoint_writer> writer;
+    if (is_enabled(checkpoint)) {
+        if (auto restored = read_checkpoint<canonical_checkpoint_state>(
+                    checkpoint.path, fingerprint)) {
+            initial = std::move(restored->mesh);
+            output_accumulator.get_postprocessor().set_velocity(
+                    restored->extra.velocity);
+            output_accumulator.set_output(std::move(restored->extra.output));
+        }
+        writer.emplace(checkpoint.path, fingerprint);
+    }
 
     const auto steps =
             run(cc,
                 mesh,
                 preprocessor::make_hard_source(
-                        compute_mesh_index(source), begin(input), end(input)),
+                        source_index,
+                        begin(input) + std::min(initial.step, input.size()),
+                        end(input)),
                 [&](auto& queue, const auto& buffer, auto step) {
                     output_accumulator(queue, buffer, step);
                     callback(queue, buffer, step, ideal_steps);
                 },
-                keep_going);
+                keep_going,
+                initial,
+                writer ? checkpoint.interval : 0,
+                [&](auto state, auto ready) {
+                    writer->write(
+                            std::move(state),
+                            std::move(ready),
+                            canonical_checkpoint_state{
+                                    output_accumulator.get_postprocessor()
+                                            .get_velocity(),
+                                    output_accumulator.get_output()});
+                });
+
+    if (writer) {
+        writer->wait();
+    }
 
     if (steps != ideal_steps) {
         return std::nullopt;
@@ -88,6 +156,16 @@ std::optional<band> canonical_impl(
     return band{std::move(output_accumulator.get_output()), sample_rate};
 }
 
+/// The mesh must have been built for the scheme that the parameters ask for,
+/// otherwise the sample rate and cutoff won't match.
+template <typename T>
+void check_scheme(const mesh& mesh, const T& sim_params) {
+    if (mesh.get_scheme() != sim_params.scheme) {
+        throw std::runtime_error{
+                "Mesh was built for a different waveguide scheme."};
+    }
+}
+
 }  // namespace detail
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -108,7 +186,9 @@ std::optional<util::aligned::vector<bandpass_band>> canonical(
         const single_band_parameters& sim_params,
         double simulation_time,
         const std::atomic_bool& keep_going,
-        PressureCallback&& pressure_callback) {
+        PressureCallback&& pressure_callback,
+        const checkpoint_parameters& checkpoint = {}) {
+    detail::check_scheme(voxelised.mesh, sim_params);
     if (auto ret = detail::canonical_impl(cc,
                                           voxelised.mesh,
                                           simulation_time,
@@ -116,7 +196,8 @@ std::optional<util::aligned::vector<bandpass_band>> canonical(
                                           receiver,
                                           environment,
                                           keep_going,
-                                          pressure_callback)) {
+                                          pressure_callback,
+                                          checkpoint)) {
         return util::aligned::vector<bandpass_band>{bandpass_band{
                 std::move(*ret), util::make_range(0.0, sim_params.cutoff)}};
     }
@@ -138,6 +219,8 @@ inline auto set_flat_coefficients_for_band(voxels_and_mesh& voxels_and_mesh,
 
 /// This is a sort of middle ground - more accurate boundary modelling, but
 /// really unbelievably slow.
+/// Each band is checkpointed to its own file, named by appending the band
+/// index to the checkpoint path.
 template <typename PressureCallback>
 std::optional<util::aligned::vector<bandpass_band>> canonical(
         const core::compute_context& cc,
@@ -148,7 +231,9 @@ std::optional<util::aligned::vector<bandpass_band>> canonical(
         const multiple_band_constant_spacing_parameters& sim_params,
         double simulation_time,
         const std::atomic_bool& keep_going,
-        PressureCallback&& pressure_callback) {
+        PressureCallback&& pressure_callback,
+        const checkpoint_parameters& checkpoint = {}) {
+    detail::check_scheme(voxelised.mesh, sim_params);
     const auto band_params = hrtf_data::hrtf_band_params_hz();
 
     util::aligned::vector<bandpass_band> ret{};
@@ -157,6 +242,12 @@ std::optional<util::aligned::vector<bandpass_band>> canonical(
     for (auto band = 0; band != sim_params.bands; ++band) {
         set_flat_coefficients_for_band(voxelised, band);
 
+        auto band_checkpoint = checkpoint;
+        if (!band_checkpoint.path.empty()) {
+            band_checkpoint.path =
+                    util::build_string(checkpoint.path, '.', band);
+        }
+
         if (auto rendered_band = detail::canonical_impl(cc,
                                                         voxelised.mesh,
                                                         simulation_time,
@@ -164,7 +255,8 @@ std::optional<util::aligned::vector<bandpass_band>> canonical(
                                                         receiver,
                                                         environment,
                                                         keep_going,
-                                                        pressure_callback)) {
+                                                        pressure_callback,
+                                                        band_checkpoint)) {
             ret.emplace_back(bandpass_band{
                     std::move(*rendered_band),
                     util::make_range(band_params.edges[band],
@@ -177,5 +269,99 @@ std::optional<util::aligned::vector<bandpass_band>> canonical(
     return ret;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+/// Like the constant-spacing version, but each band is run on a mesh whose
+/// spacing and sample rate are set by that band's cutoff.
+/// The supplied mesh should have the sampling frequency given by
+/// compute_sampling_frequency(sim_params), and is reused for the highest
+/// band(s). Lower bands get new, coarser meshes.
+/// Only bands run on the supplied mesh are passed to pressure_callback, as
+/// the other meshes have different layouts.
+/// Each band is returned at its own sample rate. postprocess resamples them
+/// to a common rate before mixing them down.
+template <typename PressureCallback>
+std::optional<util::aligned::vector<bandpass_band>> canonical(
+        const core::compute_context& cc,
+        voxels_and_mesh voxelised,
+        const glm::vec3& source,
+        const glm::vec3& receiver,
+        const core::environment& environment,
+        const multiple_band_variable_spacing_parameters& sim_params,
+        double simulation_time,
+        const std::atomic_bool& keep_going,
+        PressureCallback&& pressure_callback,
+        const checkpoint_parameters& checkpoint = {}) {
+    detail::check_scheme(voxelised.mesh, sim_params);
+    const auto band_params = hrtf_data::hrtf_band_params_hz();
+    const auto top_cutoff =
+            compute_band_cutoff(sim_params, sim_params.bands - 1);
+
+    util::aligned::vector<bandpass_band> ret{};
+
+    //  Adjacent bands with the same cutoff can share a mesh.
+    std::optional<voxels_and_mesh> coarse;
+    double coarse_cutoff = 0;
+
+    for (auto band = 0; band != sim_params.bands; ++band) {
+        const auto cutoff = compute_band_cutoff(sim_params, band);
+        const auto use_supplied = cutoff == top_cutoff;
+
+        if (!use_supplied && cutoff != coarse_cutoff) {
+            coarse = compute_voxels_and_mesh(
+                    cc,
+                    voxelised.voxels.get_scene_data(),
+                    receiver,
+                    compute_sampling_frequency(cutoff,
+                                               sim_params.usable_portion,
+                                               sim_params.scheme),
+                    environment.speed_of_sound,
+                    node_classifier::scanline,
+                    sim_params.scheme);
+            coarse_cutoff = cutoff;
+        }
+
+        auto& band_mesh = use_supplied ? voxelised : *coarse;
+        set_flat_coefficients_for_band(band_mesh, band);
+
+        auto band_checkpoint = checkpoint;
+        if (!band_checkpoint.path.empty()) {
+            band_checkpoint.path =
+                    util::build_string(checkpoint.path, '.', band);
+        }
+
+        auto rendered_band =
+                use_supplied ? detail::canonical_impl(cc,
+                                                      band_mesh.mesh,
+                                                      simulation_time,
+                                                      source,
+                                                      receiver,
+                                                      environment,
+                                                      keep_going,
+                                                      pressure_callback,
+                                                      band_checkpoint)
+                             : detail::canonical_impl(cc,
+                                                      band_mesh.mesh,
+                                                      simulation_time,
+                                                      source,
+                                                      receiver,
+                                                      environment,
+                                                      keep_going,
+                                                      [](auto&&...) {},
+                                                      band_checkpoint);
+
+        if (!rendered_band) {
+            return std::nullopt;
+        }
+
+        ret.emplace_back(bandpass_band{
+                std::move(*rendered_band),
+                util::make_range(band_params.edges[band],
+                                 band_params.edges[band + 1])});
+    }
+
+    return ret;
+}
+
 }  // namespace waveguide
 }  // namespace wayverb
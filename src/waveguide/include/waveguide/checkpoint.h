@@ -0,0 +1,138 @@
+#pragma once
+
+#include "waveguide/mesh.h"
+#include "waveguide/serialize/mesh_state.h"
+
+#include "core/cl/include.h"
+
+#include "cereal/archives/binary.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <optional>
+
+namespace wayverb {
+namespace waveguide {
+
+/// Controls periodic checkpointing of long simulations.
+/// Checkpointing is disabled if either field is left empty.
+struct checkpoint_parameters final {
+    /// The file to write to, and to resume from.
+    std::string path;
+    /// The number of steps between checkpoints.
+    size_t interval{0};
+};
+
+inline bool is_enabled(const checkpoint_parameters& p) {
+    return !p.path.empty() && p.interval != 0;
+}
+
+/// Identifies a mesh, including its boundary coefficients.
+/// A checkpoint is only used to resume a run with a matching fingerprint.
+std::uint64_t compute_fingerprint(const mesh& mesh);
+
+/// Mix some extra run parameters (source position, step count etc.) into a
+/// fingerprint.
+std::uint64_t combine_fingerprint(std::uint64_t seed,
+                                  const void* data,
+                                  size_t bytes);
+
+template <typename T>
+std::uint64_t combine_fingerprint(std::uint64_t seed, const T& t) {
+    static_assert(std::is_trivially_copyable<T>{},
+                  "Can only fingerprint trivially copyable types.");
+    return combine_fingerprint(seed, &t, sizeof(T));
+}
+
+/// The state of the mesh, along with the state of whatever is driving it.
+/// Extra must be serializable with cereal.
+template <typename Extra>
+struct checkpoint_data final {
+    mesh_state mesh;
+    Extra extra;
+};
+
+/// Returns nothing if the file doesn't exist, can't be read, or was written
+/// by a run with a different fingerprint.
+template <typename Extra>
+std::optional<checkpoint_data<Extra>> read_checkpoint(
+        const std::string& path, std::uint64_t fingerprint) {
+    std::ifstream stream{path, std::ios::binary};
+    if (!stream) {
+        return std::nullopt;
+    }
+
+    try {
+        cereal::BinaryInputArchive archive{stream};
+        std::uint64_t file_fingerprint{};
+        archive(file_fingerprint);
+        if (file_fingerprint != fingerprint) {
+            return std::nullopt;
+        }
+
+        checkpoint_data<Extra> ret;
+        archive(ret.mesh, ret.extra);
+        return ret;
+    } catch (const cereal::Exception&) {
+        return std::nullopt;
+    }
+}
+
+/// Writes checkpoints to file on a background thread, so that the simulation
+/// can keep running while the data is written.
+/// Writes are queued, and happen one at a time.
+/// Files are written to a temporary path and then renamed, so a crash
+/// part-way through a write leaves the last good checkpoint intact.
+class checkpoint_writer final {
+public:
+    checkpoint_writer(std::string path, std::uint64_t fingerprint);
+
+    checkpoint_writer(const checkpoint_writer&) = delete;
+    checkpoint_writer& operator=(const checkpoint_writer&) = delete;
+    checkpoint_writer(checkpoint_writer&&) noexcept = delete;
+    checkpoint_writer& operator=(checkpoint_writer&&) noexcept = delete;
+
+    /// Blocks until any outstanding write has finished.
+    ~checkpoint_writer() noexcept;
+
+    /// The mesh state may still be being filled by the device: the write
+    /// will wait for ready to complete before touching it.
+    /// Writes happen in order. If a write fails, the error is reported by
+    /// the next call to wait().
+    template <typename Extra>
+    void write(mesh_state state, cl::Event ready, Extra extra) {
+        future_ = std::async(
+                std::launch::async,
+                [ this,
+                  previous = std::move(future_),
+                  state = std::move(state),
+                  ready = std::move(ready),
+                  extra = std::move(extra) ]() mutable {
+                    ready.wait();
+                    if (previous.valid()) {
+                        previous.get();
+                    }
+                    write_file([&](auto& archive) {
+                        archive(fingerprint_, state, extra);
+                    });
+                });
+    }
+
+    /// Blocks until any outstanding write has finished.
+    /// Rethrows any error encountered while writing.
+    void wait();
+
+private:
+    void write_file(
+            const std::function<void(cereal::BinaryOutputArchive&)>& callback)
+            const;
+
+    std::string path_;
+    std::uint64_t fingerprint_;
+    std::future<void> future_;
+};
+
+}  // namespace waveguide
+}  // namespace wayverb
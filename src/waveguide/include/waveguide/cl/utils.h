@@ -1,5 +1,7 @@
 #pragma once
 
+#include "waveguide/pressure_precision.h"
+
 #include "core/cl/representation.h"
 #include "core/cl/traits.h"
 
@@ -31,6 +33,19 @@ constexpr auto num_ports = size_t{6};
 
 namespace cl_sources {
 extern const char* utils;
+
+/// Sets the node layout used by to_index and to_locator in 'utils' (see
+/// mesh_descriptor.h).
+/// Must come before 'utils'.
+/// Without it, nodes are assumed to be in x-major order.
+std::string node_layout(cl_int brick_size);
+
+/// Defines pressure_t, read_pressure and write_pressure, through which
+/// pressure buffers are accessed, for the given storage format (see
+/// pressure_precision.h).
+/// Node indices are scaled by NODE_BATCH_SIZE, which is 1 unless defined
+/// beforehand (see batch.h).
+const char* pressure_storage(pressure_precision precision);
 }  // namespace cl_sources
 
 }  // namespace waveguide
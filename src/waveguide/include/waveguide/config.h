@@ -1,5 +1,7 @@
 #pragma once
 
+#include "waveguide/scheme.h"
+
 #include "utilities/aligned/vector.h"
 
 #include <vector>
@@ -8,9 +10,15 @@ namespace wayverb {
 namespace waveguide {
 namespace config {
 
-double speed_of_sound(double time_step, double grid_spacing);
-double time_step(double speed_of_sound, double grid_spacing);
-double grid_spacing(double speed_of_sound, double time_step);
+double speed_of_sound(double time_step,
+                      double grid_spacing,
+                      scheme s = scheme::rectilinear);
+double time_step(double speed_of_sound,
+                 double grid_spacing,
+                 scheme s = scheme::rectilinear);
+double grid_spacing(double speed_of_sound,
+                    double time_step,
+                    scheme s = scheme::rectilinear);
 
 }  // namespace config
 
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "waveguide/slab.h"
+
+#include "core/cl/common.h"
+
+#include <atomic>
+#include <memory>
+
+namespace wayverb {
+namespace waveguide {
+
+class slab_runner;
+
+/// Holds a mesh which has been cut into slabs, with each slab living on its
+/// own compute context.
+///
+/// Nodes are addressed using their indices in the original, undivided mesh,
+/// so sources and receivers don't need to know about the decomposition.
+class slab_set final {
+public:
+    /// The mesh is cut into one slab per context, along its longest axis.
+    /// If the mesh is too thin, some contexts may be left unused.
+    slab_set(const util::aligned::vector<core::compute_context>& contexts,
+             const mesh& mesh);
+
+    slab_set(const slab_set&) = delete;
+    slab_set& operator=(const slab_set&) = delete;
+    slab_set(slab_set&&) noexcept = delete;
+    slab_set& operator=(slab_set&&) noexcept = delete;
+
+    ~slab_set() noexcept;
+
+    size_t get_num_slabs() const;
+
+    /// Compute the next state of every slab, and copy the new edge layers
+    /// into the neighbouring halos.
+    /// Edge layers are updated first, so that they can be read back while
+    /// the slab interiors are being computed.
+    void update();
+
+    /// Make the state computed by the most recent update current.
+    void swap();
+
+    /// Read the current pressure at a node.
+    cl_float read_value(size_t node);
+
+    /// Write the current pressure at a node.
+    /// Any halo copies of the node are updated too.
+    void write_value(size_t node, cl_float value);
+
+    /// Gather the current pressure at every node in the original mesh.
+    util::aligned::vector<cl_float> read_all();
+
+private:
+    const slab& find_owner(size_t node) const;
+
+    mesh_descriptor descriptor_;
+    util::aligned::vector<slab> slabs_;
+    std::vector<std::unique_ptr<slab_runner>> runners_;
+
+    /// Host staging for edge layers on their way to neighbouring slabs.
+    util::aligned::vector<util::aligned::vector<cl_float>> staging_below_;
+    util::aligned::vector<util::aligned::vector<cl_float>> staging_above_;
+};
+
+/// Like run in waveguide.h, but spreads the mesh across several compute
+/// contexts.
+/// These may be separate devices, or sub-devices of a single device (see
+/// core::make_sub_device_contexts).
+///
+/// Instead of a queue and buffer, the pre- and post-processors are passed the
+/// slab_set and the step number.
+/// The results are identical to those from a single-device run.
+template <typename step_preprocessor, typename step_postprocessor>
+size_t run_distributed(
+        const util::aligned::vector<core::compute_context>& contexts,
+        const mesh& mesh,
+        step_preprocessor&& pre,
+        step_postprocessor&& post,
+        const std::atomic_bool& keep_going) {
+    slab_set slabs{contexts, mesh};
+
+    auto step = 0u;
+    for (; pre(slabs, step) && keep_going; ++step) {
+        slabs.update();
+        post(slabs, step);
+        slabs.swap();
+    }
+    return step;
+}
+
+namespace preprocessor {
+
+/// Like hard_source (see preprocessor/hard_source.h), for run_distributed.
+template <typename It>
+class slab_hard_source final {
+public:
+    slab_hard_source(size_t node, It begin, It end)
+            : node_{node}
+            , begin_{begin}
+            , end_{end} {}
+
+    bool operator()(slab_set& slabs, size_t) {
+        if (begin_ == end_) {
+            return false;
+        }
+        slabs.write_value(node_, *begin_++);
+        return true;
+    }
+
+private:
+    size_t node_;
+    It begin_;
+    It end_;
+};
+
+template <typename It>
+auto make_slab_hard_source(size_t node, It begin, It end) {
+    return slab_hard_source<It>{node, begin, end};
+}
+
+}  // namespace preprocessor
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -14,6 +14,10 @@
 #include "utilities/for_each.h"
 #include "utilities/map.h"
 
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
 namespace wayverb {
 namespace waveguide {
 namespace detail {
@@ -49,36 +53,113 @@ auto to_impedance_coefficients(const coefficients<order>& c) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-template <size_t... Ix>
-constexpr auto make_coefficients_canonical(
-        const core::filter_coefficients<sizeof...(Ix) - 1, sizeof...(Ix) - 1>&
-                coeffs,
-        std::index_sequence<Ix...>) {
-    return coefficients_canonical{{std::get<Ix>(coeffs.b)...},
-                                  {std::get<Ix>(coeffs.a)...}};
+inline auto to_flat_coefficients(double absorption) {
+    return to_impedance_coefficients(coefficients_canonical{
+            {core::absorption_to_pressure_reflectance(absorption)}, {1}});
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// The gain of a filter at a frequency from 0-1 (dc to nyquist).
+template <size_t order>
+double magnitude_response(const coefficients<order>& c, double frequency) {
+    const auto z = std::polar(1.0, -M_PI * frequency);
+    std::complex<double> num{0}, den{0}, zk{1};
+    for (auto i = 0u; i != order + 1; ++i) {
+        num += c.b[i] * zk;
+        den += c.a[i] * zk;
+        zk *= z;
+    }
+    return std::abs(num / den);
 }
 
-constexpr auto make_coefficients_canonical(
-        const core::filter_coefficients<coefficients_canonical::order,
-                                        coefficients_canonical::order>&
-                coeffs) {
-    return make_coefficients_canonical(
-            coeffs,
-            std::make_index_sequence<coefficients_canonical::order + 1>{});
+/// The number of delays which a filter actually needs.
+/// Trailing zero coefficients don't count, so a lower-order filter stored in
+/// a higher-order struct reports its own order.
+template <size_t order>
+size_t effective_order(const coefficients<order>& c) {
+    auto ret = order;
+    while (ret && c.b[ret] == 0 && c.a[ret] == 0) {
+        --ret;
+    }
+    return ret;
 }
 
-////////////////////////////////////////////////////////////////////////////////
+/// The default largest difference between a fitted boundary filter's gain and
+/// the target pressure reflectance, at any band centre.
+/// Large enough that flat and gently sloping materials get cheap filters, but
+/// well below the tolerances of measured absorption coefficients.
+constexpr double default_reflectance_tolerance = 0.01;
 
-inline auto to_flat_coefficients(double absorption) {
-    return to_impedance_coefficients(coefficients_canonical{
-            {core::absorption_to_pressure_reflectance(absorption)}, {1}});
+namespace detail {
+
+template <size_t order>
+auto pad_coefficients(const core::filter_coefficients<order, order>& coeffs) {
+    static_assert(order <= coefficients_canonical::order,
+                  "filter order too high to be stored as canonical");
+    coefficients_canonical ret{};
+    for (auto i = 0u; i != order + 1; ++i) {
+        ret.b[i] = coeffs.b[i];
+        ret.a[i] = coeffs.a[i];
+    }
+    return ret;
 }
 
-////////////////////////////////////////////////////////////////////////////////
+template <typename Frequencies, typename Targets>
+double max_magnitude_error(const coefficients_canonical& c,
+                           const Frequencies& frequencies,
+                           const Targets& targets) {
+    double ret = 0;
+    util::for_each(
+            [&](auto frequency, auto target) {
+                ret = std::max(
+                        ret,
+                        std::abs(magnitude_response(c, frequency) - target));
+            },
+            frequencies,
+            targets);
+    return ret;
+}
 
+/// Tries each order in turn, from 'order' up to the canonical order, and
+/// returns the first stable fit within tolerance.
+/// The canonical-order fit is returned if nothing lower is good enough.
+template <size_t order, typename Frequencies, typename Targets>
+coefficients_canonical fit_reflectance_filter(const Frequencies& frequencies,
+                                              const Targets& targets,
+                                              double tolerance) {
+    const auto coeffs =
+            pad_coefficients(arbitrary_magnitude_filter<order>(
+                    make_frequency_domain_envelope(frequencies, targets)));
+
+    if constexpr (order == coefficients_canonical::order) {
+        if (!is_stable(coeffs.a)) {
+            throw std::runtime_error{
+                    "Unable to generate stable boundary filter."};
+        }
+        return coeffs;
+    } else {
+        if (is_stable(coeffs.a) &&
+            max_magnitude_error(coeffs, frequencies, targets) <= tolerance) {
+            return coeffs;
+        }
+        return fit_reflectance_filter<order + 1>(
+                frequencies, targets, tolerance);
+    }
+}
+
+}  // namespace detail
+
+/// Finds the lowest-order stable filter whose gain at each band centre is
+/// within 'tolerance' of the pressure reflectance of the given absorptions.
+/// The result is always stored as canonical coefficients, with zeros above
+/// the chosen order, so the kernel can skip the unused delays.
+/// A tolerance of 0 gives a full-order filter unless the absorption is flat.
 template <typename T>
-auto compute_reflectance_filter_coefficients(T&& absorption,
-                                             double sample_rate) {
+auto compute_reflectance_filter_coefficients(
+        T&& absorption,
+        double sample_rate,
+        double tolerance = default_reflectance_tolerance) {
     const auto band_centres =
             util::map([](auto i) { return i * 2; },
                       hrtf_data::hrtf_band_centres(sample_rate));
@@ -88,19 +169,15 @@ auto compute_reflectance_filter_coefficients(T&& absorption,
             },
             absorption);
 
-    constexpr auto lim = 1000;
-    for (auto delay = 0; delay != lim; ++delay) {
-        const auto reflectance_coeffs = make_coefficients_canonical(
-                arbitrary_magnitude_filter<coefficients_canonical::order>(
-                        make_frequency_domain_envelope(band_centres,
-                                                       reflectance)));
-
-        if (is_stable(reflectance_coeffs.a)) {
-            return reflectance_coeffs;
-        }
+    //  A single gain is the best order-0 fit, and needs no filter memory.
+    const auto [lowest, highest] =
+            std::minmax_element(std::begin(reflectance), std::end(reflectance));
+    if ((*highest - *lowest) / 2 <= tolerance) {
+        return coefficients_canonical{{(*highest + *lowest) / 2}, {1}};
     }
 
-    throw std::runtime_error{"Unable to generate stable boundary filter."};
+    return detail::fit_reflectance_filter<1>(
+            band_centres, reflectance, tolerance);
 }
 
 }  // namespace waveguide
@@ -5,7 +5,15 @@
 namespace wayverb {
 namespace waveguide {
 
+/// Uses the compensation signal generated at build time.
 std::vector<float> make_transparent(const float* begin, const float* end);
 
+/// Uses the given compensation signal, for example one of a different length
+/// from compensation_signal_cache.
+std::vector<float> make_transparent(const float* begin,
+                                    const float* end,
+                                    const float* compensation_begin,
+                                    const float* compensation_end);
+
 }  // namespace waveguide
 }  // namespace wayverb
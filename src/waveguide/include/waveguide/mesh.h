@@ -1,6 +1,9 @@
 #pragma once
 
 #include "waveguide/mesh_descriptor.h"
+#include "waveguide/node_partition.h"
+#include "waveguide/reflectance_filter_cache.h"
+#include "waveguide/scheme.h"
 #include "waveguide/setup.h"
 
 #include "core/gpu_scene_data.h"
@@ -11,10 +14,17 @@ namespace waveguide {
 
 class mesh final {
 public:
-    mesh(mesh_descriptor descriptor, vectors vectors);
+    mesh(mesh_descriptor descriptor,
+         vectors vectors,
+         waveguide::scheme scheme = waveguide::scheme::rectilinear);
 
     const mesh_descriptor& get_descriptor() const;
     const vectors& get_structure() const;
+    const node_partition& get_node_partition() const;
+
+    /// The update equation that the mesh spacing and boundary filters were
+    /// designed for.
+    waveguide::scheme get_scheme() const;
 
     void set_coefficients(coefficients_canonical coefficients);
     void set_coefficients(
@@ -23,6 +33,8 @@ public:
 private:
     mesh_descriptor descriptor_;
     vectors vectors_;
+    node_partition node_partition_;
+    waveguide::scheme scheme_;
 };
 
 /// Uses the number of 'inside' nodes and the mesh spacing to estimate the
@@ -31,19 +43,40 @@ double estimate_volume(const mesh& mesh);
 
 bool is_inside(const mesh& m, size_t node_index);
 
+/// How to decide whether each node is inside or outside the model.
+enum class node_classifier {
+    /// Fire rays from every node individually.
+    per_node,
+    /// Fire one ray per row of nodes along each axis, and only fall back to
+    /// per-node rays where the rows disagree or are ambiguous.
+    /// Much faster for large meshes, and gives the same result as per_node
+    /// for watertight models.
+    scanline
+};
+
 ///  use this if you already have a voxelised scene
+///  brick_size sets the order of nodes in memory (see mesh_descriptor.h)
+///  if filter_statistics is given, the reflectance filter cache's hits,
+///  misses, and fit time for this mesh are added to it
 mesh compute_mesh(
         const core::compute_context& cc,
         const core::voxelised_scene_data<cl_float3,
                                          core::surface<core::simulation_bands>>&
                 voxelised,
         float mesh_spacing,
-        float speed_of_sound);
+        float speed_of_sound,
+        node_classifier classifier = node_classifier::scanline,
+        scheme s = scheme::rectilinear,
+        cl_int brick_size = 0,
+        reflectance_filter_cache_statistics* filter_statistics = nullptr);
 
 struct voxels_and_mesh final {
     core::voxelised_scene_data<cl_float3, core::surface<core::simulation_bands>>
             voxels;
     mesh mesh;
+
+    /// How the mesh's boundary filters were found.
+    reflectance_filter_cache_statistics filter_statistics{};
 };
 
 /// this one should be prefered - will set up a voxelised scene with the correct
@@ -54,7 +87,10 @@ voxels_and_mesh compute_voxels_and_mesh(
         const glm::vec3& anchor,  //  probably the receiver if you want it to
                                   //  coincide with an actual node
         double sample_rate,
-        double speed_of_sound);
+        double speed_of_sound,
+        node_classifier classifier = node_classifier::scanline,
+        scheme s = scheme::rectilinear,
+        cl_int brick_size = 0);
 
 }  // namespace waveguide
 }  // namespace wayverb
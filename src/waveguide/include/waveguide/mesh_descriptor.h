@@ -1,5 +1,7 @@
 #pragma once
 
+#include "waveguide/scheme.h"
+
 #include "core/cl/representation.h"
 #include "core/cl/traits.h"
 #include "core/geo/box.h"
@@ -8,6 +10,22 @@
 
 #include <array>
 
+/// \file mesh_descriptor.h
+/// By default, nodes are stored in x-major order, so the neighbours of a node
+/// along z are a whole layer of the mesh away in memory.
+///
+/// With a non-zero brick_size, the mesh is instead cut into bricks of
+/// brick_size^3 nodes (clipped at the far faces of the mesh).
+/// The bricks are stored one after another in x-major order, and the nodes
+/// inside each brick are also in x-major order.
+/// Most neighbours are then in the same brick, and so close together in
+/// memory, which makes better use of caches on large meshes.
+/// There is no padding, so the number of nodes is the same for either
+/// layout.
+///
+/// Kernels must be built with the same brick size as the mesh (see
+/// cl_sources::node_layout).
+
 namespace wayverb {
 namespace waveguide {
 
@@ -17,10 +35,11 @@ struct alignas(1 << 4) mesh_descriptor final {
     cl_float3 min_corner;
     cl_int3 dimensions;
     cl_float spacing;
+    cl_int brick_size;
 };
 
 constexpr auto to_tuple(const mesh_descriptor& x) {
-    return std::tie(x.min_corner, x.dimensions, x.spacing);
+    return std::tie(x.min_corner, x.dimensions, x.spacing, x.brick_size);
 }
 
 constexpr bool operator==(const mesh_descriptor& a, const mesh_descriptor& b) {
@@ -31,6 +50,18 @@ constexpr bool operator!=(const mesh_descriptor& a, const mesh_descriptor& b) {
     return !(a == b);
 }
 
+/// A good brick size for most devices.
+constexpr cl_int default_brick_size = 8;
+
+/// Converts between locators and indices in a box of nodes with the given
+/// dimensions and brick size (0 for x-major order).
+size_t compute_index(const glm::ivec3& locator,
+                     const glm::ivec3& dim,
+                     cl_int brick_size);
+glm::ivec3 compute_locator(size_t index,
+                           const glm::ivec3& dim,
+                           cl_int brick_size);
+
 size_t compute_index(const mesh_descriptor& d, const glm::ivec3& pos);
 size_t compute_index(const mesh_descriptor& d, const glm::vec3& pos);
 
@@ -46,7 +77,9 @@ std::array<cl_uint, 6> compute_neighbors(const mesh_descriptor& d,
 
 core::geo::box compute_aabb(const mesh_descriptor& d);
 
-double compute_sample_rate(const mesh_descriptor& d, double speed_of_sound);
+double compute_sample_rate(const mesh_descriptor& d,
+                           double speed_of_sound,
+                           scheme s = scheme::rectilinear);
 
 size_t compute_num_nodes(const mesh_descriptor& d);
 
@@ -62,6 +95,7 @@ typedef struct {
     float3 min_corner;
     int3 dimensions;
     float spacing;
+    int brick_size;
 } mesh_descriptor;
 )";
 };
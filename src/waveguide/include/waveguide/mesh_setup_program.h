@@ -10,7 +10,9 @@ namespace waveguide {
 
 class setup_program final {
 public:
-    setup_program(const core::compute_context& cc);
+    /// Kernels expect nodes in the layout given by brick_size (see
+    /// mesh_descriptor.h).
+    setup_program(const core::compute_context& cc, cl_int brick_size = 0);
 
     auto get_node_inside_kernel() const {
         return wrapper_.get_kernel<cl::Buffer,       /// nodes
@@ -19,13 +21,44 @@ public:
                                    core::aabb,       /// global_aabb
                                    cl_uint,          /// side
                                    cl::Buffer,       /// triangles
-                                   cl::Buffer        /// vertices
+                                   cl::Buffer,       /// vertices
+                                   cl_ulong          /// num_nodes
                                    >("set_node_inside");
     }
 
+    /// Finds inside/outside votes for every node, one row at a time.
+    /// Should be run once per axis, with one work-item per row.
+    auto get_classify_rows_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,       /// votes
+                                   mesh_descriptor,  /// descriptor
+                                   cl_uint,          /// axis
+                                   cl::Buffer,       /// voxel_index
+                                   core::aabb,       /// global_aabb
+                                   cl_uint,          /// side
+                                   cl::Buffer,       /// triangles
+                                   cl::Buffer,       /// vertices
+                                   cl_uint           /// num_rows
+                                   >("classify_rows");
+    }
+
+    /// Combines votes from all three axes into inside/outside flags.
+    auto get_node_inside_from_votes_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,       /// nodes
+                                   mesh_descriptor,  /// descriptor
+                                   cl::Buffer,       /// votes
+                                   cl::Buffer,       /// voxel_index
+                                   core::aabb,       /// global_aabb
+                                   cl_uint,          /// side
+                                   cl::Buffer,       /// triangles
+                                   cl::Buffer,       /// vertices
+                                   cl_ulong          /// num_nodes
+                                   >("set_node_inside_from_votes");
+    }
+
     auto get_node_boundary_kernel() const {
-        return wrapper_.get_kernel<cl::Buffer,      /// nodes
-                                   mesh_descriptor  /// descriptor
+        return wrapper_.get_kernel<cl::Buffer,       /// nodes
+                                   mesh_descriptor,  /// descriptor
+                                   cl_ulong          /// num_nodes
                                    >("set_node_boundary_type");
     }
 
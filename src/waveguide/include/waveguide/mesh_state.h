@@ -0,0 +1,23 @@
+#pragma once
+
+#include "waveguide/cl/structs.h"
+
+#include "utilities/aligned/vector.h"
+
+namespace wayverb {
+namespace waveguide {
+
+/// Everything needed to pick up a waveguide simulation part-way through.
+/// step is the number of steps which have been completed.
+/// A default-constructed state means 'start from silence'.
+struct mesh_state final {
+    size_t step{0};
+    util::aligned::vector<cl_float> previous;
+    util::aligned::vector<cl_float> current;
+    util::aligned::vector<boundary_data_array_1> boundary_1;
+    util::aligned::vector<boundary_data_array_2> boundary_2;
+    util::aligned::vector<boundary_data_array_3> boundary_3;
+};
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "waveguide/cl/structs.h"
+#include "waveguide/mesh_descriptor.h"
+
+#include "utilities/aligned/vector.h"
+
+namespace wayverb {
+namespace waveguide {
+
+/// Lists of node indices, grouped by the update equation that applies to
+/// each node.
+/// Running one specialised kernel per list means that no work-item has to
+/// branch on its node type, so lanes in a wavefront never diverge.
+/// Outside nodes never change, so they don't appear in any list.
+struct node_partition final {
+    /// Inside and reentrant nodes with all six neighbours in the mesh.
+    util::aligned::vector<cl_uint> inside;
+
+    /// Inside and reentrant nodes on the outer faces of the mesh.
+    /// These need bounds-checked neighbour lookups, and should only occur if
+    /// the mesh has been built without any padding around the model.
+    util::aligned::vector<cl_uint> clipped;
+
+    util::aligned::vector<cl_uint> boundary_1;
+    util::aligned::vector<cl_uint> boundary_2;
+    util::aligned::vector<cl_uint> boundary_3;
+};
+
+node_partition compute_node_partition(
+        const mesh_descriptor& descriptor,
+        const util::aligned::vector<condensed_node>& nodes);
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -1,13 +1,11 @@
 #pragma once
 
+#include "waveguide/pressure_precision.h"
+
 #include "glm/glm.hpp"
 
 #include <array>
-
-namespace cl {
-class Buffer;
-class CommandQueue;
-}  // namespace cl
+#include <functional>
 
 namespace wayverb {
 namespace core {
@@ -17,6 +15,7 @@ struct environment;
 namespace waveguide {
 
 struct mesh_descriptor;
+class slab_set;
 
 namespace postprocessor {
 
@@ -34,12 +33,28 @@ public:
 
     using return_type = output;
     return_type operator()(cl::CommandQueue& queue,
-                           const cl::Buffer& buffer,
+                           const pressure_buffer& buffer,
+                           size_t step);
+    return_type operator()(slab_set& slabs, size_t step);
+
+    /// For pressures which have already been read back from the mesh (see
+    /// batch.h).
+    /// read_pressure should return the current pressure at a given node.
+    return_type operator()(const std::function<float(size_t)>& read_pressure,
                            size_t step);
 
     size_t get_output_node() const;
 
+    /// The integrated particle velocity, which must be saved and restored to
+    /// resume a simulation part-way through.
+    glm::dvec3 get_velocity() const;
+    void set_velocity(const glm::dvec3& velocity);
+
 private:
+    /// read_pressure should return the current pressure at a given node.
+    template <typename Read>
+    return_type process(Read&& read_pressure);
+
     double mesh_spacing_;
     double sample_rate_;
     double ambient_density_;
@@ -1,9 +1,12 @@
 #pragma once
 
-#include "core/cl/include.h"
+#include "waveguide/pressure_precision.h"
 
 namespace wayverb {
 namespace waveguide {
+
+class slab_set;
+
 namespace postprocessor {
 
 class node final {
@@ -12,8 +15,9 @@ public:
 
     using return_type = float;
     return_type operator()(cl::CommandQueue& queue,
-                           const cl::Buffer& buffer,
+                           const pressure_buffer& buffer,
                            size_t step) const;
+    return_type operator()(slab_set& slabs, size_t step) const;
 
     size_t get_output_node() const;
 
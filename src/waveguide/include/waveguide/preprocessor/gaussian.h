@@ -1,6 +1,7 @@
 #pragma once
 
 #include "waveguide/mesh_descriptor.h"
+#include "waveguide/pressure_precision.h"
 
 namespace wayverb {
 namespace waveguide {
@@ -16,7 +17,7 @@ public:
              size_t steps);
 
     bool operator()(cl::CommandQueue& queue,
-                    cl::Buffer& buffer,
+                    const pressure_buffer& buffer,
                     size_t step) const;
 
 private:
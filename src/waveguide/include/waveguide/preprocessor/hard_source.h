@@ -1,5 +1,7 @@
 #pragma once
 
+#include "waveguide/pressure_precision.h"
+
 #include "core/cl/common.h"
 
 namespace wayverb {
@@ -14,11 +16,13 @@ public:
             , begin_{begin}
             , end_{end} {}
 
-    bool operator()(cl::CommandQueue& queue, cl::Buffer& buffer, size_t) {
+    bool operator()(cl::CommandQueue& queue,
+                    const pressure_buffer& buffer,
+                    size_t) {
         if (begin_ == end_) {
             return false;
         }
-        core::write_value(queue, buffer, node_, *begin_++);
+        write_pressure(queue, buffer, node_, *begin_++);
         return true;
     }
 
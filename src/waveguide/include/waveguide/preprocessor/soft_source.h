@@ -1,6 +1,6 @@
 #pragma once
 
-#include "core/cl/common.h"
+#include "waveguide/pressure_precision.h"
 
 namespace wayverb {
 namespace waveguide {
@@ -14,13 +14,14 @@ public:
             , begin_{begin}
             , end_{end} {}
 
-    bool operator()(cl::CommandQueue& queue, cl::Buffer& buffer, size_t) {
+    bool operator()(cl::CommandQueue& queue,
+                    const pressure_buffer& buffer,
+                    size_t) {
         if (begin_ == end_) {
             return false;
         }
-        const auto current_pressure =
-                core::read_value<cl_float>(queue, buffer, node_);
-        core::write_value(queue, buffer, node_, current_pressure + *begin_++);
+        const auto current_pressure = read_pressure(queue, buffer, node_);
+        write_pressure(queue, buffer, node_, current_pressure + *begin_++);
         return true;
     }
 
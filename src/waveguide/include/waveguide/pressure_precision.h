@@ -0,0 +1,77 @@
+#pragma once
+
+#include "core/cl/common.h"
+
+#include "utilities/aligned/vector.h"
+
+/// \file pressure_precision.h
+/// The waveguide update reads and writes the whole mesh every step, so for
+/// large meshes it is limited by memory bandwidth rather than arithmetic.
+///
+/// With half-precision storage, the 'previous' and 'current' pressure buffers
+/// hold 16-bit floats, halving the traffic per step.
+/// Kernels load and store them with vload_half and vstore_half, which are
+/// part of core OpenCL and don't need cl_khr_fp16, so all arithmetic still
+/// happens in single precision.
+///
+/// Boundary filter state, and saved states (mesh_state), are always single
+/// precision.
+
+namespace wayverb {
+namespace waveguide {
+
+enum class pressure_precision { single, half };
+
+constexpr size_t bytes_per_pressure(pressure_precision p) {
+    switch (p) {
+        case pressure_precision::single: return sizeof(cl_float);
+        case pressure_precision::half: return sizeof(cl_half);
+    }
+    return 0;
+}
+
+/// Conversions matching vstore_half (round to nearest even) and vload_half.
+cl_half to_half(float f);
+float from_half(cl_half h);
+
+/// A buffer of node pressures, which knows how they are stored.
+/// Plain buffers convert implicitly, and are assumed to hold floats.
+class pressure_buffer final : public cl::Buffer {
+public:
+    pressure_buffer() = default;
+    pressure_buffer(const cl::Buffer& buffer,
+                    pressure_precision precision = pressure_precision::single);
+
+    /// Allocates space for the given number of nodes.
+    /// The contents are undefined.
+    pressure_buffer(const cl::Context& context,
+                    size_t nodes,
+                    pressure_precision precision);
+
+    pressure_precision get_precision() const;
+
+    /// The number of nodes in the buffer.
+    size_t size() const;
+
+private:
+    pressure_precision precision_{pressure_precision::single};
+};
+
+/// Blocking reads and writes of single nodes, for pre- and postprocessors.
+float read_pressure(cl::CommandQueue& queue,
+                    const pressure_buffer& buffer,
+                    size_t index);
+void write_pressure(cl::CommandQueue& queue,
+                    const pressure_buffer& buffer,
+                    size_t index,
+                    float value);
+
+/// Blocking reads and writes of the whole mesh.
+util::aligned::vector<cl_float> read_pressures(cl::CommandQueue& queue,
+                                               const pressure_buffer& buffer);
+void write_pressures(cl::CommandQueue& queue,
+                     const pressure_buffer& buffer,
+                     const util::aligned::vector<cl_float>& values);
+
+}  // namespace waveguide
+}  // namespace wayverb
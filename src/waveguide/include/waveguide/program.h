@@ -1,6 +1,8 @@
 #pragma once
 
 #include "waveguide/cl/structs.h"
+#include "waveguide/pressure_precision.h"
+#include "waveguide/scheme.h"
 
 #include "core/cl/common.h"
 #include "core/program_wrapper.h"
@@ -12,13 +14,23 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <stdexcept>
 
 namespace wayverb {
 namespace waveguide {
 
 class program final {
 public:
-    program(const core::compute_context& cc);
+    /// Kernels will read and write pressure buffers with the given
+    /// precision, and expect nodes in the layout given by brick_size (see
+    /// mesh_descriptor.h).
+    /// With a batch_size other than 1, pressure buffers hold that many
+    /// interleaved simulations, and only the batch kernel may be used (see
+    /// batch.h).
+    program(const core::compute_context& cc,
+            pressure_precision precision = pressure_precision::single,
+            cl_int brick_size = 0,
+            size_t batch_size = 1);
 
     auto get_kernel() const {
         return program_wrapper_
@@ -30,12 +42,112 @@ public:
                             cl::Buffer,  /// boundary_data_2
                             cl::Buffer,  /// boundary_data_3
                             cl::Buffer,  /// boundary_coefficients
+                            cl::Buffer,  /// filter_orders
                             cl::Buffer   /// error_flag
                             >("condensed_waveguide");
     }
 
+    /// Updates inside nodes which are not on the outer faces of the mesh.
+    /// Kernels for different schemes all take the same arguments.
+    auto get_inside_kernel(scheme s = scheme::rectilinear) const {
+        return program_wrapper_
+                .get_kernel<cl::Buffer,  /// previous
+                            cl::Buffer,  /// current
+                            cl_int3,     /// dimensions
+                            cl::Buffer,  /// node indices
+                            cl_uint,     /// num_indices
+                            cl::Buffer   /// error_flag
+                            >(util::build_string(kernel_prefix(s), "inside")
+                                      .c_str());
+    }
+
+    /// Updates inside nodes on the outer faces of the mesh.
+    auto get_clipped_kernel(scheme s = scheme::rectilinear) const {
+        return program_wrapper_
+                .get_kernel<cl::Buffer,  /// previous
+                            cl::Buffer,  /// current
+                            cl_int3,     /// dimensions
+                            cl::Buffer,  /// node indices
+                            cl_uint,     /// num_indices
+                            cl::Buffer   /// error_flag
+                            >(util::build_string(kernel_prefix(s), "clipped")
+                                      .c_str());
+    }
+
+    /// Updates boundary nodes with the given number of boundary dimensions.
+    template <size_t dimensions>
+    auto get_boundary_kernel(scheme s = scheme::rectilinear) const {
+        static_assert(1 <= dimensions && dimensions <= 3,
+                      "boundaries must have 1, 2, or 3 dimensions");
+        return program_wrapper_
+                .get_kernel<cl::Buffer,  /// previous
+                            cl::Buffer,  /// current
+                            cl::Buffer,  /// nodes
+                            cl_int3,     /// dimensions
+                            cl::Buffer,  /// node indices
+                            cl_uint,     /// num_indices
+                            cl::Buffer,  /// boundary_data
+                            cl::Buffer,  /// boundary_coefficients
+                            cl::Buffer,  /// filter_orders
+                            cl::Buffer   /// error_flag
+                            >(util::build_string(kernel_prefix(s),
+                                                 "boundary_",
+                                                 dimensions)
+                                      .c_str());
+    }
+
+    /// Updates boundary nodes, with boundary state in the struct-of-arrays
+    /// layout (see boundary_layout.h).
+    template <size_t dimensions>
+    auto get_boundary_soa_kernel(scheme s = scheme::rectilinear) const {
+        static_assert(1 <= dimensions && dimensions <= 3,
+                      "boundaries must have 1, 2, or 3 dimensions");
+        return program_wrapper_
+                .get_kernel<cl::Buffer,  /// previous
+                            cl::Buffer,  /// current
+                            cl::Buffer,  /// nodes
+                            cl_int3,     /// dimensions
+                            cl::Buffer,  /// node indices
+                            cl_uint,     /// num_indices
+                            cl::Buffer,  /// filter_memory
+                            cl::Buffer,  /// coefficient_index
+                            cl_uint,     /// num_boundaries
+                            cl::Buffer,  /// boundary_coefficients
+                            cl::Buffer,  /// filter_orders
+                            cl::Buffer   /// error_flag
+                            >(util::build_string(kernel_prefix(s),
+                                                 "boundary_soa_",
+                                                 dimensions)
+                                      .c_str());
+    }
+
+    /// Updates every node, for every source in a batch (see batch.h).
+    /// Each source has its own copy of the boundary data, with
+    /// num_boundaries entries.
+    auto get_batch_kernel(scheme s = scheme::rectilinear) const {
+        return program_wrapper_
+                .get_kernel<cl::Buffer,  /// previous
+                            cl::Buffer,  /// current
+                            cl::Buffer,  /// nodes
+                            cl_int3,     /// dimensions
+                            cl::Buffer,  /// boundary_data_1
+                            cl_uint,     /// num_boundaries_1
+                            cl::Buffer,  /// boundary_data_2
+                            cl_uint,     /// num_boundaries_2
+                            cl::Buffer,  /// boundary_data_3
+                            cl_uint,     /// num_boundaries_3
+                            cl::Buffer,  /// boundary_coefficients
+                            cl::Buffer,  /// filter_orders
+                            cl::Buffer,  /// error_flag
+                            cl_ulong     /// num_nodes
+                            >(util::build_string(kernel_prefix(s), "batch")
+                                      .c_str());
+    }
+
     auto get_zero_buffer_kernel() const {
-        return program_wrapper_.get_kernel<cl::Buffer>("zero_buffer");
+        return program_wrapper_.get_kernel<cl::Buffer,  /// buffer
+                                           cl_ulong     /// num_nodes
+                                           >("zero_buffer");
     }
 
     auto get_filter_test_kernel() const {
@@ -58,6 +170,14 @@ public:
     cl::Device get_device() const { return program_wrapper_.get_device(); }
 
 private:
+    static const char* kernel_prefix(scheme s) {
+        switch (s) {
+            case scheme::rectilinear: return "waveguide_";
+            case scheme::interpolated_wideband: return "waveguide_iwb_";
+        }
+        throw std::runtime_error{"Unrecognised waveguide scheme."};
+    }
+
     core::program_wrapper program_wrapper_;
 };
 
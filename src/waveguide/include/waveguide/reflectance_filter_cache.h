@@ -0,0 +1,74 @@
+#pragma once
+
+#include "waveguide/cl/filter_structs.h"
+
+#include "core/cl/scene_structs.h"
+
+#include "utilities/aligned/vector.h"
+#include "utilities/locked_cache.h"
+
+#include <array>
+#include <map>
+#include <tuple>
+
+/// \file reflectance_filter_cache.h
+/// Fitting a boundary filter to a surface's absorption curve is slow, and the
+/// same surfaces are fitted again and again, for every run and for every
+/// mesh in a multi-rate simulation.
+/// Fitted filters are kept here, so that each distinct surface is only fitted
+/// once per sample rate.
+
+namespace wayverb {
+namespace waveguide {
+
+struct reflectance_filter_cache_statistics final {
+    size_t hits{0};
+    size_t misses{0};
+
+    /// Total time spent fitting filters, in seconds, summed across threads.
+    double fit_time{0};
+};
+
+reflectance_filter_cache_statistics& operator+=(
+        reflectance_filter_cache_statistics& a,
+        const reflectance_filter_cache_statistics& b);
+
+class reflectance_filter_cache final {
+public:
+    /// Returns the reflectance filter for a single surface, fitting it if
+    /// necessary.
+    coefficients_canonical get(const core::bands_type& absorption,
+                               double sample_rate);
+
+    /// Returns the reflectance filters for several surfaces.
+    /// Any surfaces which are not already cached are fitted in parallel.
+    /// If statistics is given, the hits, misses, and fit time of this call
+    /// are added to it.
+    util::aligned::vector<coefficients_canonical> get(
+            const util::aligned::vector<core::bands_type>& absorption,
+            double sample_rate,
+            reflectance_filter_cache_statistics* statistics = nullptr);
+
+    reflectance_filter_cache_statistics get_statistics() const;
+
+    /// Removes all cached filters, and resets the statistics.
+    void clear();
+
+private:
+    using key_type = std::tuple<std::array<float, core::simulation_bands>,
+                                double,
+                                size_t>;
+
+    static key_type make_key(const core::bands_type& absorption,
+                             double sample_rate);
+
+    util::locked_cache<std::map<key_type, coefficients_canonical>,
+                       reflectance_filter_cache_statistics>
+            filters_;
+};
+
+/// The cache shared by all meshes in the process.
+reflectance_filter_cache& get_reflectance_filter_cache();
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "glm/glm.hpp"
+
+/// \file scheme.h
+/// The waveguide can be updated with one of several finite-difference
+/// schemes.
+///
+/// The rectilinear scheme only looks at a node's six axial neighbours.
+/// It is cheap per node, but its numerical dispersion depends strongly on the
+/// direction of propagation, so the mesh has to be heavily oversampled to
+/// keep errors small.
+///
+/// The interpolated wideband scheme (see kowalczyk2011) uses all 26
+/// neighbours, weighted so that dispersion is nearly isotropic and the whole
+/// band up to Nyquist is valid.
+/// It runs at a Courant number of 1, so for a given sample rate the grid is
+/// also coarser.
+/// Each node is more expensive to update, but far fewer nodes and steps are
+/// needed for the same accuracy.
+
+namespace wayverb {
+namespace waveguide {
+
+enum class scheme { rectilinear, interpolated_wideband };
+
+/// The ratio c * T / X.
+double courant_number(scheme s);
+
+/// The highest frequency that the scheme can represent, as a proportion of
+/// the sample rate.
+/// In practice, the mesh should only be used up to some fraction of this
+/// (the 'usable portion').
+constexpr double valid_bandwidth(scheme s) {
+    switch (s) {
+        case scheme::rectilinear: return 0.25;
+        case scheme::interpolated_wideband: return 0.5;
+    }
+    return 0;
+}
+
+/// The weights applied to the current pressure at a node, and at each class
+/// of neighbour, to find the next pressure at that node.
+/// The pressure at the previous step is always subtracted.
+struct stencil_weights final {
+    double axial;
+    double side;
+    double corner;
+    double centre;
+};
+
+stencil_weights get_stencil_weights(scheme s);
+
+/// Finds the speed at which a plane wave with the given frequency (as a
+/// proportion of the sample rate) and direction actually travels through the
+/// mesh, divided by the speed of sound.
+/// This is 1 for an ideal mesh.
+/// Throws if the frequency is outside the valid bandwidth of the scheme.
+double compute_relative_phase_velocity(scheme s,
+                                       double normalised_frequency,
+                                       const glm::dvec3& direction);
+
+}  // namespace waveguide
+}  // namespace wayverb
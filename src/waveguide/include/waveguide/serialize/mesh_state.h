@@ -0,0 +1,55 @@
+#pragma once
+
+#include "waveguide/mesh_state.h"
+
+#include "cereal/cereal.hpp"
+
+#include <cstdint>
+#include <type_traits>
+
+namespace cereal {
+
+/// Vectors of plain structs are written as a length followed by raw bytes.
+/// Checkpoints are only ever read back on the machine that wrote them, so
+/// there's no need to worry about portability.
+template <typename Archive, typename T>
+void save_trivial(Archive& archive, const util::aligned::vector<T>& t) {
+    static_assert(std::is_trivially_copyable<T>{},
+                  "Can only save trivially copyable types.");
+    archive(make_size_tag(static_cast<size_type>(t.size())));
+    archive(binary_data(t.data(), t.size() * sizeof(T)));
+}
+
+template <typename Archive, typename T>
+void load_trivial(Archive& archive, util::aligned::vector<T>& t) {
+    static_assert(std::is_trivially_copyable<T>{},
+                  "Can only load trivially copyable types.");
+    size_type size{};
+    archive(make_size_tag(size));
+    t.resize(size);
+    archive(binary_data(t.data(), t.size() * sizeof(T)));
+}
+
+template <typename Archive>
+void save(Archive& archive, const wayverb::waveguide::mesh_state& s) {
+    archive(make_nvp("step", static_cast<std::uint64_t>(s.step)));
+    save_trivial(archive, s.previous);
+    save_trivial(archive, s.current);
+    save_trivial(archive, s.boundary_1);
+    save_trivial(archive, s.boundary_2);
+    save_trivial(archive, s.boundary_3);
+}
+
+template <typename Archive>
+void load(Archive& archive, wayverb::waveguide::mesh_state& s) {
+    std::uint64_t step{};
+    archive(make_nvp("step", step));
+    s.step = step;
+    load_trivial(archive, s.previous);
+    load_trivial(archive, s.current);
+    load_trivial(archive, s.boundary_1);
+    load_trivial(archive, s.boundary_2);
+    load_trivial(archive, s.boundary_3);
+}
+
+}  // namespace cereal
@@ -38,12 +38,17 @@ public:
     const util::aligned::vector<coefficients_canonical>& get_coefficients()
             const;
 
+    /// The effective order of each set of coefficients, in the same order.
+    /// Boundary kernels use these to skip unused filter delays.
+    const util::aligned::vector<cl_uint>& get_filter_orders() const;
+
     void set_coefficients(coefficients_canonical c);
     void set_coefficients(util::aligned::vector<coefficients_canonical> c);
 
 private:
     util::aligned::vector<condensed_node> condensed_nodes_;
     util::aligned::vector<coefficients_canonical> coefficients_;
+    util::aligned::vector<cl_uint> filter_orders_;
     boundary_index_data boundary_index_data_;
 };
 
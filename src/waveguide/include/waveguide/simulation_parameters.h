@@ -1,5 +1,7 @@
 #pragma once
 
+#include "waveguide/scheme.h"
+
 #include <cstdlib>
 #include <tuple>
 
@@ -13,10 +15,15 @@ struct single_band_parameters final {
     /// The proportion of the 'valid' spectrum that should be used.
     /// Values between 0 and 1 are valid, but 0.6 or lower is recommended.
     double usable_portion;
+
+    /// The update equation used by the mesh.
+    /// The valid spectrum depends on the scheme, so the same cutoff and usable
+    /// portion give different sample rates for different schemes.
+    waveguide::scheme scheme{waveguide::scheme::rectilinear};
 };
 
 constexpr auto to_tuple(const single_band_parameters& x) {
-    return std::tie(x.cutoff, x.usable_portion);
+    return std::tie(x.cutoff, x.usable_portion, x.scheme);
 }
 
 constexpr bool operator==(const single_band_parameters& a,
@@ -41,10 +48,13 @@ struct multiple_band_constant_spacing_parameters final {
 
     /// As above.
     double usable_portion;
+
+    /// As above.
+    waveguide::scheme scheme{waveguide::scheme::rectilinear};
 };
 
 constexpr auto to_tuple(const multiple_band_constant_spacing_parameters& x) {
-    return std::tie(x.bands, x.cutoff, x.usable_portion);
+    return std::tie(x.bands, x.cutoff, x.usable_portion, x.scheme);
 }
 
 constexpr bool operator==(const multiple_band_constant_spacing_parameters& a,
@@ -57,20 +67,66 @@ constexpr bool operator!=(const multiple_band_constant_spacing_parameters& a,
     return !(a == b);
 }
 
+/// Each band (or group of bands) is simulated on its own mesh, with a spacing
+/// and sampling rate just fine enough for the band's upper edge.
+/// The number of nodes falls with the cube of the cutoff, and the number of
+/// steps with the cutoff itself, so the low bands are very cheap compared to
+/// running everything at the highest band's rate.
+struct multiple_band_variable_spacing_parameters final {
+    /// The number of bands which should be simulated with the waveguide.
+    size_t bands;
+
+    /// Bands with upper edges below this frequency share a mesh with this
+    /// cutoff, so that the lowest bands don't get meshes too coarse to
+    /// represent the room.
+    double min_cutoff;
+
+    /// As above.
+    double usable_portion;
+
+    /// As above.
+    waveguide::scheme scheme{waveguide::scheme::rectilinear};
+};
+
+constexpr auto to_tuple(const multiple_band_variable_spacing_parameters& x) {
+    return std::tie(x.bands, x.min_cutoff, x.usable_portion, x.scheme);
+}
+
+constexpr bool operator==(const multiple_band_variable_spacing_parameters& a,
+                          const multiple_band_variable_spacing_parameters& b) {
+    return to_tuple(a) == to_tuple(b);
+}
+
+constexpr bool operator!=(const multiple_band_variable_spacing_parameters& a,
+                          const multiple_band_variable_spacing_parameters& b) {
+    return !(a == b);
+}
+
+/// The cutoff of the mesh used to simulate a particular band.
+double compute_band_cutoff(
+        const multiple_band_variable_spacing_parameters& params, size_t band);
+
 constexpr auto compute_cutoff_frequency(double sample_rate,
-                                        double usable_portion) {
-    return sample_rate * 0.25 * usable_portion;
+                                        double usable_portion,
+                                        scheme s = scheme::rectilinear) {
+    return sample_rate * valid_bandwidth(s) * usable_portion;
 }
 
 constexpr auto compute_sampling_frequency(double cutoff,
-                                          double usable_portion) {
-    return cutoff / (0.25 * usable_portion);
+                                          double usable_portion,
+                                          scheme s = scheme::rectilinear) {
+    return cutoff / (valid_bandwidth(s) * usable_portion);
 }
 
 template <typename T>
 constexpr auto compute_sampling_frequency(const T& t) {
-    return compute_sampling_frequency(t.cutoff, t.usable_portion);
+    return compute_sampling_frequency(t.cutoff, t.usable_portion, t.scheme);
 }
 
+/// The sampling frequency of the finest mesh, which is used for the highest
+/// band.
+double compute_sampling_frequency(
+        const multiple_band_variable_spacing_parameters& params);
+
 }  // namespace waveguide
 }  // namespace wayverb
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "waveguide/mesh.h"
+
+namespace wayverb {
+namespace waveguide {
+
+/// One piece of a mesh which has been cut into slabs along a single axis.
+///
+/// The local mesh holds the layers owned by this slab, along with a single
+/// layer of 'halo' nodes on each side which borders another slab.
+/// Halo nodes are never updated locally - they are copied from the
+/// neighbouring slab after each step.
+/// Every boundary node in the local mesh has its own filter memory, so
+/// boundary state never leaves the slab.
+class slab final {
+public:
+    slab(const mesh& global, size_t axis, int begin, int end);
+
+    /// The mesh used to run this slab, in local coordinates.
+    const mesh& get_mesh() const;
+
+    size_t get_axis() const;
+
+    /// The first owned layer, in global coordinates.
+    int get_begin() const;
+
+    /// One past the last owned layer, in global coordinates.
+    int get_end() const;
+
+    bool has_halo_below() const;
+    bool has_halo_above() const;
+
+    /// Owned nodes in the layers next to a halo.
+    /// These must be updated before their values can be sent to the
+    /// neighbouring slabs.
+    const node_partition& get_edge_partition() const;
+
+    /// All other owned nodes.
+    /// These can be updated while the halo exchange is in progress.
+    const node_partition& get_interior_partition() const;
+
+    /// Local index of a global node which is owned by, or in the halo of,
+    /// this slab.
+    size_t to_local_index(size_t global_index) const;
+
+    /// True if the global node is owned by this slab.
+    bool owns(size_t global_index) const;
+
+    /// True if the global node is owned by this slab, or is in its halo.
+    bool contains(size_t global_index) const;
+
+    /// The layer of the local mesh holding the given global layer.
+    int to_local_layer(int global_layer) const;
+
+private:
+    mesh_descriptor global_descriptor_;
+    size_t axis_;
+    int begin_;
+    int end_;
+    bool halo_below_;
+    bool halo_above_;
+    mesh mesh_;
+    node_partition edge_partition_;
+    node_partition interior_partition_;
+};
+
+/// The axis along which the mesh has the most nodes.
+size_t longest_axis(const mesh_descriptor& descriptor);
+
+/// Cut the mesh into slabs of roughly equal thickness along its longest
+/// axis.
+/// The number of slabs will be reduced if the mesh is too thin to give every
+/// slab at least two layers.
+util::aligned::vector<slab> decompose(const mesh& mesh, size_t slabs);
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "waveguide/mesh_descriptor.h"
+#include "waveguide/pressure_precision.h"
+
+#include "core/cl/common.h"
+#include "core/program_wrapper.h"
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+
+/// \file snapshot.h
+/// Pulling the whole mesh back to the host every step is very slow for large
+/// meshes.
+/// The tools here select, decimate and quantise node pressures on the device,
+/// so that only the data which will actually be displayed is transferred.
+
+namespace wayverb {
+namespace waveguide {
+
+/// How snapshot pressures are stored.
+/// The integer formats map the range [-range, range] onto the full range of
+/// the integer type, clipping any values outside.
+enum class snapshot_precision { float_32, int_16, int_8 };
+
+constexpr size_t bytes_per_value(snapshot_precision p) {
+    switch (p) {
+        case snapshot_precision::float_32: return sizeof(cl_float);
+        case snapshot_precision::int_16: return sizeof(cl_short);
+        case snapshot_precision::int_8: return sizeof(cl_char);
+    }
+}
+
+/// A box of nodes, from begin (inclusive) to end (exclusive), taking every
+/// 'stride'th node along each axis.
+struct snapshot_region final {
+    glm::ivec3 begin{0};
+    glm::ivec3 end{0};
+    glm::ivec3 stride{1};
+};
+
+/// Every stride'th node in the whole mesh.
+snapshot_region make_full_region(const mesh_descriptor& descriptor,
+                                 int stride = 1);
+
+/// A single layer of nodes, perpendicular to the given axis.
+snapshot_region make_slice_region(const mesh_descriptor& descriptor,
+                                  size_t axis,
+                                  int layer,
+                                  int stride = 1);
+
+/// The number of nodes in the snapshot, along each axis.
+glm::ivec3 compute_extent(const snapshot_region& region);
+
+/// The position of each node in the region, in the same order as the values
+/// in a snapshot of that region.
+util::aligned::vector<glm::vec3> compute_node_positions(
+        const mesh_descriptor& descriptor, const snapshot_region& region);
+
+struct snapshot_parameters final {
+    snapshot_region region;
+    /// Take a snapshot every 'interval' steps.
+    size_t interval{1};
+    snapshot_precision precision{snapshot_precision::int_8};
+    /// The largest magnitude which can be represented by integer formats.
+    float range{1};
+};
+
+/// A copy of (part of) the mesh at a particular step.
+/// Values are stored x-major, in the format given by 'precision'.
+struct pressure_snapshot final {
+    snapshot_region region;
+    glm::ivec3 extent;
+    snapshot_precision precision;
+    float range;
+    util::aligned::vector<std::uint8_t> data;
+};
+
+/// Expand a snapshot back to one float per node.
+util::aligned::vector<float> to_float(const pressure_snapshot& snapshot);
+
+////////////////////////////////////////////////////////////////////////////////
+
+class snapshot_program final {
+public:
+    /// Kernels read pressures stored with the given precision, and expect
+    /// nodes in the layout given by brick_size (see mesh_descriptor.h).
+    snapshot_program(const core::compute_context& cc,
+                     pressure_precision precision = pressure_precision::single,
+                     cl_int brick_size = 0);
+
+    auto get_snapshot_float_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,  /// pressures
+                                   cl_int3,     /// dimensions
+                                   cl_int3,     /// begin
+                                   cl_int3,     /// stride
+                                   cl::Buffer   /// output
+                                   >("snapshot_float");
+    }
+
+    auto get_snapshot_short_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,  /// pressures
+                                   cl_int3,     /// dimensions
+                                   cl_int3,     /// begin
+                                   cl_int3,     /// stride
+                                   cl_float,    /// scale
+                                   cl::Buffer   /// output
+                                   >("snapshot_short");
+    }
+
+    auto get_snapshot_char_kernel() const {
+        return wrapper_.get_kernel<cl::Buffer,  /// pressures
+                                   cl_int3,     /// dimensions
+                                   cl_int3,     /// begin
+                                   cl_int3,     /// stride
+                                   cl_float,    /// scale
+                                   cl::Buffer   /// output
+                                   >("snapshot_char");
+    }
+
+private:
+    core::program_wrapper wrapper_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// A waveguide postprocessor which takes periodic snapshots of the mesh.
+/// Use it from the 'post' callback of waveguide::run.
+/// The precision must match that of the pressure buffers passed to 'post'.
+class snapshot_reader final {
+public:
+    snapshot_reader(const core::compute_context& cc,
+                    const mesh_descriptor& descriptor,
+                    const snapshot_parameters& params,
+                    pressure_precision precision = pressure_precision::single);
+
+    /// True if a snapshot should be taken at this step.
+    bool is_due(size_t step) const;
+
+    /// Take a snapshot of the mesh, regardless of whether one is due.
+    /// Throws if the buffer's precision doesn't match the reader's.
+    pressure_snapshot operator()(cl::CommandQueue& queue,
+                                 const pressure_buffer& buffer,
+                                 size_t step);
+
+    const snapshot_parameters& get_parameters() const;
+
+private:
+    mesh_descriptor descriptor_;
+    snapshot_parameters params_;
+    glm::ivec3 extent_;
+    pressure_precision precision_;
+    snapshot_program program_;
+    cl::Buffer output_;
+};
+
+}  // namespace waveguide
+}  // namespace wayverb
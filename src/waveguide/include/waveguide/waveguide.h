@@ -1,6 +1,9 @@
 #pragma once
 
+#include "waveguide/boundary_layout.h"
 #include "waveguide/mesh.h"
+#include "waveguide/mesh_state.h"
+#include "waveguide/pressure_precision.h"
 
 #include "core/cl/include.h"
 #include "core/conversions.h"
@@ -14,66 +17,263 @@
 namespace wayverb {
 namespace waveguide {
 
+/// Throws an appropriate exception if the error flag set by a waveguide kernel
+/// indicates that anything went wrong.
+inline void throw_if_error(error_code error_flag) {
+    if (error_flag & id_inf_error) {
+        throw core::exceptions::value_is_inf(
+                "Pressure value is inf, check filter coefficients.");
+    }
+
+    if (error_flag & id_nan_error) {
+        throw core::exceptions::value_is_nan(
+                "Pressure value is nan, check filter coefficients.");
+    }
+
+    if (error_flag & id_outside_mesh_error) {
+        throw std::runtime_error("Tried to read non-existant node.");
+    }
+
+    if (error_flag & id_suspicious_boundary_error) {
+        throw std::runtime_error("Suspicious boundary read.");
+    }
+}
+
 /// Will set up and run a waveguide using an existing 'template' (the mesh).
 ///
 /// cc:             OpenCL context and device to use
-/// mesh:           contains node placements and surface filter information
-/// pre:            will be run before each step, should inject inputs
-/// post:           will be run after each step, should collect outputs
+/// mesh:           contains node placements and surface filter information,
+///                 and the scheme used to update the nodes
+/// pre:            run before each step, should inject inputs, and returns
+///                 true if the simulation should continue
+/// post:           run after each step, should collect outputs - could be a
+///                 stateful object which accumulates mesh state in some way
 /// keep_going:     toggle this from another thread to quit early
+/// initial:        state to start from - use a default-constructed state to
+///                 start from silence
+/// interval:       the number of steps between snapshots, or 0 for none
+/// snapshot:       called with (mesh_state, cl::Event) after every 'interval'
+///                 steps - the mesh_state is filled asynchronously, so its
+///                 contents are only valid once the event has completed, and
+///                 it must not be destroyed before then
+/// layout:         how boundary filter state is stored on the device (see
+///                 boundary_layout.h) - both layouts give identical results
+/// precision:      how node pressures are stored on the device (see
+///                 pressure_precision.h) - pre and post are passed a
+///                 pressure_buffer, and should access it with the functions
+///                 in that header, but snapshots are always single precision
 ///
-/// returns:        the number of steps completed successfully
-
-/// step_preprocessor
-/// Run before each waveguide iteration.
-///
-/// returns:        true if the simulation should continue
-
-/// step_postprocessor
-/// Run after each waveguide iteration.
-/// Could be a stateful object which accumulates mesh state in some way.
-
-template <typename step_preprocessor, typename step_postprocessor>
+/// returns:        the total number of steps completed, including any which
+///                 were completed before the initial state was saved
+template <typename step_preprocessor,
+          typename step_postprocessor,
+          typename step_snapshot>
 size_t run(const core::compute_context& cc,
            const mesh& mesh,
            step_preprocessor&& pre,
            step_postprocessor&& post,
-           const std::atomic_bool& keep_going) {
-
+           const std::atomic_bool& keep_going,
+           const mesh_state& initial,
+           size_t interval,
+           step_snapshot&& snapshot,
+           boundary_layout layout = boundary_layout::array_of_structs,
+           pressure_precision precision = pressure_precision::single) {
     const auto num_nodes = mesh.get_structure().get_condensed_nodes().size();
 
-    const program program{cc};
+    const auto check_size = [](const auto& restored, auto expected_size) {
+        if (restored.size() != expected_size) {
+            throw std::runtime_error{
+                    "Saved waveguide state does not match mesh."};
+        }
+    };
+
+    const program program{cc, precision, mesh.get_descriptor().brick_size};
     cl::CommandQueue queue{cc.context, cc.device};
     const auto make_zeroed_buffer = [&] {
-        auto ret = cl::Buffer{
-                cc.context, CL_MEM_READ_WRITE, sizeof(cl_float) * num_nodes};
+        auto ret = pressure_buffer{cc.context, num_nodes, precision};
         auto kernel = program.get_zero_buffer_kernel();
-        kernel(cl::EnqueueArgs{queue, cl::NDRange{num_nodes}}, ret);
+        kernel(queue, num_nodes, ret, num_nodes);
         return ret;
     };
 
-    auto previous = make_zeroed_buffer();
-    auto current = make_zeroed_buffer();
+    const auto resuming = initial.step != 0;
+    const auto make_pressure_buffer = [&](const auto& restored) {
+        if (resuming) {
+            check_size(restored, num_nodes);
+            auto ret = pressure_buffer{cc.context, num_nodes, precision};
+            write_pressures(queue, ret, restored);
+            return ret;
+        }
+        return make_zeroed_buffer();
+    };
+
+    auto previous = make_pressure_buffer(initial.previous);
+    auto current = make_pressure_buffer(initial.current);
 
     const auto node_buffer = core::load_to_buffer(
             cc.context, mesh.get_structure().get_condensed_nodes(), true);
 
     const auto boundary_coefficients_buffer = core::load_to_buffer(
             cc.context, mesh.get_structure().get_coefficients(), true);
+    const auto filter_orders_buffer = core::load_to_buffer(
+            cc.context, mesh.get_structure().get_filter_orders(), true);
 
     cl::Buffer error_flag_buffer{cc.context, CL_MEM_READ_WRITE, sizeof(cl_int)};
 
-    auto boundary_buffer_1 = core::load_to_buffer(
-            cc.context, get_boundary_data<1>(mesh.get_structure()), false);
-    auto boundary_buffer_2 = core::load_to_buffer(
-            cc.context, get_boundary_data<2>(mesh.get_structure()), false);
-    auto boundary_buffer_3 = core::load_to_buffer(
-            cc.context, get_boundary_data<3>(mesh.get_structure()), false);
+    const auto make_boundary_buffer = [&](const auto& restored,
+                                          const auto& fresh) {
+        using buffer_type = boundary_buffer<std::decay_t<
+                decltype(fresh.front())>::DIMENSIONS>;
+        if (resuming) {
+            check_size(restored, fresh.size());
+            return buffer_type{cc.context, restored, layout};
+        }
+        return buffer_type{cc.context, fresh, layout};
+    };
+
+    const auto boundary_buffer_1 = make_boundary_buffer(
+            initial.boundary_1, get_boundary_data<1>(mesh.get_structure()));
+    const auto boundary_buffer_2 = make_boundary_buffer(
+            initial.boundary_2, get_boundary_data<2>(mesh.get_structure()));
+    const auto boundary_buffer_3 = make_boundary_buffer(
+            initial.boundary_3, get_boundary_data<3>(mesh.get_structure()));
+
+    //  One index list per node class.
+    //  Empty classes have no buffer, and their kernels are skipped.
+    const auto make_index_buffer = [&](const auto& indices) {
+        return indices.empty()
+                       ? cl::Buffer{}
+                       : core::load_to_buffer(cc.context, indices, true);
+    };
+
+    const auto& partition = mesh.get_node_partition();
+    const auto inside_buffer = make_index_buffer(partition.inside);
+    const auto clipped_buffer = make_index_buffer(partition.clipped);
+    const auto boundary_index_buffer_1 =
+            make_index_buffer(partition.boundary_1);
+    const auto boundary_index_buffer_2 =
+            make_index_buffer(partition.boundary_2);
+    const auto boundary_index_buffer_3 =
+            make_index_buffer(partition.boundary_3);
+
+    const auto s = mesh.get_scheme();
+    auto inside_kernel = program.get_inside_kernel(s);
+    auto clipped_kernel = program.get_clipped_kernel(s);
+    auto boundary_kernel_1 = program.get_boundary_kernel<1>(s);
+    auto boundary_kernel_2 = program.get_boundary_kernel<2>(s);
+    auto boundary_kernel_3 = program.get_boundary_kernel<3>(s);
+    auto boundary_soa_kernel_1 = program.get_boundary_soa_kernel<1>(s);
+    auto boundary_soa_kernel_2 = program.get_boundary_soa_kernel<2>(s);
+    auto boundary_soa_kernel_3 = program.get_boundary_soa_kernel<3>(s);
+
+    const auto dimensions = mesh.get_descriptor().dimensions;
+
+    const auto run_node_kernel = [&](auto& kernel,
+                                     const auto& indices,
+                                     const auto& index_buffer) {
+        if (!indices.empty()) {
+            kernel(queue,
+                   indices.size(),
+                   previous,
+                   current,
+                   dimensions,
+                   index_buffer,
+                   static_cast<cl_uint>(indices.size()),
+                   error_flag_buffer);
+        }
+    };
+
+    const auto run_boundary_kernel = [&](auto& aos_kernel,
+                                         auto& soa_kernel,
+                                         const auto& indices,
+                                         const auto& index_buffer,
+                                         const auto& boundary) {
+        if (indices.empty()) {
+            return;
+        }
+        switch (boundary.get_layout()) {
+            case boundary_layout::array_of_structs:
+                aos_kernel(queue,
+                           indices.size(),
+                           previous,
+                           current,
+                           node_buffer,
+                           dimensions,
+                           index_buffer,
+                           static_cast<cl_uint>(indices.size()),
+                           boundary.get_data(),
+                           boundary_coefficients_buffer,
+                           filter_orders_buffer,
+                           error_flag_buffer);
+                break;
+            case boundary_layout::struct_of_arrays:
+                soa_kernel(queue,
+                           indices.size(),
+                           previous,
+                           current,
+                           node_buffer,
+                           dimensions,
+                           index_buffer,
+                           static_cast<cl_uint>(indices.size()),
+                           boundary.get_data(),
+                           boundary.get_coefficient_index(),
+                           static_cast<cl_uint>(boundary.size()),
+                           boundary_coefficients_buffer,
+                           filter_orders_buffer,
+                           error_flag_buffer);
+                break;
+        }
+    };
+
+    //  Enqueues a non-blocking read of the whole mesh state.
+    //  The queue is in-order, so later kernels won't overwrite the buffers
+    //  until the reads have finished.
+    //  Half-precision pressures and struct-of-arrays boundary state have to be
+    //  converted back, so those parts of the read block.
+    const auto take_snapshot = [&](auto completed_steps) {
+        mesh_state ret{completed_steps,
+                       util::aligned::vector<cl_float>(num_nodes),
+                       util::aligned::vector<cl_float>(num_nodes),
+                       {},
+                       {},
+                       {}};
+
+        const auto enqueue_read = [&](const auto& buffer, auto& out) {
+            queue.enqueueReadBuffer(buffer,
+                                    CL_FALSE,
+                                    0,
+                                    out.size() * sizeof(out.front()),
+                                    out.data());
+        };
 
-    auto kernel = program.get_kernel();
+        const auto read_pressure_state = [&](const auto& buffer, auto& out) {
+            switch (buffer.get_precision()) {
+                case pressure_precision::single:
+                    enqueue_read(buffer, out);
+                    break;
+                case pressure_precision::half:
+                    out = read_pressures(queue, buffer);
+                    break;
+            }
+        };
+
+        read_pressure_state(previous, ret.previous);
+        read_pressure_state(current, ret.current);
+        boundary_buffer_1.read(queue, ret.boundary_1);
+        boundary_buffer_2.read(queue, ret.boundary_2);
+        boundary_buffer_3.read(queue, ret.boundary_3);
+
+        cl::Event ready;
+        queue.enqueueMarkerWithWaitList(nullptr, &ready);
+        queue.flush();
+
+        //  Moving the vectors doesn't move their storage, so the reads will
+        //  still land in the right place.
+        snapshot(std::move(ret), std::move(ready));
+    };
 
     //  run
-    auto step = 0u;
+    auto step = initial.step;
 
     //  The preprocessor returns 'true' while it should be run.
     //  It also updates the mesh with new pressure values.
@@ -81,49 +281,58 @@ size_t run(const core::compute_context& cc,
         //  set flag state to successful
         core::write_value(queue, error_flag_buffer, 0, id_success);
 
-        //  run kernel
-        kernel(cl::EnqueueArgs(queue,
-                               cl::NDRange(mesh.get_structure()
-                                                   .get_condensed_nodes()
-                                                   .size())),
-               previous,
-               current,
-               node_buffer,
-               mesh.get_descriptor().dimensions,
-               boundary_buffer_1,
-               boundary_buffer_2,
-               boundary_buffer_3,
-               boundary_coefficients_buffer,
-               error_flag_buffer);
+        //  run kernels
+        //  Each node class gets its own kernel, so that work-items in the
+        //  same wavefront always follow the same path.
+        //  The inside kernel does the bulk of the work.
+        run_node_kernel(inside_kernel, partition.inside, inside_buffer);
+        run_node_kernel(clipped_kernel, partition.clipped, clipped_buffer);
+        run_boundary_kernel(boundary_kernel_1,
+                            boundary_soa_kernel_1,
+                            partition.boundary_1,
+                            boundary_index_buffer_1,
+                            boundary_buffer_1);
+        run_boundary_kernel(boundary_kernel_2,
+                            boundary_soa_kernel_2,
+                            partition.boundary_2,
+                            boundary_index_buffer_2,
+                            boundary_buffer_2);
+        run_boundary_kernel(boundary_kernel_3,
+                            boundary_soa_kernel_3,
+                            partition.boundary_3,
+                            boundary_index_buffer_3,
+                            boundary_buffer_3);
 
         //  read out flag value
-        if (const auto error_flag =
-                    core::read_value<error_code>(queue, error_flag_buffer, 0)) {
-            if (error_flag & id_inf_error) {
-                throw core::exceptions::value_is_inf(
-                        "Pressure value is inf, check filter coefficients.");
-            }
-
-            if (error_flag & id_nan_error) {
-                throw core::exceptions::value_is_nan(
-                        "Pressure value is nan, check filter coefficients.");
-            }
-
-            if (error_flag & id_outside_mesh_error) {
-                throw std::runtime_error("Tried to read non-existant node.");
-            }
-
-            if (error_flag & id_suspicious_boundary_error) {
-                throw std::runtime_error("Suspicious boundary read.");
-            }
-        }
+        throw_if_error(
+                core::read_value<error_code>(queue, error_flag_buffer, 0));
 
         post(queue, current, step);
 
         std::swap(previous, current);
+
+        if (interval != 0 && (step + 1) % interval == 0) {
+            take_snapshot(step + 1);
+        }
     }
     return step;
 }
 
+template <typename step_preprocessor, typename step_postprocessor>
+size_t run(const core::compute_context& cc,
+           const mesh& mesh,
+           step_preprocessor&& pre,
+           step_postprocessor&& post,
+           const std::atomic_bool& keep_going) {
+    return run(cc,
+               mesh,
+               std::forward<step_preprocessor>(pre),
+               std::forward<step_postprocessor>(post),
+               keep_going,
+               mesh_state{},
+               0,
+               [](auto&&...) {});
+}
+
 }  // namespace waveguide
 }  // namespace wayverb
@@ -0,0 +1,380 @@
+#include "waveguide/batch.h"
+#include "waveguide/calibration.h"
+#include "waveguide/postprocessor/directional_receiver.h"
+#include "waveguide/program.h"
+#include "waveguide/waveguide.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace wayverb {
+namespace waveguide {
+
+namespace {
+
+/// Each source's copy of the boundary state follows the last, so that source
+/// s finds its boundaries at [s * num_boundaries].
+template <typename T>
+util::aligned::vector<T> repeat(const util::aligned::vector<T>& t,
+                                size_t times) {
+    util::aligned::vector<T> ret;
+    ret.reserve(t.size() * times);
+    for (auto i = 0u; i != times; ++i) {
+        ret.insert(ret.end(), t.begin(), t.end());
+    }
+    return ret;
+}
+
+/// Zero-sized buffers aren't allowed, so empty vectors get a buffer with
+/// room for one element, which will never be read.
+template <typename T>
+cl::Buffer make_buffer(const cl::Context& context,
+                       const util::aligned::vector<T>& t) {
+    return t.empty() ? cl::Buffer{context, CL_MEM_READ_WRITE, sizeof(T)}
+                     : core::load_to_buffer(context, t, false);
+}
+
+/// Reads the pressures of all sources at a single node, which are adjacent.
+util::aligned::vector<cl_float> read_batch_pressures(
+        cl::CommandQueue& queue,
+        const pressure_buffer& buffer,
+        size_t node,
+        size_t batch_size) {
+    util::aligned::vector<cl_float> ret(batch_size);
+    switch (buffer.get_precision()) {
+        case pressure_precision::single:
+            queue.enqueueReadBuffer(buffer,
+                                    CL_TRUE,
+                                    sizeof(cl_float) * node * batch_size,
+                                    sizeof(cl_float) * batch_size,
+                                    ret.data());
+            break;
+        case pressure_precision::half: {
+            util::aligned::vector<cl_half> stored(batch_size);
+            queue.enqueueReadBuffer(buffer,
+                                    CL_TRUE,
+                                    sizeof(cl_half) * node * batch_size,
+                                    sizeof(cl_half) * batch_size,
+                                    stored.data());
+            std::transform(
+                    stored.begin(), stored.end(), ret.begin(), from_half);
+            break;
+        }
+    }
+    return ret;
+}
+
+/// Runs a single batch, appending each source's probe outputs to 'output'.
+/// Returns false if the run was cancelled.
+bool run_one_batch(const core::compute_context& cc,
+                   const mesh& mesh,
+                   const batch_source* sources,
+                   size_t batch_size,
+                   const util::aligned::vector<size_t>& probes,
+                   const std::atomic_bool& keep_going,
+                   pressure_precision precision,
+                   batch_output::iterator output) {
+    const auto& structure = mesh.get_structure();
+    const auto num_nodes = structure.get_condensed_nodes().size();
+    const auto boundary_1 = get_boundary_data<1>(structure);
+    const auto boundary_2 = get_boundary_data<2>(structure);
+    const auto boundary_3 = get_boundary_data<3>(structure);
+
+    const program program{cc,
+                          precision,
+                          mesh.get_descriptor().brick_size,
+                          batch_size};
+    cl::CommandQueue queue{cc.context, cc.device};
+
+    const util::aligned::vector<cl_float> silence(num_nodes * batch_size, 0);
+    auto previous =
+            pressure_buffer{cc.context, num_nodes * batch_size, precision};
+    auto current =
+            pressure_buffer{cc.context, num_nodes * batch_size, precision};
+    write_pressures(queue, previous, silence);
+    write_pressures(queue, current, silence);
+
+    const auto node_buffer = core::load_to_buffer(
+            cc.context, structure.get_condensed_nodes(), true);
+    const auto boundary_coefficients_buffer = core::load_to_buffer(
+            cc.context, structure.get_coefficients(), true);
+    const auto filter_orders_buffer = core::load_to_buffer(
+            cc.context, structure.get_filter_orders(), true);
+    const auto boundary_buffer_1 =
+            make_buffer(cc.context, repeat(boundary_1, batch_size));
+    const auto boundary_buffer_2 =
+            make_buffer(cc.context, repeat(boundary_2, batch_size));
+    const auto boundary_buffer_3 =
+            make_buffer(cc.context, repeat(boundary_3, batch_size));
+
+    cl::Buffer error_flag_buffer{cc.context, CL_MEM_READ_WRITE, sizeof(cl_int)};
+
+    auto kernel = program.get_batch_kernel(mesh.get_scheme());
+
+    const auto steps =
+            std::max_element(sources,
+                             sources + batch_size,
+                             [](const auto& a, const auto& b) {
+                                 return a.signal.size() < b.signal.size();
+                             })
+                    ->signal.size();
+
+    for (auto step = 0u; step != steps; ++step) {
+        if (!keep_going) {
+            return false;
+        }
+
+        //  Inject each source into its own copy of the mesh.
+        for (auto i = 0u; i != batch_size; ++i) {
+            const auto& signal = sources[i].signal;
+            if (step < signal.size()) {
+                write_pressure(queue,
+                               current,
+                               sources[i].node * batch_size + i,
+                               signal[step]);
+            }
+        }
+
+        core::write_value(queue, error_flag_buffer, 0, id_success);
+
+        kernel(queue,
+               num_nodes,
+               previous,
+               current,
+               node_buffer,
+               mesh.get_descriptor().dimensions,
+               boundary_buffer_1,
+               static_cast<cl_uint>(boundary_1.size()),
+               boundary_buffer_2,
+               static_cast<cl_uint>(boundary_2.size()),
+               boundary_buffer_3,
+               static_cast<cl_uint>(boundary_3.size()),
+               boundary_coefficients_buffer,
+               filter_orders_buffer,
+               error_flag_buffer,
+               num_nodes);
+
+        throw_if_error(
+                core::read_value<error_code>(queue, error_flag_buffer, 0));
+
+        //  Record from the same buffer as the postprocessors in run would.
+        for (auto j = 0u; j != probes.size(); ++j) {
+            const auto pressures =
+                    read_batch_pressures(queue, current, probes[j], batch_size);
+            for (auto i = 0u; i != batch_size; ++i) {
+                if (step < sources[i].signal.size()) {
+                    output[i][j].emplace_back(pressures[i]);
+                }
+            }
+        }
+
+        std::swap(previous, current);
+    }
+
+    return true;
+}
+
+}  // namespace
+
+size_t compute_bytes_per_source(const mesh& mesh,
+                                pressure_precision precision) {
+    const auto& structure = mesh.get_structure();
+    return 2 * structure.get_condensed_nodes().size() *
+                   bytes_per_pressure(precision) +
+           structure.get_boundary_indices<1>().size() *
+                   sizeof(boundary_data_array_1) +
+           structure.get_boundary_indices<2>().size() *
+                   sizeof(boundary_data_array_2) +
+           structure.get_boundary_indices<3>().size() *
+                   sizeof(boundary_data_array_3);
+}
+
+size_t compute_shared_bytes(const mesh& mesh) {
+    const auto& structure = mesh.get_structure();
+    return structure.get_condensed_nodes().size() * sizeof(condensed_node) +
+           structure.get_coefficients().size() *
+                   (sizeof(coefficients_canonical) + sizeof(cl_uint));
+}
+
+size_t compute_batch_size(size_t memory_bytes,
+                          size_t max_alloc_bytes,
+                          const mesh& mesh,
+                          pressure_precision precision,
+                          size_t max_batch_size) {
+    const auto shared = compute_shared_bytes(mesh);
+    const auto per_source = compute_bytes_per_source(mesh, precision);
+    const auto per_pressure_buffer =
+            mesh.get_structure().get_condensed_nodes().size() *
+            bytes_per_pressure(precision);
+
+    auto ret = max_batch_size;
+    if (shared < memory_bytes && per_source != 0) {
+        ret = std::min(ret, (memory_bytes - shared) / per_source);
+    } else {
+        ret = 1;
+    }
+
+    //  The pressure buffers are the largest single allocations.
+    if (per_pressure_buffer != 0) {
+        ret = std::min(ret, max_alloc_bytes / per_pressure_buffer);
+    }
+
+    return std::max(ret, size_t{1});
+}
+
+size_t compute_batch_size(const cl::Device& device,
+                          const mesh& mesh,
+                          pressure_precision precision,
+                          size_t max_batch_size) {
+    return compute_batch_size(device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() / 2,
+                              device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>(),
+                              mesh,
+                              precision,
+                              max_batch_size);
+}
+
+batch_output run_batch(const core::compute_context& cc,
+                       const mesh& mesh,
+                       const util::aligned::vector<batch_source>& sources,
+                       const util::aligned::vector<size_t>& probes,
+                       const std::atomic_bool& keep_going,
+                       pressure_precision precision,
+                       size_t batch_size) {
+    const auto num_nodes = mesh.get_structure().get_condensed_nodes().size();
+    for (const auto& i : sources) {
+        if (num_nodes <= i.node) {
+            throw std::runtime_error{"Source node is outside mesh."};
+        }
+    }
+    for (const auto& i : probes) {
+        if (num_nodes <= i) {
+            throw std::runtime_error{"Probe node is outside mesh."};
+        }
+    }
+
+    if (batch_size == 0) {
+        batch_size = compute_batch_size(cc.device, mesh, precision);
+    }
+
+    batch_output ret(
+            sources.size(),
+            util::aligned::vector<util::aligned::vector<cl_float>>(
+                    probes.size()));
+
+    for (auto begin = 0u; begin < sources.size(); begin += batch_size) {
+        const auto size = std::min(batch_size, sources.size() - begin);
+        if (!run_one_batch(cc,
+                           mesh,
+                           sources.data() + begin,
+                           size,
+                           probes,
+                           keep_going,
+                           precision,
+                           ret.begin() + begin)) {
+            break;
+        }
+    }
+
+    return ret;
+}
+
+std::optional<util::aligned::vector<util::aligned::vector<bandpass_band>>>
+canonical_batch(const core::compute_context& cc,
+                const voxels_and_mesh& voxelised,
+                const util::aligned::vector<glm::vec3>& sources,
+                const glm::vec3& receiver,
+                const core::environment& environment,
+                const single_band_parameters& sim_params,
+                double simulation_time,
+                const std::atomic_bool& keep_going,
+                size_t batch_size) {
+    const auto& mesh = voxelised.mesh;
+    if (mesh.get_scheme() != sim_params.scheme) {
+        throw std::runtime_error{
+                "Mesh was built for a different waveguide scheme."};
+    }
+
+    const auto& descriptor = mesh.get_descriptor();
+    const auto sample_rate = compute_sample_rate(
+            descriptor, environment.speed_of_sound, mesh.get_scheme());
+
+    const auto compute_mesh_index = [&](const auto& pt) {
+        const auto ret = compute_index(descriptor, pt);
+        if (!is_inside(mesh, ret)) {
+            throw std::runtime_error{
+                    "Source/receiver node position appears to be outside "
+                    "mesh."};
+        }
+        return ret;
+    };
+
+    const auto ideal_steps =
+            static_cast<size_t>(std::ceil(sample_rate * simulation_time));
+
+    auto input = util::aligned::vector<cl_float>(ideal_steps, 0.0f);
+    if (!input.empty()) {
+        input.front() = calibration_factor(mesh.get_scheme(),
+                                           descriptor.spacing,
+                                           environment.acoustic_impedance);
+    }
+
+    util::aligned::vector<batch_source> batch_sources;
+    for (const auto& i : sources) {
+        batch_sources.emplace_back(batch_source{compute_mesh_index(i), input});
+    }
+
+    //  The directional receiver needs the pressure at the receiver node, and
+    //  at each of its neighbours.
+    const auto receiver_index = compute_mesh_index(receiver);
+    util::aligned::vector<size_t> probes{receiver_index};
+    for (const auto& i : compute_neighbors(descriptor, receiver_index)) {
+        probes.emplace_back(i);
+    }
+
+    //  Check the placement before running anything.
+    const postprocessor::directional_receiver prototype{
+            descriptor,
+            sample_rate,
+            get_ambient_density(environment),
+            receiver_index};
+
+    const auto recorded = run_batch(cc,
+                                    mesh,
+                                    batch_sources,
+                                    probes,
+                                    keep_going,
+                                    pressure_precision::single,
+                                    batch_size);
+
+    util::aligned::vector<util::aligned::vector<bandpass_band>> ret;
+    for (const auto& source : recorded) {
+        if (source.front().size() != ideal_steps) {
+            return std::nullopt;
+        }
+
+        auto receiver = prototype;
+        util::aligned::vector<postprocessor::directional_receiver::output>
+                output;
+        output.reserve(ideal_steps);
+        for (auto step = 0u; step != ideal_steps; ++step) {
+            output.emplace_back(receiver(
+                    [&](auto node) {
+                        const auto probe =
+                                std::find(probes.begin(), probes.end(), node) -
+                                probes.begin();
+                        return source[probe][step];
+                    },
+                    step));
+        }
+
+        ret.emplace_back(util::aligned::vector<bandpass_band>{bandpass_band{
+                band{std::move(output), sample_rate},
+                util::make_range(0.0, sim_params.cutoff)}});
+    }
+
+    return ret;
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
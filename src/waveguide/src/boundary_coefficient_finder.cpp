@@ -18,6 +18,55 @@ void set_boundary_index(it begin, it end, func f) {
     }
 }
 
+/// Runs the surface finders.
+/// The 1d table is indexed by the combined 1d-or-reentrant index.
+void find_boundary_surfaces(const boundary_coefficient_program& program,
+                            cl::CommandQueue& queue,
+                            const core::scene_buffers& buffers,
+                            const mesh_descriptor& descriptor,
+                            const cl::Buffer& nodes_buffer,
+                            size_t num_nodes,
+                            const cl::Buffer& index_buffer_1,
+                            const cl::Buffer& index_buffer_2,
+                            const cl::Buffer& index_buffer_3) {
+    {
+        auto kernel = program.get_boundary_coefficient_finder_1d_kernel();
+        kernel(queue,
+               num_nodes,
+               nodes_buffer,
+               descriptor,
+               index_buffer_1,
+               buffers.get_voxel_index_buffer(),
+               buffers.get_global_aabb(),
+               buffers.get_side(),
+               buffers.get_triangles_buffer(),
+               buffers.get_vertices_buffer(),
+               num_nodes);
+    }
+
+    {
+        auto kernel = program.get_boundary_coefficient_finder_2d_kernel();
+        kernel(queue,
+               num_nodes,
+               nodes_buffer,
+               descriptor,
+               index_buffer_2,
+               index_buffer_1,
+               num_nodes);
+    }
+
+    {
+        auto kernel = program.get_boundary_coefficient_finder_3d_kernel();
+        kernel(queue,
+               num_nodes,
+               nodes_buffer,
+               descriptor,
+               index_buffer_3,
+               index_buffer_1,
+               num_nodes);
+    }
+}
+
 }  // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -58,31 +107,24 @@ boundary_index_data compute_boundary_index_data(
 
     //  fire up the program
     const boundary_coefficient_program program{
-            core::compute_context{buffers.get_context(), device}};
+            core::compute_context{buffers.get_context(), device},
+            descriptor.brick_size};
 
     //  create a queue to make sure the cl stuff gets ordered properly
     cl::CommandQueue queue{buffers.get_context(), device};
 
-    //  all our programs use the same size/queue, which can be set up here
-    const auto enqueue = [&] {
-        return cl::EnqueueArgs{queue, cl::NDRange{nodes.size()}};
-    };
-
     //  run the kernels to compute boundary indices
+    find_boundary_surfaces(program,
+                           queue,
+                           buffers,
+                           descriptor,
+                           nodes_buffer,
+                           nodes.size(),
+                           index_buffer_1,
+                           index_buffer_2,
+                           index_buffer_3);
 
     auto ret_1 = [&] {
-        auto kernel = program.get_boundary_coefficient_finder_1d_kernel();
-        kernel(enqueue(),
-               nodes_buffer,
-               descriptor,
-               index_buffer_1,
-               buffers.get_voxel_index_buffer(),
-               buffers.get_global_aabb(),
-               buffers.get_side(),
-               buffers.get_triangles_buffer(),
-               buffers.get_triangles_buffer().getInfo<CL_MEM_SIZE>() /
-                       sizeof(core::triangle),
-               buffers.get_vertices_buffer());
         const auto out = core::read_from_buffer<boundary_index_array_1>(
                 queue, index_buffer_1);
 
@@ -102,27 +144,10 @@ boundary_index_data compute_boundary_index_data(
         return ret;
     }();
 
-    auto ret_2 = [&] {
-        auto kernel = program.get_boundary_coefficient_finder_2d_kernel();
-        kernel(enqueue(),
-               nodes_buffer,
-               descriptor,
-               index_buffer_2,
-               index_buffer_1);
-        return core::read_from_buffer<boundary_index_array_2>(queue,
-                                                              index_buffer_2);
-    }();
-
-    auto ret_3 = [&] {
-        auto kernel = program.get_boundary_coefficient_finder_3d_kernel();
-        kernel(enqueue(),
-               nodes_buffer,
-               descriptor,
-               index_buffer_3,
-               index_buffer_1);
-        return core::read_from_buffer<boundary_index_array_3>(queue,
-                                                              index_buffer_3);
-    }();
+    auto ret_2 = core::read_from_buffer<boundary_index_array_2>(
+            queue, index_buffer_2);
+    auto ret_3 = core::read_from_buffer<boundary_index_array_3>(
+            queue, index_buffer_3);
 
     //  finally, update node boundary indices so that the 1d indices point only
     //  to boundaries and not to reentrant nodes
@@ -131,5 +156,125 @@ boundary_index_data compute_boundary_index_data(
     return {std::move(ret_1), std::move(ret_2), std::move(ret_3)};
 }
 
+boundary_index_data compute_boundary_index_data(
+        const cl::Device& device,
+        cl::CommandQueue& queue,
+        const core::scene_buffers& buffers,
+        const mesh_descriptor& descriptor,
+        const cl::Buffer& nodes_buffer,
+        size_t num_nodes) {
+    const auto& context = buffers.get_context();
+    const boundary_coefficient_program program{
+            core::compute_context{context, device}, descriptor.brick_size};
+
+    //  count each kind of boundary node, per block of nodes, and then scan
+    //  the counts to find where each block's indices start
+    constexpr cl_uint block_size = 256;
+    const auto num_blocks = (num_nodes + block_size - 1) / block_size;
+
+    cl::Buffer block_buffer{
+            context, CL_MEM_READ_WRITE, sizeof(cl_uint4) * num_blocks};
+    cl::Buffer totals_buffer{context, CL_MEM_READ_WRITE, sizeof(cl_uint4)};
+
+    {
+        auto kernel = program.get_count_boundary_blocks_kernel();
+        kernel(queue,
+               num_blocks,
+               nodes_buffer,
+               num_nodes,
+               block_size,
+               block_buffer);
+    }
+
+    {
+        constexpr auto group = boundary_coefficient_program::scan_group_size;
+        auto kernel = program.get_scan_boundary_blocks_kernel();
+        kernel(cl::EnqueueArgs{queue, cl::NDRange{group}, cl::NDRange{group}},
+               block_buffer,
+               static_cast<cl_uint>(num_blocks),
+               totals_buffer);
+    }
+
+    //  the totals are the only thing we need on the host, to size the
+    //  output tables
+    const auto totals = core::read_value<cl_uint4>(queue, totals_buffer, 0);
+    const auto num_combined = totals.s[0];
+    const auto num_1d = totals.s[1];
+    const auto num_2d = totals.s[2];
+    const auto num_3d = totals.s[3];
+    if (!num_combined || !num_2d || !num_3d) {
+        throw std::runtime_error("No boundaries.");
+    }
+
+    cl::Buffer combined_to_1d{
+            context, CL_MEM_READ_WRITE, sizeof(cl_uint) * num_combined};
+
+    {
+        auto kernel = program.get_assign_boundary_indices_kernel();
+        kernel(queue,
+               num_blocks,
+               nodes_buffer,
+               num_nodes,
+               block_size,
+               block_buffer,
+               combined_to_1d);
+    }
+
+    cl::Buffer index_buffer_combined{
+            context,
+            CL_MEM_READ_WRITE,
+            sizeof(boundary_index_array_1) * num_combined};
+    cl::Buffer index_buffer_2{context,
+                              CL_MEM_READ_WRITE,
+                              sizeof(boundary_index_array_2) * num_2d};
+    cl::Buffer index_buffer_3{context,
+                              CL_MEM_READ_WRITE,
+                              sizeof(boundary_index_array_3) * num_3d};
+
+    find_boundary_surfaces(program,
+                           queue,
+                           buffers,
+                           descriptor,
+                           nodes_buffer,
+                           num_nodes,
+                           index_buffer_combined,
+                           index_buffer_2,
+                           index_buffer_3);
+
+    //  drop reentrant nodes from the 1d table, and update the node indices
+    //  to match
+    util::aligned::vector<boundary_index_array_1> ret_1;
+    if (num_1d) {
+        cl::Buffer index_buffer_1{context,
+                                  CL_MEM_READ_WRITE,
+                                  sizeof(boundary_index_array_1) * num_1d};
+        {
+            auto kernel = program.get_compact_1d_boundaries_kernel();
+            kernel(queue,
+                   num_combined,
+                   index_buffer_combined,
+                   combined_to_1d,
+                   index_buffer_1,
+                   num_combined);
+        }
+        {
+            auto kernel = program.get_finalise_1d_boundary_indices_kernel();
+            kernel(queue,
+                   num_nodes,
+                   nodes_buffer,
+                   combined_to_1d,
+                   num_nodes);
+        }
+        ret_1 = core::read_from_buffer<boundary_index_array_1>(queue,
+                                                               index_buffer_1);
+    }
+
+    return {std::move(ret_1),
+            core::read_from_buffer<boundary_index_array_2>(queue,
+                                                           index_buffer_2),
+            core::read_from_buffer<boundary_index_array_3>(queue,
+                                                           index_buffer_3)};
+}
+
 }  // namespace waveguide
 }  // namespace wayverb
@@ -6,6 +6,8 @@
 #include "core/cl/geometry_structs.h"
 #include "core/cl/voxel.h"
 
+#include <string>
+
 namespace wayverb {
 namespace waveguide {
 
@@ -162,6 +164,8 @@ typedef struct {
     float distance_squared;
 } triangle_distance_pair;
 
+//  Update 'closest' with any closer triangle in the given voxel.
+//  Ties are broken in favour of the lower triangle index.
 triangle_distance_pair closest_triangle_in_voxel(
         float3 pt,
         const global uint* voxel_index,
@@ -171,7 +175,7 @@ triangle_distance_pair closest_triangle_in_voxel(
         const global float3* vertices,
         int3 this_voxel_index,
         float3 voxel_dimensions,
-        float distance_squared);
+        triangle_distance_pair closest);
 triangle_distance_pair closest_triangle_in_voxel(
         float3 pt,
         const global uint* voxel_index,
@@ -181,65 +185,52 @@ triangle_distance_pair closest_triangle_in_voxel(
         const global float3* vertices,
         int3 this_voxel_index,
         float3 voxel_dimensions,
-        float distance_squared) {
+        triangle_distance_pair closest) {
     const float3 this_voxel_c0 =
-            global_aabb.c0 + (this_voxel_index + (int3)(0)) * voxel_dimensions;
+            global_aabb.c0 +
+            convert_float3(this_voxel_index + (int3)(0)) * voxel_dimensions;
     const float3 this_voxel_c1 =
-            global_aabb.c1 + (this_voxel_index + (int3)(1)) * voxel_dimensions;
+            global_aabb.c0 +
+            convert_float3(this_voxel_index + (int3)(1)) * voxel_dimensions;
 
     const aabb this_voxel_aabb = (aabb){this_voxel_c0, this_voxel_c1};
 
-    const float min_dist_to_voxel =
-            min_dist_to_cuboid_squared(pt, this_voxel_aabb);
-
-    triangle_distance_pair ret = {0, INFINITY};
-
-    //  if the voxel is within the checking distance
-    if (min_dist_to_voxel <= distance_squared) {
-        const uint voxel_offset =
-                get_voxel_index(voxel_index, this_voxel_index, side);
-        const uint num_triangles = voxel_index[voxel_offset];
-        const global uint* it = voxel_index + voxel_offset + 1;
-        const global uint* voxel_end = it + num_triangles;
-
-        //  for each triangle in the voxel
-        for (; it != voxel_end; ++it) {
-            //  find squared distance to the triangle
-            const uint this_index = *it;
-            const triangle this_triangle = triangles[this_index];
-            const float d = point_triangle_dist_squared(this_triangle, vertices, pt);
-
-            if (d < ret.distance_squared && d <= distance_squared) {
-                ret.triangle = *it;
-                ret.distance_squared = d;
-            }
-        }
+    //  if the voxel can't contain anything closer, don't bother checking it
+    if (closest.distance_squared <
+        min_dist_to_cuboid_squared(pt, this_voxel_aabb)) {
+        return closest;
     }
 
-    return ret;
-}
-
-uint slow_closest_triangle(float3 pt,
-                           const global triangle* triangles,
-                           uint num_triangles,
-                           const global float3* vertices);
-uint slow_closest_triangle(float3 pt,
-                           const global triangle* triangles,
-                           uint num_triangles,
-                           const global float3* vertices) {
-    uint ret = 0;
-    float distance = INFINITY;
-    for (uint i = 0; i != num_triangles; ++i) {
-        const triangle this_triangle = triangles[i];
-        const float new_dist = point_triangle_dist_squared(this_triangle, vertices, pt);
-        if (new_dist < distance) {
-            ret = i;
-            distance = new_dist;
+    const uint voxel_offset =
+            get_voxel_index(voxel_index, this_voxel_index, side);
+    const uint num_triangles = voxel_index[voxel_offset];
+    const global uint* it = voxel_index + voxel_offset + 1;
+    const global uint* voxel_end = it + num_triangles;
+
+    //  for each triangle in the voxel
+    for (; it != voxel_end; ++it) {
+        //  find squared distance to the triangle
+        const uint this_index = *it;
+        const triangle this_triangle = triangles[this_index];
+        const float d =
+                point_triangle_dist_squared(this_triangle, vertices, pt);
+
+        if (d < closest.distance_squared ||
+            (d == closest.distance_squared && this_index < closest.triangle)) {
+            closest.triangle = this_index;
+            closest.distance_squared = d;
         }
     }
-    return ret;
+
+    return closest;
 }
 
+//  Find the triangle closest to a point, by searching shells of voxels around
+//  the voxel containing the point.
+//  Stops as soon as no unsearched voxel could contain anything closer.
+//  Gives the same result as checking every triangle in the scene, but only
+//  has to look at the triangles nearby.
+//  Returns ~(uint)(0) if there are no triangles in the voxel grid.
 uint closest_triangle(float3 pt,
                       const global uint* voxel_index,
                       aabb global_aabb,
@@ -253,58 +244,68 @@ uint closest_triangle(float3 pt,
                       const global triangle* triangles,
                       const global float3* vertices) {
     const float3 voxel_dimensions = (global_aabb.c1 - global_aabb.c0) / side;
-    const int3 starting_index =
-            get_starting_index(pt, global_aabb, voxel_dimensions);
-
-    //  keep increasing search distance until we find a triangle
-    const float lim = distance(global_aabb.c0, global_aabb.c1);
-    for (float dist = length(voxel_dimensions); dist < lim; dist *= 1.6) {
-        const float distance_squared = dist * dist;
-
-        //  find the range of the voxel structure to search
-        const int3 index_diff = convert_int3(ceil((float3)(dist) / voxel_dimensions));
-
-        const int3 min_diff = max(starting_index - index_diff, (int3)(0));
-        const int3 max_diff =
-                min(starting_index + index_diff + (int3)(1), (int3)(side));
-
-        triangle_distance_pair ret = {0, INFINITY};
-
-        //  for each voxel in the search range
-        for (int x = min_diff.x; x != max_diff.x; ++x) {
-            for (int y = min_diff.y; y != max_diff.y; ++y) {
-                for (int z = min_diff.z; z != max_diff.z; ++z) {
+    const int3 last = (int3)((int)side - 1);
+    const int3 start =
+            clamp(get_starting_index(pt, global_aabb, voxel_dimensions),
+                  (int3)(0),
+                  last);
+
+    triangle_distance_pair closest = {~(uint)(0), INFINITY};
+
+    for (int radius = 0;; ++radius) {
+        const int3 lo = max(start - radius, (int3)(0));
+        const int3 hi = min(start + radius, last);
+
+        //  for each voxel in the new shell
+        for (int x = lo.x; x <= hi.x; ++x) {
+            for (int y = lo.y; y <= hi.y; ++y) {
+                for (int z = lo.z; z <= hi.z; ++z) {
                     const int3 this_voxel_index = (int3)(x, y, z);
 
-                    //  find the closest triangle in this voxel
-                    const triangle_distance_pair pair =
-                            closest_triangle_in_voxel(pt,
-                                                      voxel_index,
-                                                      global_aabb,
-                                                      side,
-                                                      triangles,
-                                                      vertices,
-                                                      this_voxel_index,
-                                                      voxel_dimensions,
-                                                      distance_squared);
-
-                    //  if it's closer than the current closest, update the
-                    //  current closest with the nearer results
-                    if (pair.distance_squared < ret.distance_squared) {
-                        ret = pair;
+                    //  voxels inside the shell were searched last time
+                    if (all(abs_diff(this_voxel_index, start) <
+                            (uint3)(radius))) {
+                        continue;
                     }
+
+                    closest = closest_triangle_in_voxel(pt,
+                                                        voxel_index,
+                                                        global_aabb,
+                                                        side,
+                                                        triangles,
+                                                        vertices,
+                                                        this_voxel_index,
+                                                        voxel_dimensions,
+                                                        closest);
                 }
             }
         }
 
-        //  if we found a triangle within the search range, return it
-        if (ret.distance_squared < INFINITY) {
-            return ret.triangle;
+        //  if the whole grid has been searched, we're done
+        if (all(lo == (int3)(0)) && all(hi == last)) {
+            break;
+        }
+
+        //  find the distance to the nearest unsearched voxel
+        const float3 searched_c0 =
+                global_aabb.c0 + convert_float3(lo) * voxel_dimensions;
+        const float3 searched_c1 =
+                global_aabb.c0 + convert_float3(hi + 1) * voxel_dimensions;
+        const float3 to_c0 =
+                select((float3)(INFINITY), pt - searched_c0, (int3)(0) < lo);
+        const float3 to_c1 =
+                select((float3)(INFINITY), searched_c1 - pt, hi < last);
+        const float3 to_edge = min(to_c0, to_c1);
+        const float bound =
+                max(0.0f, min(to_edge.x, min(to_edge.y, to_edge.z)));
+
+        //  if nothing unsearched could be closer, we're done
+        if (closest.distance_squared < bound * bound) {
+            break;
         }
     }
 
-    //  if we get here there are bad problems
-    return ~(uint)(0);
+    return closest.triangle;
 }
 
 kernel void boundary_coefficient_finder_1d(
@@ -318,9 +319,13 @@ kernel void boundary_coefficient_finder_1d(
         uint side,
 
         const global triangle* triangles,  //  scene
-        uint num_triangles,
-        const global float3* vertices) {
+        const global float3* vertices,
+
+        ulong num_nodes) {
     const size_t thread = get_global_id(0);
+    if (thread >= num_nodes) {
+        return;
+    }
 
     const int bt = nodes[thread].boundary_type;
     const int popcnt = popcount(bt);
@@ -335,7 +340,8 @@ kernel void boundary_coefficient_finder_1d(
     //  find the closest triangle
     const int3 locator = to_locator(thread, descriptor.dimensions);
     const float3 pt = compute_node_position(descriptor, locator);
-    const uint closest_triangle_index = slow_closest_triangle(pt, triangles, num_triangles, vertices);
+    const uint closest_triangle_index = closest_triangle(
+            pt, voxel_index, global_aabb, side, triangles, vertices);
     const uint s = triangles[closest_triangle_index].surface;
 
     //  now set the boundary to the triangle's surface
@@ -361,8 +367,12 @@ kernel void boundary_coefficient_finder_2d(
         const global condensed_node* nodes,  //  io
         const mesh_descriptor descriptor,
         global boundary_index_array_2* boundary_2d,
-        const global boundary_index_array_1* boundary_1d) {
+        const global boundary_index_array_1* boundary_1d,
+        ulong num_nodes) {
     const size_t thread = get_global_id(0);
+    if (thread >= num_nodes) {
+        return;
+    }
 
     const int bt = nodes[thread].boundary_type;
     const int popcnt = popcount(bt);
@@ -431,8 +441,12 @@ kernel void boundary_coefficient_finder_3d(
         const global condensed_node* nodes,  //  io
         const mesh_descriptor descriptor,
         global boundary_index_array_3* boundary_3d,
-        const global boundary_index_array_1* boundary_1d) {
+        const global boundary_index_array_1* boundary_1d,
+        ulong num_nodes) {
     const size_t thread = get_global_id(0);
+    if (thread >= num_nodes) {
+        return;
+    }
 
     const int bt = nodes[thread].boundary_type;
     const int popcnt = popcount(bt);
@@ -484,8 +498,147 @@ kernel void boundary_coefficient_finder_3d(
 }
 )";
 
+//  Assigning boundary indices is a stream compaction: each boundary node's
+//  index is the number of nodes of the same kind which precede it.
+//  The nodes are split into blocks, each block is counted, the counts are
+//  scanned, and then each block assigns its indices in order.
+//  Per-kind counts are packed into a uint4:
+//      x: 1d boundary or reentrant (the index space used while finding
+//         surfaces)
+//      y: 1d boundary
+//      z: 2d boundary
+//      w: 3d boundary
+constexpr auto indexing_source = R"(
+uint4 boundary_kinds(int bt);
+uint4 boundary_kinds(int bt) {
+    const bool boundary = !(bt & id_reentrant || bt & id_inside);
+    const int popcnt = popcount(bt);
+    return (uint4)(bt == id_reentrant || (boundary && popcnt == 1) ? 1 : 0,
+                   boundary && popcnt == 1 ? 1 : 0,
+                   boundary && popcnt == 2 ? 1 : 0,
+                   boundary && popcnt == 3 ? 1 : 0);
+}
+
+kernel void count_boundary_blocks(const global condensed_node* nodes,
+                                  ulong num_nodes,
+                                  uint block_size,
+                                  global uint4* block_counts) {
+    const size_t thread = get_global_id(0);
+    const ulong begin = thread * block_size;
+    if (begin >= num_nodes) {
+        return;
+    }
+    const ulong end = min(begin + block_size, num_nodes);
+
+    uint4 count = (uint4)(0);
+    for (ulong i = begin; i < end; ++i) {
+        count += boundary_kinds(nodes[i].boundary_type);
+    }
+    block_counts[thread] = count;
+}
+
+//  Must be run as a single work-group of SCAN_GROUP_SIZE.
+//  Replaces each block count with the total count of all preceding blocks.
+kernel void scan_boundary_blocks(global uint4* block_counts,
+                                 uint num_blocks,
+                                 global uint4* totals) {
+    local uint4 partial[SCAN_GROUP_SIZE];
+
+    const uint thread = get_local_id(0);
+    const uint per_thread =
+            (num_blocks + SCAN_GROUP_SIZE - 1) / SCAN_GROUP_SIZE;
+    const uint begin = min(thread * per_thread, num_blocks);
+    const uint end = min(begin + per_thread, num_blocks);
+
+    uint4 sum = (uint4)(0);
+    for (uint i = begin; i != end; ++i) {
+        sum += block_counts[i];
+    }
+    partial[thread] = sum;
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    //  there are only a handful of partial sums, so scan them serially
+    if (thread == 0) {
+        uint4 running = (uint4)(0);
+        for (uint i = 0; i != SCAN_GROUP_SIZE; ++i) {
+            const uint4 count = partial[i];
+            partial[i] = running;
+            running += count;
+        }
+        *totals = running;
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    uint4 running = partial[thread];
+    for (uint i = begin; i != end; ++i) {
+        const uint4 count = block_counts[i];
+        block_counts[i] = running;
+        running += count;
+    }
+}
+
+//  1d and reentrant nodes are given indices in the combined space, and the
+//  mapping from the combined space to the 1d-only space is recorded.
+kernel void assign_boundary_indices(global condensed_node* nodes,
+                                    ulong num_nodes,
+                                    uint block_size,
+                                    const global uint4* block_offsets,
+                                    global uint* combined_to_1d) {
+    const size_t thread = get_global_id(0);
+    const ulong begin = thread * block_size;
+    if (begin >= num_nodes) {
+        return;
+    }
+    const ulong end = min(begin + block_size, num_nodes);
+
+    uint4 running = block_offsets[thread];
+    for (ulong i = begin; i < end; ++i) {
+        const uint4 kinds = boundary_kinds(nodes[i].boundary_type);
+        if (kinds.x) {
+            nodes[i].boundary_index = running.x;
+            combined_to_1d[running.x] = kinds.y ? running.y : ~(uint)0;
+        } else if (kinds.z) {
+            nodes[i].boundary_index = running.z;
+        } else if (kinds.w) {
+            nodes[i].boundary_index = running.w;
+        }
+        running += kinds;
+    }
+}
+
+//  Drop the reentrant entries from the 1d surface table.
+kernel void compact_1d_boundaries(
+        const global boundary_index_array_1* combined,
+        const global uint* combined_to_1d,
+        global boundary_index_array_1* boundary_1d,
+        uint num_combined) {
+    const size_t thread = get_global_id(0);
+    if (thread >= num_combined) {
+        return;
+    }
+    const uint index = combined_to_1d[thread];
+    if (index != ~(uint)0) {
+        boundary_1d[index] = combined[thread];
+    }
+}
+
+//  Point 1d nodes at the compacted table.
+kernel void finalise_1d_boundary_indices(global condensed_node* nodes,
+                                         const global uint* combined_to_1d,
+                                         ulong num_nodes) {
+    const size_t thread = get_global_id(0);
+    if (thread >= num_nodes) {
+        return;
+    }
+    if (boundary_kinds(nodes[thread].boundary_type).y) {
+        nodes[thread].boundary_index =
+                combined_to_1d[nodes[thread].boundary_index];
+    }
+}
+)";
+
 boundary_coefficient_program::boundary_coefficient_program(
-        const core::compute_context& cc)
+        const core::compute_context& cc, cl_int brick_size)
         : wrapper_{cc,
                    std::vector<std::string>{
                            core::cl_representation_v<mesh_descriptor>,
@@ -502,8 +655,12 @@ boundary_coefficient_program::boundary_coefficient_program(
                            core::cl_representation_v<core::triangle>,
                            core::cl_sources::geometry,
                            core::cl_sources::voxel,
+                           cl_sources::node_layout(brick_size),
                            cl_sources::utils,
-                           source}} {}
+                           "#define SCAN_GROUP_SIZE " +
+                                   std::to_string(scan_group_size) + "\n",
+                           source,
+                           indexing_source}} {}
 
 }  // namespace waveguide
-}  // namespace wyaverb
+}  // namespace wayverb
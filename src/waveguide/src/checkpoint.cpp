@@ -0,0 +1,94 @@
+#include "waveguide/checkpoint.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace wayverb {
+namespace waveguide {
+
+namespace {
+
+/// Bumped whenever the checkpoint layout changes, so that old files are
+/// ignored rather than misread.
+constexpr std::uint64_t checkpoint_version = 2;
+
+//  64-bit FNV-1a.
+constexpr std::uint64_t fnv_offset_basis = 0xcbf29ce484222325;
+constexpr std::uint64_t fnv_prime = 0x100000001b3;
+
+template <typename T>
+std::uint64_t combine_vector(std::uint64_t seed,
+                             const util::aligned::vector<T>& t) {
+    seed = combine_fingerprint(seed, t.size());
+    return combine_fingerprint(seed, t.data(), t.size() * sizeof(T));
+}
+
+}  // namespace
+
+std::uint64_t combine_fingerprint(std::uint64_t seed,
+                                  const void* data,
+                                  size_t bytes) {
+    const auto begin = static_cast<const unsigned char*>(data);
+    for (auto it = begin, end = begin + bytes; it != end; ++it) {
+        seed = (seed ^ *it) * fnv_prime;
+    }
+    return seed;
+}
+
+std::uint64_t compute_fingerprint(const mesh& mesh) {
+    auto ret = combine_fingerprint(fnv_offset_basis, checkpoint_version);
+
+    //  cl vector types have a padding element, which must be skipped.
+    const auto& descriptor = mesh.get_descriptor();
+    for (auto i = 0; i != 3; ++i) {
+        ret = combine_fingerprint(ret, descriptor.min_corner.s[i]);
+        ret = combine_fingerprint(ret, descriptor.dimensions.s[i]);
+    }
+    ret = combine_fingerprint(ret, descriptor.spacing);
+    ret = combine_fingerprint(ret, descriptor.brick_size);
+    ret = combine_fingerprint(ret, mesh.get_scheme());
+
+    ret = combine_vector(ret, mesh.get_structure().get_condensed_nodes());
+    ret = combine_vector(ret, mesh.get_structure().get_coefficients());
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+checkpoint_writer::checkpoint_writer(std::string path,
+                                     std::uint64_t fingerprint)
+        : path_{std::move(path)}
+        , fingerprint_{fingerprint} {}
+
+checkpoint_writer::~checkpoint_writer() noexcept {
+    if (future_.valid()) {
+        future_.wait();
+    }
+}
+
+void checkpoint_writer::wait() {
+    if (future_.valid()) {
+        future_.get();
+    }
+}
+
+void checkpoint_writer::write_file(
+        const std::function<void(cereal::BinaryOutputArchive&)>& callback)
+        const {
+    const auto temp_path = path_ + ".tmp";
+    {
+        std::ofstream stream{temp_path, std::ios::binary | std::ios::trunc};
+        if (!stream) {
+            throw std::runtime_error{"Unable to open checkpoint file."};
+        }
+        cereal::BinaryOutputArchive archive{stream};
+        callback(archive);
+    }
+
+    if (std::rename(temp_path.c_str(), path_.c_str())) {
+        throw std::runtime_error{"Unable to replace checkpoint file."};
+    }
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -14,14 +14,16 @@ const char* filters = R"(
 #define CAT(a, b) PRIMITIVE_CAT(a, b)
 #define PRIMITIVE_CAT(a, b) a##b
 
-#define FILTER_STEP(order)                                                   \
-    filt_real CAT(filter_step_, order)(                                      \
+//  'space' is the address space of the filter memory, which may be global or
+//  private.
+#define FILTER_STEP(order, space, prefix)                                    \
+    filt_real CAT(prefix, order)(                                            \
             filt_real input,                                                 \
-            global CAT(memory_, order) * m,                                  \
+            space CAT(memory_, order) * m,                                   \
             const global CAT(coefficients_, order) * c);                     \
-    filt_real CAT(filter_step_, order)(                                      \
+    filt_real CAT(prefix, order)(                                            \
             filt_real input,                                                 \
-            global CAT(memory_, order) * m,                                  \
+            space CAT(memory_, order) * m,                                   \
             const global CAT(coefficients_, order) * c) {                    \
         const filt_real output = (input * c->b[0] + m->array[0]) / c->a[0];  \
         for (int i = 0; i != order - 1; ++i) {                               \
@@ -35,11 +37,42 @@ const char* filters = R"(
         return output;                                                       \
     }
 
-FILTER_STEP(BIQUAD_ORDER);
-FILTER_STEP(CANONICAL_FILTER_ORDER);
+FILTER_STEP(BIQUAD_ORDER, global, filter_step_);
+FILTER_STEP(CANONICAL_FILTER_ORDER, global, filter_step_);
+FILTER_STEP(CANONICAL_FILTER_ORDER, private, filter_step_private_);
 
 #define filter_step_biquad CAT(filter_step_, BIQUAD_ORDER)
 #define filter_step_canonical CAT(filter_step_, CANONICAL_FILTER_ORDER)
+#define filter_step_canonical_private \
+    CAT(filter_step_private_, CANONICAL_FILTER_ORDER)
+
+//  Like filter_step_canonical_private, but only updates the first 'order'
+//  delays.
+//  Lower-order filters are stored with trailing zero coefficients, and their
+//  orders are found on the host (see vectors::get_filter_orders).
+//  The coefficients above 'order' must be zero, in which case the remaining
+//  delays always hold zero, and the result is the same as the full update.
+filt_real filter_step_canonical_adaptive(filt_real input,
+                                         private memory_canonical* m,
+                                         const global coefficients_canonical* c,
+                                         int order);
+filt_real filter_step_canonical_adaptive(filt_real input,
+                                         private memory_canonical* m,
+                                         const global coefficients_canonical* c,
+                                         int order) {
+    const filt_real output = (input * c->b[0] + m->array[0]) / c->a[0];
+    for (int i = 0; i < order - 1; ++i) {
+        const filt_real b = c->b[i + 1] == 0 ? 0 : c->b[i + 1] * input;
+        const filt_real a = c->a[i + 1] == 0 ? 0 : c->a[i + 1] * output;
+        m->array[i] = b - a + m->array[i + 1];
+    }
+    if (order) {
+        const filt_real b = c->b[order] == 0 ? 0 : c->b[order] * input;
+        const filt_real a = c->a[order] == 0 ? 0 : c->a[order] * output;
+        m->array[order - 1] = b - a;
+    }
+    return output;
+}
 
 float biquad_cascade(filt_real input,
                      global biquad_memory_array* bm,
@@ -1,10 +1,55 @@
 #include "waveguide/cl/utils.h"
 
+#include "utilities/string_builder.h"
+
+#include <stdexcept>
+
 namespace wayverb {
 namespace waveguide {
 namespace cl_sources {
 
+std::string node_layout(cl_int brick_size) {
+    return util::build_string("#define NODE_BRICK_SIZE (", brick_size, ")\n");
+}
+
+namespace {
+
+constexpr auto single_pressure_storage = R"(
+#ifndef NODE_BATCH_SIZE
+#define NODE_BATCH_SIZE (1)
+#endif
+typedef float pressure_t;
+#define read_pressure(buffer, index) ((buffer)[(index)*NODE_BATCH_SIZE])
+#define write_pressure(buffer, index, value) \
+    ((buffer)[(index)*NODE_BATCH_SIZE] = (value))
+)";
+
+constexpr auto half_pressure_storage = R"(
+#ifndef NODE_BATCH_SIZE
+#define NODE_BATCH_SIZE (1)
+#endif
+typedef half pressure_t;
+#define read_pressure(buffer, index) \
+    vload_half((index)*NODE_BATCH_SIZE, (buffer))
+#define write_pressure(buffer, index, value) \
+    vstore_half((value), (index)*NODE_BATCH_SIZE, (buffer))
+)";
+
+}  // namespace
+
+const char* pressure_storage(pressure_precision precision) {
+    switch (precision) {
+        case pressure_precision::single: return single_pressure_storage;
+        case pressure_precision::half: return half_pressure_storage;
+    }
+    throw std::runtime_error{"Unrecognised pressure precision."};
+}
+
 const char* utils{R"(
+#ifndef NODE_BRICK_SIZE
+#define NODE_BRICK_SIZE (0)
+#endif
+
 #define no_neighbor (~(uint)(0))
 #define PORTS (6)
 
@@ -22,17 +67,80 @@ bool locator_outside(int3 locator, int3 dim) {
     return any(locator < (int3)(0)) || any(dim <= locator);
 }
 
-int3 to_locator(size_t index, int3 dim);
-int3 to_locator(size_t index, int3 dim) {
+//  Conversions for boxes of nodes in x-major order.
+
+int3 linear_locator(size_t index, int3 dim);
+int3 linear_locator(size_t index, int3 dim) {
     const int xrem = index % dim.x, xquot = index / dim.x;
     const int yrem = xquot % dim.y, yquot = xquot / dim.y;
     const int zrem = yquot % dim.z;
     return (int3)(xrem, yrem, zrem);
 }
 
+size_t linear_index(int3 locator, int3 dim);
+size_t linear_index(int3 locator, int3 dim) {
+    return locator.x + locator.y * dim.x + locator.z * dim.x * dim.y;
+}
+
+//  Conversions for boxes of nodes in the mesh's layout.
+//  These must match compute_index and compute_locator in
+//  mesh_descriptor.cpp.
+
+#if NODE_BRICK_SIZE
+
+int3 to_locator(size_t index, int3 dim);
+int3 to_locator(size_t index, int3 dim) {
+    int3 begin;
+    int3 extent;
+
+    const size_t layer_size = (size_t)(NODE_BRICK_SIZE) * dim.x * dim.y;
+    begin.z = index / layer_size * NODE_BRICK_SIZE;
+    extent.z = min(NODE_BRICK_SIZE, dim.z - begin.z);
+    index -= (size_t)(begin.z) * dim.x * dim.y;
+
+    const size_t row_size = (size_t)(NODE_BRICK_SIZE) * dim.x * extent.z;
+    begin.y = index / row_size * NODE_BRICK_SIZE;
+    extent.y = min(NODE_BRICK_SIZE, dim.y - begin.y);
+    index -= (size_t)(begin.y) * dim.x * extent.z;
+
+    const size_t brick_volume = (size_t)(NODE_BRICK_SIZE) * extent.y * extent.z;
+    begin.x = index / brick_volume * NODE_BRICK_SIZE;
+    extent.x = min(NODE_BRICK_SIZE, dim.x - begin.x);
+    index -= (size_t)(begin.x) * extent.y * extent.z;
+
+    return begin + linear_locator(index, extent);
+}
+
 size_t to_index(int3 locator, int3 dim);
 size_t to_index(int3 locator, int3 dim) {
-    return locator.x + locator.y * dim.x + locator.z * dim.x * dim.y;
+    const int3 begin = locator / NODE_BRICK_SIZE * NODE_BRICK_SIZE;
+    const int3 extent = min((int3)(NODE_BRICK_SIZE), dim - begin);
+    return (size_t)(begin.z) * dim.x * dim.y +
+           (size_t)(begin.y) * dim.x * extent.z +
+           (size_t)(begin.x) * extent.y * extent.z +
+           linear_index(locator - begin, extent);
+}
+
+#else
+
+int3 to_locator(size_t index, int3 dim);
+int3 to_locator(size_t index, int3 dim) { return linear_locator(index, dim); }
+
+size_t to_index(int3 locator, int3 dim);
+size_t to_index(int3 locator, int3 dim) { return linear_index(locator, dim); }
+
+#endif
+
+//  The index of the node at a small offset from a node which is not on the
+//  outer faces of the mesh, so that no bounds checks are needed.
+//  In x-major order the offset is a fixed stride, and the locator is unused.
+size_t inner_neighbor_index(size_t index, int3 locator, int3 offset, int3 dim);
+size_t inner_neighbor_index(size_t index, int3 locator, int3 offset, int3 dim) {
+#if NODE_BRICK_SIZE
+    return to_index(locator + offset, dim);
+#else
+    return index + offset.x + (offset.y + offset.z * dim.y) * dim.x;
+#endif
 }
 
 uint neighbor_index(int3 locator, int3 dim, PortDirection pd);
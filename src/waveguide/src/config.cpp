@@ -1,8 +1,9 @@
 #include "waveguide/config.h"
 
-#include <cmath>
+#include "core/resampler.h"
 
-#include "samplerate.h"
+#include <cmath>
+#include <stdexcept>
 
 namespace wayverb {
 namespace waveguide {
@@ -10,18 +11,29 @@ namespace config {
 
 namespace {
 constexpr auto DIM = 3;
+
+/// X / (c * T).
+/// The rectilinear value is computed directly, rather than by inverting the
+/// courant number, so that existing meshes keep exactly the same spacing.
+double inverse_courant(scheme s) {
+    switch (s) {
+        case scheme::rectilinear: return std::sqrt(DIM);
+        case scheme::interpolated_wideband: return 1;
+    }
+    throw std::runtime_error{"Unrecognised waveguide scheme."};
+}
 }  // namespace
 
-double speed_of_sound(double time_step, double grid_spacing) {
-    return grid_spacing / (time_step * std::sqrt(DIM));
+double speed_of_sound(double time_step, double grid_spacing, scheme s) {
+    return grid_spacing / (time_step * inverse_courant(s));
 }
 
-double time_step(double speed_of_sound, double grid_spacing) {
-    return grid_spacing / (speed_of_sound * std::sqrt(DIM));
+double time_step(double speed_of_sound, double grid_spacing, scheme s) {
+    return grid_spacing / (speed_of_sound * inverse_courant(s));
 }
 
-double grid_spacing(double speed_of_sound, double time_step) {
-    return speed_of_sound * time_step * std::sqrt(DIM);
+double grid_spacing(double speed_of_sound, double time_step, scheme s) {
+    return speed_of_sound * time_step * inverse_courant(s);
 }
 
 }  // namespace config
@@ -34,20 +46,11 @@ util::aligned::vector<float> adjust_sampling_rate(const float* data,
         throw std::runtime_error{
                 "Sample rate of 0 gives few hints about how to proceed."};
     }
-    const auto ratio = out_sr / in_sr;
-    util::aligned::vector<float> out_signal(ratio * size);
-    SRC_DATA sample_rate_info{data,
-                              out_signal.data(),
-                              static_cast<long>(size),
-                              static_cast<long>(out_signal.size()),
-                              0,
-                              0,
-                              0,
-                              ratio};
-    src_simple(&sample_rate_info, SRC_SINC_BEST_QUALITY, 1);
+    auto out_signal =
+            core::resample(data, size, in_sr, out_sr, core::resampler_best);
 
     //  Correct output level.
-    const auto volume_scale = 1 / ratio;
+    const auto volume_scale = in_sr / out_sr;
     for (auto& i : out_signal) {
         i *= volume_scale;
     }
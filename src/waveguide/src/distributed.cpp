@@ -0,0 +1,509 @@
+#include "waveguide/distributed.h"
+#include "waveguide/program.h"
+#include "waveguide/waveguide.h"
+
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <stdexcept>
+
+namespace wayverb {
+namespace waveguide {
+
+namespace {
+
+struct index_list final {
+    cl::Buffer buffer;
+    size_t size;
+};
+
+index_list make_index_list(const cl::Context& context,
+                           const util::aligned::vector<cl_uint>& indices) {
+    return {indices.empty() ? cl::Buffer{}
+                            : core::load_to_buffer(context, indices, true),
+            indices.size()};
+}
+
+struct partition_buffers final {
+    partition_buffers(const cl::Context& context, const node_partition& p)
+            : inside{make_index_list(context, p.inside)}
+            , clipped{make_index_list(context, p.clipped)}
+            , boundary_1{make_index_list(context, p.boundary_1)}
+            , boundary_2{make_index_list(context, p.boundary_2)}
+            , boundary_3{make_index_list(context, p.boundary_3)} {}
+
+    index_list inside;
+    index_list clipped;
+    index_list boundary_1;
+    index_list boundary_2;
+    index_list boundary_3;
+};
+
+/// A slab may have no boundaries of a particular kind, but OpenCL doesn't
+/// allow zero-sized buffers.
+template <typename T>
+cl::Buffer load_or_placeholder(const cl::Context& context,
+                               const util::aligned::vector<T>& t,
+                               bool read_only) {
+    return t.empty() ? cl::Buffer{context, CL_MEM_READ_WRITE, sizeof(T)}
+                     : core::load_to_buffer(context, t, read_only);
+}
+
+/// Describes a run of whole layers in a pressure buffer, in the form expected
+/// by the rect read/write calls.
+struct layer_block final {
+    cl::size_t<3> origin;
+    cl::size_t<3> region;
+    size_t row_pitch;
+    size_t slice_pitch;
+};
+
+layer_block compute_layer_block(const mesh_descriptor& descriptor,
+                                size_t axis,
+                                int first,
+                                int layers) {
+    const auto& dim = descriptor.dimensions.s;
+    layer_block ret{};
+    ret.region[0] = dim[0];
+    ret.region[1] = dim[1];
+    ret.region[2] = dim[2];
+    ret.origin[axis] = first;
+    ret.region[axis] = layers;
+
+    //  The x origin and extent are in bytes.
+    ret.origin[0] *= sizeof(cl_float);
+    ret.region[0] *= sizeof(cl_float);
+
+    ret.row_pitch = dim[0] * sizeof(cl_float);
+    ret.slice_pitch = ret.row_pitch * dim[1];
+    return ret;
+}
+
+size_t compute_block_size(const layer_block& block) {
+    return block.region[0] / sizeof(cl_float) * block.region[1] *
+           block.region[2];
+}
+
+/// The same block, packed into a buffer of its own.
+layer_block compute_packed_block(const layer_block& block) {
+    layer_block ret{};
+    ret.region = block.region;
+    ret.row_pitch = block.region[0];
+    ret.slice_pitch = ret.row_pitch * block.region[1];
+    return ret;
+}
+
+void copy_block(cl::CommandQueue& queue,
+                const cl::Buffer& src,
+                const layer_block& src_block,
+                const cl::Buffer& dst,
+                const layer_block& dst_block,
+                const std::vector<cl::Event>* wait = nullptr) {
+    queue.enqueueCopyBufferRect(src,
+                                dst,
+                                src_block.origin,
+                                dst_block.origin,
+                                src_block.region,
+                                src_block.row_pitch,
+                                src_block.slice_pitch,
+                                dst_block.row_pitch,
+                                dst_block.slice_pitch,
+                                wait);
+}
+
+}  // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Owns the device state for a single slab.
+/// Kernels run on one queue, and halo transfers on another, so that the two
+/// can overlap.
+/// The transfer queue never touches the pressure buffers, which the interior
+/// kernels may be writing at the same time.
+/// Instead, edge layers are copied out to staging buffers on the compute
+/// queue, and halo layers are copied in from staging buffers on the compute
+/// queue, after the interior kernels.
+class slab_runner final {
+public:
+    slab_runner(const core::compute_context& cc, const slab& s)
+            : descriptor_{s.get_mesh().get_descriptor()}
+            , axis_{s.get_axis()}
+            , scheme_{s.get_mesh().get_scheme()}
+            , program_{cc}
+            , compute_queue_{cc.context, cc.device}
+            , transfer_queue_{cc.context, cc.device}
+            , previous_{make_zeroed_buffer(cc.context)}
+            , current_{make_zeroed_buffer(cc.context)}
+            , nodes_{core::load_to_buffer(
+                      cc.context,
+                      s.get_mesh().get_structure().get_condensed_nodes(),
+                      true)}
+            , coefficients_{core::load_to_buffer(
+                      cc.context,
+                      s.get_mesh().get_structure().get_coefficients(),
+                      true)}
+            , filter_orders_{core::load_to_buffer(
+                      cc.context,
+                      s.get_mesh().get_structure().get_filter_orders(),
+                      true)}
+            , boundary_1_{load_or_placeholder(
+                      cc.context,
+                      get_boundary_data<1>(s.get_mesh().get_structure()),
+                      false)}
+            , boundary_2_{load_or_placeholder(
+                      cc.context,
+                      get_boundary_data<2>(s.get_mesh().get_structure()),
+                      false)}
+            , boundary_3_{load_or_placeholder(
+                      cc.context,
+                      get_boundary_data<3>(s.get_mesh().get_structure()),
+                      false)}
+            , error_flag_{cc.context, CL_MEM_READ_WRITE, sizeof(cl_int)}
+            , edge_staging_{make_layer_buffer(cc.context),
+                            make_layer_buffer(cc.context)}
+            , halo_staging_{make_layer_buffer(cc.context),
+                            make_layer_buffer(cc.context)}
+            , edge_{cc.context, s.get_edge_partition()}
+            , interior_{cc.context, s.get_interior_partition()} {}
+
+    /// The ends of the slab, for indexing staging buffers.
+    enum side { below, above };
+
+    /// Updates the edges, and copies the given edge layers to the staging
+    /// buffers for their sides.
+    /// Returns an event which completes once the copies are done.
+    cl::Event update_edges(
+            const std::array<std::optional<int>, 2>& edge_layers) {
+        core::write_value(compute_queue_, error_flag_, 0, id_success);
+        update(edge_);
+        for (auto i : {below, above}) {
+            if (edge_layers[i]) {
+                const auto block = compute_layer_block(
+                        descriptor_, axis_, *edge_layers[i], 1);
+                copy_block(compute_queue_,
+                           previous_,
+                           block,
+                           edge_staging_[i],
+                           compute_packed_block(block));
+            }
+        }
+        cl::Event ret;
+        compute_queue_.enqueueMarkerWithWaitList(nullptr, &ret);
+        compute_queue_.flush();
+        return ret;
+    }
+
+    void update_interior() {
+        update(interior_);
+        compute_queue_.flush();
+    }
+
+    void read_edge(side which,
+                   util::aligned::vector<cl_float>& out,
+                   const cl::Event& after) {
+        out.resize(layer_size());
+        const std::vector<cl::Event> wait{after};
+        transfer_queue_.enqueueReadBuffer(edge_staging_[which],
+                                          CL_FALSE,
+                                          0,
+                                          out.size() * sizeof(cl_float),
+                                          out.data(),
+                                          &wait);
+        transfer_queue_.flush();
+    }
+
+    /// Uploads a halo layer on the transfer queue, then copies it into place
+    /// on the compute queue, once the interior kernels have finished.
+    void write_halo(side which,
+                    int layer,
+                    const util::aligned::vector<cl_float>& in) {
+        cl::Event uploaded;
+        transfer_queue_.enqueueWriteBuffer(halo_staging_[which],
+                                           CL_FALSE,
+                                           0,
+                                           in.size() * sizeof(cl_float),
+                                           in.data(),
+                                           nullptr,
+                                           &uploaded);
+        transfer_queue_.flush();
+
+        const auto block = compute_layer_block(descriptor_, axis_, layer, 1);
+        const std::vector<cl::Event> wait{uploaded};
+        copy_block(compute_queue_,
+                   halo_staging_[which],
+                   compute_packed_block(block),
+                   previous_,
+                   block,
+                   &wait);
+        compute_queue_.flush();
+    }
+
+    /// Copy the owned layers of the current state into a buffer laid out
+    /// like the original mesh.
+    void read_owned(const slab& s,
+                    const mesh_descriptor& global,
+                    util::aligned::vector<cl_float>& out) {
+        const auto layers = s.get_end() - s.get_begin();
+        const auto local = compute_layer_block(
+                descriptor_, axis_, s.to_local_layer(s.get_begin()), layers);
+        const auto host =
+                compute_layer_block(global, axis_, s.get_begin(), layers);
+        compute_queue_.enqueueReadBufferRect(current_,
+                                             CL_TRUE,
+                                             local.origin,
+                                             host.origin,
+                                             local.region,
+                                             local.row_pitch,
+                                             local.slice_pitch,
+                                             host.row_pitch,
+                                             host.slice_pitch,
+                                             out.data());
+    }
+
+    void finish_transfers() { transfer_queue_.finish(); }
+
+    void finish() {
+        compute_queue_.finish();
+        transfer_queue_.finish();
+        throw_if_error(
+                core::read_value<error_code>(compute_queue_, error_flag_, 0));
+    }
+
+    void swap() { std::swap(previous_, current_); }
+
+    cl_float read_value(size_t index) {
+        return core::read_value<cl_float>(compute_queue_, current_, index);
+    }
+
+    void write_value(size_t index, cl_float value) {
+        core::write_value(compute_queue_, current_, index, value);
+    }
+
+private:
+    size_t layer_size() const {
+        return compute_block_size(
+                compute_layer_block(descriptor_, axis_, 0, 1));
+    }
+
+    cl::Buffer make_layer_buffer(const cl::Context& context) const {
+        return cl::Buffer{
+                context, CL_MEM_READ_WRITE, layer_size() * sizeof(cl_float)};
+    }
+
+    cl::Buffer make_zeroed_buffer(const cl::Context& context) const {
+        return core::load_to_buffer(
+                context,
+                util::aligned::vector<cl_float>(
+                        compute_num_nodes(descriptor_), 0),
+                false);
+    }
+
+    template <typename Kernel>
+    void run_node_kernel(Kernel& kernel, const index_list& indices) {
+        if (indices.size) {
+            kernel(compute_queue_,
+                   indices.size,
+                   previous_,
+                   current_,
+                   descriptor_.dimensions,
+                   indices.buffer,
+                   static_cast<cl_uint>(indices.size),
+                   error_flag_);
+        }
+    }
+
+    template <typename Kernel>
+    void run_boundary_kernel(Kernel& kernel,
+                             const index_list& indices,
+                             const cl::Buffer& boundary) {
+        if (indices.size) {
+            kernel(compute_queue_,
+                   indices.size,
+                   previous_,
+                   current_,
+                   nodes_,
+                   descriptor_.dimensions,
+                   indices.buffer,
+                   static_cast<cl_uint>(indices.size),
+                   boundary,
+                   coefficients_,
+                   filter_orders_,
+                   error_flag_);
+        }
+    }
+
+    void update(const partition_buffers& p) {
+        run_node_kernel(inside_kernel_, p.inside);
+        run_node_kernel(clipped_kernel_, p.clipped);
+        run_boundary_kernel(boundary_kernel_1_, p.boundary_1, boundary_1_);
+        run_boundary_kernel(boundary_kernel_2_, p.boundary_2, boundary_2_);
+        run_boundary_kernel(boundary_kernel_3_, p.boundary_3, boundary_3_);
+    }
+
+    mesh_descriptor descriptor_;
+    size_t axis_;
+    scheme scheme_;
+
+    program program_;
+    cl::CommandQueue compute_queue_;
+    cl::CommandQueue transfer_queue_;
+
+    cl::Buffer previous_;
+    cl::Buffer current_;
+    cl::Buffer nodes_;
+    cl::Buffer coefficients_;
+    cl::Buffer filter_orders_;
+    cl::Buffer boundary_1_;
+    cl::Buffer boundary_2_;
+    cl::Buffer boundary_3_;
+    cl::Buffer error_flag_;
+
+    /// One layer each, indexed by side.
+    std::array<cl::Buffer, 2> edge_staging_;
+    std::array<cl::Buffer, 2> halo_staging_;
+
+    partition_buffers edge_;
+    partition_buffers interior_;
+
+    decltype(program_.get_inside_kernel()) inside_kernel_{
+            program_.get_inside_kernel(scheme_)};
+    decltype(program_.get_clipped_kernel()) clipped_kernel_{
+            program_.get_clipped_kernel(scheme_)};
+    decltype(program_.get_boundary_kernel<1>()) boundary_kernel_1_{
+            program_.get_boundary_kernel<1>(scheme_)};
+    decltype(program_.get_boundary_kernel<2>()) boundary_kernel_2_{
+            program_.get_boundary_kernel<2>(scheme_)};
+    decltype(program_.get_boundary_kernel<3>()) boundary_kernel_3_{
+            program_.get_boundary_kernel<3>(scheme_)};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+slab_set::slab_set(
+        const util::aligned::vector<core::compute_context>& contexts,
+        const mesh& mesh)
+        : descriptor_{mesh.get_descriptor()}
+        , slabs_{decompose(mesh, contexts.size())} {
+    if (contexts.empty()) {
+        throw std::runtime_error{
+                "Distributed waveguide requires at least one context."};
+    }
+
+    //  Halo transfers copy rectangular regions of x-major buffers.
+    if (descriptor_.brick_size) {
+        throw std::runtime_error{
+                "Distributed waveguide requires the linear node layout."};
+    }
+
+    runners_.reserve(slabs_.size());
+    for (auto i = 0u; i != slabs_.size(); ++i) {
+        runners_.emplace_back(
+                std::make_unique<slab_runner>(contexts[i], slabs_[i]));
+    }
+
+    staging_below_.resize(slabs_.size());
+    staging_above_.resize(slabs_.size());
+}
+
+slab_set::~slab_set() noexcept = default;
+
+size_t slab_set::get_num_slabs() const { return slabs_.size(); }
+
+void slab_set::update() {
+    const auto num_slabs = slabs_.size();
+
+    //  Update edge layers first, and start copying them back as soon as they
+    //  are ready.
+    for (auto i = 0u; i != num_slabs; ++i) {
+        const auto& s = slabs_[i];
+        std::array<std::optional<int>, 2> edge_layers;
+        if (s.has_halo_below()) {
+            edge_layers[slab_runner::below] = s.to_local_layer(s.get_begin());
+        }
+        if (s.has_halo_above()) {
+            edge_layers[slab_runner::above] =
+                    s.to_local_layer(s.get_end() - 1);
+        }
+        const auto edges_done = runners_[i]->update_edges(edge_layers);
+        if (s.has_halo_below()) {
+            runners_[i]->read_edge(
+                    slab_runner::below, staging_below_[i], edges_done);
+        }
+        if (s.has_halo_above()) {
+            runners_[i]->read_edge(
+                    slab_runner::above, staging_above_[i], edges_done);
+        }
+    }
+
+    //  The interiors don't depend on the halos, so they can be computed while
+    //  the edges are in transit.
+    for (auto& i : runners_) {
+        i->update_interior();
+    }
+
+    for (auto& i : runners_) {
+        i->finish_transfers();
+    }
+
+    //  Pass each edge to the halo of the neighbouring slab.
+    for (auto i = 0u; i != num_slabs; ++i) {
+        const auto& s = slabs_[i];
+        if (s.has_halo_below()) {
+            runners_[i]->write_halo(slab_runner::below,
+                                    s.to_local_layer(s.get_begin() - 1),
+                                    staging_above_[i - 1]);
+        }
+        if (s.has_halo_above()) {
+            runners_[i]->write_halo(slab_runner::above,
+                                    s.to_local_layer(s.get_end()),
+                                    staging_below_[i + 1]);
+        }
+    }
+
+    for (auto& i : runners_) {
+        i->finish();
+    }
+}
+
+void slab_set::swap() {
+    for (auto& i : runners_) {
+        i->swap();
+    }
+}
+
+const slab& slab_set::find_owner(size_t node) const {
+    const auto it =
+            std::find_if(begin(slabs_), end(slabs_), [&](const auto& i) {
+                return i.owns(node);
+            });
+    if (it == end(slabs_)) {
+        throw std::out_of_range{"Node index is outside the mesh."};
+    }
+    return *it;
+}
+
+cl_float slab_set::read_value(size_t node) {
+    const auto& owner = find_owner(node);
+    const auto index = &owner - slabs_.data();
+    return runners_[index]->read_value(owner.to_local_index(node));
+}
+
+void slab_set::write_value(size_t node, cl_float value) {
+    find_owner(node);
+    for (auto i = 0u; i != slabs_.size(); ++i) {
+        if (slabs_[i].contains(node)) {
+            runners_[i]->write_value(slabs_[i].to_local_index(node), value);
+        }
+    }
+}
+
+util::aligned::vector<cl_float> slab_set::read_all() {
+    util::aligned::vector<cl_float> ret(compute_num_nodes(descriptor_));
+    for (auto i = 0u; i != slabs_.size(); ++i) {
+        runners_[i]->read_owned(slabs_[i], descriptor_, ret);
+    }
+    return ret;
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -1,3 +1,5 @@
+#include "waveguide/make_transparent.h"
+
 #include "core/sinc.h"
 
 #include "frequency_domain/convolver.h"
@@ -7,12 +9,19 @@
 namespace wayverb {
 namespace waveguide {
 
-std::vector<float> make_transparent(const float* begin, const float* end) {
-    //  window ir
-    const auto input_size = std::distance(begin, end);
+namespace {
 
-    auto windowed = core::right_hanning(mesh_impulse_response.size());
-    core::elementwise_multiply(windowed, mesh_impulse_response);
+auto window_compensation_signal(const float* begin, const float* end) {
+    util::aligned::vector<float> ret(begin, end);
+    core::elementwise_multiply(ret, core::right_hanning(ret.size()));
+    return ret;
+}
+
+std::vector<float> subtract_convolved(
+        const float* begin,
+        const float* end,
+        const util::aligned::vector<float>& windowed) {
+    const auto input_size = std::distance(begin, end);
 
     //  create convolver
     frequency_domain::convolver convolver{input_size + windowed.size() - 1};
@@ -29,5 +38,25 @@ std::vector<float> make_transparent(const float* begin, const float* end) {
     return convolved;
 }
 
+}  // namespace
+
+std::vector<float> make_transparent(const float* begin, const float* end) {
+    //  The built-in signal never changes, so it's only windowed once.
+    static const auto windowed = window_compensation_signal(
+            mesh_impulse_response.data(),
+            mesh_impulse_response.data() + mesh_impulse_response.size());
+    return subtract_convolved(begin, end, windowed);
+}
+
+std::vector<float> make_transparent(const float* begin,
+                                    const float* end,
+                                    const float* compensation_begin,
+                                    const float* compensation_end) {
+    return subtract_convolved(
+            begin,
+            end,
+            window_compensation_signal(compensation_begin, compensation_end));
+}
+
 }  // namespace waveguide
 }  // namespace wayverb
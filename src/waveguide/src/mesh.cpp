@@ -4,6 +4,7 @@
 #include "waveguide/fitted_boundary.h"
 #include "waveguide/mesh_setup_program.h"
 #include "waveguide/program.h"
+#include "waveguide/reflectance_filter_cache.h"
 
 #include "core/conversions.h"
 #include "core/scene_data_loader.h"
@@ -17,12 +18,21 @@
 namespace wayverb {
 namespace waveguide {
 
-mesh::mesh(mesh_descriptor descriptor, vectors vectors)
+mesh::mesh(mesh_descriptor descriptor,
+           vectors vectors,
+           waveguide::scheme scheme)
         : descriptor_(std::move(descriptor))
-        , vectors_(std::move(vectors)) {}
+        , vectors_(std::move(vectors))
+        , node_partition_(compute_node_partition(
+                  descriptor_, vectors_.get_condensed_nodes()))
+        , scheme_(scheme) {}
 
 const mesh_descriptor& mesh::get_descriptor() const { return descriptor_; }
 const vectors& mesh::get_structure() const { return vectors_; }
+const node_partition& mesh::get_node_partition() const {
+    return node_partition_;
+}
+waveguide::scheme mesh::get_scheme() const { return scheme_; }
 
 bool is_inside(const mesh& m, size_t node_index) {
     return is_inside(m.get_structure().get_condensed_nodes()[node_index]);
@@ -56,8 +66,12 @@ mesh compute_mesh(
                                          core::surface<core::simulation_bands>>&
                 voxelised,
         float mesh_spacing,
-        float speed_of_sound) {
-    const auto program = setup_program{cc};
+        float speed_of_sound,
+        node_classifier classifier,
+        scheme s,
+        cl_int brick_size,
+        reflectance_filter_cache_statistics* filter_statistics) {
+    const auto program = setup_program{cc, brick_size};
     auto queue = cl::CommandQueue{cc.context, cc.device};
 
     const auto buffers = make_scene_buffers(cc.context, voxelised);
@@ -67,31 +81,72 @@ mesh compute_mesh(
         const auto dim = glm::ivec3{dimensions(aabb) / mesh_spacing};
         return mesh_descriptor{core::to_cl_float3{}(aabb.get_min()),
                                core::to_cl_int3{}(dim),
-                               mesh_spacing};
+                               mesh_spacing,
+                               brick_size};
     }();
 
-    auto nodes = [&] {
-        const auto num_nodes = compute_num_nodes(desc);
-
-        cl::Buffer node_buffer{cc.context,
-                               CL_MEM_READ_WRITE,
-                               num_nodes * sizeof(condensed_node)};
+    const auto num_nodes = compute_num_nodes(desc);
 
-        const auto enqueue = [&] {
-            return cl::EnqueueArgs(queue, cl::NDRange(num_nodes));
-        };
+    cl::Buffer node_buffer{
+            cc.context, CL_MEM_READ_WRITE, num_nodes * sizeof(condensed_node)};
 
+    {
         //  find whether each node is inside or outside the model
-        {
-            auto kernel = program.get_node_inside_kernel();
-            kernel(enqueue(),
-                   node_buffer,
-                   desc,
-                   buffers.get_voxel_index_buffer(),
-                   buffers.get_global_aabb(),
-                   buffers.get_side(),
-                   buffers.get_triangles_buffer(),
-                   buffers.get_vertices_buffer());
+        switch (classifier) {
+            case node_classifier::per_node: {
+                auto kernel = program.get_node_inside_kernel();
+                kernel(queue,
+                       num_nodes,
+                       node_buffer,
+                       desc,
+                       buffers.get_voxel_index_buffer(),
+                       buffers.get_global_aabb(),
+                       buffers.get_side(),
+                       buffers.get_triangles_buffer(),
+                       buffers.get_vertices_buffer(),
+                       num_nodes);
+                break;
+            }
+
+            case node_classifier::scanline: {
+                //  one vote per node, per axis
+                cl::Buffer votes_buffer{
+                        cc.context, CL_MEM_READ_WRITE, 3 * num_nodes};
+
+                const auto& dim = desc.dimensions.s;
+                const size_t rows_per_axis[] = {size_t(dim[1] * dim[2]),
+                                                size_t(dim[0] * dim[2]),
+                                                size_t(dim[0] * dim[1])};
+
+                auto classify = program.get_classify_rows_kernel();
+                for (cl_uint axis = 0; axis != 3; ++axis) {
+                    classify(queue,
+                             rows_per_axis[axis],
+                             votes_buffer,
+                             desc,
+                             axis,
+                             buffers.get_voxel_index_buffer(),
+                             buffers.get_global_aabb(),
+                             buffers.get_side(),
+                             buffers.get_triangles_buffer(),
+                             buffers.get_vertices_buffer(),
+                             static_cast<cl_uint>(rows_per_axis[axis]));
+                }
+
+                auto combine = program.get_node_inside_from_votes_kernel();
+                combine(queue,
+                        num_nodes,
+                        node_buffer,
+                        desc,
+                        votes_buffer,
+                        buffers.get_voxel_index_buffer(),
+                        buffers.get_global_aabb(),
+                        buffers.get_side(),
+                        buffers.get_triangles_buffer(),
+                        buffers.get_vertices_buffer(),
+                        num_nodes);
+                break;
+            }
         }
 
 #ifndef NDEBUG
@@ -111,42 +166,44 @@ mesh compute_mesh(
         //  find node boundary type
         {
             auto kernel = program.get_node_boundary_kernel();
-            kernel(enqueue(), node_buffer, desc);
+            kernel(queue, num_nodes, node_buffer, desc, num_nodes);
         }
+    }
 
-        return core::read_from_buffer<condensed_node>(queue, node_buffer);
-    }();
+    //  Assign boundary indices and find boundary surfaces on the device.
+    //  The nodes only come back to the host once they're finished.
+    auto boundary_data = compute_boundary_index_data(
+            cc.device, queue, buffers, desc, node_buffer, num_nodes);
 
-    //  IMPORTANT
-    //  compute_boundary_index_data mutates the nodes array, so it must
-    //  be run before condensing the nodes.
-    auto boundary_data =
-            compute_boundary_index_data(cc.device, buffers, desc, nodes);
+    const auto& surfaces = voxelised.get_scene_data().get_surfaces();
+    const auto reflectance = get_reflectance_filter_cache().get(
+            util::map_to_vector(begin(surfaces),
+                                end(surfaces),
+                                [](const auto& i) { return i.absorption; }),
+            1 / config::time_step(speed_of_sound, mesh_spacing, s),
+            filter_statistics);
 
     auto v = vectors{
-            std::move(nodes),
+            core::read_from_buffer<condensed_node>(queue, node_buffer),
             util::map_to_vector(
-                    begin(voxelised.get_scene_data().get_surfaces()),
-                    end(voxelised.get_scene_data().get_surfaces()),
-                    [&](const auto& surface) {
-                        return to_impedance_coefficients(
-                                compute_reflectance_filter_coefficients(
-                                        surface.absorption.s,
-                                        1 / config::time_step(speed_of_sound,
-                                                              mesh_spacing)));
-                    }),
+                    begin(reflectance),
+                    end(reflectance),
+                    [](const auto& i) { return to_impedance_coefficients(i); }),
             std::move(boundary_data)};
 
-    return {desc, std::move(v)};
+    return {desc, std::move(v), s};
 }
 
 voxels_and_mesh compute_voxels_and_mesh(const core::compute_context& cc,
                                         const core::gpu_scene_data& scene,
                                         const glm::vec3& anchor,
                                         double sample_rate,
-                                        double speed_of_sound) {
+                                        double speed_of_sound,
+                                        node_classifier classifier,
+                                        scheme s,
+                                        cl_int brick_size) {
     const auto mesh_spacing =
-            config::grid_spacing(speed_of_sound, 1 / sample_rate);
+            config::grid_spacing(speed_of_sound, 1 / sample_rate, s);
     auto voxelised = make_voxelised_scene_data(
             scene,
             5,
@@ -154,8 +211,16 @@ voxels_and_mesh compute_voxels_and_mesh(const core::compute_context& cc,
                     core::geo::compute_aabb(scene.get_vertices()),
                     anchor,
                     mesh_spacing));
-    auto mesh = compute_mesh(cc, voxelised, mesh_spacing, speed_of_sound);
-    return {std::move(voxelised), std::move(mesh)};
+    reflectance_filter_cache_statistics filter_statistics;
+    auto mesh = compute_mesh(cc,
+                             voxelised,
+                             mesh_spacing,
+                             speed_of_sound,
+                             classifier,
+                             s,
+                             brick_size,
+                             &filter_statistics);
+    return {std::move(voxelised), std::move(mesh), filter_statistics};
 }
 
 }  // namespace waveguide
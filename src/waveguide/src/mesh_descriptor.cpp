@@ -4,9 +4,68 @@
 namespace wayverb {
 namespace waveguide {
 
+namespace {
+
+size_t linear_index(const glm::ivec3& locator, const glm::ivec3& dim) {
+    return locator.x + locator.y * dim.x + locator.z * dim.x * dim.y;
+}
+
+glm::ivec3 linear_locator(size_t index, const glm::ivec3& dim) {
+    const auto x = div(index, dim.x);
+    const auto y = div(x.quot, dim.y);
+    return glm::ivec3{x.rem, y.rem, y.quot % dim.z};
+}
+
+}  // namespace
+
+size_t compute_index(const glm::ivec3& locator,
+                     const glm::ivec3& dim,
+                     cl_int brick_size) {
+    if (!brick_size) {
+        return linear_index(locator, dim);
+    }
+
+    const auto begin = locator / brick_size * brick_size;
+    const auto extent = glm::min(glm::ivec3{brick_size}, dim - begin);
+
+    //  Every layer of bricks before this one is full height, every row of
+    //  bricks before this one in the layer is full depth, and so on.
+    return size_t(begin.z) * dim.x * dim.y +
+           size_t(begin.y) * dim.x * extent.z +
+           size_t(begin.x) * extent.y * extent.z +
+           linear_index(locator - begin, extent);
+}
+
+glm::ivec3 compute_locator(size_t index,
+                           const glm::ivec3& dim,
+                           cl_int brick_size) {
+    if (!brick_size) {
+        return linear_locator(index, dim);
+    }
+
+    glm::ivec3 begin{0};
+    glm::ivec3 extent{0};
+
+    const auto layer_size = size_t(brick_size) * dim.x * dim.y;
+    begin.z = index / layer_size * brick_size;
+    extent.z = std::min(brick_size, dim.z - begin.z);
+    index -= size_t(begin.z) * dim.x * dim.y;
+
+    const auto row_size = size_t(brick_size) * dim.x * extent.z;
+    begin.y = index / row_size * brick_size;
+    extent.y = std::min(brick_size, dim.y - begin.y);
+    index -= size_t(begin.y) * dim.x * extent.z;
+
+    const auto brick_volume = size_t(brick_size) * extent.y * extent.z;
+    begin.x = index / brick_volume * brick_size;
+    extent.x = std::min(brick_size, dim.x - begin.x);
+    index -= size_t(begin.x) * extent.y * extent.z;
+
+    return begin + linear_locator(index, extent);
+}
+
 size_t compute_index(const mesh_descriptor& d, const glm::ivec3& pos) {
-    return pos.x + pos.y * d.dimensions.s[0] +
-           pos.z * d.dimensions.s[0] * d.dimensions.s[1];
+    return compute_index(pos, core::to_ivec3{}(d.dimensions), d.brick_size);
 }
 
 size_t compute_index(const mesh_descriptor& d, const glm::vec3& pos) {
@@ -14,9 +73,8 @@ size_t compute_index(const mesh_descriptor& d, const glm::vec3& pos) {
 }
 
 glm::ivec3 compute_locator(const mesh_descriptor& d, size_t index) {
-    const auto x = div(index, d.dimensions.s[0]);
-    const auto y = div(x.quot, d.dimensions.s[1]);
-    return glm::ivec3{x.rem, y.rem, y.quot % d.dimensions.s[2]};
+    return compute_locator(
+            index, core::to_ivec3{}(d.dimensions), d.brick_size);
 }
 
 glm::ivec3 compute_locator(const mesh_descriptor& d, const glm::vec3& v) {
@@ -69,8 +127,10 @@ core::geo::box compute_aabb(const mesh_descriptor& d) {
             core::to_vec3{}(d.min_corner + d.dimensions * d.spacing)};
 }
 
-double compute_sample_rate(const mesh_descriptor& d, double speed_of_sound) {
-    return 1 / waveguide::config::time_step(speed_of_sound, d.spacing);
+double compute_sample_rate(const mesh_descriptor& d,
+                           double speed_of_sound,
+                           scheme s) {
+    return 1 / waveguide::config::time_step(speed_of_sound, d.spacing, s);
 }
 
 size_t compute_num_nodes(const mesh_descriptor& d) {
@@ -115,9 +115,14 @@ kernel void set_node_inside(global condensed_node* nodes,
                             uint side,
 
                             const global triangle* triangles,  //  scene
-                            const global float3* vertices) {
+                            const global float3* vertices,
+
+                            ulong num_nodes) {
     //  find this thread index
     const size_t thread = get_global_id(0);
+    if (thread >= num_nodes) {
+        return;
+    }
 
     //  zero out the return struct
     nodes[thread] = (condensed_node){};  //  zero it out to begin with
@@ -139,9 +144,182 @@ kernel void set_node_inside(global condensed_node* nodes,
     }
 }
 
+//  Scanline classification  ///////////////////////////////////////////////////
+
+#define MAX_ROW_CROSSINGS (64)
+#define VOTE_OUTSIDE (0)
+#define VOTE_INSIDE (1)
+#define VOTE_UNKNOWN (2)
+
+//  Like count_intersections, but records the distance to each crossing.
+//  Returns the number of crossings, or ~(uint)(0) if any crossing is
+//  degenerate, or if there are too many crossings to store.
+uint find_crossings(ray r,
+                    const global uint* voxel_index,
+                    aabb global_aabb,
+                    uint side,
+                    const global triangle* triangles,
+                    const global float3* vertices,
+                    float* crossings);
+uint find_crossings(ray r,
+                    const global uint* voxel_index,
+                    aabb global_aabb,
+                    uint side,
+                    const global triangle* triangles,
+                    const global float3* vertices,
+                    float* crossings) {
+    uint count = 0;
+
+    VOXEL_TRAVERSAL_ALGORITHM(for (uint i = 0; i != num_triangles; ++i) {
+        const uint tri_ind = voxel_begin[i];
+        const triangle tri = triangles[tri_ind];
+        const triangle_inter inter = triangle_intersection(tri, vertices, r);
+        if (inter.t) {
+            if (is_degenerate(inter)) {
+                return ~(uint)(0);
+            }
+            if (prev_max < inter.t && inter.t <= max_dist_inside_voxel) {
+                if (count == MAX_ROW_CROSSINGS) {
+                    return ~(uint)(0);
+                }
+                crossings[count++] = inter.t;
+            }
+        }
+    })
+
+    return count;
+}
+
+//  Classify a whole row of nodes along one axis using a single ray, fired
+//  from the first node in the row.
+//  A node is inside if an odd number of crossings lie beyond it.
+//  Writes one vote per node: inside, outside, or unknown if the ray was
+//  degenerate or if the node is very close to a crossing.
+kernel void classify_rows(global char* votes,
+                          const mesh_descriptor descriptor,
+                          uint axis,
+
+                          const global uint* voxel_index,  //  voxel
+                          aabb global_aabb,
+                          uint side,
+
+                          const global triangle* triangles,  //  scene
+                          const global float3* vertices,
+
+                          uint num_rows) {
+    const size_t thread = get_global_id(0);
+    if (thread >= num_rows) {
+        return;
+    }
+
+    const int3 dim = descriptor.dimensions;
+
+    int3 first;
+    int3 step;
+    int row_length;
+    switch (axis) {
+        case 0:
+            first = (int3)(0, thread % dim.y, thread / dim.y);
+            step = (int3)(1, 0, 0);
+            row_length = dim.x;
+            break;
+        case 1:
+            first = (int3)(thread % dim.x, 0, thread / dim.x);
+            step = (int3)(0, 1, 0);
+            row_length = dim.y;
+            break;
+        default:
+            first = (int3)(thread % dim.x, thread / dim.x, 0);
+            step = (int3)(0, 0, 1);
+            row_length = dim.z;
+            break;
+    }
+
+    const size_t num_nodes = dim.x * dim.y * dim.z;
+    global char* axis_votes = votes + axis * num_nodes;
+
+    const ray r = {compute_node_position(descriptor, first),
+                   convert_float3(step)};
+    float crossings[MAX_ROW_CROSSINGS];
+    const uint num_crossings = find_crossings(
+            r, voxel_index, global_aabb, side, triangles, vertices, crossings);
+
+    const float epsilon = descriptor.spacing * 0.01f;
+
+    for (int i = 0; i != row_length; ++i) {
+        const size_t index = to_index(first + step * i, dim);
+
+        //  The first node sits on the ray origin, where crossings can't be
+        //  detected reliably.
+        if (num_crossings == ~(uint)(0) || i == 0) {
+            axis_votes[index] = VOTE_UNKNOWN;
+            continue;
+        }
+
+        const float t = i * descriptor.spacing;
+        uint beyond = 0;
+        bool ambiguous = false;
+        for (uint j = 0; j != num_crossings; ++j) {
+            ambiguous = ambiguous || fabs(crossings[j] - t) < epsilon;
+            beyond += t < crossings[j];
+        }
+
+        axis_votes[index] = ambiguous ? VOTE_UNKNOWN
+                                      : beyond % 2 ? VOTE_INSIDE
+                                                   : VOTE_OUTSIDE;
+    }
+}
+
+//  Combine the votes from each axis.
+//  If the axes disagree, or none of them could classify the node, falls back
+//  to the per-node test used by set_node_inside.
+kernel void set_node_inside_from_votes(global condensed_node* nodes,
+                                       const mesh_descriptor descriptor,
+                                       const global char* votes,
+
+                                       const global uint* voxel_index,
+                                       aabb global_aabb,
+                                       uint side,
+
+                                       const global triangle* triangles,
+                                       const global float3* vertices,
+
+                                       ulong num_nodes) {
+    const size_t thread = get_global_id(0);
+    if (thread >= num_nodes) {
+        return;
+    }
+
+    nodes[thread] = (condensed_node){};
+
+    uint inside = 0;
+    uint outside = 0;
+    for (uint axis = 0; axis != 3; ++axis) {
+        const char vote = votes[axis * num_nodes + thread];
+        inside += vote == VOTE_INSIDE;
+        outside += vote == VOTE_OUTSIDE;
+    }
+
+    bool is_inside = inside != 0;
+    if ((inside != 0) == (outside != 0)) {
+        const int3 locator = to_locator(thread, descriptor.dimensions);
+        const float3 position = compute_node_position(descriptor, locator);
+        is_inside = voxel_inside(
+                position, voxel_index, global_aabb, side, triangles, vertices);
+    }
+
+    if (is_inside) {
+        nodes[thread].boundary_type = id_inside;
+    }
+}
+
 kernel void set_node_boundary_type(global condensed_node* nodes,
-                                   const mesh_descriptor descriptor) {
+                                   const mesh_descriptor descriptor,
+                                   ulong num_nodes) {
     const size_t thread = get_global_id(0);
+    if (thread >= num_nodes) {
+        return;
+    }
 
     //  if the node is inside
     if (nodes[thread].boundary_type & id_inside) {
@@ -150,8 +328,6 @@ kernel void set_node_boundary_type(global condensed_node* nodes,
 
     //  if we got here, the node is outside
 
-    const size_t num_nodes = get_global_size(0);
-
     const direction_array_data data[] = {
             (direction_array_data){directions_1d, num_directions_1d},
             (direction_array_data){directions_2d, num_directions_2d},
@@ -173,7 +349,8 @@ kernel void set_node_boundary_type(global condensed_node* nodes,
 
 )";
 
-setup_program::setup_program(const core::compute_context& cc)
+setup_program::setup_program(const core::compute_context& cc,
+                             cl_int brick_size)
         : wrapper_{cc,
                    std::vector<std::string>{
                            core::cl_representation_v<core::bands_type>,
@@ -190,6 +367,7 @@ setup_program::setup_program(const core::compute_context& cc)
                            core::cl_representation_v<mesh_descriptor>,
                            core::cl_sources::geometry,
                            core::cl_sources::voxel,
+                           cl_sources::node_layout(brick_size),
                            cl_sources::utils,
                            source}} {}
 
@@ -0,0 +1,45 @@
+#include "waveguide/node_partition.h"
+#include "waveguide/boundary_coefficient_finder.h"
+
+#include "core/conversions.h"
+
+namespace wayverb {
+namespace waveguide {
+
+namespace {
+
+bool is_on_outer_face(const mesh_descriptor& descriptor, size_t index) {
+    const auto locator = compute_locator(descriptor, index);
+    const auto dim = core::to_ivec3{}(descriptor.dimensions);
+    return glm::any(glm::equal(locator, glm::ivec3{0})) ||
+           glm::any(glm::equal(locator, dim - 1));
+}
+
+}  // namespace
+
+node_partition compute_node_partition(
+        const mesh_descriptor& descriptor,
+        const util::aligned::vector<condensed_node>& nodes) {
+    node_partition ret{};
+
+    //  Indices are pushed in ascending order, so each class is visited in
+    //  memory order by its kernel.
+    for (auto i = 0u; i != nodes.size(); ++i) {
+        const auto bt = nodes[i].boundary_type;
+        if (bt == id_inside || bt == id_reentrant) {
+            (is_on_outer_face(descriptor, i) ? ret.clipped : ret.inside)
+                    .emplace_back(i);
+        } else if (is_boundary<1>(bt)) {
+            ret.boundary_1.emplace_back(i);
+        } else if (is_boundary<2>(bt)) {
+            ret.boundary_2.emplace_back(i);
+        } else if (is_boundary<3>(bt)) {
+            ret.boundary_3.emplace_back(i);
+        }
+    }
+
+    return ret;
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -1,4 +1,5 @@
 #include "waveguide/postprocessor/directional_receiver.h"
+#include "waveguide/distributed.h"
 #include "waveguide/mesh_descriptor.h"
 
 #include "core/cl/common.h"
@@ -27,10 +28,29 @@ directional_receiver::directional_receiver(
 }
 
 directional_receiver::return_type directional_receiver::operator()(
-        cl::CommandQueue& queue, const cl::Buffer& buffer, size_t /*unused*/) {
+        cl::CommandQueue& queue,
+        const pressure_buffer& buffer,
+        size_t /*unused*/) {
+    return process(
+            [&](auto node) { return read_pressure(queue, buffer, node); });
+}
+
+directional_receiver::return_type directional_receiver::operator()(
+        slab_set& slabs, size_t /*unused*/) {
+    return process([&](auto node) { return slabs.read_value(node); });
+}
+
+directional_receiver::return_type directional_receiver::operator()(
+        const std::function<float(size_t)>& read_pressure,
+        size_t /*unused*/) {
+    return process(read_pressure);
+}
+
+template <typename Read>
+directional_receiver::return_type directional_receiver::process(
+        Read&& read_pressure) {
     //  copy out node pressure
-    const auto pressure =
-            core::read_value<cl_float>(queue, buffer, output_node_);
+    const auto pressure = read_pressure(output_node_);
 
     //  copy out surrounding pressures
 
@@ -40,10 +60,9 @@ directional_receiver::return_type directional_receiver::operator()(
     constexpr auto num_surrounding = 6;
     std::array<cl_float, num_surrounding> surrounding;
     for (auto i = 0ul; i != num_surrounding; ++i) {
-        surrounding[i] = (core::read_value<cl_float>(
-                                  queue, buffer, surrounding_nodes_[i]) -
-                          pressure) /
-                         mesh_spacing_;
+        surrounding[i] =
+                (read_pressure(surrounding_nodes_[i]) - pressure) /
+                mesh_spacing_;
     }
 
     //  The approximation of the pressure gradient is obtained by
@@ -70,6 +89,12 @@ directional_receiver::return_type directional_receiver::operator()(
 
 size_t directional_receiver::get_output_node() const { return output_node_; }
 
+glm::dvec3 directional_receiver::get_velocity() const { return velocity_; }
+
+void directional_receiver::set_velocity(const glm::dvec3& velocity) {
+    velocity_ = velocity;
+}
+
 }  // namespace postprocessor
 }  // namespace waveguide
 }  // namespace wayverb
@@ -1,4 +1,5 @@
 #include "waveguide/postprocessor/node.h"
+#include "waveguide/distributed.h"
 
 #include "core/cl/common.h"
 
@@ -12,9 +13,13 @@ node::node(size_t output_node)
         : output_node_{output_node} {}
 
 node::return_type node::operator()(cl::CommandQueue& queue,
-                                   const cl::Buffer& buffer,
+                                   const pressure_buffer& buffer,
                                    size_t step) const {
-    return core::read_value<cl_float>(queue, buffer, output_node_);
+    return read_pressure(queue, buffer, output_node_);
+}
+
+node::return_type node::operator()(slab_set& slabs, size_t /*unused*/) const {
+    return slabs.read_value(output_node_);
 }
 
 size_t node::get_output_node() const { return output_node_; }
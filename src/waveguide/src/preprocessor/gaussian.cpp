@@ -24,7 +24,7 @@ gaussian::gaussian(const mesh_descriptor& descriptor,
         , steps_{steps} {}
 
 bool gaussian::operator()(cl::CommandQueue& queue,
-                          cl::Buffer& buffer,
+                          const pressure_buffer& buffer,
                           size_t step) const {
     if (step == steps_) {
         return false;
@@ -34,7 +34,7 @@ bool gaussian::operator()(cl::CommandQueue& queue,
         //  set all the mesh values
 
         //  first on the CPU
-        const auto nodes = core::items_in_buffer<cl_float>(buffer);
+        const auto nodes = buffer.size();
         util::aligned::vector<cl_float> pressures;
         pressures.reserve(nodes);
         for (auto i = 0u; i != nodes; ++i) {
@@ -47,7 +47,7 @@ bool gaussian::operator()(cl::CommandQueue& queue,
         }
 
         //  now copy to the buffer
-        cl::copy(queue, pressures.begin(), pressures.end(), buffer);
+        write_pressures(queue, buffer, pressures);
     }
     return true;
 }
@@ -0,0 +1,187 @@
+#include "waveguide/pressure_precision.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace wayverb {
+namespace waveguide {
+
+cl_half to_half(float f) {
+    uint32_t x;
+    std::memcpy(&x, &f, sizeof(x));
+    const uint32_t sign = (x >> 16) & 0x8000;
+    const uint32_t abs = x & 0x7fffffff;
+
+    //  Infinity and nan (keeping nans quiet).
+    if (0x7f800000 <= abs) {
+        return sign | 0x7c00 | (0x7f800000 < abs ? 0x200 : 0);
+    }
+
+    //  Anything which rounds above the largest half is infinite.
+    if (0x477ff000 <= abs) {
+        return sign | 0x7c00;
+    }
+
+    //  Subnormal halves, in units of 2^-24.
+    //  Values below 2^-25 round to zero.
+    if (abs < 0x38800000) {
+        if (abs <= 0x33000000) {
+            return sign;
+        }
+        const uint32_t shift = 126 - (abs >> 23);
+        const uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        uint32_t ret = mantissa >> shift;
+        if (halfway < remainder || (remainder == halfway && (ret & 1))) {
+            ret += 1;
+        }
+        return sign | ret;
+    }
+
+    //  Normal halves.
+    //  A carry out of the mantissa correctly bumps the exponent.
+    uint32_t ret = (abs >> 13) - (112 << 10);
+    const uint32_t remainder = abs & 0x1fff;
+    if (0x1000 < remainder || (remainder == 0x1000 && (ret & 1))) {
+        ret += 1;
+    }
+    return sign | ret;
+}
+
+float from_half(cl_half h) {
+    const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1f;
+    const uint32_t mantissa = h & 0x3ff;
+
+    if (exponent == 0) {
+        const auto ret = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -ret : ret;
+    }
+
+    const uint32_t x =
+            exponent == 0x1f
+                    ? sign | 0x7f800000 | (mantissa << 13)
+                    : sign | ((exponent + 112) << 23) | (mantissa << 13);
+    float ret;
+    std::memcpy(&ret, &x, sizeof(ret));
+    return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+pressure_buffer::pressure_buffer(const cl::Buffer& buffer,
+                                 pressure_precision precision)
+        : cl::Buffer{buffer}
+        , precision_{precision} {}
+
+pressure_buffer::pressure_buffer(const cl::Context& context,
+                                 size_t nodes,
+                                 pressure_precision precision)
+        : cl::Buffer{context,
+                     CL_MEM_READ_WRITE,
+                     nodes * bytes_per_pressure(precision)}
+        , precision_{precision} {}
+
+pressure_precision pressure_buffer::get_precision() const {
+    return precision_;
+}
+
+size_t pressure_buffer::size() const {
+    return getInfo<CL_MEM_SIZE>() / bytes_per_pressure(precision_);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+float read_pressure(cl::CommandQueue& queue,
+                    const pressure_buffer& buffer,
+                    size_t index) {
+    switch (buffer.get_precision()) {
+        case pressure_precision::single:
+            return core::read_value<cl_float>(queue, buffer, index);
+        case pressure_precision::half:
+            return from_half(core::read_value<cl_half>(queue, buffer, index));
+    }
+    throw std::runtime_error{"Unrecognised pressure precision."};
+}
+
+void write_pressure(cl::CommandQueue& queue,
+                    const pressure_buffer& buffer,
+                    size_t index,
+                    float value) {
+    switch (buffer.get_precision()) {
+        case pressure_precision::single:
+            queue.enqueueWriteBuffer(buffer,
+                                     CL_TRUE,
+                                     sizeof(cl_float) * index,
+                                     sizeof(cl_float),
+                                     &value);
+            break;
+        case pressure_precision::half: {
+            const auto h = to_half(value);
+            queue.enqueueWriteBuffer(buffer,
+                                     CL_TRUE,
+                                     sizeof(cl_half) * index,
+                                     sizeof(cl_half),
+                                     &h);
+            break;
+        }
+    }
+}
+
+util::aligned::vector<cl_float> read_pressures(cl::CommandQueue& queue,
+                                               const pressure_buffer& buffer) {
+    switch (buffer.get_precision()) {
+        case pressure_precision::single:
+            return core::read_from_buffer<cl_float>(queue, buffer);
+        case pressure_precision::half: {
+            const auto stored = core::read_from_buffer<cl_half>(queue, buffer);
+            util::aligned::vector<cl_float> ret;
+            ret.reserve(stored.size());
+            for (const auto& i : stored) {
+                ret.emplace_back(from_half(i));
+            }
+            return ret;
+        }
+    }
+    throw std::runtime_error{"Unrecognised pressure precision."};
+}
+
+void write_pressures(cl::CommandQueue& queue,
+                     const pressure_buffer& buffer,
+                     const util::aligned::vector<cl_float>& values) {
+    if (values.size() != buffer.size()) {
+        throw std::runtime_error{
+                "Number of pressures does not match buffer size."};
+    }
+    if (values.empty()) {
+        return;
+    }
+    switch (buffer.get_precision()) {
+        case pressure_precision::single:
+            queue.enqueueWriteBuffer(buffer,
+                                     CL_TRUE,
+                                     0,
+                                     sizeof(cl_float) * values.size(),
+                                     values.data());
+            break;
+        case pressure_precision::half: {
+            util::aligned::vector<cl_half> stored;
+            stored.reserve(values.size());
+            for (const auto& i : values) {
+                stored.emplace_back(to_half(i));
+            }
+            queue.enqueueWriteBuffer(buffer,
+                                     CL_TRUE,
+                                     0,
+                                     sizeof(cl_half) * stored.size(),
+                                     stored.data());
+            break;
+        }
+    }
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
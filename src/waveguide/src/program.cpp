@@ -8,6 +8,15 @@
 namespace wayverb {
 namespace waveguide {
 
+namespace {
+std::string batch_size_source(size_t batch_size) {
+    if (batch_size == 0) {
+        throw std::runtime_error{"Batches must hold at least one source."};
+    }
+    return util::build_string("#define NODE_BATCH_SIZE (", batch_size, ")\n");
+}
+}  // namespace
+
 constexpr auto source = R"(
 #define courant (1.0f / sqrt(3.0f))
 #define courant_sq (1.0f / 3.0f)
@@ -147,30 +156,47 @@ SurroundingPorts2 on_boundary_2(InnerNodeDirections2 ind) {
 //
 //  we don't actually care about the pressure at the ghost point other than to
 //  calculate the boundary filter input
+//
+//  the boundary data is a private copy, which the caller loads from and stores
+//  back to whichever layout the boundary state is kept in
+//
+//  the courant number is that of the scheme being used
+//
+//  only as many filter delays as the boundary's filter order are updated, so
+//  flat materials cost a single multiply
+//
+//  filter orders are found once on the host, and stored in 'filter_orders'
+//  alongside the boundary coefficients
 void ghost_point_pressure_update(float next_pressure,
                                  float prev_pressure,
                                  float inner_pressure,
-                                 global boundary_data* bd,
-                                 const global coefficients_canonical* boundary);
+                                 boundary_data* bd,
+                                 const global coefficients_canonical* boundary,
+                                 int filter_order,
+                                 float courant_number);
 void ghost_point_pressure_update(
         float next_pressure,
         float prev_pressure,
         float inner_pressure,
-        global boundary_data* bd,
-        const global coefficients_canonical* boundary) {
+        boundary_data* bd,
+        const global coefficients_canonical* boundary,
+        int filter_order,
+        float courant_number) {
     const filt_real filt_state = bd->filter_memory.array[0];
     const filt_real b0 = boundary->b[0];
     const filt_real a0 = boundary->a[0];
 
-    const filt_real diff = (a0 * (prev_pressure - next_pressure)) / (b0 * courant) +
-                      (filt_state / b0);
+    const filt_real diff =
+            (a0 * (prev_pressure - next_pressure)) / (b0 * courant_number) +
+            (filt_state / b0);
 #if 0
     const filt_real ghost_pressure = inner_pressure + diff;
     const filt_real filter_input = inner_pressure - ghost_pressure;
 #else
     const filt_real filter_input = -diff;
 #endif
-    filter_step_canonical(filter_input, &(bd->filter_memory), boundary);
+    filter_step_canonical_adaptive(
+            filter_input, &(bd->filter_memory), boundary, filter_order);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -179,14 +205,14 @@ void ghost_point_pressure_update(
     float CAT(get_summed_surrounding_, dimensions)(                          \
             const global condensed_node* nodes,                              \
             CAT(InnerNodeDirections, dimensions) pd,                         \
-            const global float* current,                                     \
+            const global pressure_t* current,                                \
             int3 locator,                                                    \
             int3 dim,                                                        \
             volatile global int* error_flag);                                \
     float CAT(get_summed_surrounding_, dimensions)(                          \
             const global condensed_node* nodes,                              \
             CAT(InnerNodeDirections, dimensions) pd,                         \
-            const global float* current,                                     \
+            const global pressure_t* current,                                \
             int3 locator,                                                    \
             int3 dim,                                                        \
             volatile global int* error_flag) {                               \
@@ -203,7 +229,7 @@ void ghost_point_pressure_update(
             if (boundary_type == id_none || boundary_type == id_inside) {    \
                 atomic_or(error_flag, id_suspicious_boundary_error);         \
             }                                                                \
-            ret += current[index];                                           \
+            ret += read_pressure(current, index);                            \
         }                                                                    \
         return ret;                                                          \
     }
@@ -213,13 +239,13 @@ TEMPLATE_SUM_SURROUNDING_PORTS(2);
 
 float get_summed_surrounding_3(const global condensed_node* nodes,
                                InnerNodeDirections3 i,
-                               const global float* current,
+                               const global pressure_t* current,
                                int3 locator,
                                int3 dimensions,
                                volatile global int* error_flag);
 float get_summed_surrounding_3(const global condensed_node* nodes,
                                InnerNodeDirections3 i,
-                               const global float* current,
+                               const global pressure_t* current,
                                int3 locator,
                                int3 dimensions,
                                volatile global int* error_flag) {
@@ -229,13 +255,13 @@ float get_summed_surrounding_3(const global condensed_node* nodes,
 ////////////////////////////////////////////////////////////////////////////////
 
 float get_inner_pressure(const global condensed_node* nodes,
-                         const global float* current,
+                         const global pressure_t* current,
                          int3 locator,
                          int3 dim,
                          PortDirection bt,
                          volatile global int* error_flag);
 float get_inner_pressure(const global condensed_node* nodes,
-                         const global float* current,
+                         const global pressure_t* current,
                          int3 locator,
                          int3 dim,
                          PortDirection bt,
@@ -245,20 +271,20 @@ float get_inner_pressure(const global condensed_node* nodes,
         atomic_or(error_flag, id_outside_mesh_error);
         return 0;
     }
-    return current[neighbor];
+    return read_pressure(current, neighbor);
 }
 
 #define GET_CURRENT_SURROUNDING_WEIGHTING_TEMPLATE(dimensions)                 \
     float CAT(get_current_surrounding_weighting_, dimensions)(                 \
             const global condensed_node* nodes,                                \
-            const global float* current,                                       \
+            const global pressure_t* current,                                  \
             int3 locator,                                                      \
             int3 dim,                                                          \
             CAT(InnerNodeDirections, dimensions) ind,                          \
             volatile global int* error_flag);                                  \
     float CAT(get_current_surrounding_weighting_, dimensions)(                 \
             const global condensed_node* nodes,                                \
-            const global float* current,                                       \
+            const global pressure_t* current,                                  \
             int3 locator,                                                      \
             int3 dim,                                                          \
             CAT(InnerNodeDirections, dimensions) ind,                          \
@@ -283,21 +309,23 @@ GET_CURRENT_SURROUNDING_WEIGHTING_TEMPLATE(3);
 
 ////////////////////////////////////////////////////////////////////////////////
 
-#define GET_FILTER_WEIGHTING_TEMPLATE(dimensions)                         \
-    float CAT(get_filter_weighting_, dimensions)(                         \
-            global CAT(boundary_data_array_, dimensions) * bda,           \
-            const global coefficients_canonical* boundary_coefficients);  \
-    float CAT(get_filter_weighting_, dimensions)(                         \
-            global CAT(boundary_data_array_, dimensions) * bda,           \
-            const global coefficients_canonical* boundary_coefficients) { \
-        float sum = 0;                                                    \
-        for (int i = 0; i != dimensions; ++i) {                           \
-            boundary_data bd = bda->array[i];                             \
-            const filt_real filt_state = bd.filter_memory.array[0];            \
-            sum += filt_state /                                           \
-                   boundary_coefficients[bd.coefficient_index].b[0];      \
-        }                                                                 \
-        return courant_sq * sum;                                          \
+#define GET_FILTER_WEIGHTING_TEMPLATE(dimensions)                        \
+    float CAT(get_filter_weighting_, dimensions)(                        \
+            const CAT(boundary_data_array_, dimensions) * bda,           \
+            const global coefficients_canonical* boundary_coefficients,  \
+            float courant_number_sq);                                    \
+    float CAT(get_filter_weighting_, dimensions)(                        \
+            const CAT(boundary_data_array_, dimensions) * bda,           \
+            const global coefficients_canonical* boundary_coefficients,  \
+            float courant_number_sq) {                                   \
+        float sum = 0;                                                   \
+        for (int i = 0; i != dimensions; ++i) {                          \
+            boundary_data bd = bda->array[i];                            \
+            const filt_real filt_state = bd.filter_memory.array[0];      \
+            sum += filt_state /                                          \
+                   boundary_coefficients[bd.coefficient_index].b[0];     \
+        }                                                                \
+        return courant_number_sq * sum;                                  \
     }
 
 GET_FILTER_WEIGHTING_TEMPLATE(1);
@@ -308,18 +336,20 @@ GET_FILTER_WEIGHTING_TEMPLATE(3);
 
 #define GET_COEFF_WEIGHTING_TEMPLATE(dimensions)                             \
     float CAT(get_coeff_weighting_, dimensions)(                             \
-            global CAT(boundary_data_array_, dimensions) * bda,              \
-            const global coefficients_canonical* boundary_coefficients);     \
+            const CAT(boundary_data_array_, dimensions) * bda,               \
+            const global coefficients_canonical* boundary_coefficients,      \
+            float courant_number);                                           \
     float CAT(get_coeff_weighting_, dimensions)(                             \
-            global CAT(boundary_data_array_, dimensions) * bda,              \
-            const global coefficients_canonical* boundary_coefficients) {    \
+            const CAT(boundary_data_array_, dimensions) * bda,               \
+            const global coefficients_canonical* boundary_coefficients,      \
+            float courant_number) {                                          \
         float sum = 0;                                                       \
         for (int i = 0; i != dimensions; ++i) {                              \
             const global coefficients_canonical* boundary =                  \
                     boundary_coefficients + bda->array[i].coefficient_index; \
             sum += boundary->a[0] / boundary->b[0];                          \
         }                                                                    \
-        return sum * courant;                                                \
+        return sum * courant_number;                                         \
     }
 
 GET_COEFF_WEIGHTING_TEMPLATE(1);
@@ -330,42 +360,42 @@ GET_COEFF_WEIGHTING_TEMPLATE(3);
 
 #define BOUNDARY_TEMPLATE(dimensions)                                          \
     float CAT(boundary_, dimensions)(                                          \
-            const global float* current,                                       \
+            const global pressure_t* current,                                  \
             float prev_pressure,                                               \
             condensed_node node,                                               \
             const global condensed_node* nodes,                                \
             int3 locator,                                                      \
             int3 dim,                                                          \
-            global CAT(boundary_data_array_, dimensions) * bdat,               \
+            CAT(boundary_data_array_, dimensions) * bda,                       \
             const global coefficients_canonical* boundary_coefficients,        \
+            const global uint* filter_orders,                                  \
             volatile global int* error_flag);                                  \
     float CAT(boundary_, dimensions)(                                          \
-            const global float* current,                                       \
+            const global pressure_t* current,                                  \
             float prev_pressure,                                               \
             condensed_node node,                                               \
             const global condensed_node* nodes,                                \
             int3 locator,                                                      \
             int3 dim,                                                          \
-            global CAT(boundary_data_array_, dimensions) * bdat,               \
+            CAT(boundary_data_array_, dimensions) * bda,                       \
             const global coefficients_canonical* boundary_coefficients,        \
+            const global uint* filter_orders,                                  \
             volatile global int* error_flag) {                                 \
         CAT(InnerNodeDirections, dimensions)                                   \
         ind = CAT(get_inner_node_directions_, dimensions)(node.boundary_type); \
         float current_surrounding_weighting =                                  \
                 CAT(get_current_surrounding_weighting_, dimensions)(           \
                         nodes, current, locator, dim, ind, error_flag);        \
-        global CAT(boundary_data_array_, dimensions)* bda =                    \
-                bdat + node.boundary_index;                                    \
         const float filter_weighting = CAT(get_filter_weighting_, dimensions)( \
-                bda, boundary_coefficients);                                   \
+                bda, boundary_coefficients, courant_sq);                       \
         const float coeff_weighting = CAT(get_coeff_weighting_, dimensions)(   \
-                bda, boundary_coefficients);                                   \
+                bda, boundary_coefficients, courant);                          \
         const float prev_weighting = (coeff_weighting - 1) * prev_pressure;    \
         const float ret = (current_surrounding_weighting + filter_weighting +  \
                            prev_weighting) /                                   \
                           (1 + coeff_weighting);                               \
         for (int i = 0; i != dimensions; ++i) {                                \
-            global boundary_data* bd = bda->array + i;                         \
+            boundary_data* bd = bda->array + i;                                \
             const global coefficients_canonical* boundary =                    \
                     boundary_coefficients + bd->coefficient_index;             \
             ghost_point_pressure_update(ret,                                   \
@@ -377,7 +407,9 @@ GET_COEFF_WEIGHTING_TEMPLATE(3);
                                                            ind.array[i],       \
                                                            error_flag),        \
                                         bd,                                    \
-                                        boundary);                             \
+                                        boundary,                              \
+                                        filter_orders[bd->coefficient_index],  \
+                                        courant);                              \
         }                                                                      \
         return ret;                                                            \
     }
@@ -386,23 +418,152 @@ BOUNDARY_TEMPLATE(1);
 BOUNDARY_TEMPLATE(2);
 BOUNDARY_TEMPLATE(3);
 
+////////////////////////////////////////////////////////////////////////////////
+//  Boundary state may be stored in one of two layouts.
+//
+//  In the array-of-structs layout, each boundary node's filter memories and
+//  coefficient indices are stored together in a boundary_data_array.
+//
+//  In the struct-of-arrays layout, each filter memory lane, and each
+//  coefficient index, gets its own contiguous array, so that neighbouring
+//  work-items read neighbouring addresses:
+//      filter_memory[(dim * CANONICAL_FILTER_ORDER + lane) * num_boundaries +
+//                    boundary_index]
+//      coefficient_index[dim * num_boundaries + boundary_index]
+//
+//  Either way, the state is copied into private memory, updated, and stored
+//  back, so the two layouts give identical results.
+//
+//  In the struct-of-arrays layout, only the lanes used by each filter's order
+//  are read and written; the rest always hold zero.
+
+#define AOS_BOUNDARY_TEMPLATE(prefix, update, dimensions)                      \
+    float CAT(prefix, dimensions)(                                             \
+            const global pressure_t* current,                                  \
+            float prev_pressure,                                               \
+            condensed_node node,                                               \
+            const global condensed_node* nodes,                                \
+            int3 locator,                                                      \
+            int3 dim,                                                          \
+            global CAT(boundary_data_array_, dimensions) * bdat,               \
+            const global coefficients_canonical* boundary_coefficients,        \
+            const global uint* filter_orders,                                  \
+            volatile global int* error_flag);                                  \
+    float CAT(prefix, dimensions)(                                             \
+            const global pressure_t* current,                                  \
+            float prev_pressure,                                               \
+            condensed_node node,                                               \
+            const global condensed_node* nodes,                                \
+            int3 locator,                                                      \
+            int3 dim,                                                          \
+            global CAT(boundary_data_array_, dimensions) * bdat,               \
+            const global coefficients_canonical* boundary_coefficients,        \
+            const global uint* filter_orders,                                  \
+            volatile global int* error_flag) {                                 \
+        CAT(boundary_data_array_, dimensions) bda = bdat[node.boundary_index]; \
+        const float ret = CAT(update, dimensions)(current,                     \
+                                                  prev_pressure,               \
+                                                  node,                        \
+                                                  nodes,                       \
+                                                  locator,                     \
+                                                  dim,                         \
+                                                  &bda,                        \
+                                                  boundary_coefficients,       \
+                                                  filter_orders,               \
+                                                  error_flag);                 \
+        bdat[node.boundary_index] = bda;                                       \
+        return ret;                                                            \
+    }
+
+AOS_BOUNDARY_TEMPLATE(boundary_aos_, boundary_, 1);
+AOS_BOUNDARY_TEMPLATE(boundary_aos_, boundary_, 2);
+AOS_BOUNDARY_TEMPLATE(boundary_aos_, boundary_, 3);
+
+#define SOA_BOUNDARY_TEMPLATE(prefix, update, dimensions)                  \
+    float CAT(prefix, dimensions)(                                         \
+            const global pressure_t* current,                              \
+            float prev_pressure,                                           \
+            condensed_node node,                                           \
+            const global condensed_node* nodes,                            \
+            int3 locator,                                                  \
+            int3 dim,                                                      \
+            global filt_real* filter_memory,                               \
+            const global uint* coefficient_index,                          \
+            uint num_boundaries,                                           \
+            const global coefficients_canonical* boundary_coefficients,    \
+            const global uint* filter_orders,                              \
+            volatile global int* error_flag);                              \
+    float CAT(prefix, dimensions)(                                         \
+            const global pressure_t* current,                              \
+            float prev_pressure,                                           \
+            condensed_node node,                                           \
+            const global condensed_node* nodes,                            \
+            int3 locator,                                                  \
+            int3 dim,                                                      \
+            global filt_real* filter_memory,                               \
+            const global uint* coefficient_index,                          \
+            uint num_boundaries,                                           \
+            const global coefficients_canonical* boundary_coefficients,    \
+            const global uint* filter_orders,                              \
+            volatile global int* error_flag) {                             \
+        const uint bi = node.boundary_index;                               \
+        CAT(boundary_data_array_, dimensions) bda;                         \
+        int order[dimensions];                                             \
+        for (int i = 0; i != dimensions; ++i) {                            \
+            const uint ci = coefficient_index[i * num_boundaries + bi];    \
+            bda.array[i].coefficient_index = ci;                           \
+            order[i] = filter_orders[ci];                                  \
+            for (int j = 0; j != CANONICAL_FILTER_ORDER; ++j) {            \
+                bda.array[i].filter_memory.array[j] = 0;                   \
+            }                                                              \
+            for (int j = 0; j != order[i]; ++j) {                          \
+                bda.array[i].filter_memory.array[j] =                      \
+                        filter_memory[(i * CANONICAL_FILTER_ORDER + j) *   \
+                                              num_boundaries +             \
+                                      bi];                                 \
+            }                                                              \
+        }                                                                  \
+        const float ret = CAT(update, dimensions)(current,                 \
+                                                  prev_pressure,           \
+                                                  node,                    \
+                                                  nodes,                   \
+                                                  locator,                 \
+                                                  dim,                     \
+                                                  &bda,                    \
+                                                  boundary_coefficients,   \
+                                                  filter_orders,           \
+                                                  error_flag);             \
+        for (int i = 0; i != dimensions; ++i) {                            \
+            for (int j = 0; j != order[i]; ++j) {                          \
+                filter_memory[(i * CANONICAL_FILTER_ORDER + j) *           \
+                                      num_boundaries +                     \
+                              bi] = bda.array[i].filter_memory.array[j];   \
+            }                                                              \
+        }                                                                  \
+        return ret;                                                        \
+    }
+
+SOA_BOUNDARY_TEMPLATE(boundary_soa_, boundary_, 1);
+SOA_BOUNDARY_TEMPLATE(boundary_soa_, boundary_, 2);
+SOA_BOUNDARY_TEMPLATE(boundary_soa_, boundary_, 3);
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #define ENABLE_BOUNDARIES (1)
 
 float normal_waveguide_update(float prev_pressure,
-                              const global float* current,
+                              const global pressure_t* current,
                               int3 dimensions,
                               int3 locator);
 float normal_waveguide_update(float prev_pressure,
-                              const global float* current,
+                              const global pressure_t* current,
                               int3 dimensions,
                               int3 locator) {
     float ret = 0;
     for (int i = 0; i != PORTS; ++i) {
         uint port_index = neighbor_index(locator, dimensions, i);
         if (port_index != no_neighbor) {
-            ret += current[port_index];
+            ret += read_pressure(current, port_index);
         }
     }
 
@@ -415,25 +576,27 @@ float next_waveguide_pressure(
         const condensed_node node,
         const global condensed_node* nodes,
         float prev_pressure,
-        const global float* current,
+        const global pressure_t* current,
         int3 dimensions,
         int3 locator,
         global boundary_data_array_1* boundary_data_1,
         global boundary_data_array_2* boundary_data_2,
         global boundary_data_array_3* boundary_data_3,
         const global coefficients_canonical* boundary_coefficients,
+        const global uint* filter_orders,
         volatile global int* error_flag);
 float next_waveguide_pressure(
         const condensed_node node,
         const global condensed_node* nodes,
         float prev_pressure,
-        const global float* current,
+        const global pressure_t* current,
         int3 dimensions,
         int3 locator,
         global boundary_data_array_1* boundary_data_1,
         global boundary_data_array_2* boundary_data_2,
         global boundary_data_array_3* boundary_data_3,
         const global coefficients_canonical* boundary_coefficients,
+        const global uint* filter_orders,
         volatile global int* error_flag) {
     //  find the next pressure at this node, assign it to next_pressure
     switch (popcount(node.boundary_type)) {
@@ -445,68 +608,75 @@ float next_waveguide_pressure(
                         prev_pressure, current, dimensions, locator);
             } else {
 #if ENABLE_BOUNDARIES
-                return boundary_1(current,
+                return boundary_aos_1(current,
+                                      prev_pressure,
+                                      node,
+                                      nodes,
+                                      locator,
+                                      dimensions,
+                                      boundary_data_1,
+                                      boundary_coefficients,
+                                      filter_orders,
+                                      error_flag);
+#endif
+            }
+        //  this is an edge where two boundaries meet
+        case 2:
+#if ENABLE_BOUNDARIES
+            return boundary_aos_2(current,
                                   prev_pressure,
                                   node,
                                   nodes,
                                   locator,
                                   dimensions,
-                                  boundary_data_1,
+                                  boundary_data_2,
                                   boundary_coefficients,
+                                  filter_orders,
                                   error_flag);
-#endif
-            }
-        //  this is an edge where two boundaries meet
-        case 2:
-#if ENABLE_BOUNDARIES
-            return boundary_2(current,
-                              prev_pressure,
-                              node,
-                              nodes,
-                              locator,
-                              dimensions,
-                              boundary_data_2,
-                              boundary_coefficients,
-                              error_flag);
 #endif
         //  this is a corner where three boundaries meet
         case 3:
 #if ENABLE_BOUNDARIES
-            return boundary_3(current,
-                              prev_pressure,
-                              node,
-                              nodes,
-                              locator,
-                              dimensions,
-                              boundary_data_3,
-                              boundary_coefficients,
-                              error_flag);
+            return boundary_aos_3(current,
+                                  prev_pressure,
+                                  node,
+                                  nodes,
+                                  locator,
+                                  dimensions,
+                                  boundary_data_3,
+                                  boundary_coefficients,
+                                  filter_orders,
+                                  error_flag);
 #endif
         default: return 0;
     }
 }
 
-kernel void zero_buffer(global float* buffer) {
+kernel void zero_buffer(global pressure_t* buffer, ulong num_nodes) {
     const size_t thread = get_global_id(0);
-    buffer[thread] = 0.0f;
+    if (thread >= num_nodes) {
+        return;
+    }
+    write_pressure(buffer, thread, 0.0f);
 }
 
 kernel void condensed_waveguide(
-        global float* previous,
-        const global float* current,
+        global pressure_t* previous,
+        const global pressure_t* current,
         const global condensed_node* nodes,
         int3 dimensions,
         global boundary_data_array_1* boundary_data_1,
         global boundary_data_array_2* boundary_data_2,
         global boundary_data_array_3* boundary_data_3,
         const global coefficients_canonical* boundary_coefficients,
+        const global uint* filter_orders,
         volatile global int* error_flag) {
     const size_t index = get_global_id(0);
 
     const condensed_node node = nodes[index];
     const int3 locator = to_locator(index, dimensions);
 
-    const float prev_pressure = previous[index];
+    const float prev_pressure = read_pressure(previous, index);
     const float next_pressure = next_waveguide_pressure(node,
                                                         nodes,
                                                         prev_pressure,
@@ -517,6 +687,7 @@ kernel void condensed_waveguide(
                                                         boundary_data_2,
                                                         boundary_data_3,
                                                         boundary_coefficients,
+                                                        filter_orders,
                                                         error_flag);
 
     if (isinf(next_pressure)) {
@@ -526,15 +697,749 @@ kernel void condensed_waveguide(
         atomic_or(error_flag, id_nan_error);
     }
 
-    previous[index] = next_pressure;
+    write_pressure(previous, index, next_pressure);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//  Partitioned kernels.
+//  Each of these is run over a list of node indices which all share the same
+//  update equation, so there's no divergence within a wavefront.
+//  Every node is written by exactly one kernel, and all reads are from
+//  'current', so the kernels may run in any order or concurrently.
+
+void store_pressure(global pressure_t* previous,
+                    size_t index,
+                    float next_pressure,
+                    volatile global int* error_flag);
+void store_pressure(global pressure_t* previous,
+                    size_t index,
+                    float next_pressure,
+                    volatile global int* error_flag) {
+    if (isinf(next_pressure)) {
+        atomic_or(error_flag, id_inf_error);
+    }
+    if (isnan(next_pressure)) {
+        atomic_or(error_flag, id_nan_error);
+    }
+
+    write_pressure(previous, index, next_pressure);
+}
+
+//  Inside nodes which are known to have all six neighbours, so neighbour
+//  indices can be found without bounds checks (with fixed strides, in the
+//  linear layout).
+//  The summation order matches normal_waveguide_update, so the results are
+//  identical.
+kernel void waveguide_inside(global pressure_t* previous,
+                             const global pressure_t* current,
+                             int3 dimensions,
+                             const global uint* indices,
+                             uint num_indices,
+                             volatile global int* error_flag) {
+    if (get_global_id(0) >= num_indices) {
+        return;
+    }
+
+    const uint index = indices[get_global_id(0)];
+    const int3 locator = to_locator(index, dimensions);
+
+    const int3 offsets[PORTS] = {(int3)(-1, 0, 0),
+                                 (int3)(1, 0, 0),
+                                 (int3)(0, -1, 0),
+                                 (int3)(0, 1, 0),
+                                 (int3)(0, 0, -1),
+                                 (int3)(0, 0, 1)};
+
+    float ret = 0;
+    for (int i = 0; i != PORTS; ++i) {
+        ret += read_pressure(
+                current,
+                inner_neighbor_index(index, locator, offsets[i], dimensions));
+    }
+
+    ret /= (PORTS / 2);
+    ret -= read_pressure(previous, index);
+
+    store_pressure(previous, index, ret, error_flag);
+}
+
+//  Inside nodes on the faces of the mesh, which need checked neighbour
+//  lookups.
+kernel void waveguide_clipped(global pressure_t* previous,
+                              const global pressure_t* current,
+                              int3 dimensions,
+                              const global uint* indices,
+                              uint num_indices,
+                              volatile global int* error_flag) {
+    if (get_global_id(0) >= num_indices) {
+        return;
+    }
+
+    const uint index = indices[get_global_id(0)];
+    const int3 locator = to_locator(index, dimensions);
+    store_pressure(
+            previous,
+            index,
+            normal_waveguide_update(read_pressure(previous, index),
+                                    current,
+                                    dimensions,
+                                    locator),
+            error_flag);
+}
+
+#define BOUNDARY_KERNEL_TEMPLATE(kernel_name, update, dimensions)              \
+    kernel void CAT(kernel_name, dimensions)(                                  \
+            global pressure_t* previous,                                       \
+            const global pressure_t* current,                                  \
+            const global condensed_node* nodes,                                \
+            int3 dim,                                                          \
+            const global uint* indices,                                        \
+            uint num_indices,                                                  \
+            global CAT(boundary_data_array_, dimensions) * bdat,               \
+            const global coefficients_canonical* boundary_coefficients,        \
+            const global uint* filter_orders,                                  \
+            volatile global int* error_flag) {                                 \
+        if (get_global_id(0) >= num_indices) {                                 \
+            return;                                                            \
+        }                                                                      \
+        const uint index = indices[get_global_id(0)];                          \
+        const int3 locator = to_locator(index, dim);                           \
+        store_pressure(previous,                                               \
+                       index,                                                  \
+                       CAT(update, dimensions)(current,                        \
+                                               read_pressure(previous, index), \
+                                               nodes[index],                   \
+                                               nodes,                          \
+                                               locator,                        \
+                                               dim,                            \
+                                               bdat,                           \
+                                               boundary_coefficients,          \
+                                               filter_orders,                  \
+                                               error_flag),                    \
+                       error_flag);                                            \
+    }
+
+BOUNDARY_KERNEL_TEMPLATE(waveguide_boundary_, boundary_aos_, 1);
+BOUNDARY_KERNEL_TEMPLATE(waveguide_boundary_, boundary_aos_, 2);
+BOUNDARY_KERNEL_TEMPLATE(waveguide_boundary_, boundary_aos_, 3);
+
+#define SOA_BOUNDARY_KERNEL_TEMPLATE(kernel_name, update, dimensions)          \
+    kernel void CAT(kernel_name, dimensions)(                                  \
+            global pressure_t* previous,                                       \
+            const global pressure_t* current,                                  \
+            const global condensed_node* nodes,                                \
+            int3 dim,                                                          \
+            const global uint* indices,                                        \
+            uint num_indices,                                                  \
+            global filt_real* filter_memory,                                   \
+            const global uint* coefficient_index,                              \
+            uint num_boundaries,                                               \
+            const global coefficients_canonical* boundary_coefficients,        \
+            const global uint* filter_orders,                                  \
+            volatile global int* error_flag) {                                 \
+        if (get_global_id(0) >= num_indices) {                                 \
+            return;                                                            \
+        }                                                                      \
+        const uint index = indices[get_global_id(0)];                          \
+        const int3 locator = to_locator(index, dim);                           \
+        store_pressure(previous,                                               \
+                       index,                                                  \
+                       CAT(update, dimensions)(current,                        \
+                                               read_pressure(previous, index), \
+                                               nodes[index],                   \
+                                               nodes,                          \
+                                               locator,                        \
+                                               dim,                            \
+                                               filter_memory,                  \
+                                               coefficient_index,              \
+                                               num_boundaries,                 \
+                                               boundary_coefficients,          \
+                                               filter_orders,                  \
+                                               error_flag),                    \
+                       error_flag);                                            \
+    }
+
+SOA_BOUNDARY_KERNEL_TEMPLATE(waveguide_boundary_soa_, boundary_soa_, 1);
+SOA_BOUNDARY_KERNEL_TEMPLATE(waveguide_boundary_soa_, boundary_soa_, 2);
+SOA_BOUNDARY_KERNEL_TEMPLATE(waveguide_boundary_soa_, boundary_soa_, 3);
+
+)";
+
+//  The interpolated wideband scheme (kowalczyk2011).
+//  Each node is updated from all 26 of its neighbours, at a courant number of
+//  1.
+//  The kernels here mirror the rectilinear ones above, and take the same
+//  arguments.
+constexpr auto interpolated_source = R"(
+#define iwb_courant (1.0f)
+#define iwb_courant_sq (1.0f)
+
+#define iwb_axial (1.0f / 4)
+#define iwb_side (1.0f / 8)
+#define iwb_corner (1.0f / 16)
+#define iwb_centre (-3.0f / 2)
+
+typedef struct {
+    float axial;
+    float side;
+    float corner;
+} iwb_neighbour_sums;
+
+void iwb_accumulate(iwb_neighbour_sums* sums, int3 offset, float pressure);
+void iwb_accumulate(iwb_neighbour_sums* sums, int3 offset, float pressure) {
+    switch (abs(offset.x) + abs(offset.y) + abs(offset.z)) {
+        case 1: sums->axial += pressure; break;
+        case 2: sums->side += pressure; break;
+        case 3: sums->corner += pressure; break;
+    }
+}
+
+//  The weighted sum of the current pressures around a node.
+//  The previous pressure at the node must still be subtracted.
+float iwb_stencil_sum(iwb_neighbour_sums sums, float centre);
+float iwb_stencil_sum(iwb_neighbour_sums sums, float centre) {
+    return iwb_axial * sums.axial + iwb_side * sums.side +
+           iwb_corner * sums.corner + iwb_centre * centre;
+}
+
+int3 port_offset(PortDirection pd);
+int3 port_offset(PortDirection pd) {
+    switch (pd) {
+        case id_port_nx: return (int3)(-1, 0, 0);
+        case id_port_px: return (int3)(1, 0, 0);
+        case id_port_ny: return (int3)(0, -1, 0);
+        case id_port_py: return (int3)(0, 1, 0);
+        case id_port_nz: return (int3)(0, 0, -1);
+        case id_port_pz: return (int3)(0, 0, 1);
+
+        default: return (int3)(0);
+    }
+}
+
+//  Sums the neighbours of a boundary node.
+//  'ghost' has a non-zero component for each boundary direction, pointing
+//  away from the inside of the model.
+//  Neighbours on the far side of the boundary are ghost points, which are
+//  replaced by their mirror images on the near side.
+//  The boundary filters supply the difference between each ghost point and
+//  its image.
+//  Other neighbours are read directly - near reentrant corners, some of these
+//  may be outside nodes, which always have zero pressure.
+iwb_neighbour_sums iwb_mirrored_sums(const global pressure_t* current,
+                                     int3 locator,
+                                     int3 dim,
+                                     int3 ghost,
+                                     volatile global int* error_flag);
+iwb_neighbour_sums iwb_mirrored_sums(const global pressure_t* current,
+                                     int3 locator,
+                                     int3 dim,
+                                     int3 ghost,
+                                     volatile global int* error_flag) {
+    iwb_neighbour_sums ret = {0, 0, 0};
+    for (int z = -1; z <= 1; ++z) {
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                const int3 offset = (int3)(x, y, z);
+                const int3 mirrored = select(
+                        offset, -offset, (ghost != 0) & (offset == ghost));
+                const int3 neighbour = locator + mirrored;
+                if (locator_outside(neighbour, dim)) {
+                    atomic_or(error_flag, id_outside_mesh_error);
+                    return ret;
+                }
+                iwb_accumulate(
+                        &ret,
+                        offset,
+                        read_pressure(current, to_index(neighbour, dim)));
+            }
+        }
+    }
+    return ret;
+}
+
+//  The same locally-reacting boundary as the rectilinear scheme.
+//  Every ghost point on one side of the node is assumed to differ from its
+//  image by the same amount.
+//  The weights of the ghost points on one side always sum to courant^2, so
+//  the update has exactly the same form as the rectilinear one, with an extra
+//  term for the node's own pressure.
+#define IWB_BOUNDARY_TEMPLATE(dimensions)                                      \
+    float CAT(iwb_boundary_, dimensions)(                                      \
+            const global pressure_t* current,                                  \
+            float prev_pressure,                                               \
+            condensed_node node,                                               \
+            const global condensed_node* nodes,                                \
+            int3 locator,                                                      \
+            int3 dim,                                                          \
+            CAT(boundary_data_array_, dimensions) * bda,                       \
+            const global coefficients_canonical* boundary_coefficients,        \
+            const global uint* filter_orders,                                  \
+            volatile global int* error_flag);                                  \
+    float CAT(iwb_boundary_, dimensions)(                                      \
+            const global pressure_t* current,                                  \
+            float prev_pressure,                                               \
+            condensed_node node,                                               \
+            const global condensed_node* nodes,                                \
+            int3 locator,                                                      \
+            int3 dim,                                                          \
+            CAT(boundary_data_array_, dimensions) * bda,                       \
+            const global coefficients_canonical* boundary_coefficients,        \
+            const global uint* filter_orders,                                  \
+            volatile global int* error_flag) {                                 \
+        CAT(InnerNodeDirections, dimensions)                                   \
+        ind = CAT(get_inner_node_directions_, dimensions)(node.boundary_type); \
+        int3 ghost = (int3)(0);                                                \
+        for (int i = 0; i != dimensions; ++i) {                                \
+            ghost -= port_offset(ind.array[i]);                                \
+        }                                                                      \
+        const float stencil_sum = iwb_stencil_sum(                             \
+                iwb_mirrored_sums(current, locator, dim, ghost, error_flag),   \
+                read_pressure(current, to_index(locator, dim)));               \
+        const float filter_weighting = CAT(get_filter_weighting_, dimensions)( \
+                bda, boundary_coefficients, iwb_courant_sq);                   \
+        const float coeff_weighting = CAT(get_coeff_weighting_, dimensions)(   \
+                bda, boundary_coefficients, iwb_courant);                      \
+        const float prev_weighting = (coeff_weighting - 1) * prev_pressure;    \
+        const float ret =                                                      \
+                (stencil_sum + filter_weighting + prev_weighting) /            \
+                (1 + coeff_weighting);                                         \
+        for (int i = 0; i != dimensions; ++i) {                                \
+            boundary_data* bd = bda->array + i;                                \
+            const global coefficients_canonical* boundary =                    \
+                    boundary_coefficients + bd->coefficient_index;             \
+            ghost_point_pressure_update(ret,                                   \
+                                        prev_pressure,                         \
+                                        get_inner_pressure(nodes,              \
+                                                           current,            \
+                                                           locator,            \
+                                                           dim,                \
+                                                           ind.array[i],       \
+                                                           error_flag),        \
+                                        bd,                                    \
+                                        boundary,                              \
+                                        filter_orders[bd->coefficient_index],  \
+                                        iwb_courant);                          \
+        }                                                                      \
+        return ret;                                                            \
+    }
+
+IWB_BOUNDARY_TEMPLATE(1);
+IWB_BOUNDARY_TEMPLATE(2);
+IWB_BOUNDARY_TEMPLATE(3);
+
+AOS_BOUNDARY_TEMPLATE(iwb_boundary_aos_, iwb_boundary_, 1);
+AOS_BOUNDARY_TEMPLATE(iwb_boundary_aos_, iwb_boundary_, 2);
+AOS_BOUNDARY_TEMPLATE(iwb_boundary_aos_, iwb_boundary_, 3);
+
+SOA_BOUNDARY_TEMPLATE(iwb_boundary_soa_, iwb_boundary_, 1);
+SOA_BOUNDARY_TEMPLATE(iwb_boundary_soa_, iwb_boundary_, 2);
+SOA_BOUNDARY_TEMPLATE(iwb_boundary_soa_, iwb_boundary_, 3);
+
+////////////////////////////////////////////////////////////////////////////////
+
+//  All 26 neighbours of these nodes are in the mesh, so they can be found
+//  without bounds checks.
+kernel void waveguide_iwb_inside(global pressure_t* previous,
+                                 const global pressure_t* current,
+                                 int3 dimensions,
+                                 const global uint* indices,
+                                 uint num_indices,
+                                 volatile global int* error_flag) {
+    if (get_global_id(0) >= num_indices) {
+        return;
+    }
+
+    const uint index = indices[get_global_id(0)];
+    const int3 locator = to_locator(index, dimensions);
+
+    iwb_neighbour_sums sums = {0, 0, 0};
+    for (int z = -1; z <= 1; ++z) {
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                const int3 offset = (int3)(x, y, z);
+                if (x || y || z) {
+                    iwb_accumulate(
+                            &sums,
+                            offset,
+                            read_pressure(current,
+                                          inner_neighbor_index(index,
+                                                               locator,
+                                                               offset,
+                                                               dimensions)));
+                }
+            }
+        }
+    }
+
+    store_pressure(previous,
+                   index,
+                   iwb_stencil_sum(sums, read_pressure(current, index)) -
+                           read_pressure(previous, index),
+                   error_flag);
+}
+
+//  Neighbours outside the mesh are treated as having zero pressure, as in the
+//  rectilinear scheme.
+//  The summation order matches waveguide_iwb_inside, so the results are
+//  identical.
+float iwb_waveguide_update(float prev_pressure,
+                           const global pressure_t* current,
+                           int3 dimensions,
+                           int3 locator);
+float iwb_waveguide_update(float prev_pressure,
+                           const global pressure_t* current,
+                           int3 dimensions,
+                           int3 locator) {
+    iwb_neighbour_sums sums = {0, 0, 0};
+    for (int z = -1; z <= 1; ++z) {
+        for (int y = -1; y <= 1; ++y) {
+            for (int x = -1; x <= 1; ++x) {
+                const int3 offset = (int3)(x, y, z);
+                const int3 neighbour = locator + offset;
+                if ((x || y || z) && !locator_outside(neighbour, dimensions)) {
+                    iwb_accumulate(
+                            &sums,
+                            offset,
+                            read_pressure(current,
+                                          to_index(neighbour, dimensions)));
+                }
+            }
+        }
+    }
+
+    return iwb_stencil_sum(
+                   sums,
+                   read_pressure(current, to_index(locator, dimensions))) -
+           prev_pressure;
+}
+
+kernel void waveguide_iwb_clipped(global pressure_t* previous,
+                                  const global pressure_t* current,
+                                  int3 dimensions,
+                                  const global uint* indices,
+                                  uint num_indices,
+                                  volatile global int* error_flag) {
+    if (get_global_id(0) >= num_indices) {
+        return;
+    }
+
+    const uint index = indices[get_global_id(0)];
+    const int3 locator = to_locator(index, dimensions);
+    store_pressure(
+            previous,
+            index,
+            iwb_waveguide_update(read_pressure(previous, index),
+                                 current,
+                                 dimensions,
+                                 locator),
+            error_flag);
+}
+
+BOUNDARY_KERNEL_TEMPLATE(waveguide_iwb_boundary_, iwb_boundary_aos_, 1);
+BOUNDARY_KERNEL_TEMPLATE(waveguide_iwb_boundary_, iwb_boundary_aos_, 2);
+BOUNDARY_KERNEL_TEMPLATE(waveguide_iwb_boundary_, iwb_boundary_aos_, 3);
+
+SOA_BOUNDARY_KERNEL_TEMPLATE(waveguide_iwb_boundary_soa_, iwb_boundary_soa_, 1);
+SOA_BOUNDARY_KERNEL_TEMPLATE(waveguide_iwb_boundary_soa_, iwb_boundary_soa_, 2);
+SOA_BOUNDARY_KERNEL_TEMPLATE(waveguide_iwb_boundary_soa_, iwb_boundary_soa_, 3);
+
+//  Equivalent to next_waveguide_pressure.
+float iwb_next_waveguide_pressure(
+        const condensed_node node,
+        const global condensed_node* nodes,
+        float prev_pressure,
+        const global pressure_t* current,
+        int3 dimensions,
+        int3 locator,
+        global boundary_data_array_1* boundary_data_1,
+        global boundary_data_array_2* boundary_data_2,
+        global boundary_data_array_3* boundary_data_3,
+        const global coefficients_canonical* boundary_coefficients,
+        const global uint* filter_orders,
+        volatile global int* error_flag);
+float iwb_next_waveguide_pressure(
+        const condensed_node node,
+        const global condensed_node* nodes,
+        float prev_pressure,
+        const global pressure_t* current,
+        int3 dimensions,
+        int3 locator,
+        global boundary_data_array_1* boundary_data_1,
+        global boundary_data_array_2* boundary_data_2,
+        global boundary_data_array_3* boundary_data_3,
+        const global coefficients_canonical* boundary_coefficients,
+        const global uint* filter_orders,
+        volatile global int* error_flag) {
+    switch (popcount(node.boundary_type)) {
+        case 1:
+            if (node.boundary_type & id_inside ||
+                node.boundary_type & id_reentrant) {
+                return iwb_waveguide_update(
+                        prev_pressure, current, dimensions, locator);
+            }
+            return iwb_boundary_aos_1(current,
+                                      prev_pressure,
+                                      node,
+                                      nodes,
+                                      locator,
+                                      dimensions,
+                                      boundary_data_1,
+                                      boundary_coefficients,
+                                      filter_orders,
+                                      error_flag);
+        case 2:
+            return iwb_boundary_aos_2(current,
+                                      prev_pressure,
+                                      node,
+                                      nodes,
+                                      locator,
+                                      dimensions,
+                                      boundary_data_2,
+                                      boundary_coefficients,
+                                      filter_orders,
+                                      error_flag);
+        case 3:
+            return iwb_boundary_aos_3(current,
+                                      prev_pressure,
+                                      node,
+                                      nodes,
+                                      locator,
+                                      dimensions,
+                                      boundary_data_3,
+                                      boundary_coefficients,
+                                      filter_orders,
+                                      error_flag);
+        default: return 0;
+    }
+}
+
+)";
+
+//  Multi-source batches (see batch.h).
+//  The mesh holds NODE_BATCH_SIZE independent simulations, one per source,
+//  which share nodes and boundary coefficients.
+//  The pressures of all sources at a node are stored together:
+//      pressure[index * NODE_BATCH_SIZE + source]
+//  and each source has its own copy of the boundary state:
+//      boundary_data_d[source * num_boundaries_d + boundary_index]
+//
+//  read_pressure and write_pressure scale node indices by NODE_BATCH_SIZE, so
+//  offsetting a pressure buffer by a source number gives a view of that
+//  source's mesh, and the usual update functions can be used unchanged.
+//  Each work-item updates one node for every source, so the neighbours of
+//  inside nodes are only found once, and the pressures read from each
+//  neighbour are adjacent in memory.
+//  The summation order is the same as in the single-source kernels, so each
+//  source gets exactly the result it would get on its own.
+//
+//  In a program built for batches of more than one source, only these kernels
+//  may be used.
+constexpr auto batch_source = R"(
+#define BATCH_NODE_TEMPLATE(name, next_pressure)                               \
+    void name(global pressure_t* previous,                                     \
+              const global pressure_t* current,                                \
+              const global condensed_node* nodes,                              \
+              int3 dimensions,                                                 \
+              size_t index,                                                    \
+              global boundary_data_array_1* boundary_data_1,                   \
+              uint num_boundaries_1,                                           \
+              global boundary_data_array_2* boundary_data_2,                   \
+              uint num_boundaries_2,                                           \
+              global boundary_data_array_3* boundary_data_3,                   \
+              uint num_boundaries_3,                                           \
+              const global coefficients_canonical* boundary_coefficients,      \
+              const global uint* filter_orders,                                \
+              volatile global int* error_flag);                                \
+    void name(global pressure_t* previous,                                     \
+              const global pressure_t* current,                                \
+              const global condensed_node* nodes,                              \
+              int3 dimensions,                                                 \
+              size_t index,                                                    \
+              global boundary_data_array_1* boundary_data_1,                   \
+              uint num_boundaries_1,                                           \
+              global boundary_data_array_2* boundary_data_2,                   \
+              uint num_boundaries_2,                                           \
+              global boundary_data_array_3* boundary_data_3,                   \
+              uint num_boundaries_3,                                           \
+              const global coefficients_canonical* boundary_coefficients,      \
+              const global uint* filter_orders,                                \
+              volatile global int* error_flag) {                               \
+        const condensed_node node = nodes[index];                              \
+        const int3 locator = to_locator(index, dimensions);                    \
+        for (uint source = 0; source != NODE_BATCH_SIZE; ++source) {           \
+            store_pressure(                                                    \
+                    previous + source,                                         \
+                    index,                                                     \
+                    next_pressure(node,                                        \
+                                  nodes,                                       \
+                                  read_pressure(previous + source, index),     \
+                                  current + source,                            \
+                                  dimensions,                                  \
+                                  locator,                                     \
+                                  boundary_data_1 + source * num_boundaries_1, \
+                                  boundary_data_2 + source * num_boundaries_2, \
+                                  boundary_data_3 + source * num_boundaries_3, \
+                                  boundary_coefficients,                       \
+                                  filter_orders,                               \
+                                  error_flag),                                 \
+                    error_flag);                                               \
+        }                                                                      \
+    }
+
+BATCH_NODE_TEMPLATE(batch_node_update, next_waveguide_pressure);
+BATCH_NODE_TEMPLATE(iwb_batch_node_update, iwb_next_waveguide_pressure);
+
+kernel void waveguide_batch(
+        global pressure_t* previous,
+        const global pressure_t* current,
+        const global condensed_node* nodes,
+        int3 dimensions,
+        global boundary_data_array_1* boundary_data_1,
+        uint num_boundaries_1,
+        global boundary_data_array_2* boundary_data_2,
+        uint num_boundaries_2,
+        global boundary_data_array_3* boundary_data_3,
+        uint num_boundaries_3,
+        const global coefficients_canonical* boundary_coefficients,
+        const global uint* filter_orders,
+        volatile global int* error_flag,
+        ulong num_nodes) {
+    const size_t index = get_global_id(0);
+    if (index >= num_nodes) {
+        return;
+    }
+
+    const int boundary_type = nodes[index].boundary_type;
+
+    if (boundary_type == id_inside || boundary_type == id_reentrant) {
+        //  As normal_waveguide_update, with the neighbours found once.
+        const int3 locator = to_locator(index, dimensions);
+        uint neighbours[PORTS];
+        for (int i = 0; i != PORTS; ++i) {
+            neighbours[i] = neighbor_index(locator, dimensions, i);
+        }
+
+        for (uint source = 0; source != NODE_BATCH_SIZE; ++source) {
+            float ret = 0;
+            for (int i = 0; i != PORTS; ++i) {
+                if (neighbours[i] != no_neighbor) {
+                    ret += read_pressure(current + source, neighbours[i]);
+                }
+            }
+            ret /= (PORTS / 2);
+            ret -= read_pressure(previous + source, index);
+            store_pressure(previous + source, index, ret, error_flag);
+        }
+        return;
+    }
+
+    batch_node_update(previous,
+                      current,
+                      nodes,
+                      dimensions,
+                      index,
+                      boundary_data_1,
+                      num_boundaries_1,
+                      boundary_data_2,
+                      num_boundaries_2,
+                      boundary_data_3,
+                      num_boundaries_3,
+                      boundary_coefficients,
+                      filter_orders,
+                      error_flag);
+}
+
+//  The offsets of the 27 nodes in a 3x3x3 block, in the order used by
+//  iwb_waveguide_update.
+int3 stencil_offset(int i);
+int3 stencil_offset(int i) {
+    return (int3)(i % 3, (i / 3) % 3, i / 9) - 1;
+}
+
+kernel void waveguide_iwb_batch(
+        global pressure_t* previous,
+        const global pressure_t* current,
+        const global condensed_node* nodes,
+        int3 dimensions,
+        global boundary_data_array_1* boundary_data_1,
+        uint num_boundaries_1,
+        global boundary_data_array_2* boundary_data_2,
+        uint num_boundaries_2,
+        global boundary_data_array_3* boundary_data_3,
+        uint num_boundaries_3,
+        const global coefficients_canonical* boundary_coefficients,
+        const global uint* filter_orders,
+        volatile global int* error_flag,
+        ulong num_nodes) {
+    const size_t index = get_global_id(0);
+    if (index >= num_nodes) {
+        return;
+    }
+
+    const int boundary_type = nodes[index].boundary_type;
+
+    if (boundary_type == id_inside || boundary_type == id_reentrant) {
+        //  As iwb_waveguide_update, with the neighbours found once.
+        const int3 locator = to_locator(index, dimensions);
+        uint neighbours[27];
+        for (int i = 0; i != 27; ++i) {
+            const int3 neighbour = locator + stencil_offset(i);
+            neighbours[i] = locator_outside(neighbour, dimensions)
+                                    ? no_neighbor
+                                    : to_index(neighbour, dimensions);
+        }
+
+        for (uint source = 0; source != NODE_BATCH_SIZE; ++source) {
+            iwb_neighbour_sums sums = {0, 0, 0};
+            for (int i = 0; i != 27; ++i) {
+                const int3 offset = stencil_offset(i);
+                if ((offset.x || offset.y || offset.z) &&
+                    neighbours[i] != no_neighbor) {
+                    iwb_accumulate(
+                            &sums,
+                            offset,
+                            read_pressure(current + source, neighbours[i]));
+                }
+            }
+            store_pressure(
+                    previous + source,
+                    index,
+                    iwb_stencil_sum(sums,
+                                    read_pressure(current + source, index)) -
+                            read_pressure(previous + source, index),
+                    error_flag);
+        }
+        return;
+    }
+
+    iwb_batch_node_update(previous,
+                          current,
+                          nodes,
+                          dimensions,
+                          index,
+                          boundary_data_1,
+                          num_boundaries_1,
+                          boundary_data_2,
+                          num_boundaries_2,
+                          boundary_data_3,
+                          num_boundaries_3,
+                          boundary_coefficients,
+                          filter_orders,
+                          error_flag);
 }
 
 )";
 
-program::program(const core::compute_context& cc)
+program::program(const core::compute_context& cc,
+                 pressure_precision precision,
+                 cl_int brick_size,
+                 size_t batch_size)
         : program_wrapper_{
                   cc,
                   std::vector<std::string>{
+                          batch_size_source(batch_size),
+                          cl_sources::pressure_storage(precision),
+                          cl_sources::node_layout(brick_size),
                           cl_sources::filter_constants,
                           core::cl_representation_v<filt_real>,
                           core::cl_representation_v<memory_biquad>,
@@ -553,7 +1458,9 @@ program::program(const core::compute_context& cc)
                           core::cl_representation_v<boundary_type>,
                           cl_sources::filters,
                           cl_sources::utils,
-                          source}} {}
+                          source,
+                          interpolated_source,
+                          batch_source}} {}
 
 }  // namespace waveguide
 }  // namespace wayverb
@@ -0,0 +1,127 @@
+#include "waveguide/reflectance_filter_cache.h"
+#include "waveguide/fitted_boundary.h"
+
+#include "utilities/map_to_vector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+namespace wayverb {
+namespace waveguide {
+
+namespace {
+
+struct timed_fit final {
+    coefficients_canonical coefficients;
+    double time;
+};
+
+timed_fit fit(const std::array<float, core::simulation_bands>& absorption,
+              double sample_rate) {
+    const auto begin = std::chrono::steady_clock::now();
+    const auto coefficients =
+            compute_reflectance_filter_coefficients(absorption, sample_rate);
+    const auto end = std::chrono::steady_clock::now();
+    return {coefficients, std::chrono::duration<double>(end - begin).count()};
+}
+
+}  // namespace
+
+reflectance_filter_cache_statistics& operator+=(
+        reflectance_filter_cache_statistics& a,
+        const reflectance_filter_cache_statistics& b) {
+    a.hits += b.hits;
+    a.misses += b.misses;
+    a.fit_time += b.fit_time;
+    return a;
+}
+
+reflectance_filter_cache::key_type reflectance_filter_cache::make_key(
+        const core::bands_type& absorption, double sample_rate) {
+    std::array<float, core::simulation_bands> ret;
+    std::copy(std::begin(absorption.s), std::end(absorption.s), ret.begin());
+    return key_type{ret, sample_rate, coefficients_canonical::order};
+}
+
+coefficients_canonical reflectance_filter_cache::get(
+        const core::bands_type& absorption, double sample_rate) {
+    return get(util::aligned::vector<core::bands_type>{absorption},
+               sample_rate)
+            .front();
+}
+
+util::aligned::vector<coefficients_canonical> reflectance_filter_cache::get(
+        const util::aligned::vector<core::bands_type>& absorption,
+        double sample_rate,
+        reflectance_filter_cache_statistics* statistics) {
+    util::aligned::vector<coefficients_canonical> ret(absorption.size());
+
+    //  Fill in everything we already know, and group the rest by key, so that
+    //  identical surfaces are only fitted once.
+    std::map<key_type, util::aligned::vector<size_t>> to_fit;
+    filters_.access([&](const auto& filters, const auto&) {
+        for (auto i = 0u; i != absorption.size(); ++i) {
+            const auto key = make_key(absorption[i], sample_rate);
+            const auto it = filters.find(key);
+            if (it != filters.end()) {
+                ret[i] = it->second;
+            } else {
+                to_fit[key].emplace_back(i);
+            }
+        }
+    });
+
+    //  Fit the misses in parallel, without holding the lock.
+    auto futures = util::map_to_vector(
+            begin(to_fit), end(to_fit), [&](const auto& i) {
+                return std::async(std::launch::async, [&] {
+                    return fit(std::get<0>(i.first), sample_rate);
+                });
+            });
+
+    auto fitted = util::map_to_vector(
+            begin(futures), end(futures), [](auto& i) { return i.get(); });
+
+    reflectance_filter_cache_statistics this_call;
+    this_call.misses = to_fit.size();
+    this_call.hits = absorption.size() - to_fit.size();
+
+    auto it = fitted.begin();
+    for (const auto& i : to_fit) {
+        for (const auto index : i.second) {
+            ret[index] = it->coefficients;
+        }
+        this_call.fit_time += it->time;
+        ++it;
+    }
+
+    filters_.access([&](auto& filters, auto& totals) {
+        auto it = fitted.begin();
+        for (const auto& i : to_fit) {
+            filters.emplace(i.first, it->coefficients);
+            ++it;
+        }
+        totals += this_call;
+    });
+
+    if (statistics) {
+        *statistics += this_call;
+    }
+    return ret;
+}
+
+reflectance_filter_cache_statistics reflectance_filter_cache::get_statistics()
+        const {
+    return filters_.get_statistics();
+}
+
+void reflectance_filter_cache::clear() { filters_.clear(); }
+
+reflectance_filter_cache& get_reflectance_filter_cache() {
+    static reflectance_filter_cache cache;
+    return cache;
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
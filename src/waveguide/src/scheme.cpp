@@ -0,0 +1,73 @@
+#include "waveguide/scheme.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace wayverb {
+namespace waveguide {
+
+double courant_number(scheme s) {
+    switch (s) {
+        case scheme::rectilinear: return 1 / std::sqrt(3.0);
+        case scheme::interpolated_wideband: return 1;
+    }
+    throw std::runtime_error{"Unrecognised waveguide scheme."};
+}
+
+stencil_weights get_stencil_weights(scheme s) {
+    switch (s) {
+        case scheme::rectilinear: return {1.0 / 3, 0, 0, 0};
+        case scheme::interpolated_wideband:
+            return {1.0 / 4, 1.0 / 8, 1.0 / 16, -1.5};
+    }
+    throw std::runtime_error{"Unrecognised waveguide scheme."};
+}
+
+namespace {
+
+/// Solves the scheme's dispersion relation for the normalised angular
+/// frequency (omega * T) of a plane wave with wave vector k * X.
+double compute_omega_t(const stencil_weights& w, const glm::dvec3& kx) {
+    const auto c = glm::cos(kx);
+    const auto axial = 2 * (c.x + c.y + c.z);
+    const auto side = 4 * (c.x * c.y + c.y * c.z + c.z * c.x);
+    const auto corner = 8 * c.x * c.y * c.z;
+    const auto cos_omega_t =
+            (w.axial * axial + w.side * side + w.corner * corner + w.centre) /
+            2;
+    return std::acos(std::max(-1.0, std::min(1.0, cos_omega_t)));
+}
+
+}  // namespace
+
+double compute_relative_phase_velocity(scheme s,
+                                       double normalised_frequency,
+                                       const glm::dvec3& direction) {
+    const auto weights = get_stencil_weights(s);
+    const auto dir = glm::normalize(direction);
+    const auto target = 2 * M_PI * normalised_frequency;
+
+    //  Search along the direction, up to the edge of the first Brillouin
+    //  zone.
+    auto lower = 0.0;
+    auto upper = M_PI / glm::max(std::abs(dir.x),
+                                 glm::max(std::abs(dir.y), std::abs(dir.z)));
+    if (!(0 < target && target < compute_omega_t(weights, upper * dir))) {
+        throw std::runtime_error{
+                "Frequency cannot propagate through the mesh in this "
+                "direction."};
+    }
+
+    for (auto i = 0; i != 100; ++i) {
+        const auto mid = (lower + upper) / 2;
+        (compute_omega_t(weights, mid * dir) < target ? lower : upper) = mid;
+    }
+
+    //  omega / k = (omega * T / (k * X)) * (X / T) = (omega * T / (k * X)) *
+    //  (c / courant)
+    return target / (courant_number(s) * (lower + upper) / 2);
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -1,14 +1,28 @@
 #include "waveguide/setup.h"
+#include "waveguide/fitted_boundary.h"
 #include "waveguide/mesh_setup_program.h"
 
 namespace wayverb {
 namespace waveguide {
 
+namespace {
+
+auto compute_filter_orders(
+        const util::aligned::vector<coefficients_canonical>& coefficients) {
+    return util::map_to_vector(
+            begin(coefficients), end(coefficients), [](const auto& i) {
+                return static_cast<cl_uint>(effective_order(i));
+            });
+}
+
+}  // namespace
+
 vectors::vectors(util::aligned::vector<condensed_node> nodes,
                  util::aligned::vector<coefficients_canonical> coefficients,
                  boundary_index_data boundary_index_data)
         : condensed_nodes_(std::move(nodes))
         , coefficients_(std::move(coefficients))
+        , filter_orders_(compute_filter_orders(coefficients_))
         , boundary_index_data_(std::move(boundary_index_data)) {
 #ifndef NDEBUG
     auto throw_if_mismatch = [&](auto checker, auto size) {
@@ -36,8 +50,15 @@ const util::aligned::vector<coefficients_canonical>& vectors::get_coefficients()
     return coefficients_;
 }
 
+const util::aligned::vector<cl_uint>& vectors::get_filter_orders() const {
+    return filter_orders_;
+}
+
 void vectors::set_coefficients(coefficients_canonical c) {
     std::fill(begin(coefficients_), end(coefficients_), c);
+    std::fill(begin(filter_orders_),
+              end(filter_orders_),
+              static_cast<cl_uint>(effective_order(c)));
 }
 
 void vectors::set_coefficients(
@@ -48,6 +69,7 @@ void vectors::set_coefficients(
                 "one in order to maintain object invariants.");
     }
     coefficients_ = std::move(c);
+    filter_orders_ = compute_filter_orders(coefficients_);
 }
 
 }  // namespace waveguide
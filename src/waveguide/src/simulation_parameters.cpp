@@ -0,0 +1,32 @@
+#include "waveguide/simulation_parameters.h"
+
+#include "hrtf/multiband.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace wayverb {
+namespace waveguide {
+
+double compute_band_cutoff(
+        const multiple_band_variable_spacing_parameters& params, size_t band) {
+    const auto edges = hrtf_data::hrtf_band_params_hz().edges;
+    if (edges.size() <= band + 1) {
+        throw std::runtime_error{"Band index out of range."};
+    }
+    return std::max(edges[band + 1], params.min_cutoff);
+}
+
+double compute_sampling_frequency(
+        const multiple_band_variable_spacing_parameters& params) {
+    if (!params.bands) {
+        throw std::runtime_error{"Must simulate at least one band."};
+    }
+    return compute_sampling_frequency(
+            compute_band_cutoff(params, params.bands - 1),
+            params.usable_portion,
+            params.scheme);
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
@@ -0,0 +1,182 @@
+#include "waveguide/slab.h"
+#include "waveguide/boundary_coefficient_finder.h"
+
+#include "core/conversions.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace wayverb {
+namespace waveguide {
+
+namespace {
+
+template <typename Pred>
+auto filter_indices(const util::aligned::vector<cl_uint>& indices,
+                    Pred pred) {
+    util::aligned::vector<cl_uint> ret;
+    std::copy_if(begin(indices), end(indices), std::back_inserter(ret), pred);
+    return ret;
+}
+
+template <typename Pred>
+node_partition filter_partition(const node_partition& p, Pred pred) {
+    return {filter_indices(p.inside, pred),
+            filter_indices(p.clipped, pred),
+            filter_indices(p.boundary_1, pred),
+            filter_indices(p.boundary_2, pred),
+            filter_indices(p.boundary_3, pred)};
+}
+
+template <size_t n>
+void push_boundary_index(const vectors& global,
+                         condensed_node& node,
+                         util::aligned::vector<boundary_index_array<n>>& out) {
+    const auto& indices = global.get_boundary_indices<n>();
+    out.emplace_back(indices[node.boundary_index]);
+    node.boundary_index = out.size() - 1;
+}
+
+/// Copy the layers [layer_begin, layer_end) along axis into a new mesh.
+/// Boundary indices are renumbered so that they refer to new, slab-local
+/// boundary arrays.
+mesh make_local_mesh(const mesh& global,
+                     size_t axis,
+                     int layer_begin,
+                     int layer_end) {
+    const auto& global_descriptor = global.get_descriptor();
+
+    auto descriptor = global_descriptor;
+    descriptor.dimensions.s[axis] = layer_end - layer_begin;
+    descriptor.min_corner.s[axis] += layer_begin * global_descriptor.spacing;
+
+    const auto& global_nodes = global.get_structure().get_condensed_nodes();
+
+    const auto num_nodes = compute_num_nodes(descriptor);
+    util::aligned::vector<condensed_node> nodes;
+    nodes.reserve(num_nodes);
+    boundary_index_data boundary_index_data{};
+
+    for (auto i = 0u; i != num_nodes; ++i) {
+        auto locator = compute_locator(descriptor, i);
+        locator[axis] += layer_begin;
+        auto node = global_nodes[compute_index(global_descriptor, locator)];
+
+        if (is_boundary<1>(node.boundary_type)) {
+            push_boundary_index(
+                    global.get_structure(), node, boundary_index_data.b1);
+        } else if (is_boundary<2>(node.boundary_type)) {
+            push_boundary_index(
+                    global.get_structure(), node, boundary_index_data.b2);
+        } else if (is_boundary<3>(node.boundary_type)) {
+            push_boundary_index(
+                    global.get_structure(), node, boundary_index_data.b3);
+        }
+
+        nodes.emplace_back(node);
+    }
+
+    return {descriptor,
+            vectors{std::move(nodes),
+                    global.get_structure().get_coefficients(),
+                    std::move(boundary_index_data)},
+            global.get_scheme()};
+}
+
+}  // namespace
+
+slab::slab(const mesh& global, size_t axis, int begin, int end)
+        : global_descriptor_{global.get_descriptor()}
+        , axis_{axis}
+        , begin_{begin}
+        , end_{end}
+        , halo_below_{begin != 0}
+        , halo_above_{end != global_descriptor_.dimensions.s[axis]}
+        , mesh_{make_local_mesh(global,
+                                axis,
+                                begin - halo_below_,
+                                end + halo_above_)} {
+    const auto& descriptor = mesh_.get_descriptor();
+    const auto first_owned = static_cast<int>(halo_below_);
+    const auto last_owned = first_owned + (end_ - begin_) - 1;
+
+    const auto layer = [&](auto index) {
+        return compute_locator(descriptor, index)[axis_];
+    };
+    const auto is_owned = [&](auto index) {
+        const auto l = layer(index);
+        return first_owned <= l && l <= last_owned;
+    };
+    const auto is_edge = [&](auto index) {
+        const auto l = layer(index);
+        return (halo_below_ && l == first_owned) ||
+               (halo_above_ && l == last_owned);
+    };
+
+    const auto owned = filter_partition(mesh_.get_node_partition(), is_owned);
+    edge_partition_ = filter_partition(owned, is_edge);
+    interior_partition_ =
+            filter_partition(owned, [&](auto i) { return !is_edge(i); });
+}
+
+const mesh& slab::get_mesh() const { return mesh_; }
+size_t slab::get_axis() const { return axis_; }
+int slab::get_begin() const { return begin_; }
+int slab::get_end() const { return end_; }
+bool slab::has_halo_below() const { return halo_below_; }
+bool slab::has_halo_above() const { return halo_above_; }
+
+const node_partition& slab::get_edge_partition() const {
+    return edge_partition_;
+}
+
+const node_partition& slab::get_interior_partition() const {
+    return interior_partition_;
+}
+
+int slab::to_local_layer(int global_layer) const {
+    return global_layer - begin_ + halo_below_;
+}
+
+size_t slab::to_local_index(size_t global_index) const {
+    auto locator = compute_locator(global_descriptor_, global_index);
+    locator[axis_] = to_local_layer(locator[axis_]);
+    return compute_index(mesh_.get_descriptor(), locator);
+}
+
+bool slab::owns(size_t global_index) const {
+    const auto l = compute_locator(global_descriptor_, global_index)[axis_];
+    return begin_ <= l && l < end_;
+}
+
+bool slab::contains(size_t global_index) const {
+    const auto l = compute_locator(global_descriptor_, global_index)[axis_];
+    return begin_ - halo_below_ <= l && l < end_ + halo_above_;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+size_t longest_axis(const mesh_descriptor& descriptor) {
+    const auto& dim = descriptor.dimensions.s;
+    return std::distance(dim, std::max_element(dim, dim + 3));
+}
+
+util::aligned::vector<slab> decompose(const mesh& mesh, size_t slabs) {
+    const auto axis = longest_axis(mesh.get_descriptor());
+    const auto layers = mesh.get_descriptor().dimensions.s[axis];
+    slabs = std::max(
+            size_t{1}, std::min(slabs, static_cast<size_t>(layers / 2)));
+
+    util::aligned::vector<slab> ret;
+    ret.reserve(slabs);
+    for (auto i = 0u; i != slabs; ++i) {
+        ret.emplace_back(mesh,
+                         axis,
+                         layers * i / slabs,
+                         layers * (i + 1) / slabs);
+    }
+    return ret;
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
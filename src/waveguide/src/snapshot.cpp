@@ -0,0 +1,257 @@
+#include "waveguide/snapshot.h"
+#include "waveguide/cl/utils.h"
+
+#include "core/conversions.h"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace wayverb {
+namespace waveguide {
+
+namespace {
+
+constexpr auto source = R"(
+size_t snapshot_input_index(int3 dimensions, int3 begin, int3 stride);
+size_t snapshot_input_index(int3 dimensions, int3 begin, int3 stride) {
+    const int3 pos = begin + stride * (int3)(get_global_id(0),
+                                             get_global_id(1),
+                                             get_global_id(2));
+    return to_index(pos, dimensions);
+}
+
+size_t snapshot_output_index();
+size_t snapshot_output_index() {
+    return get_global_id(0) +
+           get_global_id(1) * get_global_size(0) +
+           get_global_id(2) * get_global_size(0) * get_global_size(1);
+}
+
+kernel void snapshot_float(const global pressure_t* pressures,
+                           int3 dimensions,
+                           int3 begin,
+                           int3 stride,
+                           global float* output) {
+    output[snapshot_output_index()] = read_pressure(
+            pressures, snapshot_input_index(dimensions, begin, stride));
+}
+
+kernel void snapshot_short(const global pressure_t* pressures,
+                           int3 dimensions,
+                           int3 begin,
+                           int3 stride,
+                           float scale,
+                           global short* output) {
+    output[snapshot_output_index()] = convert_short_sat_rte(
+            read_pressure(pressures,
+                          snapshot_input_index(dimensions, begin, stride)) *
+            scale);
+}
+
+kernel void snapshot_char(const global pressure_t* pressures,
+                          int3 dimensions,
+                          int3 begin,
+                          int3 stride,
+                          float scale,
+                          global char* output) {
+    output[snapshot_output_index()] = convert_char_sat_rte(
+            read_pressure(pressures,
+                          snapshot_input_index(dimensions, begin, stride)) *
+            scale);
+}
+)";
+
+template <typename T>
+constexpr auto max_value() {
+    return static_cast<float>(std::numeric_limits<T>::max());
+}
+
+float compute_scale(snapshot_precision precision, float range) {
+    switch (precision) {
+        case snapshot_precision::float_32: return 1;
+        case snapshot_precision::int_16: return max_value<cl_short>() / range;
+        case snapshot_precision::int_8: return max_value<cl_char>() / range;
+    }
+}
+
+template <typename T>
+util::aligned::vector<float> dequantise(const pressure_snapshot& snapshot,
+                                        float scale) {
+    const auto num_values = snapshot.data.size() / sizeof(T);
+    util::aligned::vector<float> ret(num_values);
+    for (auto i = 0u; i != num_values; ++i) {
+        T value;
+        std::memcpy(&value, snapshot.data.data() + i * sizeof(T), sizeof(T));
+        ret[i] = value / scale;
+    }
+    return ret;
+}
+
+}  // namespace
+
+snapshot_region make_full_region(const mesh_descriptor& descriptor,
+                                 int stride) {
+    const auto& dim = descriptor.dimensions.s;
+    return {glm::ivec3{0},
+            glm::ivec3{dim[0], dim[1], dim[2]},
+            glm::ivec3{stride}};
+}
+
+snapshot_region make_slice_region(const mesh_descriptor& descriptor,
+                                  size_t axis,
+                                  int layer,
+                                  int stride) {
+    auto ret = make_full_region(descriptor, stride);
+    ret.begin[axis] = layer;
+    ret.end[axis] = layer + 1;
+    ret.stride[axis] = 1;
+    return ret;
+}
+
+glm::ivec3 compute_extent(const snapshot_region& region) {
+    return (region.end - region.begin + region.stride - 1) / region.stride;
+}
+
+util::aligned::vector<glm::vec3> compute_node_positions(
+        const mesh_descriptor& descriptor, const snapshot_region& region) {
+    util::aligned::vector<glm::vec3> ret;
+    const auto extent = compute_extent(region);
+    ret.reserve(extent.x * extent.y * extent.z);
+    for (auto z = region.begin.z; z < region.end.z; z += region.stride.z) {
+        for (auto y = region.begin.y; y < region.end.y; y += region.stride.y) {
+            for (auto x = region.begin.x; x < region.end.x;
+                 x += region.stride.x) {
+                ret.emplace_back(
+                        compute_position(descriptor, glm::ivec3{x, y, z}));
+            }
+        }
+    }
+    return ret;
+}
+
+util::aligned::vector<float> to_float(const pressure_snapshot& snapshot) {
+    const auto scale = compute_scale(snapshot.precision, snapshot.range);
+    switch (snapshot.precision) {
+        case snapshot_precision::float_32:
+            return dequantise<cl_float>(snapshot, scale);
+        case snapshot_precision::int_16:
+            return dequantise<cl_short>(snapshot, scale);
+        case snapshot_precision::int_8:
+            return dequantise<cl_char>(snapshot, scale);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+snapshot_program::snapshot_program(const core::compute_context& cc,
+                                   pressure_precision precision,
+                                   cl_int brick_size)
+        : wrapper_{cc,
+                   std::vector<std::string>{
+                           cl_sources::pressure_storage(precision),
+                           core::cl_representation_v<mesh_descriptor>,
+                           cl_sources::node_layout(brick_size),
+                           cl_sources::utils,
+                           source}} {}
+
+////////////////////////////////////////////////////////////////////////////////
+
+snapshot_reader::snapshot_reader(const core::compute_context& cc,
+                                 const mesh_descriptor& descriptor,
+                                 const snapshot_parameters& params,
+                                 pressure_precision precision)
+        : descriptor_{descriptor}
+        , params_{params}
+        , extent_{compute_extent(params.region)}
+        , precision_{precision}
+        , program_{cc, precision, descriptor.brick_size} {
+    const auto& dim = descriptor.dimensions.s;
+    const auto& r = params.region;
+    for (auto i = 0; i != 3; ++i) {
+        if (r.stride[i] < 1 || r.begin[i] < 0 || r.end[i] > dim[i] ||
+            r.end[i] <= r.begin[i]) {
+            throw std::runtime_error{"Invalid snapshot region."};
+        }
+    }
+
+    if (params.interval == 0) {
+        throw std::runtime_error{"Snapshot interval must be at least 1."};
+    }
+
+    if (!(0 < params.range)) {
+        throw std::runtime_error{"Snapshot range must be positive."};
+    }
+
+    output_ = cl::Buffer{cc.context,
+                         CL_MEM_WRITE_ONLY,
+                         extent_.x * extent_.y * extent_.z *
+                                 bytes_per_value(params.precision)};
+}
+
+bool snapshot_reader::is_due(size_t step) const {
+    return step % params_.interval == 0;
+}
+
+pressure_snapshot snapshot_reader::operator()(cl::CommandQueue& queue,
+                                              const pressure_buffer& buffer,
+                                              size_t /*step*/) {
+    if (buffer.get_precision() != precision_) {
+        throw std::runtime_error{
+                "Snapshot reader built for a different pressure precision."};
+    }
+
+    const cl::EnqueueArgs args{queue,
+                               cl::NDRange(extent_.x, extent_.y, extent_.z)};
+    const auto begin = core::to_cl_int3{}(params_.region.begin);
+    const auto stride = core::to_cl_int3{}(params_.region.stride);
+    const auto scale = compute_scale(params_.precision, params_.range);
+
+    switch (params_.precision) {
+        case snapshot_precision::float_32: {
+            auto kernel = program_.get_snapshot_float_kernel();
+            kernel(args,
+                   buffer,
+                   descriptor_.dimensions,
+                   begin,
+                   stride,
+                   output_);
+            break;
+        }
+        case snapshot_precision::int_16: {
+            auto kernel = program_.get_snapshot_short_kernel();
+            kernel(args,
+                   buffer,
+                   descriptor_.dimensions,
+                   begin,
+                   stride,
+                   scale,
+                   output_);
+            break;
+        }
+        case snapshot_precision::int_8: {
+            auto kernel = program_.get_snapshot_char_kernel();
+            kernel(args,
+                   buffer,
+                   descriptor_.dimensions,
+                   begin,
+                   stride,
+                   scale,
+                   output_);
+            break;
+        }
+    }
+
+    return {params_.region,
+            extent_,
+            params_.precision,
+            params_.range,
+            core::read_from_buffer<std::uint8_t>(queue, output_)};
+}
+
+const snapshot_parameters& snapshot_reader::get_parameters() const {
+    return params_;
+}
+
+}  // namespace waveguide
+}  // namespace wayverb
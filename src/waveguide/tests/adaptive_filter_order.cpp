@@ -0,0 +1,167 @@
+#include "test_mesh.h"
+
+#include "gtest/gtest.h"
+
+using namespace wayverb::waveguide;
+using namespace wayverb::waveguide::test;
+using namespace wayverb::core;
+
+namespace {
+
+constexpr auto sample_rate = 10000.0;
+
+using absorption_array = std::array<double, simulation_bands>;
+
+constexpr absorption_array sloped_absorption{
+        {0.05, 0.1, 0.2, 0.4, 0.6, 0.7, 0.8, 0.9}};
+
+TEST(adaptive_filter_order, flat) {
+    for (const auto absorption : {0.0, 0.1, 0.5, 0.9}) {
+        absorption_array flat;
+        flat.fill(absorption);
+
+        const auto coeffs =
+                compute_reflectance_filter_coefficients(flat, sample_rate, 0);
+        ASSERT_EQ(effective_order(coeffs), 0u);
+        ASSERT_NEAR(coeffs.b[0],
+                    absorption_to_pressure_reflectance(absorption),
+                    1.0e-12);
+
+        //  The impedance filter is exactly the flat one.
+        const auto impedance = to_impedance_coefficients(coeffs);
+        ASSERT_EQ(effective_order(impedance), 0u);
+        const auto expected = to_flat_coefficients(absorption);
+        ASSERT_NEAR(impedance.b[0], expected.b[0], 1.0e-12);
+        ASSERT_NEAR(impedance.a[0], expected.a[0], 1.0e-12);
+    }
+}
+
+TEST(adaptive_filter_order, sloped) {
+    const auto band_centres =
+            util::map([](auto i) { return i * 2; },
+                      hrtf_data::hrtf_band_centres(sample_rate));
+    const auto reflectance = util::map(
+            [](auto i) { return absorption_to_pressure_reflectance(i); },
+            sloped_absorption);
+
+    //  With no tolerance, only the full-order fit will do.
+    ASSERT_EQ(effective_order(compute_reflectance_filter_coefficients(
+                      sloped_absorption, sample_rate, 0)),
+              coefficients_canonical::order);
+
+    auto previous_order = coefficients_canonical::order;
+    for (const auto tolerance : {0.01, 0.05, 0.1, 0.2, 0.5}) {
+        const auto coeffs = compute_reflectance_filter_coefficients(
+                sloped_absorption, sample_rate, tolerance);
+        const auto order = effective_order(coeffs);
+
+        //  Looser tolerances never need higher orders.
+        ASSERT_LE(order, previous_order);
+        previous_order = order;
+
+        ASSERT_TRUE(is_stable(coeffs.a));
+
+        //  Anything below full order must be within tolerance.
+        if (order != coefficients_canonical::order) {
+            util::for_each(
+                    [&](auto frequency, auto target) {
+                        ASSERT_LE(std::abs(magnitude_response(coeffs,
+                                                              frequency) -
+                                           target),
+                                  tolerance);
+                    },
+                    band_centres,
+                    reflectance);
+        }
+    }
+
+    //  A tolerance wider than the whole range of reflectances is met by a
+    //  single gain.
+    ASSERT_EQ(effective_order(compute_reflectance_filter_coefficients(
+                      sloped_absorption, sample_rate, 1)),
+              0u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// A box where some walls have flat absorption and the others don't, so that
+/// boundary nodes use a mix of filter orders.
+auto make_mixed_mesh(const compute_context& cc) {
+    const auto box_scene = make_test_scene();
+    auto triangles = box_scene.get_triangles();
+    for (auto i = 0u; i != triangles.size() / 2; ++i) {
+        triangles[i].surface = 1;
+    }
+    const auto surface = make_surface<simulation_bands>(0.1, 0);
+    const decltype(box_scene) scene_data{
+            triangles, box_scene.get_vertices(), {surface, surface}};
+
+    auto ret = make_test_mesh(
+            cc, scene_data, scheme::rectilinear, 0, sample_rate);
+    ret.set_coefficients(util::aligned::vector<coefficients_canonical>{
+            to_flat_coefficients(0.1),
+            to_impedance_coefficients(compute_reflectance_filter_coefficients(
+                    sloped_absorption, sample_rate, 0))});
+    return ret;
+}
+
+TEST(adaptive_filter_order, filter_orders) {
+    const compute_context cc{};
+    auto mesh = make_mixed_mesh(cc);
+
+    const auto check_orders = [&] {
+        const auto& coefficients = mesh.get_structure().get_coefficients();
+        const auto& orders = mesh.get_structure().get_filter_orders();
+        ASSERT_EQ(coefficients.size(), orders.size());
+        for (auto i = 0u; i != coefficients.size(); ++i) {
+            ASSERT_EQ(orders[i], effective_order(coefficients[i]));
+        }
+    };
+
+    check_orders();
+    ASSERT_EQ(mesh.get_structure().get_filter_orders(),
+              (util::aligned::vector<cl_uint>{
+                      0, coefficients_canonical::order}));
+
+    //  Orders follow the coefficients when they change.
+    mesh.set_coefficients(to_flat_coefficients(0.5));
+    check_orders();
+}
+
+TEST(adaptive_filter_order, mixed_orders) {
+    const compute_context cc{};
+    const auto mesh = make_mixed_mesh(cc);
+
+    const auto aos = run_test_mesh(
+            cc, mesh, 200, mesh_state{}, boundary_layout::array_of_structs);
+    const auto soa = run_test_mesh(
+            cc, mesh, 200, mesh_state{}, boundary_layout::struct_of_arrays);
+
+    //  The struct-of-arrays layout skips the unused lanes of low-order
+    //  filters, but the results are the same.
+    ASSERT_EQ(aos.probes, soa.probes);
+    ASSERT_EQ(aos.state.boundary_1, soa.state.boundary_1);
+    ASSERT_EQ(aos.state.boundary_2, soa.state.boundary_2);
+    ASSERT_EQ(aos.state.boundary_3, soa.state.boundary_3);
+
+    //  Unused lanes stay empty.
+    const auto check_unused = [&](const auto& boundary_data) {
+        for (const auto& node : boundary_data) {
+            for (const auto& data : node.array) {
+                const auto& coeffs = mesh.get_structure()
+                                             .get_coefficients()
+                                             [data.coefficient_index];
+                for (auto i = effective_order(coeffs);
+                     i != memory_canonical::order;
+                     ++i) {
+                    ASSERT_EQ(data.filter_memory.array[i], 0);
+                }
+            }
+        }
+    };
+    check_unused(aos.state.boundary_1);
+    check_unused(aos.state.boundary_2);
+    check_unused(aos.state.boundary_3);
+}
+
+}  // namespace
@@ -0,0 +1,180 @@
+#include "test_mesh.h"
+
+#include "waveguide/batch.h"
+#include "waveguide/canonical.h"
+
+#include "gtest/gtest.h"
+
+#include <limits>
+
+using namespace wayverb::waveguide;
+using namespace wayverb::waveguide::test;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(batch, batch_size) {
+    const compute_context cc{};
+    const auto mesh = make_test_mesh(cc, scheme::rectilinear);
+
+    const auto shared = compute_shared_bytes(mesh);
+    const auto per_source =
+            compute_bytes_per_source(mesh, pressure_precision::single);
+    const auto unlimited = std::numeric_limits<size_t>::max();
+
+    //  Always at least one source, even if it won't fit.
+    ASSERT_EQ(compute_batch_size(
+                      0, unlimited, mesh, pressure_precision::single, 16),
+              1);
+
+    ASSERT_EQ(compute_batch_size(shared + 3 * per_source,
+                                 unlimited,
+                                 mesh,
+                                 pressure_precision::single,
+                                 16),
+              3);
+
+    //  Limited by the largest allocation.
+    const auto pressure_bytes =
+            mesh.get_structure().get_condensed_nodes().size() *
+            sizeof(cl_float);
+    ASSERT_EQ(compute_batch_size(unlimited / 2,
+                                 5 * pressure_bytes,
+                                 mesh,
+                                 pressure_precision::single,
+                                 16),
+              5);
+
+    //  Limited by the maximum.
+    ASSERT_EQ(compute_batch_size(unlimited / 2,
+                                 unlimited,
+                                 mesh,
+                                 pressure_precision::single,
+                                 16),
+              16);
+
+    //  Half-precision sources are smaller.
+    ASSERT_LT(compute_bytes_per_source(mesh, pressure_precision::half),
+              per_source);
+}
+
+auto run_single(const compute_context& cc,
+                const mesh& mesh,
+                const batch_source& source,
+                const util::aligned::vector<size_t>& probes,
+                pressure_precision precision) {
+    return run_test_mesh(cc,
+                         mesh,
+                         source.node,
+                         source.signal,
+                         probes,
+                         mesh_state{},
+                         boundary_layout::array_of_structs,
+                         precision)
+            .probes;
+}
+
+TEST(batch, matches_single) {
+    const compute_context cc{};
+
+    for (const auto s : {scheme::rectilinear, scheme::interpolated_wideband}) {
+        const auto mesh = make_test_mesh(cc, s);
+        const auto& descriptor = mesh.get_descriptor();
+
+        const auto make_signal = [](auto length, auto scale) {
+            util::aligned::vector<cl_float> ret(length, 0);
+            ret.front() = scale;
+            ret[5] = -scale / 2;
+            return ret;
+        };
+
+        //  Sources of different lengths, some near walls and corners.
+        const util::aligned::vector<batch_source> sources{
+                {compute_index(descriptor, glm::vec3{0.5, 0.75, 0.5}),
+                 make_signal(150, 1.0f)},
+                {compute_index(descriptor, glm::vec3{0.05, 0.05, 0.05}),
+                 make_signal(120, 2.0f)},
+                {compute_index(descriptor, glm::vec3{1.5, 1.2, 0.3}),
+                 make_signal(150, -1.0f)}};
+
+        const util::aligned::vector<size_t> probes{
+                compute_index(descriptor, glm::vec3{1.5, 0.75, 0.5}),
+                compute_index(descriptor, glm::vec3{1.95, 1.45, 0.95}),
+                sources.front().node};
+
+        for (const auto precision :
+             {pressure_precision::single, pressure_precision::half}) {
+            //  A batch size which doesn't divide the number of sources.
+            const auto batched =
+                    run_batch(cc, mesh, sources, probes, true, precision, 2);
+            ASSERT_EQ(batched.size(), sources.size());
+
+            for (auto i = 0u; i != sources.size(); ++i) {
+                ASSERT_EQ(batched[i],
+                          run_single(cc, mesh, sources[i], probes, precision));
+            }
+        }
+    }
+}
+
+TEST(batch, canonical) {
+    const compute_context cc{};
+    const auto scene_data = make_test_scene();
+    const glm::vec3 receiver{1, 0.75, 0.5};
+    const single_band_parameters params{500, 0.6};
+    const environment env{};
+
+    const auto voxelised =
+            compute_voxels_and_mesh(cc,
+                                    scene_data,
+                                    receiver,
+                                    compute_sampling_frequency(params),
+                                    env.speed_of_sound);
+
+    const util::aligned::vector<glm::vec3> sources{
+            glm::vec3{0.5, 0.75, 0.5}, glm::vec3{1.5, 0.5, 0.3}};
+
+    const auto batched = canonical_batch(
+            cc, voxelised, sources, receiver, env, params, 0.05, true);
+    ASSERT_TRUE(batched);
+    ASSERT_EQ(batched->size(), sources.size());
+
+    //  Each source matches a solo run with the same directional receiver.
+    for (auto i = 0u; i != sources.size(); ++i) {
+        const auto solo = canonical(cc,
+                                    voxelised,
+                                    sources[i],
+                                    receiver,
+                                    env,
+                                    params,
+                                    0.05,
+                                    true,
+                                    [](auto&&...) {});
+        ASSERT_TRUE(solo);
+
+        const auto& bands = (*batched)[i];
+        ASSERT_EQ(bands.size(), solo->size());
+        for (auto j = 0u; j != bands.size(); ++j) {
+            const auto& a = bands[j];
+            const auto& b = (*solo)[j];
+            ASSERT_EQ(a.valid_hz, b.valid_hz);
+            ASSERT_EQ(a.band.sample_rate, b.band.sample_rate);
+            ASSERT_EQ(a.band.directional.size(),
+                      b.band.directional.size());
+            ASSERT_FALSE(a.band.directional.empty());
+
+            for (auto k = 0u; k != a.band.directional.size(); ++k) {
+                ASSERT_EQ(a.band.directional[k].pressure,
+                          b.band.directional[k].pressure);
+                ASSERT_EQ(a.band.directional[k].intensity,
+                          b.band.directional[k].intensity);
+            }
+        }
+    }
+
+    //  Cancelling gives no result.
+    ASSERT_FALSE(canonical_batch(
+            cc, voxelised, sources, receiver, env, params, 0.05, false));
+}
+
+}  // namespace
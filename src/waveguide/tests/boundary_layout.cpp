@@ -0,0 +1,57 @@
+#include "test_mesh.h"
+
+#include "waveguide/boundary_layout.h"
+
+#include "gtest/gtest.h"
+
+using namespace wayverb::waveguide;
+using namespace wayverb::waveguide::test;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(boundary_layout, round_trip) {
+    util::aligned::vector<boundary_data_array_2> aos(5);
+    for (auto i = 0u; i != aos.size(); ++i) {
+        for (auto d = 0u; d != 2; ++d) {
+            aos[i].array[d].coefficient_index = i * 2 + d;
+            for (auto l = 0u; l != memory_canonical::order; ++l) {
+                aos[i].array[d].filter_memory.array[l] = i * 100 + d * 10 + l;
+            }
+        }
+    }
+
+    const auto soa = to_soa(aos);
+    ASSERT_EQ(size(soa), aos.size());
+
+    //  Check the layout is the one the kernel expects.
+    ASSERT_EQ(soa.coefficient_index[1 * 5 + 3],
+              aos[3].array[1].coefficient_index);
+    ASSERT_EQ(soa.filter_memory[(1 * memory_canonical::order + 4) * 5 + 2],
+              aos[2].array[1].filter_memory.array[4]);
+
+    ASSERT_EQ(to_aos(soa), aos);
+}
+
+TEST(boundary_layout, soa_matches_aos) {
+    const compute_context cc{};
+    const auto mesh = make_test_mesh(cc);
+
+    const auto aos = run_test_mesh(
+            cc, mesh, 200, mesh_state{}, boundary_layout::array_of_structs);
+    const auto soa = run_test_mesh(
+            cc, mesh, 200, mesh_state{}, boundary_layout::struct_of_arrays);
+
+    ASSERT_EQ(aos.probes, soa.probes);
+
+    //  Snapshots are always stored in the same layout, so a checkpoint from
+    //  either layout can be resumed with the other.
+    ASSERT_EQ(aos.state.step, soa.state.step);
+    ASSERT_EQ(aos.state.previous, soa.state.previous);
+    ASSERT_EQ(aos.state.current, soa.state.current);
+    ASSERT_EQ(aos.state.boundary_1, soa.state.boundary_1);
+    ASSERT_EQ(aos.state.boundary_2, soa.state.boundary_2);
+    ASSERT_EQ(aos.state.boundary_3, soa.state.boundary_3);
+}
+
+}  // namespace
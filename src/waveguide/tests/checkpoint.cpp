@@ -0,0 +1,115 @@
+#include "test_mesh.h"
+
+#include "waveguide/checkpoint.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdio>
+
+using namespace wayverb::waveguide;
+using namespace wayverb::waveguide::test;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(checkpoint, resume_matches_uninterrupted) {
+    const compute_context cc{};
+    const auto mesh = make_test_mesh(cc);
+
+    const auto source_index = test_source(mesh);
+    const auto receiver_index = test_receiver(mesh);
+    const auto input = make_test_input(200);
+
+    constexpr size_t resume_step = 100;
+
+    //  Run the whole thing, keeping a snapshot from half-way through.
+    callback_accumulator<postprocessor::node> full{receiver_index};
+    mesh_state saved{};
+    run(cc,
+        mesh,
+        preprocessor::make_hard_source(source_index, begin(input), end(input)),
+        [&](auto& queue, const auto& buffer, auto step) {
+            full(queue, buffer, step);
+        },
+        true,
+        mesh_state{},
+        50,
+        [&](auto state, auto ready) {
+            ready.wait();
+            if (state.step == resume_step) {
+                saved = std::move(state);
+            }
+        });
+
+    ASSERT_EQ(saved.step, resume_step);
+
+    //  Resume from the snapshot.
+    callback_accumulator<postprocessor::node> resumed{receiver_index};
+    const auto steps =
+            run(cc,
+                mesh,
+                preprocessor::make_hard_source(
+                        source_index, begin(input) + resume_step, end(input)),
+                [&](auto& queue, const auto& buffer, auto step) {
+                    resumed(queue, buffer, step);
+                },
+                true,
+                saved,
+                0,
+                [](auto&&...) {});
+
+    ASSERT_EQ(steps, input.size());
+    ASSERT_EQ(util::aligned::vector<float>(begin(full.get_output()) +
+                                                   resume_step,
+                                           end(full.get_output())),
+              resumed.get_output());
+}
+
+TEST(checkpoint, fingerprint_includes_brick_size) {
+    //  The brick size changes the node index map, so a checkpoint from one
+    //  layout can't be resumed with another.
+    const compute_context cc{};
+    ASSERT_NE(compute_fingerprint(make_test_mesh(cc, scheme::rectilinear, 0)),
+              compute_fingerprint(make_test_mesh(cc, scheme::rectilinear, 4)));
+}
+
+TEST(checkpoint, file_round_trip) {
+    const compute_context cc{};
+    const auto mesh = make_test_mesh(cc);
+    const auto fingerprint = compute_fingerprint(mesh);
+    const auto path = std::string{"checkpoint_test.bin"};
+
+    mesh_state state{};
+    state.step = 10;
+    state.previous = util::aligned::vector<cl_float>{1, 2, 3};
+    state.current = util::aligned::vector<cl_float>{4, 5, 6};
+    state.boundary_1 = get_boundary_data<1>(mesh.get_structure());
+
+    {
+        checkpoint_writer writer{path, fingerprint};
+
+        //  Make an event which has already completed.
+        cl::CommandQueue queue{cc.context, cc.device};
+        cl::Event ready;
+        queue.enqueueMarkerWithWaitList(nullptr, &ready);
+        queue.finish();
+
+        writer.write(state, ready, 42);
+        writer.wait();
+    }
+
+    const auto restored = read_checkpoint<int>(path, fingerprint);
+    ASSERT_TRUE(restored);
+    ASSERT_EQ(restored->extra, 42);
+    ASSERT_EQ(restored->mesh.step, state.step);
+    ASSERT_EQ(restored->mesh.previous, state.previous);
+    ASSERT_EQ(restored->mesh.current, state.current);
+    ASSERT_EQ(restored->mesh.boundary_1, state.boundary_1);
+
+    ASSERT_FALSE(read_checkpoint<int>(path, fingerprint + 1));
+    ASSERT_FALSE(read_checkpoint<int>("no_such_checkpoint.bin", fingerprint));
+
+    std::remove(path.c_str());
+}
+
+}  // namespace
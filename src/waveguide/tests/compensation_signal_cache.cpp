@@ -0,0 +1,96 @@
+#include "waveguide/make_transparent.h"
+
+#include "compensation_signal/cache.h"
+#include "compensation_signal/waveguide.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+using namespace wayverb::waveguide;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(compensation_signal_cache, hits) {
+    const compute_context cc{};
+    compensation_signal_cache cache;
+
+    const auto a = cache.get(cc, 100);
+    ASSERT_EQ(a.size(), 100u);
+    ASSERT_EQ(cache.get_statistics().misses, 1u);
+    ASSERT_EQ(cache.get_statistics().hits, 0u);
+
+    //  Repeated lengths aren't simulated again.
+    ASSERT_EQ(cache.get(cc, 100), a);
+    ASSERT_EQ(cache.get_statistics().misses, 1u);
+    ASSERT_EQ(cache.get_statistics().hits, 1u);
+
+    //  Odd lengths are trimmed, and the start of the signal doesn't depend on
+    //  how long it is.
+    const auto b = cache.get(cc, 51);
+    ASSERT_EQ(b.size(), 51u);
+    ASSERT_EQ(cache.get_statistics().misses, 2u);
+    ASSERT_TRUE(std::equal(b.begin(), b.end(), a.begin()));
+
+    cache.clear();
+    ASSERT_EQ(cache.get_statistics().misses, 0u);
+    ASSERT_EQ(cache.get_statistics().hits, 0u);
+}
+
+TEST(compensation_signal_cache, matches_built_in) {
+    //  The built-in signal is 512 samples long, from the same simulation.
+    const auto signal = compensation_signal_cache{}.get(compute_context{}, 512);
+
+    const std::vector<float> input{1, 2, 3, 4, 5, 4, 3, 2, 1};
+    const auto built_in =
+            make_transparent(input.data(), input.data() + input.size());
+    const auto generated = make_transparent(input.data(),
+                                            input.data() + input.size(),
+                                            signal.data(),
+                                            signal.data() + signal.size());
+
+    ASSERT_EQ(built_in.size(), generated.size());
+    for (auto i = 0u; i != built_in.size(); ++i) {
+        ASSERT_NEAR(built_in[i], generated[i], 1.0e-5);
+    }
+}
+
+TEST(compensation_signal_cache, soft_source) {
+    //  A soft source of an impulse is the same as a hard source, at least
+    //  until the first reflection gets back to the source node.
+    const compute_context cc{};
+    compressed_rectangular_waveguide waveguide{cc, 64};
+
+    const std::vector<float> impulse{0.0f, 1.0f};
+    const auto hard = waveguide.run_hard_source(
+            impulse.begin(), impulse.end(), [](auto) {});
+    const auto soft = waveguide.run_soft_source(
+            impulse.begin(), impulse.end(), [](auto) {});
+
+    ASSERT_EQ(hard.size(), 64u);
+    ASSERT_EQ(soft.size(), 64u);
+    ASSERT_EQ(hard[0], soft[0]);
+    ASSERT_EQ(hard[1], soft[1]);
+}
+
+TEST(compensation_signal_cache, progress) {
+    const compute_context cc{};
+    constexpr size_t steps = 200;
+    compressed_rectangular_waveguide waveguide{cc, steps};
+
+    const std::vector<float> impulse{0.0f, 1.0f};
+    std::vector<size_t> reported;
+    waveguide.run_hard_source(impulse.begin(),
+                              impulse.end(),
+                              [&](auto step) { reported.emplace_back(step); });
+
+    //  Every step is reported, in order, even though the device is only waited
+    //  on every so often.
+    ASSERT_EQ(reported.size(), steps);
+    for (auto i = 0u; i != reported.size(); ++i) {
+        ASSERT_EQ(reported[i], i);
+    }
+}
+
+}  // namespace
@@ -0,0 +1,85 @@
+#include "test_mesh.h"
+
+#include "waveguide/distributed.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace wayverb::waveguide;
+using namespace wayverb::waveguide::test;
+using namespace wayverb::core;
+
+namespace {
+
+/// Prefer sub-devices, but fall back to sharing a single device if the
+/// platform can't partition it.
+auto make_contexts(size_t count) {
+    const compute_context cc{};
+    try {
+        return make_sub_device_contexts(cc, count);
+    } catch (const std::exception&) {
+        return util::aligned::vector<compute_context>(count, cc);
+    }
+}
+
+TEST(distributed, slabs_cover_each_node_once) {
+    const compute_context cc{};
+    const auto mesh = make_test_mesh(cc);
+    const auto slabs = decompose(mesh, 3);
+    ASSERT_EQ(slabs.size(), 3);
+
+    const auto num_nodes = compute_num_nodes(mesh.get_descriptor());
+    for (auto i = 0u; i != num_nodes; ++i) {
+        const auto owners = std::count_if(
+                begin(slabs), end(slabs), [&](const auto& s) {
+                    return s.owns(i);
+                });
+        ASSERT_EQ(owners, 1) << i;
+    }
+
+    //  Every updated node should be updated by exactly one slab.
+    const auto count_updated = [](const node_partition& p) {
+        return p.inside.size() + p.clipped.size() + p.boundary_1.size() +
+               p.boundary_2.size() + p.boundary_3.size();
+    };
+    const auto total = std::accumulate(
+            begin(slabs), end(slabs), size_t{0}, [&](auto a, const auto& s) {
+                return a + count_updated(s.get_edge_partition()) +
+                       count_updated(s.get_interior_partition());
+            });
+    ASSERT_EQ(total, count_updated(mesh.get_node_partition()));
+}
+
+TEST(distributed, matches_single_device) {
+    const compute_context cc{};
+    const auto mesh = make_test_mesh(cc);
+
+    const auto source_index = test_source(mesh);
+    const auto receiver_index = test_receiver(mesh);
+    const auto input = make_test_input(200);
+
+    const auto single =
+            run_test_mesh(cc, mesh, source_index, input, {receiver_index});
+
+    callback_accumulator<postprocessor::node> distributed{receiver_index};
+    util::aligned::vector<cl_float> last_state;
+    run_distributed(
+            make_contexts(3),
+            mesh,
+            preprocessor::make_slab_hard_source(
+                    source_index, begin(input), end(input)),
+            [&](auto& slabs, auto step) {
+                distributed(slabs, step);
+                if (step == input.size() - 1) {
+                    last_state = slabs.read_all();
+                }
+            },
+            true);
+
+    ASSERT_EQ(single.probes.front(), distributed.get_output());
+    ASSERT_EQ(last_state.size(), compute_num_nodes(mesh.get_descriptor()));
+}
+
+}  // namespace
@@ -0,0 +1,238 @@
+#include "waveguide/config.h"
+#include "waveguide/mesh.h"
+#include "waveguide/postprocessor/node.h"
+#include "waveguide/preprocessor/hard_source.h"
+#include "waveguide/scheme.h"
+#include "waveguide/simulation_parameters.h"
+#include "waveguide/waveguide.h"
+
+#include "core/callback_accumulator.h"
+#include "core/geo/box.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace wayverb::waveguide;
+using namespace wayverb::core;
+
+namespace {
+
+/// Directions covering one octant, which is enough because both schemes are
+/// symmetric about each axis.
+auto octant_directions() {
+    util::aligned::vector<glm::dvec3> ret;
+    constexpr auto steps = 16;
+    for (auto i = 0; i <= steps; ++i) {
+        const auto azimuth = M_PI / 2 * i / steps;
+        for (auto j = 0; j <= steps; ++j) {
+            const auto elevation = M_PI / 2 * j / steps;
+            ret.emplace_back(std::cos(azimuth) * std::cos(elevation),
+                             std::sin(azimuth) * std::cos(elevation),
+                             std::sin(elevation));
+        }
+    }
+    return ret;
+}
+
+double max_dispersion_error(scheme s, double normalised_frequency) {
+    auto ret = 0.0;
+    for (const auto& direction : octant_directions()) {
+        ret = std::max(ret,
+                       std::abs(compute_relative_phase_velocity(
+                                        s, normalised_frequency, direction) -
+                                1));
+    }
+    return ret;
+}
+
+/// The highest frequency, as a proportion of the sample rate, at which the
+/// worst-case phase velocity error is still below the tolerance.
+double max_frequency_for_error(scheme s, double tolerance) {
+    auto ret = 0.0;
+    for (auto f = 0.001; f < valid_bandwidth(s); f += 0.001) {
+        if (tolerance < max_dispersion_error(s, f)) {
+            break;
+        }
+        ret = f;
+    }
+    return ret;
+}
+
+TEST(interpolated_scheme, config) {
+    constexpr auto c = 340.0;
+    constexpr auto sample_rate = 10000.0;
+
+    //  The default is unchanged.
+    ASSERT_EQ(config::grid_spacing(c, 1 / sample_rate),
+              config::grid_spacing(c, 1 / sample_rate, scheme::rectilinear));
+
+    for (const auto s : {scheme::rectilinear, scheme::interpolated_wideband}) {
+        const auto spacing = config::grid_spacing(c, 1 / sample_rate, s);
+        ASSERT_NEAR(c * (1 / sample_rate) / spacing, courant_number(s), 1e-9);
+        ASSERT_NEAR(config::time_step(c, spacing, s), 1 / sample_rate, 1e-12);
+        ASSERT_NEAR(config::speed_of_sound(1 / sample_rate, spacing, s),
+                    c,
+                    1e-9);
+
+        //  A constant field must stay constant.
+        const auto w = get_stencil_weights(s);
+        ASSERT_NEAR(6 * w.axial + 12 * w.side + 8 * w.corner + w.centre,
+                    2,
+                    1e-12);
+
+        ASSERT_NEAR(
+                compute_cutoff_frequency(
+                        compute_sampling_frequency(1000, 0.5, s), 0.5, s),
+                1000,
+                1e-9);
+    }
+}
+
+TEST(interpolated_scheme, dispersion) {
+    //  Plane waves along the axes travel at exactly the right speed in the
+    //  interpolated scheme, but not in the rectilinear scheme.
+    ASSERT_NEAR(compute_relative_phase_velocity(
+                        scheme::interpolated_wideband, 0.1, {1, 0, 0}),
+                1,
+                1e-6);
+    ASSERT_LT(compute_relative_phase_velocity(
+                      scheme::rectilinear, 0.1, {1, 0, 0}),
+              0.97);
+
+    //  The interpolated scheme is more accurate at every frequency.
+    for (auto f : {0.02, 0.05, 0.1, 0.15}) {
+        ASSERT_LT(max_dispersion_error(scheme::interpolated_wideband, f),
+                  max_dispersion_error(scheme::rectilinear, f));
+    }
+
+    //  Frequencies which can't propagate are rejected.
+    ASSERT_THROW(compute_relative_phase_velocity(
+                         scheme::rectilinear, 0.24, {1, 0, 0}),
+                 std::exception);
+}
+
+TEST(interpolated_scheme, cost_at_equal_error) {
+    constexpr auto tolerance = 0.01;
+    constexpr auto cutoff = 1000.0;
+    constexpr auto c = 340.0;
+
+    struct cost final {
+        double sample_rate;
+        double nodes_per_cubic_metre;
+        double reads_per_second;
+    };
+
+    const auto compute_cost = [&](scheme s, size_t stencil_points) {
+        const auto f = max_frequency_for_error(s, tolerance);
+        const auto sample_rate = cutoff / f;
+        const auto spacing = config::grid_spacing(c, 1 / sample_rate, s);
+        const auto nodes = 1 / (spacing * spacing * spacing);
+        return cost{sample_rate, nodes, nodes * sample_rate * stencil_points};
+    };
+
+    const auto rectilinear = compute_cost(scheme::rectilinear, 7);
+    const auto interpolated = compute_cost(scheme::interpolated_wideband, 27);
+
+    std::cout << "for " << tolerance * 100 << "% error at " << cutoff
+              << " Hz:\n";
+    for (const auto& i : {std::make_pair("rectilinear", rectilinear),
+                          std::make_pair("interpolated", interpolated)}) {
+        std::cout << "    " << i.first << ": " << i.second.sample_rate
+                  << " Hz, " << i.second.nodes_per_cubic_metre
+                  << " nodes/m^3, " << i.second.reads_per_second
+                  << " neighbour reads/m^3/s\n";
+    }
+
+    //  The interpolated scheme needs fewer nodes, fewer steps, and less work
+    //  overall, even though each node is more expensive.
+    ASSERT_LT(interpolated.sample_rate, rectilinear.sample_rate);
+    ASSERT_LT(interpolated.nodes_per_cubic_metre * 2,
+              rectilinear.nodes_per_cubic_metre);
+    ASSERT_LT(interpolated.reads_per_second, rectilinear.reads_per_second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Runs an impulse through a mesh built with the given scheme, and returns the
+/// signal at the receiver.
+auto run_impulse(const compute_context& cc,
+                 const single_band_parameters& params,
+                 const glm::vec3& source,
+                 const glm::vec3& receiver,
+                 size_t steps) {
+    const auto scene_data =
+            geo::get_scene_data(geo::box{glm::vec3{0}, glm::vec3{4, 3, 2.5}},
+                                make_surface<simulation_bands>(0.1, 0));
+    const auto mesh =
+            compute_voxels_and_mesh(cc,
+                                    scene_data,
+                                    receiver,
+                                    compute_sampling_frequency(params),
+                                    340,
+                                    node_classifier::scanline,
+                                    params.scheme)
+                    .mesh;
+
+    util::aligned::vector<float> input(steps, 0);
+    input.front() = 1;
+
+    callback_accumulator<postprocessor::node> output{
+            compute_index(mesh.get_descriptor(), receiver)};
+    run(cc,
+        mesh,
+        preprocessor::make_hard_source(
+                compute_index(mesh.get_descriptor(), source),
+                begin(input),
+                end(input)),
+        [&](auto& queue, const auto& buffer, auto step) {
+            output(queue, buffer, step);
+        },
+        true);
+    return output.get_output();
+}
+
+TEST(interpolated_scheme, arrival_time) {
+    const compute_context cc{};
+
+    const glm::vec3 source{1, 1, 1};
+    const glm::vec3 receiver{2.5, 2, 1.5};
+    const auto distance = glm::distance(source, receiver);
+
+    for (const auto s : {scheme::rectilinear, scheme::interpolated_wideband}) {
+        const single_band_parameters params{1000, 0.4, s};
+        const auto sample_rate = compute_sampling_frequency(params);
+        const auto steps = static_cast<size_t>(sample_rate * 0.05);
+
+        const auto output =
+                run_impulse(cc, params, source, receiver, steps);
+        ASSERT_EQ(output.size(), steps);
+
+        for (const auto& i : output) {
+            ASSERT_TRUE(std::isfinite(i));
+        }
+
+        //  The direct sound should be the loudest thing in the response.
+        const auto peak = std::distance(
+                begin(output),
+                std::max_element(
+                        begin(output), end(output), [](auto a, auto b) {
+                            return std::abs(a) < std::abs(b);
+                        }));
+        const auto expected = distance / 340 * sample_rate;
+        ASSERT_NEAR(peak, expected, expected * 0.05);
+
+        //  With lossy walls, the response should decay.
+        const auto energy = [&](auto b, auto e) {
+            return std::accumulate(
+                    b, e, 0.0, [](auto a, auto b) { return a + b * b; });
+        };
+        const auto quarter = steps / 4;
+        ASSERT_LT(energy(end(output) - quarter, end(output)),
+                  energy(begin(output), begin(output) + quarter));
+    }
+}
+
+}  // namespace
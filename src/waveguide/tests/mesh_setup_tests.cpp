@@ -1,10 +1,15 @@
 #include "waveguide/mesh.h"
 
+#include "core/geo/box.h"
 #include "core/scene_data_loader.h"
+#include "core/spatial_division/scene_buffers.h"
 #include "core/spatial_division/voxelised_scene_data.h"
 
 #include "gtest/gtest.h"
 
+#include <algorithm>
+#include <limits>
+
 #ifndef OBJ_PATH_BEDROOM
 #define OBJ_PATH_BEDROOM ""
 #endif
@@ -27,4 +32,99 @@ TEST(mesh_setup, setup) {
     const auto m = compute_mesh(compute_context{}, boundary, 0.1, 340);
 }
 
+//  The models here are watertight, so scanline classification should agree
+//  exactly with the per-node test.
+TEST(mesh_setup, scanline_matches_per_node) {
+    const compute_context cc{};
+    const auto check = [&](const auto& voxelised) {
+        const auto per_node = compute_mesh(
+                cc, voxelised, 0.1, 340, node_classifier::per_node);
+        const auto scanline = compute_mesh(
+                cc, voxelised, 0.1, 340, node_classifier::scanline);
+        ASSERT_EQ(per_node.get_structure().get_condensed_nodes(),
+                  scanline.get_structure().get_condensed_nodes());
+    };
+
+    check(get_voxelised(
+            geo::get_scene_data(geo::box{glm::vec3{0}, glm::vec3{2, 1.5, 1}},
+                                make_surface<simulation_bands>(0.1, 0))));
+
+    check(get_voxelised(scene_with_extracted_surfaces(
+            *scene_data_loader{OBJ_PATH_BEDROOM}.get_scene_data(),
+            util::aligned::unordered_map<std::string,
+                                         surface<simulation_bands>>{})));
+}
+
+//  Each 1d boundary node should take the surface of its closest triangle.
+TEST(mesh_setup, boundary_surfaces_match_brute_force) {
+    const auto voxelised = get_voxelised(scene_with_extracted_surfaces(
+            *scene_data_loader{OBJ_PATH_BEDROOM}.get_scene_data(),
+            util::aligned::unordered_map<std::string,
+                                         surface<simulation_bands>>{}));
+    const auto m = compute_mesh(compute_context{}, voxelised, 0.1, 340);
+
+    const auto& triangles = voxelised.get_scene_data().get_triangles();
+    const auto& vertices = voxelised.get_scene_data().get_vertices();
+    const auto& nodes = m.get_structure().get_condensed_nodes();
+    const auto& boundary = m.get_structure().get_boundary_indices<1>();
+
+    for (auto i = 0u; i != nodes.size(); ++i) {
+        if (!is_boundary<1>(nodes[i].boundary_type)) {
+            continue;
+        }
+
+        const auto pt = compute_position(m.get_descriptor(), i);
+        const auto surface = boundary[nodes[i].boundary_index].array[0];
+
+        //  Find the closest triangle overall, and the closest triangle with
+        //  the chosen surface.
+        //  These should be the same distance away, allowing for
+        //  floating-point differences between host and device.
+        auto closest = std::numeric_limits<float>::infinity();
+        auto closest_with_surface = std::numeric_limits<float>::infinity();
+        for (const auto& tri : triangles) {
+            const auto d = geo::point_triangle_distance_squared(
+                    geo::get_triangle_vec3(tri, vertices.data()), pt);
+            closest = std::min(closest, d);
+            if (tri.surface == surface) {
+                closest_with_surface = std::min(closest_with_surface, d);
+            }
+        }
+
+        ASSERT_NEAR(closest, closest_with_surface, 1.0e-5);
+    }
+}
+
+//  The device-side indexing should match the original host passes exactly.
+TEST(mesh_setup, device_boundary_indices_match_host) {
+    const compute_context cc{};
+    const auto voxelised = get_voxelised(scene_with_extracted_surfaces(
+            *scene_data_loader{OBJ_PATH_BEDROOM}.get_scene_data(),
+            util::aligned::unordered_map<std::string,
+                                         surface<simulation_bands>>{}));
+    const auto m = compute_mesh(cc, voxelised, 0.1, 340);
+
+    //  The host passes reassign every boundary index from scratch, so they
+    //  can be run on the finished nodes.
+    auto nodes = m.get_structure().get_condensed_nodes();
+    const auto buffers = make_scene_buffers(cc.context, voxelised);
+    const auto host = compute_boundary_index_data(
+            cc.device, buffers, m.get_descriptor(), nodes);
+
+    ASSERT_EQ(nodes, m.get_structure().get_condensed_nodes());
+
+    const auto check = [](const auto& a, const auto& b) {
+        ASSERT_EQ(a.size(), b.size());
+        for (auto i = 0u; i != a.size(); ++i) {
+            ASSERT_TRUE(std::equal(std::begin(a[i].array),
+                                   std::end(a[i].array),
+                                   std::begin(b[i].array)));
+        }
+    };
+
+    check(host.b1, m.get_structure().get_boundary_indices<1>());
+    check(host.b2, m.get_structure().get_boundary_indices<2>());
+    check(host.b3, m.get_structure().get_boundary_indices<3>());
+}
+
 }  // namespace
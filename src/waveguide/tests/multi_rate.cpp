@@ -0,0 +1,73 @@
+#include "waveguide/canonical.h"
+#include "waveguide/simulation_parameters.h"
+
+#include "core/cl/common.h"
+#include "core/geo/box.h"
+
+#include "gtest/gtest.h"
+
+using namespace wayverb::waveguide;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(multi_rate, band_cutoffs) {
+    const auto edges = hrtf_data::hrtf_band_params_hz().edges;
+    const multiple_band_variable_spacing_parameters params{4, 100, 0.6};
+
+    //  Low bands are grouped at the minimum cutoff.
+    ASSERT_EQ(compute_band_cutoff(params, 0), 100);
+    ASSERT_EQ(compute_band_cutoff(params, 1), edges[2]);
+    ASSERT_EQ(compute_band_cutoff(params, 3), edges[4]);
+
+    ASSERT_EQ(compute_sampling_frequency(params),
+              compute_sampling_frequency(edges[4], 0.6));
+
+    ASSERT_THROW(compute_band_cutoff(params, edges.size()), std::exception);
+}
+
+TEST(multi_rate, run) {
+    const compute_context cc{};
+    const environment env{};
+
+    const glm::vec3 source{1, 1.5, 1.25};
+    const glm::vec3 receiver{3, 1.5, 1.25};
+
+    const multiple_band_variable_spacing_parameters params{3, 200, 0.6};
+
+    auto voxelised = compute_voxels_and_mesh(
+            cc,
+            geo::get_scene_data(geo::box{glm::vec3{0}, glm::vec3{4, 3, 2.5}},
+                                make_surface<simulation_bands>(0.1, 0)),
+            receiver,
+            compute_sampling_frequency(params),
+            env.speed_of_sound);
+
+    const std::atomic_bool keep_going{true};
+    size_t callbacks = 0;
+    const auto results = canonical(cc,
+                                   std::move(voxelised),
+                                   source,
+                                   receiver,
+                                   env,
+                                   params,
+                                   0.1,
+                                   keep_going,
+                                   [&](auto&&...) { callbacks += 1; });
+
+    ASSERT_TRUE(results);
+    ASSERT_EQ(results->size(), params.bands);
+
+    //  The two lowest bands share a mesh, and the top band is finer.
+    const auto& r = *results;
+    ASSERT_EQ(r[0].band.sample_rate, r[1].band.sample_rate);
+    ASSERT_LT(r[1].band.sample_rate, r[2].band.sample_rate);
+    ASSERT_NEAR(r[2].band.sample_rate,
+                compute_sampling_frequency(params),
+                compute_sampling_frequency(params) * 0.001);
+
+    //  Only the top band runs on the supplied mesh.
+    ASSERT_EQ(callbacks, r[2].band.directional.size());
+}
+
+}  // namespace
@@ -0,0 +1,99 @@
+#include "test_mesh.h"
+
+#include "waveguide/program.h"
+
+#include "gtest/gtest.h"
+
+using namespace wayverb::waveguide;
+using namespace wayverb::waveguide::test;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(node_partition, covers_each_updated_node_once) {
+    const compute_context cc{};
+    const auto mesh = make_test_mesh(cc);
+    const auto& nodes = mesh.get_structure().get_condensed_nodes();
+    const auto& partition = mesh.get_node_partition();
+
+    util::aligned::vector<int> seen(nodes.size(), 0);
+    const auto visit = [&](const auto& indices, auto predicate) {
+        for (const auto i : indices) {
+            ASSERT_TRUE(predicate(nodes[i].boundary_type)) << i;
+            seen[i] += 1;
+        }
+    };
+
+    const auto is_inside_or_reentrant = [](auto i) {
+        return i == id_inside || i == id_reentrant;
+    };
+    visit(partition.inside, is_inside_or_reentrant);
+    visit(partition.clipped, is_inside_or_reentrant);
+    visit(partition.boundary_1, is_boundary<1>);
+    visit(partition.boundary_2, is_boundary<2>);
+    visit(partition.boundary_3, is_boundary<3>);
+
+    for (auto i = 0u; i != nodes.size(); ++i) {
+        ASSERT_EQ(nodes[i].boundary_type != id_none, seen[i] == 1) << i;
+    }
+}
+
+TEST(node_partition, matches_condensed_kernel) {
+    const compute_context cc{};
+    const auto mesh = make_test_mesh(cc);
+
+    const auto source_index = test_source(mesh);
+    const auto receiver_index = test_receiver(mesh);
+    const auto input = make_test_input(200);
+
+    //  Run using the partitioned kernels.
+    const auto partitioned =
+            run_test_mesh(cc, mesh, source_index, input, {receiver_index});
+
+    //  Run the same simulation using the single branching kernel.
+    const auto num_nodes = mesh.get_structure().get_condensed_nodes().size();
+    const program program{cc};
+    cl::CommandQueue queue{cc.context, cc.device};
+    const util::aligned::vector<cl_float> zeros(num_nodes, 0);
+    auto previous = load_to_buffer(cc.context, zeros, false);
+    auto current = load_to_buffer(cc.context, zeros, false);
+    const auto nodes = load_to_buffer(
+            cc.context, mesh.get_structure().get_condensed_nodes(), true);
+    const auto coefficients = load_to_buffer(
+            cc.context, mesh.get_structure().get_coefficients(), true);
+    const auto filter_orders = load_to_buffer(
+            cc.context, mesh.get_structure().get_filter_orders(), true);
+    auto b1 = load_to_buffer(
+            cc.context, get_boundary_data<1>(mesh.get_structure()), false);
+    auto b2 = load_to_buffer(
+            cc.context, get_boundary_data<2>(mesh.get_structure()), false);
+    auto b3 = load_to_buffer(
+            cc.context, get_boundary_data<3>(mesh.get_structure()), false);
+    cl::Buffer error_flag{cc.context, CL_MEM_READ_WRITE, sizeof(cl_int)};
+    write_value(queue, error_flag, 0, cl_int{id_success});
+
+    auto kernel = program.get_kernel();
+    util::aligned::vector<float> condensed;
+    for (const auto sample : input) {
+        write_value(queue, current, source_index, sample);
+        kernel(cl::EnqueueArgs{queue, cl::NDRange{num_nodes}},
+               previous,
+               current,
+               nodes,
+               mesh.get_descriptor().dimensions,
+               b1,
+               b2,
+               b3,
+               coefficients,
+               filter_orders,
+               error_flag);
+        condensed.emplace_back(
+                read_value<cl_float>(queue, current, receiver_index));
+        std::swap(previous, current);
+    }
+
+    ASSERT_EQ(read_value<cl_int>(queue, error_flag, 0), id_success);
+    ASSERT_EQ(partitioned.probes.front(), condensed);
+}
+
+}  // namespace
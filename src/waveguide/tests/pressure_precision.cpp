@@ -0,0 +1,121 @@
+#include "test_mesh.h"
+
+#include "waveguide/pressure_precision.h"
+
+#include "utilities/decibels.h"
+
+#include "gtest/gtest.h"
+
+#include <cmath>
+
+using namespace wayverb::waveguide;
+using namespace wayverb::waveguide::test;
+using namespace wayverb::core;
+
+namespace {
+
+TEST(pressure_precision, conversions) {
+    ASSERT_EQ(to_half(0.0f), 0x0000);
+    ASSERT_EQ(to_half(-0.0f), 0x8000);
+    ASSERT_EQ(to_half(1.0f), 0x3c00);
+    ASSERT_EQ(to_half(-2.0f), 0xc000);
+    ASSERT_EQ(to_half(65504.0f), 0x7bff);
+    ASSERT_EQ(to_half(65520.0f), 0x7c00);
+    ASSERT_EQ(to_half(std::ldexp(1.0f, -24)), 0x0001);
+    ASSERT_EQ(to_half(std::ldexp(1.0f, -25)), 0x0000);
+
+    //  Ties round to even.
+    ASSERT_EQ(to_half(1.0f + std::ldexp(1.0f, -11)), 0x3c00);
+    ASSERT_EQ(to_half(1.0f + 3 * std::ldexp(1.0f, -11)), 0x3c02);
+
+    //  Every half which isn't a nan survives a round trip.
+    for (auto i = 0u; i != 0x10000; ++i) {
+        const auto h = static_cast<cl_half>(i);
+        const auto f = from_half(h);
+        if (!std::isnan(f)) {
+            ASSERT_EQ(to_half(f), h);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+auto run_with_precision(const compute_context& cc,
+                        const mesh& mesh,
+                        size_t steps,
+                        pressure_precision precision,
+                        const mesh_state& initial = mesh_state{}) {
+    return run_test_mesh(cc,
+                         mesh,
+                         steps,
+                         initial,
+                         boundary_layout::array_of_structs,
+                         precision);
+}
+
+/// The largest difference between two signals, relative to the peak of the
+/// first.
+float relative_error(const util::aligned::vector<float>& reference,
+                     const util::aligned::vector<float>& test) {
+    auto peak = 0.0f;
+    auto error = 0.0f;
+    for (auto i = 0u; i != reference.size(); ++i) {
+        peak = std::max(peak, std::abs(reference[i]));
+        error = std::max(error, std::abs(reference[i] - test[i]));
+    }
+    return error / peak;
+}
+
+TEST(pressure_precision, half_matches_single) {
+    const compute_context cc{};
+
+    for (const auto s : {scheme::rectilinear, scheme::interpolated_wideband}) {
+        const auto mesh = make_test_mesh(cc, s);
+        constexpr auto steps = 400;
+
+        const auto single =
+                run_with_precision(cc, mesh, steps, pressure_precision::single);
+        const auto half =
+                run_with_precision(cc, mesh, steps, pressure_precision::half);
+
+        ASSERT_EQ(single.probes.front().size(), half.probes.front().size());
+
+        const auto output_error =
+                relative_error(single.probes.front(), half.probes.front());
+        const auto state_error =
+                relative_error(single.state.current, half.state.current);
+
+        std::cout << (s == scheme::rectilinear ? "rectilinear: "
+                                               : "interpolated wideband: ")
+                  << "receiver error " << util::decibels::a2db(output_error)
+                  << " dB, mesh error " << util::decibels::a2db(state_error)
+                  << " dB (relative to peak)\n";
+
+        //  Storage is accurate to about -66 dB, and rounding errors
+        //  accumulate slowly over the run.
+        ASSERT_LT(output_error, 1e-2);
+        ASSERT_LT(state_error, 1e-2);
+    }
+}
+
+TEST(pressure_precision, resume) {
+    const compute_context cc{};
+    const auto mesh = make_test_mesh(cc, scheme::rectilinear);
+
+    //  Saved states are single precision, so a half-precision run can be
+    //  stopped and resumed without changing the result.
+    const auto whole =
+            run_with_precision(cc, mesh, 200, pressure_precision::half);
+
+    auto first = run_with_precision(cc, mesh, 100, pressure_precision::half);
+    const auto second = run_with_precision(
+            cc, mesh, 200, pressure_precision::half, first.state);
+
+    auto& output = first.probes.front();
+    output.insert(output.end(),
+                  second.probes.front().begin(),
+                  second.probes.front().end());
+    ASSERT_EQ(output, whole.probes.front());
+}
+
+}  // namespace
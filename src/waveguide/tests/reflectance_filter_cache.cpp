@@ -0,0 +1,64 @@
+#include "waveguide/fitted_boundary.h"
+#include "waveguide/reflectance_filter_cache.h"
+
+#include "gtest/gtest.h"
+
+using namespace wayverb::waveguide;
+using namespace wayverb::core;
+
+namespace {
+
+void assert_equal(const coefficients_canonical& a,
+                  const coefficients_canonical& b) {
+    for (auto i = 0u; i != coefficients_canonical::order + 1; ++i) {
+        ASSERT_EQ(a.b[i], b.b[i]);
+        ASSERT_EQ(a.a[i], b.a[i]);
+    }
+}
+
+TEST(reflectance_filter_cache, matches_direct_fit) {
+    reflectance_filter_cache cache;
+    const auto absorption = make_bands_type(0.2);
+    const auto sample_rate = 10000.0;
+
+    assert_equal(cache.get(absorption, sample_rate),
+                 compute_reflectance_filter_coefficients(absorption.s,
+                                                         sample_rate));
+}
+
+TEST(reflectance_filter_cache, statistics) {
+    reflectance_filter_cache cache;
+    const util::aligned::vector<bands_type> absorption{make_bands_type(0.1),
+                                                       make_bands_type(0.5),
+                                                       make_bands_type(0.1)};
+
+    //  The repeated surface is only fitted once.
+    const auto first = cache.get(absorption, 10000);
+    ASSERT_EQ(cache.get_statistics().misses, 2);
+    ASSERT_EQ(cache.get_statistics().hits, 1);
+    ASSERT_LT(0, cache.get_statistics().fit_time);
+    assert_equal(first[0], first[2]);
+
+    //  Everything is cached now.
+    const auto second = cache.get(absorption, 10000);
+    ASSERT_EQ(cache.get_statistics().misses, 2);
+    ASSERT_EQ(cache.get_statistics().hits, 4);
+    for (auto i = 0u; i != absorption.size(); ++i) {
+        assert_equal(first[i], second[i]);
+    }
+
+    //  A new sample rate needs new filters.
+    //  Callers can also see what a single call cost.
+    reflectance_filter_cache_statistics this_call;
+    cache.get(absorption, 20000, &this_call);
+    ASSERT_EQ(cache.get_statistics().misses, 4);
+    ASSERT_EQ(this_call.misses, 2);
+    ASSERT_EQ(this_call.hits, 1);
+    ASSERT_LT(0, this_call.fit_time);
+
+    cache.clear();
+    ASSERT_EQ(cache.get_statistics().misses, 0);
+    ASSERT_EQ(cache.get_statistics().hits, 0);
+}
+
+}  // namespace
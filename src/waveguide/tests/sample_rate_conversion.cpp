@@ -1,11 +1,17 @@
 #include "waveguide/config.h"
 
+#include "core/resampler.h"
+
 #include "audio_file/audio_file.h"
 
 #include "utilities/string_builder.h"
 
 #include "gtest/gtest.h"
 
+#include "samplerate.h"
+
+#include <cmath>
+
 namespace {
 
 template <typename T>
@@ -26,8 +32,67 @@ void scale_and_write(double scale,
             audio_file::bit_depth::pcm16);
 }
 
+/// The converter which adjust_sampling_rate used to use.
+auto libsamplerate_convert(const util::aligned::vector<float>& input,
+                           double in_sr,
+                           double out_sr) {
+    const auto ratio = out_sr / in_sr;
+    util::aligned::vector<float> ret(std::ceil(ratio * input.size()));
+    SRC_DATA data{input.data(),
+                  ret.data(),
+                  static_cast<long>(input.size()),
+                  static_cast<long>(ret.size()),
+                  0,
+                  0,
+                  0,
+                  ratio};
+    src_simple(&data, SRC_SINC_BEST_QUALITY, 1);
+    return ret;
+}
+
+/// A few sines, all well inside the passband.
+auto make_test_signal(double sample_rate, size_t length) {
+    util::aligned::vector<float> ret(length);
+    for (auto i = 0u; i != length; ++i) {
+        const auto t = i / sample_rate;
+        ret[i] = 0.5 * std::sin(2 * M_PI * 0.05 * sample_rate * t) +
+                 0.3 * std::sin(2 * M_PI * 0.17 * sample_rate * t) +
+                 0.2 * std::sin(2 * M_PI * 0.31 * sample_rate * t);
+    }
+    return ret;
+}
+
 }  // namespace
 
+TEST(sample_rate_conversion, compare_with_libsamplerate) {
+    for (const auto& rates : {std::make_pair(1000.0, 44100.0),
+                              std::make_pair(1774.2, 44100.0),
+                              std::make_pair(44100.0, 48000.0)}) {
+        const auto input = make_test_signal(rates.first, 20000);
+        const auto expected =
+                libsamplerate_convert(input, rates.first, rates.second);
+        const auto actual =
+                wayverb::core::resample(input.data(),
+                                        input.size(),
+                                        rates.first,
+                                        rates.second,
+                                        wayverb::core::resampler_best);
+
+        //  Compare the middle of the signals, away from edge effects.
+        const auto length = std::min(expected.size(), actual.size());
+        double error = 0;
+        double energy = 0;
+        for (auto i = length / 4; i != length * 3 / 4; ++i) {
+            const auto diff = expected[i] - actual[i];
+            error += diff * diff;
+            energy += expected[i] * expected[i];
+        }
+
+        const auto relative_error = std::sqrt(error / energy);
+        ASSERT_LT(relative_error, 1.0e-3);
+    }
+}
+
 TEST(sample_rate_conversion, convert) {
     std::vector<float> input(1000, 0.0);
     input[200] = 1.0;
@@ -0,0 +1,147 @@
+#include "waveguide/snapshot.h"
+
+#include "core/cl/common.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+
+using namespace wayverb::waveguide;
+using namespace wayverb::core;
+
+namespace {
+
+const mesh_descriptor descriptor{cl_float3{{0, 0, 0, 0}},
+                                 cl_int3{{7, 5, 4, 0}},
+                                 1,
+                                 0};
+
+auto make_pressures() {
+    util::aligned::vector<cl_float> ret(compute_num_nodes(descriptor));
+    for (auto i = 0u; i != ret.size(); ++i) {
+        ret[i] = (i % 11) / 10.0f - 0.5f;
+    }
+    return ret;
+}
+
+/// Select the region on the host, for comparison.
+auto select(const util::aligned::vector<cl_float>& pressures,
+            const snapshot_region& region) {
+    util::aligned::vector<float> ret;
+    for (auto z = region.begin.z; z < region.end.z; z += region.stride.z) {
+        for (auto y = region.begin.y; y < region.end.y; y += region.stride.y) {
+            for (auto x = region.begin.x; x < region.end.x;
+                 x += region.stride.x) {
+                ret.emplace_back(pressures[compute_index(
+                        descriptor, glm::ivec3{x, y, z})]);
+            }
+        }
+    }
+    return ret;
+}
+
+TEST(snapshot, strided_float) {
+    const compute_context cc{};
+    cl::CommandQueue queue{cc.context, cc.device};
+    const auto pressures = make_pressures();
+    const auto buffer = load_to_buffer(cc.context, pressures, true);
+
+    snapshot_parameters params{};
+    params.region = make_full_region(descriptor, 2);
+    params.precision = snapshot_precision::float_32;
+    snapshot_reader reader{cc, descriptor, params};
+
+    const auto snapshot = reader(queue, buffer, 0);
+    ASSERT_EQ(snapshot.extent, glm::ivec3(4, 3, 2));
+    ASSERT_EQ(to_float(snapshot), select(pressures, params.region));
+}
+
+TEST(snapshot, quantised_slice) {
+    const compute_context cc{};
+    cl::CommandQueue queue{cc.context, cc.device};
+    const auto pressures = make_pressures();
+    const auto buffer = load_to_buffer(cc.context, pressures, true);
+
+    for (const auto precision :
+         {snapshot_precision::int_16, snapshot_precision::int_8}) {
+        snapshot_parameters params{};
+        params.region = make_slice_region(descriptor, 1, 2);
+        params.precision = precision;
+        params.range = 0.5;
+        snapshot_reader reader{cc, descriptor, params};
+
+        const auto snapshot = reader(queue, buffer, 0);
+        ASSERT_EQ(snapshot.data.size(),
+                  7 * 4 * bytes_per_value(precision));
+
+        const auto expected = select(pressures, params.region);
+        const auto actual = to_float(snapshot);
+        ASSERT_EQ(expected.size(), actual.size());
+
+        const auto tolerance = precision == snapshot_precision::int_8
+                                       ? 0.5 / 127
+                                       : 0.5 / 32767;
+        for (auto i = 0u; i != expected.size(); ++i) {
+            //  Values outside the range are clipped.
+            const auto clipped = std::max(-0.5f, std::min(0.5f, expected[i]));
+            ASSERT_NEAR(clipped, actual[i], tolerance);
+        }
+    }
+}
+
+TEST(snapshot, half_precision) {
+    const compute_context cc{};
+    cl::CommandQueue queue{cc.context, cc.device};
+    const auto pressures = make_pressures();
+    const pressure_buffer buffer{
+            cc.context, pressures.size(), pressure_precision::half};
+    write_pressures(queue, buffer, pressures);
+
+    snapshot_parameters params{};
+    params.region = make_full_region(descriptor, 2);
+    params.precision = snapshot_precision::float_32;
+    snapshot_reader reader{cc, descriptor, params, pressure_precision::half};
+
+    auto expected = select(pressures, params.region);
+    for (auto& i : expected) {
+        i = from_half(to_half(i));
+    }
+    ASSERT_EQ(to_float(reader(queue, buffer, 0)), expected);
+
+    //  A reader for single-precision buffers can't read this one.
+    snapshot_reader single{cc, descriptor, params};
+    ASSERT_THROW(single(queue, buffer, 0), std::exception);
+}
+
+TEST(snapshot, node_positions) {
+    const auto region = make_slice_region(descriptor, 2, 1, 3);
+    const auto positions = compute_node_positions(descriptor, region);
+    ASSERT_EQ(positions.size(), 3 * 2);
+
+    //  x-major, like the snapshot values.
+    ASSERT_EQ(positions[0], compute_position(descriptor, glm::ivec3{0, 0, 1}));
+    ASSERT_EQ(positions[1], compute_position(descriptor, glm::ivec3{3, 0, 1}));
+    ASSERT_EQ(positions[3], compute_position(descriptor, glm::ivec3{0, 3, 1}));
+}
+
+TEST(snapshot, interval) {
+    const compute_context cc{};
+    snapshot_parameters params{};
+    params.region = make_full_region(descriptor);
+    params.interval = 3;
+    const snapshot_reader reader{cc, descriptor, params};
+    ASSERT_TRUE(reader.is_due(0));
+    ASSERT_FALSE(reader.is_due(1));
+    ASSERT_FALSE(reader.is_due(2));
+    ASSERT_TRUE(reader.is_due(3));
+}
+
+TEST(snapshot, invalid_region) {
+    const compute_context cc{};
+    snapshot_parameters params{};
+    params.region = make_full_region(descriptor);
+    params.region.end.x += 1;
+    ASSERT_THROW((snapshot_reader{cc, descriptor, params}), std::exception);
+}
+
+}  // namespace
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "waveguide/fitted_boundary.h"
+#include "waveguide/mesh.h"
+#include "waveguide/postprocessor/node.h"
+#include "waveguide/preprocessor/hard_source.h"
+#include "waveguide/waveguide.h"
+
+#include "core/callback_accumulator.h"
+#include "core/geo/box.h"
+#include "core/gpu_scene_data.h"
+#include "core/spatial_division/voxelised_scene_data.h"
+
+//  Fixtures shared by the waveguide tests.
+//  Most tests run a small box, which is quick to simulate but still has
+//  every kind of node in it.
+
+namespace wayverb {
+namespace waveguide {
+namespace test {
+
+inline auto make_test_scene() {
+    return core::geo::get_scene_data(
+            core::geo::box{glm::vec3{0}, glm::vec3{2, 1.5, 1}},
+            core::make_surface<core::simulation_bands>(0.1, 0));
+}
+
+/// Meshes a scene, anchored at the centre of the test box.
+/// Every surface gets the same flat reflectance, which callers can replace.
+inline mesh make_test_mesh(const core::compute_context& cc,
+                           const core::gpu_scene_data& scene,
+                           scheme s = scheme::rectilinear,
+                           cl_int brick_size = 0,
+                           double sample_rate = 10000) {
+    auto ret = compute_voxels_and_mesh(cc,
+                                       scene,
+                                       glm::vec3{1, 0.75, 0.5},
+                                       sample_rate,
+                                       340,
+                                       node_classifier::scanline,
+                                       s,
+                                       brick_size)
+                       .mesh;
+    ret.set_coefficients(to_flat_coefficients(0.1));
+    return ret;
+}
+
+inline mesh make_test_mesh(const core::compute_context& cc,
+                           scheme s = scheme::rectilinear,
+                           cl_int brick_size = 0) {
+    return make_test_mesh(cc, make_test_scene(), s, brick_size);
+}
+
+inline size_t test_source(const mesh& mesh) {
+    return compute_index(mesh.get_descriptor(), glm::vec3{0.5, 0.75, 0.5});
+}
+
+inline size_t test_receiver(const mesh& mesh) {
+    return compute_index(mesh.get_descriptor(), glm::vec3{1.5, 0.75, 0.5});
+}
+
+/// A unit impulse, followed by silence.
+inline util::aligned::vector<float> make_test_input(size_t steps) {
+    util::aligned::vector<float> ret(steps, 0);
+    ret.front() = 1;
+    return ret;
+}
+
+struct test_run final {
+    util::aligned::vector<util::aligned::vector<float>> probes;
+    mesh_state state;
+};
+
+/// Drives a mesh with a hard source, recording the pressure at each probe and
+/// the state of the mesh after the last step.
+/// When resuming, the input is still indexed from the start of the run.
+inline test_run run_test_mesh(
+        const core::compute_context& cc,
+        const mesh& mesh,
+        size_t source_index,
+        const util::aligned::vector<float>& input,
+        const util::aligned::vector<size_t>& probes,
+        const mesh_state& initial = mesh_state{},
+        boundary_layout layout = boundary_layout::array_of_structs,
+        pressure_precision precision = pressure_precision::single) {
+    util::aligned::vector<core::callback_accumulator<postprocessor::node>>
+            outputs;
+    for (const auto& i : probes) {
+        outputs.emplace_back(i);
+    }
+
+    test_run ret;
+    run(cc,
+        mesh,
+        preprocessor::make_hard_source(
+                source_index, begin(input) + initial.step, end(input)),
+        [&](auto& queue, const auto& buffer, auto step) {
+            for (auto& i : outputs) {
+                i(queue, buffer, step);
+            }
+        },
+        true,
+        initial,
+        input.size(),
+        [&](auto state, auto ready) {
+            ready.wait();
+            ret.state = std::move(state);
+        },
+        layout,
+        precision);
+
+    for (const auto& i : outputs) {
+        ret.probes.emplace_back(i.get_output());
+    }
+    return ret;
+}
+
+/// Runs the usual impulse from the test source, and records it at the test
+/// receiver.
+inline test_run run_test_mesh(
+        const core::compute_context& cc,
+        const mesh& mesh,
+        size_t steps,
+        const mesh_state& initial = mesh_state{},
+        boundary_layout layout = boundary_layout::array_of_structs,
+        pressure_precision precision = pressure_precision::single) {
+    return run_test_mesh(cc,
+                         mesh,
+                         test_source(mesh),
+                         make_test_input(steps),
+                         {test_receiver(mesh)},
+                         initial,
+                         layout,
+                         precision);
+}
+
+}  // namespace test
+}  // namespace waveguide
+}  // namespace wayverb
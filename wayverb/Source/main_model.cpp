@@ -129,8 +129,6 @@ public:
                       make_queue_forwarding_call(engine_state_changed_))}
             , node_positions_changed_connection_{engine_.connect_waveguide_node_positions_changed(
                       make_queue_forwarding_call(node_positions_changed_))}
-            , node_pressures_changed_connection_{engine_.connect_waveguide_node_pressures_changed(
-                      make_queue_forwarding_call(node_pressures_changed_))}
             , reflections_generated_connection_{engine_.connect_raytracer_reflections_generated(
                       make_queue_forwarding_call(reflections_generated_))}
             , encountered_error_connection_{engine_.connect_encountered_error(
@@ -162,9 +160,17 @@ public:
         return node_positions_changed_.connect(std::move(t));
     }
 
-    waveguide_node_pressures_changed::connection connect_node_pressures(
-            waveguide_node_pressures_changed::callback_type t) {
-        return node_pressures_changed_.connect(std::move(t));
+    waveguide_pressure_snapshot_taken::connection connect_pressure_snapshots(
+            snapshot_parameters_factory factory,
+            waveguide_pressure_snapshot_taken::callback_type t) {
+        //  Replacing the engine connection drops the old parameters.
+        pressure_snapshot_taken_connection_ =
+                waveguide_pressure_snapshot_taken::scoped_connection{
+                        engine_.connect_waveguide_pressure_snapshot_taken(
+                                std::move(factory),
+                                make_queue_forwarding_call(
+                                        pressure_snapshot_taken_))};
+        return pressure_snapshot_taken_.connect(std::move(t));
     }
 
     raytracer_reflections_generated::connection connect_reflections(
@@ -215,9 +221,9 @@ private:
     waveguide_node_positions_changed::scoped_connection
             node_positions_changed_connection_;
 
-    waveguide_node_pressures_changed node_pressures_changed_;
-    waveguide_node_pressures_changed::scoped_connection
-            node_pressures_changed_connection_;
+    waveguide_pressure_snapshot_taken pressure_snapshot_taken_;
+    waveguide_pressure_snapshot_taken::scoped_connection
+            pressure_snapshot_taken_connection_;
 
     raytracer_reflections_generated reflections_generated_;
     raytracer_reflections_generated::scoped_connection
@@ -286,10 +292,12 @@ main_model::connect_node_positions(
     return pimpl_->connect_node_positions(std::move(t));
 }
 
-main_model::waveguide_node_pressures_changed::connection
-main_model::connect_node_pressures(
-        waveguide_node_pressures_changed::callback_type t) {
-    return pimpl_->connect_node_pressures(std::move(t));
+main_model::waveguide_pressure_snapshot_taken::connection
+main_model::connect_pressure_snapshots(
+        snapshot_parameters_factory factory,
+        waveguide_pressure_snapshot_taken::callback_type t) {
+    return pimpl_->connect_pressure_snapshots(std::move(factory),
+                                              std::move(t));
 }
 
 main_model::raytracer_reflections_generated::connection
@@ -89,10 +89,16 @@ public:
     waveguide_node_positions_changed::connection connect_node_positions(
             waveguide_node_positions_changed::callback_type t);
 
-    using waveguide_node_pressures_changed = wayverb::combined::
-            complete_engine::waveguide_node_pressures_changed;
-    waveguide_node_pressures_changed::connection connect_node_pressures(
-            waveguide_node_pressures_changed::callback_type t);
+    using snapshot_parameters_factory = wayverb::combined::
+            complete_engine::snapshot_parameters_factory;
+    using waveguide_pressure_snapshot_taken = wayverb::combined::
+            complete_engine::waveguide_pressure_snapshot_taken;
+    /// The engine only takes snapshots once something has connected.
+    /// All listeners get snapshots with the parameters from the most recent
+    /// call.
+    waveguide_pressure_snapshot_taken::connection connect_pressure_snapshots(
+            snapshot_parameters_factory factory,
+            waveguide_pressure_snapshot_taken::callback_type t);
 
     using raytracer_reflections_generated =
             wayverb::combined::complete_engine::raytracer_reflections_generated;
@@ -11,14 +11,44 @@
 
 #include "../UtilityComponents/generic_renderer.h"
 
+#include "waveguide/snapshot.h"
+
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_inverse.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtc/quaternion.hpp"
 #include "glm/gtc/type_ptr.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 namespace scene {
 
+namespace {
+
+//  The view only needs enough nodes to show the shape of the wavefront, so
+//  large meshes are decimated to roughly this many nodes, and only every few
+//  steps are shown.
+//  Pressures are drawn with an opacity proportional to their magnitude, so
+//  the default 8-bit snapshots lose nothing visible.
+constexpr auto max_visualised_nodes = size_t{1} << 18;
+constexpr auto visualised_interval = size_t{4};
+
+wayverb::waveguide::snapshot_parameters visualised_snapshot(
+        const wayverb::waveguide::mesh_descriptor& descriptor) {
+    const auto nodes = wayverb::waveguide::compute_num_nodes(descriptor);
+    const auto stride = std::max(
+            1,
+            static_cast<int>(std::ceil(std::cbrt(
+                    nodes / static_cast<double>(max_visualised_nodes)))));
+    wayverb::waveguide::snapshot_parameters ret{};
+    ret.region = wayverb::waveguide::make_full_region(descriptor, stride);
+    ret.interval = visualised_interval;
+    return ret;
+}
+
+}  // namespace
+
 class master::impl final : public Component, public generic_renderer<view>::Listener, public SettableTooltipClient {
 public:
     impl(main_model& model)
@@ -52,18 +82,21 @@ public:
                                                 renderer.set_node_positions(
                                                         wayverb::waveguide::
                                                                 compute_node_positions(
-                                                                        d));
+                                                                        d, visualised_snapshot(d).region));
                                             });
                                         })};
 
-                        pressures_changed_ = main_model::waveguide_node_pressures_changed::scoped_connection{
-                                        model_.connect_node_pressures([this](
-                                                auto pressures, auto distance) {
+                        //  Only the nodes which will be drawn are read
+                        //  back from the device (see visualised_snapshot).
+                        pressures_changed_ = main_model::waveguide_pressure_snapshot_taken::scoped_connection{
+                                        model_.connect_pressure_snapshots(
+                                                visualised_snapshot,
+                                                [this](auto snapshot, auto distance) {
                                             view_.low_priority_command([
-                                                p = std::move(pressures),
+                                                s = std::move(snapshot),
                                                 d = distance
                                             ](auto& renderer) {
-                                                renderer.set_node_pressures(std::move(p));
+                                                renderer.set_node_pressures(wayverb::waveguide::to_float(s));
                                                 renderer.set_distance_travelled(d);
                                             });
                                         })};
@@ -82,7 +115,7 @@ public:
 
                     } else {
                         positions_changed_     = main_model::waveguide_node_positions_changed::scoped_connection{};
-                        pressures_changed_     = main_model::waveguide_node_pressures_changed::scoped_connection{};
+                        pressures_changed_     = main_model::waveguide_pressure_snapshot_taken::scoped_connection{};
                         reflections_generated_ = main_model::raytracer_reflections_generated::scoped_connection{};
                         view_.high_priority_command([](auto& renderer) { renderer.clear(); });
                     }
@@ -209,7 +242,7 @@ private:
             receivers_connection_;
 
     main_model::waveguide_node_positions_changed::scoped_connection positions_changed_;
-    main_model::waveguide_node_pressures_changed::scoped_connection pressures_changed_;
+    main_model::waveguide_pressure_snapshot_taken::scoped_connection pressures_changed_;
     main_model::raytracer_reflections_generated::scoped_connection reflections_generated_;
     main_model::begun::scoped_connection begun_;
     main_model::finished::scoped_connection finished_;